@@ -0,0 +1,55 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+public class ClassForNameBenchmark {
+    public static class TestClass {}
+
+    // A class that is already loaded, found in the class loader's class table.
+    public void timeClassForNameLoaded(int count) throws Exception {
+        ClassLoader loader = ClassForNameBenchmark.class.getClassLoader();
+        for (int i = 0; i < count; ++i) {
+            $noinline$foo(Class.forName("ClassForNameBenchmark$TestClass", false, loader));
+        }
+    }
+
+    // A class in the boot class path, looked up through the application class loader.
+    public void timeClassForNameBoot(int count) throws Exception {
+        ClassLoader loader = ClassForNameBenchmark.class.getClassLoader();
+        for (int i = 0; i < count; ++i) {
+            $noinline$foo(Class.forName("java.util.ArrayList", false, loader));
+        }
+    }
+
+    // Probing for an optional class that does not exist, as done by reflection-heavy libraries.
+    // Searches every dex file of the class loader chain unless the miss is cached.
+    public void timeClassForNameMissing(int count) {
+        ClassLoader loader = ClassForNameBenchmark.class.getClassLoader();
+        for (int i = 0; i < count; ++i) {
+            try {
+                $noinline$foo(Class.forName("ClassForNameBenchmark$NoSuchClass", false, loader));
+            } catch (ClassNotFoundException expected) {
+                // Expected.
+            }
+        }
+    }
+
+    static void $noinline$foo(Class<?> c) {
+        if (doThrow) { throw new Error(); }
+    }
+
+    public static boolean doThrow = false;
+}
@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+public class InterfaceDispatchBenchmark {
+    // An interface with few methods, each method gets its own IMT slot.
+    public interface SmallInterface {
+        int m0();
+        int m1();
+        int m2();
+    }
+
+    public static class SmallImpl implements SmallInterface {
+        public int m0() { return 0; }
+        public int m1() { return 1; }
+        public int m2() { return 2; }
+    }
+
+    // LargeInterface has 512 methods, so that calls go through hashed ImtConflictTables. It and
+    // LargeImpl are generated into src/ by util-src/generate_java.py.
+    private final SmallInterface small = new SmallImpl();
+    private final LargeInterface large = new LargeImpl();
+
+    public void timeSmallInterface(int count) {
+        SmallInterface s = small;
+        int sum = 0;
+        for (int i = 0; i < count; ++i) {
+            sum += s.m0();
+            sum += s.m1();
+            sum += s.m2();
+        }
+        $noinline$use(sum);
+    }
+
+    public void timeLargeInterfaceFirstMethods(int count) {
+        LargeInterface l = large;
+        int sum = 0;
+        for (int i = 0; i < count; ++i) {
+            sum += l.m000();
+            sum += l.m001();
+            sum += l.m002();
+        }
+        $noinline$use(sum);
+    }
+
+    public void timeLargeInterfaceLastMethods(int count) {
+        LargeInterface l = large;
+        int sum = 0;
+        for (int i = 0; i < count; ++i) {
+            sum += l.m509();
+            sum += l.m510();
+            sum += l.m511();
+        }
+        $noinline$use(sum);
+    }
+
+    public void timeLargeInterfaceManyMethods(int count) {
+        LargeInterface l = large;
+        int sum = 0;
+        for (int i = 0; i < count; ++i) {
+            sum += l.m007();
+            sum += l.m100();
+            sum += l.m233();
+            sum += l.m318();
+            sum += l.m421();
+            sum += l.m505();
+        }
+        $noinline$use(sum);
+    }
+
+    private static void $noinline$use(int value) {
+        if (doThrow) { throw new Error(Integer.toString(value)); }
+    }
+
+    public static boolean doThrow = false;
+}
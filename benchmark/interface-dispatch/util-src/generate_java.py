@@ -0,0 +1,74 @@
+#!/usr/bin/python3
+#
+# Copyright (C) 2017 The Android Open Source Project
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""
+Generate the large interface and its implementation used by InterfaceDispatchBenchmark.
+"""
+
+import os
+import sys
+
+# With 43 IMT slots, each slot has about 12 conflicting methods, so calls go
+# through hashed ImtConflictTables. InterfaceDispatchBenchmark calls methods up
+# to m511.
+NUM_METHODS = 512
+
+COPYRIGHT = """/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Generated by util-src/generate_java.py, do not edit.
+"""
+
+def method_name(i):
+  return "m{:03d}".format(i)
+
+def write_java_file(out_dir, class_name, body):
+  with open(os.path.join(out_dir, class_name + ".java"), "w") as f:
+    f.write(COPYRIGHT)
+    f.write(body)
+
+def main(argv):
+  if len(argv) != 2:
+    print("Usage: {} <output dir>".format(argv[0]), file=sys.stderr)
+    sys.exit(1)
+  out_dir = argv[1]
+  os.makedirs(out_dir, exist_ok=True)
+  methods = range(NUM_METHODS)
+  write_java_file(out_dir, "LargeInterface",
+                  "public interface LargeInterface {\n" +
+                  "".join("    int {}();\n".format(method_name(i)) for i in methods) +
+                  "}\n")
+  write_java_file(out_dir, "LargeImpl",
+                  "public class LargeImpl implements LargeInterface {\n" +
+                  "".join("    public int {}() {{ return {}; }}\n".format(method_name(i), i)
+                          for i in methods) +
+                  "}\n")
+
+if __name__ == "__main__":
+  main(sys.argv)
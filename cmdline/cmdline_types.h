@@ -729,6 +729,12 @@ struct CmdlineType<ProfileSaverOptions> : CmdlineTypeParser<ProfileSaverOptions>
              &ProfileSaverOptions::startup_method_samples_,
              type_parser.Parse(suffix));
     }
+    if (android::base::StartsWith(option, "hot-startup-method-samples:")) {
+      CmdlineType<unsigned int> type_parser;
+      return ParseInto(existing,
+             &ProfileSaverOptions::hot_startup_method_samples_,
+             type_parser.Parse(suffix));
+    }
     if (android::base::StartsWith(option, "min-methods-to-save:")) {
       CmdlineType<unsigned int> type_parser;
       return ParseInto(existing,
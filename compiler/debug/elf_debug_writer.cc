@@ -88,27 +88,62 @@ void WriteDebugInfo(ElfBuilder<ElfTypes>* builder,
   }
 }
 
-std::vector<uint8_t> MakeMiniDebugInfo(
+std::vector<uint8_t> MakeMiniDebugInfoElf(
     InstructionSet isa,
     const InstructionSetFeatures* features,
     size_t rodata_size,
     size_t text_size,
     const ArrayRef<const MethodDebugInfo>& method_infos) {
   if (Is64BitInstructionSet(isa)) {
-    return MakeMiniDebugInfoInternal<ElfTypes64>(isa,
-                                                 features,
-                                                 rodata_size,
-                                                 text_size,
-                                                 method_infos);
+    return MakeMiniDebugInfoElfInternal<ElfTypes64>(isa,
+                                                    features,
+                                                    rodata_size,
+                                                    text_size,
+                                                    method_infos);
   } else {
-    return MakeMiniDebugInfoInternal<ElfTypes32>(isa,
-                                                 features,
-                                                 rodata_size,
-                                                 text_size,
-                                                 method_infos);
+    return MakeMiniDebugInfoElfInternal<ElfTypes32>(isa,
+                                                    features,
+                                                    rodata_size,
+                                                    text_size,
+                                                    method_infos);
   }
 }
 
+size_t GetMiniDebugInfoBlockCount(const std::vector<uint8_t>& elf_file) {
+  return GetXzBlockCount(elf_file.size());
+}
+
+void PrepareMiniDebugInfoCompression() {
+  XzInitTables();
+}
+
+void CompressMiniDebugInfoBlock(const std::vector<uint8_t>& elf_file,
+                                size_t block_index,
+                                std::vector<uint8_t>* compressed_block) {
+  XzCompressBlock(&elf_file, block_index, compressed_block);
+}
+
+std::vector<uint8_t> JoinMiniDebugInfoBlocks(
+    const std::vector<std::vector<uint8_t>>& compressed_blocks) {
+  std::vector<uint8_t> result;
+  XzJoinBlocks(compressed_blocks, &result);
+  return result;
+}
+
+std::vector<uint8_t> MakeMiniDebugInfo(
+    InstructionSet isa,
+    const InstructionSetFeatures* features,
+    size_t rodata_size,
+    size_t text_size,
+    const ArrayRef<const MethodDebugInfo>& method_infos) {
+  std::vector<uint8_t> elf_file =
+      MakeMiniDebugInfoElf(isa, features, rodata_size, text_size, method_infos);
+  std::vector<uint8_t> compressed_buffer;
+  compressed_buffer.reserve(elf_file.size() / 4);
+  XzCompress(&elf_file, &compressed_buffer);
+  return compressed_buffer;
+}
+
 template <typename ElfTypes>
 static std::vector<uint8_t> WriteDebugElfFileForMethodsInternal(
     InstructionSet isa,
@@ -47,6 +47,30 @@ std::vector<uint8_t> MakeMiniDebugInfo(
     size_t text_section_size,
     const ArrayRef<const MethodDebugInfo>& method_infos);
 
+// The steps of MakeMiniDebugInfo(), exposed so that the compression can be spread
+// over several threads. MakeMiniDebugInfoElf() writes the uncompressed ELF file, which
+// is then compressed in GetMiniDebugInfoBlockCount() independent blocks. Joining the
+// compressed blocks with JoinMiniDebugInfoBlocks() gives the same result as
+// MakeMiniDebugInfo(). PrepareMiniDebugInfoCompression() must be called before compressing
+// any block.
+std::vector<uint8_t> MakeMiniDebugInfoElf(
+    InstructionSet isa,
+    const InstructionSetFeatures* features,
+    size_t rodata_section_size,
+    size_t text_section_size,
+    const ArrayRef<const MethodDebugInfo>& method_infos);
+
+size_t GetMiniDebugInfoBlockCount(const std::vector<uint8_t>& elf_file);
+
+void PrepareMiniDebugInfoCompression();
+
+void CompressMiniDebugInfoBlock(const std::vector<uint8_t>& elf_file,
+                                size_t block_index,
+                                std::vector<uint8_t>* compressed_block);
+
+std::vector<uint8_t> JoinMiniDebugInfoBlocks(
+    const std::vector<std::vector<uint8_t>>& compressed_blocks);
+
 std::vector<uint8_t> WriteDebugElfFileForMethods(
     InstructionSet isa,
     const InstructionSetFeatures* features,
@@ -20,6 +20,7 @@
 #include <vector>
 
 #include "arch/instruction_set.h"
+#include "base/bit_utils.h"
 #include "elf_builder.h"
 #include "linker/vector_output_stream.h"
 
@@ -31,10 +32,31 @@
 namespace art {
 namespace debug {
 
-static void XzCompress(const std::vector<uint8_t>* src, std::vector<uint8_t>* dst) {
-  // Configure the compression library.
+// The mini-debug-info is compressed in blocks of this many input bytes. Each block is
+// encoded as a standalone xz stream, and XzJoinBlocks() then moves the xz blocks of all
+// streams into a single stream with one index. Readers of .gnu_debugdata such as gdb and
+// libunwind only decode one stream. The block boundaries depend only on the input size,
+// so the output is the same however many threads compress the blocks.
+static constexpr size_t kXzBlockSize = 256 * KB;
+
+static size_t GetXzBlockCount(size_t src_size) {
+  return std::max<size_t>(RoundUp(src_size, kXzBlockSize) / kXzBlockSize, 1u);
+}
+
+// Generates the global CRC tables used by the encoder. Must be called before
+// XzCompressBlock() since the tables are shared by all compressing threads.
+static void XzInitTables() {
   CrcGenerateTable();
   Crc64GenerateTable();
+}
+
+static void XzCompressBlock(const std::vector<uint8_t>* src,
+                            size_t block_index,
+                            std::vector<uint8_t>* dst) {
+  DCHECK_LT(block_index, GetXzBlockCount(src->size()));
+  const size_t src_begin = block_index * kXzBlockSize;
+  const size_t src_end = std::min(src_begin + kXzBlockSize, src->size());
+  // Configure the compression library.
   CLzma2EncProps lzma2Props;
   Lzma2EncProps_Init(&lzma2Props);
   lzma2Props.lzmaProps.level = 1;  // Fast compression.
@@ -46,7 +68,7 @@ static void XzCompress(const std::vector<uint8_t>* src, std::vector<uint8_t>* ds
   struct XzCallbacks : public ISeqInStream, public ISeqOutStream, public ICompressProgress {
     static SRes ReadImpl(void* p, void* buf, size_t* size) {
       auto* ctx = static_cast<XzCallbacks*>(reinterpret_cast<ISeqInStream*>(p));
-      *size = std::min(*size, ctx->src_->size() - ctx->src_pos_);
+      *size = std::min(*size, ctx->src_end_ - ctx->src_pos_);
       memcpy(buf, ctx->src_->data() + ctx->src_pos_, *size);
       ctx->src_pos_ += *size;
       return SZ_OK;
@@ -61,6 +83,7 @@ static void XzCompress(const std::vector<uint8_t>* src, std::vector<uint8_t>* ds
       return SZ_OK;
     }
     size_t src_pos_;
+    size_t src_end_;
     const std::vector<uint8_t>* src_;
     std::vector<uint8_t>* dst_;
   };
@@ -68,7 +91,8 @@ static void XzCompress(const std::vector<uint8_t>* src, std::vector<uint8_t>* ds
   callbacks.Read = XzCallbacks::ReadImpl;
   callbacks.Write = XzCallbacks::WriteImpl;
   callbacks.Progress = XzCallbacks::ProgressImpl;
-  callbacks.src_pos_ = 0;
+  callbacks.src_pos_ = src_begin;
+  callbacks.src_end_ = src_end;
   callbacks.src_ = src;
   callbacks.dst_ = dst;
   // Compress.
@@ -76,8 +100,109 @@ static void XzCompress(const std::vector<uint8_t>* src, std::vector<uint8_t>* ds
   CHECK_EQ(res, SZ_OK);
 }
 
+// Sizes of the xz stream header and footer, and of their CRC32 fields.
+static constexpr size_t kXzStreamHeaderSize = 12u;
+static constexpr size_t kXzStreamFooterSize = 12u;
+static constexpr size_t kXzCrc32Size = 4u;
+static constexpr size_t kXzStreamFlagsSize = 2u;
+static constexpr size_t kXzStreamMagicSize = 6u;
+
+static uint32_t XzReadUint32(const uint8_t* data) {
+  return static_cast<uint32_t>(data[0]) |
+      (static_cast<uint32_t>(data[1]) << 8) |
+      (static_cast<uint32_t>(data[2]) << 16) |
+      (static_cast<uint32_t>(data[3]) << 24);
+}
+
+static void XzWriteUint32(std::vector<uint8_t>* dst, uint32_t value) {
+  for (size_t i = 0; i != sizeof(uint32_t); ++i) {
+    dst->push_back(static_cast<uint8_t>(value >> (i * kBitsPerByte)));
+  }
+}
+
+static uint64_t XzReadVarInt(const std::vector<uint8_t>& data, size_t* pos) {
+  uint64_t value = 0u;
+  for (size_t shift = 0; ; shift += 7) {
+    CHECK_LT(*pos, data.size());
+    CHECK_LT(shift, 63u);
+    uint8_t byte = data[(*pos)++];
+    value |= static_cast<uint64_t>(byte & 0x7fu) << shift;
+    if ((byte & 0x80u) == 0u) {
+      return value;
+    }
+  }
+}
+
+static void XzWriteVarInt(std::vector<uint8_t>* dst, uint64_t value) {
+  while (value >= 0x80u) {
+    dst->push_back(static_cast<uint8_t>(value) | 0x80u);
+    value >>= 7;
+  }
+  dst->push_back(static_cast<uint8_t>(value));
+}
+
+// Joins the xz streams written by XzCompressBlock() into a single stream: the stream header
+// of the first one, the xz blocks of all of them in order, and an index listing every block.
+// Joining a single stream writes it back unchanged.
+static void XzJoinBlocks(const std::vector<std::vector<uint8_t>>& streams,
+                         std::vector<uint8_t>* dst) {
+  DCHECK(!streams.empty());
+  const std::vector<uint8_t>& first = streams.front();
+  CHECK_GE(first.size(), kXzStreamHeaderSize + kXzStreamFooterSize);
+  dst->insert(dst->end(), first.begin(), first.begin() + kXzStreamHeaderSize);
+  // Index indicator, number of records, then the unpadded and uncompressed size of each block.
+  std::vector<uint8_t> records;
+  uint64_t num_records = 0u;
+  for (const std::vector<uint8_t>& stream : streams) {
+    CHECK_GE(stream.size(), kXzStreamHeaderSize + kXzStreamFooterSize);
+    // All the streams use the same flags, which are repeated in the footer.
+    CHECK_EQ(memcmp(stream.data(), first.data(), kXzStreamHeaderSize), 0);
+    const uint8_t* footer = stream.data() + stream.size() - kXzStreamFooterSize;
+    const size_t index_size = (static_cast<size_t>(XzReadUint32(footer + kXzCrc32Size)) + 1u) * 4u;
+    CHECK_LE(index_size, stream.size() - kXzStreamHeaderSize - kXzStreamFooterSize);
+    const size_t index_begin = stream.size() - kXzStreamFooterSize - index_size;
+    dst->insert(dst->end(), stream.begin() + kXzStreamHeaderSize, stream.begin() + index_begin);
+    size_t pos = index_begin;
+    CHECK_EQ(stream[pos], 0u);  // Index indicator.
+    ++pos;
+    uint64_t stream_records = XzReadVarInt(stream, &pos);
+    for (uint64_t i = 0; i != stream_records; ++i) {
+      XzWriteVarInt(&records, XzReadVarInt(stream, &pos));  // Unpadded size.
+      XzWriteVarInt(&records, XzReadVarInt(stream, &pos));  // Uncompressed size.
+    }
+    num_records += stream_records;
+  }
+  std::vector<uint8_t> index;
+  index.push_back(0u);
+  XzWriteVarInt(&index, num_records);
+  index.insert(index.end(), records.begin(), records.end());
+  while (index.size() % 4u != 0u) {
+    index.push_back(0u);
+  }
+  XzWriteUint32(&index, CrcCalc(index.data(), index.size()));
+  dst->insert(dst->end(), index.begin(), index.end());
+  // Stream footer: CRC32 of the backward size and flags, backward size, flags and magic.
+  std::vector<uint8_t> footer;
+  XzWriteUint32(&footer, static_cast<uint32_t>(index.size() / 4u - 1u));
+  const uint8_t* flags = first.data() + kXzStreamMagicSize;
+  footer.insert(footer.end(), flags, flags + kXzStreamFlagsSize);
+  XzWriteUint32(dst, CrcCalc(footer.data(), footer.size()));
+  dst->insert(dst->end(), footer.begin(), footer.end());
+  dst->push_back('Y');
+  dst->push_back('Z');
+}
+
+static void XzCompress(const std::vector<uint8_t>* src, std::vector<uint8_t>* dst) {
+  XzInitTables();
+  std::vector<std::vector<uint8_t>> streams(GetXzBlockCount(src->size()));
+  for (size_t i = 0; i != streams.size(); ++i) {
+    XzCompressBlock(src, i, &streams[i]);
+  }
+  XzJoinBlocks(streams, dst);
+}
+
 template <typename ElfTypes>
-static std::vector<uint8_t> MakeMiniDebugInfoInternal(
+static std::vector<uint8_t> MakeMiniDebugInfoElfInternal(
     InstructionSet isa,
     const InstructionSetFeatures* features,
     size_t rodata_section_size,
@@ -99,10 +224,7 @@ static std::vector<uint8_t> MakeMiniDebugInfoInternal(
                   false /* write_oat_paches */);
   builder->End();
   CHECK(builder->Good());
-  std::vector<uint8_t> compressed_buffer;
-  compressed_buffer.reserve(buffer.size() / 4);
-  XzCompress(&buffer, &compressed_buffer);
-  return compressed_buffer;
+  return buffer;
 }
 
 }  // namespace debug
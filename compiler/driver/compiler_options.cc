@@ -47,6 +47,7 @@ CompilerOptions::CompilerOptions()
       init_failure_output_(nullptr),
       dump_cfg_file_name_(""),
       dump_cfg_append_(false),
+      dump_compile_report_file_name_(""),
       force_determinism_(false),
       register_allocation_strategy_(RegisterAllocator::kRegisterAllocatorDefault),
       passes_to_run_(nullptr) {
@@ -108,6 +109,7 @@ CompilerOptions::CompilerOptions(CompilerFilter::Filter compiler_filter,
       init_failure_output_(init_failure_output),
       dump_cfg_file_name_(dump_cfg_file_name),
       dump_cfg_append_(dump_cfg_append),
+      dump_compile_report_file_name_(""),
       force_determinism_(force_determinism),
       register_allocation_strategy_(regalloc_strategy),
       passes_to_run_(passes_to_run) {
@@ -218,6 +220,8 @@ bool CompilerOptions::ParseCompilerOption(const StringPiece& option, UsageFn Usa
     dump_cfg_file_name_ = option.substr(strlen("--dump-cfg=")).data();
   } else if (option.starts_with("--dump-cfg-append")) {
     dump_cfg_append_ = true;
+  } else if (option.starts_with("--dump-compile-report=")) {
+    dump_compile_report_file_name_ = option.substr(strlen("--dump-compile-report=")).data();
   } else if (option.starts_with("--register-allocation-strategy=")) {
     ParseRegisterAllocationStrategy(option, Usage);
   } else {
@@ -265,6 +265,10 @@ class CompilerOptions FINAL {
     return dump_cfg_append_;
   }
 
+  const std::string& GetDumpCompileReportFileName() const {
+    return dump_compile_report_file_name_;
+  }
+
   bool IsForceDeterminism() const {
     return force_determinism_;
   }
@@ -330,6 +334,10 @@ class CompilerOptions FINAL {
   std::string dump_cfg_file_name_;
   bool dump_cfg_append_;
 
+  // If not empty, the optimizing compiler appends a per-method compile-time and
+  // memory report to this file.
+  std::string dump_compile_report_file_name_;
+
   // Whether the compiler should trade performance for determinism to guarantee exactly reproducible
   // outcomes.
   bool force_determinism_;
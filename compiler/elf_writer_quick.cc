@@ -55,33 +55,62 @@ class DebugInfoTask : public Task {
                 const InstructionSetFeatures* features,
                 size_t rodata_section_size,
                 size_t text_section_size,
-                const ArrayRef<const debug::MethodDebugInfo>& method_infos)
+                const ArrayRef<const debug::MethodDebugInfo>& method_infos,
+                ThreadPool* thread_pool)
       : isa_(isa),
         instruction_set_features_(features),
         rodata_section_size_(rodata_section_size),
         text_section_size_(text_section_size),
-        method_infos_(method_infos) {
+        method_infos_(method_infos),
+        thread_pool_(thread_pool) {
   }
 
-  void Run(Thread*) {
-    result_ = debug::MakeMiniDebugInfo(isa_,
-                                       instruction_set_features_,
-                                       rodata_section_size_,
-                                       text_section_size_,
-                                       method_infos_);
+  void Run(Thread* self) {
+    elf_file_ = debug::MakeMiniDebugInfoElf(isa_,
+                                            instruction_set_features_,
+                                            rodata_section_size_,
+                                            text_section_size_,
+                                            method_infos_);
+    // Compress the blocks of the ELF file in parallel. The block boundaries
+    // do not depend on the number of threads, so neither does the output.
+    debug::PrepareMiniDebugInfoCompression();
+    compressed_blocks_.resize(debug::GetMiniDebugInfoBlockCount(elf_file_));
+    for (size_t i = 0; i != compressed_blocks_.size(); ++i) {
+      thread_pool_->AddTask(self, new CompressBlockTask(this, i));
+    }
   }
 
-  std::vector<uint8_t>* GetResult() {
-    return &result_;
+  // Must be called only after the thread pool has finished all tasks.
+  std::vector<uint8_t> GetResult() {
+    return debug::JoinMiniDebugInfoBlocks(compressed_blocks_);
   }
 
  private:
+  class CompressBlockTask : public SelfDeletingTask {
+   public:
+    CompressBlockTask(DebugInfoTask* owner, size_t block_index)
+        : owner_(owner), block_index_(block_index) {}
+
+    void Run(Thread*) OVERRIDE {
+      debug::CompressMiniDebugInfoBlock(owner_->elf_file_,
+                                        block_index_,
+                                        &owner_->compressed_blocks_[block_index_]);
+    }
+
+   private:
+    DebugInfoTask* const owner_;
+    const size_t block_index_;
+  };
+
   InstructionSet isa_;
   const InstructionSetFeatures* instruction_set_features_;
   size_t rodata_section_size_;
   size_t text_section_size_;
   const ArrayRef<const debug::MethodDebugInfo>& method_infos_;
-  std::vector<uint8_t> result_;
+  ThreadPool* const thread_pool_;
+  std::vector<uint8_t> elf_file_;
+  // Each block is written by exactly one CompressBlockTask.
+  std::vector<std::vector<uint8_t>> compressed_blocks_;
 };
 
 template <typename ElfTypes>
@@ -90,7 +119,8 @@ class ElfWriterQuick FINAL : public ElfWriter {
   ElfWriterQuick(InstructionSet instruction_set,
                  const InstructionSetFeatures* features,
                  const CompilerOptions* compiler_options,
-                 File* elf_file);
+                 File* elf_file,
+                 size_t thread_count);
   ~ElfWriterQuick();
 
   void Start() OVERRIDE;
@@ -119,6 +149,7 @@ class ElfWriterQuick FINAL : public ElfWriter {
   const InstructionSetFeatures* instruction_set_features_;
   const CompilerOptions* const compiler_options_;
   File* const elf_file_;
+  const size_t thread_count_;
   size_t rodata_size_;
   size_t text_size_;
   size_t bss_size_;
@@ -135,17 +166,20 @@ class ElfWriterQuick FINAL : public ElfWriter {
 std::unique_ptr<ElfWriter> CreateElfWriterQuick(InstructionSet instruction_set,
                                                 const InstructionSetFeatures* features,
                                                 const CompilerOptions* compiler_options,
-                                                File* elf_file) {
+                                                File* elf_file,
+                                                size_t thread_count) {
   if (Is64BitInstructionSet(instruction_set)) {
     return MakeUnique<ElfWriterQuick<ElfTypes64>>(instruction_set,
                                                   features,
                                                   compiler_options,
-                                                  elf_file);
+                                                  elf_file,
+                                                  thread_count);
   } else {
     return MakeUnique<ElfWriterQuick<ElfTypes32>>(instruction_set,
                                                   features,
                                                   compiler_options,
-                                                  elf_file);
+                                                  elf_file,
+                                                  thread_count);
   }
 }
 
@@ -153,11 +187,13 @@ template <typename ElfTypes>
 ElfWriterQuick<ElfTypes>::ElfWriterQuick(InstructionSet instruction_set,
                                          const InstructionSetFeatures* features,
                                          const CompilerOptions* compiler_options,
-                                         File* elf_file)
+                                         File* elf_file,
+                                         size_t thread_count)
     : ElfWriter(),
       instruction_set_features_(features),
       compiler_options_(compiler_options),
       elf_file_(elf_file),
+      thread_count_(thread_count),
       rodata_size_(0u),
       text_size_(0u),
       bss_size_(0u),
@@ -236,14 +272,15 @@ void ElfWriterQuick<ElfTypes>::PrepareDebugInfo(
   if (!method_infos.empty() && compiler_options_->GetGenerateMiniDebugInfo()) {
     // Prepare the mini-debug-info in background while we do other I/O.
     Thread* self = Thread::Current();
+    debug_info_thread_pool_ = std::unique_ptr<ThreadPool>(
+        new ThreadPool("Mini-debug-info writer", std::max<size_t>(thread_count_, 1u)));
     debug_info_task_ = std::unique_ptr<DebugInfoTask>(
         new DebugInfoTask(builder_->GetIsa(),
                           instruction_set_features_,
                           rodata_size_,
                           text_size_,
-                          method_infos));
-    debug_info_thread_pool_ = std::unique_ptr<ThreadPool>(
-        new ThreadPool("Mini-debug-info writer", 1));
+                          method_infos,
+                          debug_info_thread_pool_.get()));
     debug_info_thread_pool_->AddTask(self, debug_info_task_.get());
     debug_info_thread_pool_->StartWorkers(self);
   }
@@ -262,7 +299,8 @@ void ElfWriterQuick<ElfTypes>::WriteDebugInfo(
       Thread* self = Thread::Current();
       DCHECK(debug_info_thread_pool_ != nullptr);
       debug_info_thread_pool_->Wait(self, true, false);
-      builder_->WriteSection(".gnu_debugdata", debug_info_task_->GetResult());
+      std::vector<uint8_t> mini_debug_info = debug_info_task_->GetResult();
+      builder_->WriteSection(".gnu_debugdata", &mini_debug_info);
     }
   }
 }
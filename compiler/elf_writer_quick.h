@@ -31,7 +31,8 @@ class InstructionSetFeatures;
 std::unique_ptr<ElfWriter> CreateElfWriterQuick(InstructionSet instruction_set,
                                                 const InstructionSetFeatures* features,
                                                 const CompilerOptions* compiler_options,
-                                                File* elf_file);
+                                                File* elf_file,
+                                                size_t thread_count);
 
 }  // namespace art
 
@@ -224,7 +224,8 @@ void CompilationHelper::Compile(CompilerDriver* driver,
         elf_writers.emplace_back(CreateElfWriterQuick(driver->GetInstructionSet(),
                                                       driver->GetInstructionSetFeatures(),
                                                       &driver->GetCompilerOptions(),
-                                                      oat_file.GetFile()));
+                                                      oat_file.GetFile(),
+                                                      /* thread_count */ 1u));
         elf_writers.back()->Start();
         oat_writers.emplace_back(new OatWriter(/*compiling_boot_image*/true,
                                                &timings,
@@ -1805,15 +1805,13 @@ void ImageWriter::CopyAndFixupImTable(ImTable* orig, ImTable* copy) {
 }
 
 void ImageWriter::CopyAndFixupImtConflictTable(ImtConflictTable* orig, ImtConflictTable* copy) {
-  const size_t count = orig->NumEntries(target_ptr_size_);
-  for (size_t i = 0; i < count; ++i) {
-    ArtMethod* interface_method = orig->GetInterfaceMethod(i, target_ptr_size_);
-    ArtMethod* implementation_method = orig->GetImplementationMethod(i, target_ptr_size_);
-    copy->SetInterfaceMethod(i, target_ptr_size_, NativeLocationInImage(interface_method));
-    copy->SetImplementationMethod(i,
-                                  target_ptr_size_,
-                                  NativeLocationInImage(implementation_method));
-  }
+  // Copy the table as is, hashed tables keep their slots since they hash the dex method index.
+  memcpy(copy, orig, orig->ComputeSize(target_ptr_size_));
+  copy->Visit([this](const std::pair<ArtMethod*, ArtMethod*>& methods)
+      REQUIRES_SHARED(Locks::mutator_lock_) {
+    return std::make_pair(NativeLocationInImage(methods.first),
+                          NativeLocationInImage(methods.second));
+  }, target_ptr_size_);
 }
 
 void ImageWriter::CopyAndFixupNativeData(size_t oat_index) {
@@ -1869,9 +1867,7 @@ void ImageWriter::CopyAndFixupNativeData(size_t oat_index) {
       }
       case kNativeObjectRelocationTypeIMTConflictTable: {
         auto* orig_table = reinterpret_cast<ImtConflictTable*>(pair.first);
-        CopyAndFixupImtConflictTable(
-            orig_table,
-            new(dest)ImtConflictTable(orig_table->NumEntries(target_ptr_size_), target_ptr_size_));
+        CopyAndFixupImtConflictTable(orig_table, reinterpret_cast<ImtConflictTable*>(dest));
         break;
       }
     }
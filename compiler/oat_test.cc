@@ -186,7 +186,8 @@ class OatTest : public CommonCompilerTest {
         compiler_driver_->GetInstructionSet(),
         compiler_driver_->GetInstructionSetFeatures(),
         &compiler_driver_->GetCompilerOptions(),
-        oat_file);
+        oat_file,
+        /* thread_count */ 1u);
     elf_writer->Start();
     OutputStream* oat_rodata = elf_writer->StartRoData();
     std::unique_ptr<MemMap> opened_dex_files_map;
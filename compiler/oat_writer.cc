@@ -33,6 +33,7 @@
 #include "debug/method_debug_info.h"
 #include "dex/verification_results.h"
 #include "dex_file-inl.h"
+#include "dex_file_verifier.h"
 #include "dexlayout.h"
 #include "driver/compiler_driver.h"
 #include "driver/compiler_options.h"
@@ -278,7 +279,10 @@ class OatWriter::OatDexFile {
   DCHECK_EQ(static_cast<off_t>(file_offset + offset_), out->Seek(0, kSeekCurrent)) \
     << "file_offset=" << file_offset << " offset_=" << offset_
 
-OatWriter::OatWriter(bool compiling_boot_image, TimingLogger* timings, ProfileCompilationInfo* info)
+OatWriter::OatWriter(bool compiling_boot_image,
+                     TimingLogger* timings,
+                     ProfileCompilationInfo* info,
+                     bool share_dex_data)
   : write_state_(WriteState::kAddingDexFileSources),
     timings_(timings),
     raw_dex_files_(),
@@ -291,6 +295,7 @@ OatWriter::OatWriter(bool compiling_boot_image, TimingLogger* timings, ProfileCo
     dex_files_(nullptr),
     vdex_size_(0u),
     vdex_dex_files_offset_(0u),
+    vdex_shared_dex_data_size_(0u),
     vdex_verifier_deps_offset_(0u),
     vdex_quickening_info_offset_(0u),
     oat_size_(0u),
@@ -308,6 +313,7 @@ OatWriter::OatWriter(bool compiling_boot_image, TimingLogger* timings, ProfileCo
     size_oat_header_(0),
     size_oat_header_key_value_store_(0),
     size_dex_file_(0),
+    size_shared_dex_data_(0),
     size_verifier_deps_(0),
     size_verifier_deps_alignment_(0),
     size_quickening_info_(0),
@@ -342,7 +348,9 @@ OatWriter::OatWriter(bool compiling_boot_image, TimingLogger* timings, ProfileCo
     size_oat_class_method_offsets_(0),
     relative_patcher_(nullptr),
     absolute_patch_locations_(),
-    profile_compilation_info_(info) {
+    profile_compilation_info_(info),
+    share_dex_data_(share_dex_data),
+    input_shared_dex_data_() {
 }
 
 bool OatWriter::AddDexFileSource(const char* filename,
@@ -435,6 +443,11 @@ bool OatWriter::AddVdexDexFilesSource(const VdexFile& vdex_file,
     LOG(ERROR) << "Unexpected number of dex files in vdex " << location;
     return false;
   }
+  input_shared_dex_data_ = vdex_file.GetSharedDexData();
+  if (!input_shared_dex_data_.empty()) {
+    // The dex files can only be rewritten along with the data they share.
+    share_dex_data_ = true;
+  }
 
   if (oat_dex_files_.empty()) {
     LOG(ERROR) << "No dex files in vdex file created from " << location;
@@ -1902,6 +1915,7 @@ bool OatWriter::WriteCode(OutputStream* out) {
     DO_STAT(size_oat_header_);
     DO_STAT(size_oat_header_key_value_store_);
     DO_STAT(size_dex_file_);
+    DO_STAT(size_shared_dex_data_);
     DO_STAT(size_verifier_deps_);
     DO_STAT(size_verifier_deps_alignment_);
     DO_STAT(size_quickening_info_);
@@ -2151,6 +2165,10 @@ bool OatWriter::WriteDexFiles(OutputStream* out, File* file, bool update_input_v
 
   vdex_dex_files_offset_ = vdex_size_;
 
+  if (kIsVdexEnabled && share_dex_data_ && oat_dex_files_.size() > 1u && !update_input_vdex) {
+    return WriteDexFilesWithSharedData(out, file);
+  }
+
   // Write dex files.
   for (OatDexFile& oat_dex_file : oat_dex_files_) {
     if (!WriteDexFile(out, file, &oat_dex_file, update_input_vdex)) {
@@ -2158,10 +2176,144 @@ bool OatWriter::WriteDexFiles(OutputStream* out, File* file, bool update_input_v
     }
   }
 
+  if (!input_shared_dex_data_.empty()) {
+    // The dex files of the input vdex are kept as they are, so is their shared data.
+    DCHECK(kIsVdexEnabled);
+    DCHECK(update_input_vdex);
+    vdex_shared_dex_data_size_ = input_shared_dex_data_.size();
+    vdex_size_ += vdex_shared_dex_data_size_;
+    size_shared_dex_data_ += vdex_shared_dex_data_size_;
+  }
+
+  CloseSources();
+  return true;
+}
+
+bool OatWriter::WriteDexFilesWithSharedData(OutputStream* out, File* file) {
+  TimingLogger::ScopedTiming split("Dex Shared Data Layout", timings_);
+  std::vector<std::unique_ptr<const DexFile>> dex_files;
+  std::vector<const DexFile*> dex_file_pointers;
+  for (OatDexFile& oat_dex_file : oat_dex_files_) {
+    std::unique_ptr<const DexFile> dex_file = OpenDexFileForLayout(&oat_dex_file);
+    if (dex_file == nullptr) {
+      return false;
+    }
+    dex_file_pointers.push_back(dex_file.get());
+    dex_files.push_back(std::move(dex_file));
+  }
+  Options options;
+  options.output_to_memmap_ = true;
+  options.dedupe_debug_info_ = true;
+  std::vector<std::unique_ptr<MemMap>> dex_file_maps;
+  std::vector<uint8_t> shared_data;
+  std::string error_msg;
+  if (!DexLayout::LayoutSharedData(options,
+                                   profile_compilation_info_,
+                                   dex_file_pointers,
+                                   &dex_file_maps,
+                                   &shared_data,
+                                   &error_msg)) {
+    LOG(ERROR) << "Failed to lay out dex files with shared data: " << error_msg;
+    return false;
+  }
+  if (!VerifyDexFilesWithSharedData(dex_file_maps, shared_data)) {
+    return false;
+  }
+
+  // The dex files must be placed as DexLayout::LayoutSharedData() expects.
+  static_assert(DexLayout::kSharedDataDexFileAlignment == 4u, "Unexpected dex file alignment");
+  for (size_t i = 0; i != oat_dex_files_.size(); ++i) {
+    OatDexFile* oat_dex_file = &oat_dex_files_[i];
+    if (!SeekToDexFile(out, file, oat_dex_file)) {
+      return false;
+    }
+    if (!WriteDexFile(out,
+                      oat_dex_file,
+                      dex_file_maps[i]->Begin(),
+                      /* update_input_vdex */ false)) {
+      return false;
+    }
+    // Set the checksum of the new oat dex file to be the original file's checksum.
+    oat_dex_file->dex_file_location_checksum_ = dex_files[i]->GetLocationChecksum();
+    DCHECK_EQ(vdex_size_, oat_dex_file->dex_file_offset_);
+    vdex_size_ += oat_dex_file->dex_file_size_;
+    size_dex_file_ += oat_dex_file->dex_file_size_;
+  }
+
+  // The shared data section immediately follows the last dex file.
+  if (!out->WriteFully(shared_data.data(), shared_data.size())) {
+    PLOG(ERROR) << "Failed to write shared dex data to " << out->GetLocation();
+    return false;
+  }
+  if (!out->Flush()) {
+    PLOG(ERROR) << "Failed to flush stream after writing shared dex data."
+                << " File: " << file->GetPath();
+    return false;
+  }
+  vdex_shared_dex_data_size_ = shared_data.size();
+  vdex_size_ += vdex_shared_dex_data_size_;
+  size_shared_dex_data_ += vdex_shared_dex_data_size_;
+
   CloseSources();
   return true;
 }
 
+bool OatWriter::VerifyDexFilesWithSharedData(
+    const std::vector<std::unique_ptr<MemMap>>& dex_file_maps,
+    const std::vector<uint8_t>& shared_data) {
+  TimingLogger::ScopedTiming split("Verify Dex Shared Data", timings_);
+  // The string ids of the dex files point to the shared data section after them, so verify
+  // them in a copy of the data as it is written to the vdex file.
+  std::vector<uint32_t> dex_file_offsets;
+  uint32_t offset = 0u;
+  for (const std::unique_ptr<MemMap>& dex_file_map : dex_file_maps) {
+    offset = RoundUp(offset, DexLayout::kSharedDataDexFileAlignment);
+    dex_file_offsets.push_back(offset);
+    offset += reinterpret_cast<const DexFile::Header*>(dex_file_map->Begin())->file_size_;
+  }
+  const uint32_t shared_data_offset = offset;
+  std::vector<uint8_t> data(shared_data_offset + shared_data.size(), 0u);
+  for (size_t i = 0; i != dex_file_maps.size(); ++i) {
+    const uint8_t* dex_file_begin = dex_file_maps[i]->Begin();
+    memcpy(&data[dex_file_offsets[i]],
+           dex_file_begin,
+           reinterpret_cast<const DexFile::Header*>(dex_file_begin)->file_size_);
+  }
+  std::copy(shared_data.begin(), shared_data.end(), data.begin() + shared_data_offset);
+
+  for (size_t i = 0; i != dex_file_maps.size(); ++i) {
+    const uint8_t* dex_file_begin = &data[dex_file_offsets[i]];
+    size_t dex_file_size = reinterpret_cast<const DexFile::Header*>(dex_file_begin)->file_size_;
+    std::string location(oat_dex_files_[i].GetLocation());
+    std::string error_msg;
+    std::unique_ptr<const DexFile> dex_file = DexFile::Open(dex_file_begin,
+                                                            dex_file_size,
+                                                            location,
+                                                            /* location_checksum */ 0u,
+                                                            /* oat_dex_file */ nullptr,
+                                                            /* verify */ false,
+                                                            /* verify_checksum */ false,
+                                                            &error_msg);
+    if (dex_file == nullptr) {
+      LOG(ERROR) << "Failed to open dex file with shared data: " << error_msg;
+      return false;
+    }
+    // The dex files keep the checksum of the input dex files, so it is not verified.
+    if (!DexFileVerifier::VerifyWithSharedData(dex_file.get(),
+                                               dex_file_begin,
+                                               dex_file_size,
+                                               data.data() + shared_data_offset,
+                                               shared_data.size(),
+                                               location.c_str(),
+                                               /* verify_checksum */ false,
+                                               &error_msg)) {
+      LOG(ERROR) << "Failed to verify dex file with shared data: " << error_msg;
+      return false;
+    }
+  }
+  return true;
+}
+
 void OatWriter::CloseSources() {
   for (OatDexFile& oat_dex_file : oat_dex_files_) {
     oat_dex_file.source_.Clear();  // Get rid of the reference, it's about to be invalidated.
@@ -2251,8 +2403,7 @@ bool OatWriter::SeekToDexFile(OutputStream* out, File* file, OatDexFile* oat_dex
   return true;
 }
 
-bool OatWriter::LayoutAndWriteDexFile(OutputStream* out, OatDexFile* oat_dex_file) {
-  TimingLogger::ScopedTiming split("Dex Layout", timings_);
+std::unique_ptr<const DexFile> OatWriter::OpenDexFileForLayout(OatDexFile* oat_dex_file) {
   std::string error_msg;
   std::string location(oat_dex_file->GetLocation());
   std::unique_ptr<const DexFile> dex_file;
@@ -2262,7 +2413,7 @@ bool OatWriter::LayoutAndWriteDexFile(OutputStream* out, OatDexFile* oat_dex_fil
         zip_entry->ExtractToMemMap(location.c_str(), "classes.dex", &error_msg));
     if (mem_map == nullptr) {
       LOG(ERROR) << "Failed to extract dex file to mem map for layout: " << error_msg;
-      return false;
+      return nullptr;
     }
     dex_file = DexFile::Open(location,
                              zip_entry->GetCrc32(),
@@ -2284,21 +2435,32 @@ bool OatWriter::LayoutAndWriteDexFile(OutputStream* out, OatDexFile* oat_dex_fil
     DCHECK(ValidateDexFileHeader(raw_dex_file, oat_dex_file->GetLocation()));
     const UnalignedDexFileHeader* header = AsUnalignedDexFileHeader(raw_dex_file);
     // Since the source may have had its layout changed, don't verify the checksum.
+    // The verifier rejects string data in a shared data section, after the end of the dex file.
     dex_file = DexFile::Open(raw_dex_file,
                              header->file_size_,
                              location,
                              oat_dex_file->dex_file_location_checksum_,
                              nullptr,
-                             /* verify */ true,
+                             /* verify */ input_shared_dex_data_.empty(),
                              /* verify_checksum */ false,
                              &error_msg);
   }
   if (dex_file == nullptr) {
     LOG(ERROR) << "Failed to open dex file for layout: " << error_msg;
+  }
+  return dex_file;
+}
+
+bool OatWriter::LayoutAndWriteDexFile(OutputStream* out, OatDexFile* oat_dex_file) {
+  TimingLogger::ScopedTiming split("Dex Layout", timings_);
+  std::string location(oat_dex_file->GetLocation());
+  std::unique_ptr<const DexFile> dex_file = OpenDexFileForLayout(oat_dex_file);
+  if (dex_file == nullptr) {
     return false;
   }
   Options options;
   options.output_to_memmap_ = true;
+  options.dedupe_debug_info_ = true;
   DexLayout dex_layout(options, profile_compilation_info_, nullptr);
   dex_layout.ProcessDexFile(location.c_str(), dex_file.get(), 0);
   std::unique_ptr<MemMap> mem_map(dex_layout.GetAndReleaseMemMap());
@@ -2734,6 +2896,7 @@ bool OatWriter::WriteChecksumsAndVdexHeader(OutputStream* vdex_out) {
 
   VdexFile::Header vdex_header(oat_dex_files_.size(),
                                dex_section_size,
+                               vdex_shared_dex_data_size_,
                                verifier_deps_section_size,
                                quickening_info_section_size);
   if (!vdex_out->WriteFully(&vdex_header, sizeof(VdexFile::Header))) {
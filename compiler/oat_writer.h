@@ -113,7 +113,12 @@ class OatWriter {
     kDefault = kCreate
   };
 
-  OatWriter(bool compiling_boot_image, TimingLogger* timings, ProfileCompilationInfo* info);
+  // If `share_dex_data` is true, the string data used by several dex files is written once to a
+  // data section shared by the dex files, see DexLayout::LayoutSharedData().
+  OatWriter(bool compiling_boot_image,
+            TimingLogger* timings,
+            ProfileCompilationInfo* info,
+            bool share_dex_data = false);
 
   // To produce a valid oat file, the user must first add sources with any combination of
   //   - AddDexFileSource(),
@@ -276,6 +281,10 @@ class OatWriter {
                     bool update_input_vdex);
   bool SeekToDexFile(OutputStream* out, File* file, OatDexFile* oat_dex_file);
   bool LayoutAndWriteDexFile(OutputStream* out, OatDexFile* oat_dex_file);
+  bool WriteDexFilesWithSharedData(OutputStream* out, File* file);
+  bool VerifyDexFilesWithSharedData(const std::vector<std::unique_ptr<MemMap>>& dex_file_maps,
+                                    const std::vector<uint8_t>& shared_data);
+  std::unique_ptr<const DexFile> OpenDexFileForLayout(OatDexFile* oat_dex_file);
   bool WriteDexFile(OutputStream* out,
                     File* file,
                     OatDexFile* oat_dex_file,
@@ -355,6 +364,9 @@ class OatWriter {
   // Offset of section holding Dex files inside Vdex.
   size_t vdex_dex_files_offset_;
 
+  // Size of the data shared by the dex files, at the end of the section holding Dex files.
+  size_t vdex_shared_dex_data_size_;
+
   // Offset of section holding VerifierDeps inside Vdex.
   size_t vdex_verifier_deps_offset_;
 
@@ -411,6 +423,7 @@ class OatWriter {
   uint32_t size_oat_header_;
   uint32_t size_oat_header_key_value_store_;
   uint32_t size_dex_file_;
+  uint32_t size_shared_dex_data_;
   uint32_t size_verifier_deps_;
   uint32_t size_verifier_deps_alignment_;
   uint32_t size_quickening_info_;
@@ -453,6 +466,12 @@ class OatWriter {
   // Profile info used to generate new layout of files.
   ProfileCompilationInfo* profile_compilation_info_;
 
+  // Whether to write the dex files with a shared data section.
+  bool share_dex_data_;
+
+  // The shared data of the dex files of an input vdex file.
+  ArrayRef<const uint8_t> input_shared_dex_data_;
+
   DISALLOW_COPY_AND_ASSIGN(OatWriter);
 };
 
@@ -923,6 +923,17 @@ void HEnvironment::CopyFromWithLoopPhiAdjustment(HEnvironment* env,
   }
 }
 
+void HEnvironment::SetLocationAt(size_t index, Location location) {
+  DCHECK_LT(index, Size());
+  if (locations_ == nullptr) {
+    // Zero-initialized memory is a valid array of invalid locations.
+    static_assert(Location::kInvalid == 0, "Location::kInvalid must be zero");
+    locations_ = holder_->GetArena()->AllocArray<Location>(Size(),
+                                                           kArenaAllocEnvironmentLocations);
+  }
+  locations_[index] = location;
+}
+
 void HEnvironment::RemoveAsUserOfInput(size_t index) const {
   const HUserRecord<HEnvironment*>& env_use = vregs_[index];
   HInstruction* user = env_use.GetInstruction();
@@ -25,6 +25,7 @@
 #include "base/arena_containers.h"
 #include "base/arena_object.h"
 #include "base/array_ref.h"
+#include "base/casts.h"
 #include "base/iteration_range.h"
 #include "base/stl_util.h"
 #include "base/transform_array_ref.h"
@@ -1739,12 +1740,17 @@ class HEnvironment : public ArenaObject<kArenaAllocEnvironment> {
                ArtMethod* method,
                uint32_t dex_pc,
                HInstruction* holder)
-     : vregs_(number_of_vregs, arena->Adapter(kArenaAllocEnvironmentVRegs)),
-       locations_(number_of_vregs, arena->Adapter(kArenaAllocEnvironmentLocations)),
+     : vregs_(arena->AllocArray<HUserRecord<HEnvironment*>>(number_of_vregs,
+                                                            kArenaAllocEnvironmentVRegs)),
+       locations_(nullptr),
        parent_(nullptr),
        method_(method),
+       number_of_vregs_(dchecked_integral_cast<uint32_t>(number_of_vregs)),
        dex_pc_(dex_pc),
        holder_(holder) {
+    for (size_t i = 0; i != number_of_vregs; ++i) {
+      ::new (static_cast<void*>(&vregs_[i])) HUserRecord<HEnvironment*>();
+    }
   }
 
   HEnvironment(ArenaAllocator* arena, const HEnvironment& to_copy, HInstruction* holder)
@@ -1775,25 +1781,28 @@ class HEnvironment : public ArenaObject<kArenaAllocEnvironment> {
   void CopyFromWithLoopPhiAdjustment(HEnvironment* env, HBasicBlock* loop_header);
 
   void SetRawEnvAt(size_t index, HInstruction* instruction) {
+    DCHECK_LT(index, Size());
     vregs_[index] = HUserRecord<HEnvironment*>(instruction);
   }
 
   HInstruction* GetInstructionAt(size_t index) const {
+    DCHECK_LT(index, Size());
     return vregs_[index].GetInstruction();
   }
 
   void RemoveAsUserOfInput(size_t index) const;
 
-  size_t Size() const { return vregs_.size(); }
+  size_t Size() const { return number_of_vregs_; }
 
   HEnvironment* GetParent() const { return parent_; }
 
-  void SetLocationAt(size_t index, Location location) {
-    locations_[index] = location;
-  }
+  // The locations are allocated on first use, as they are needed only by the code
+  // generator and many environments are removed before register allocation.
+  void SetLocationAt(size_t index, Location location);
 
   Location GetLocationAt(size_t index) const {
-    return locations_[index];
+    DCHECK_LT(index, Size());
+    return (locations_ != nullptr) ? locations_[index] : Location();
   }
 
   uint32_t GetDexPc() const {
@@ -1814,10 +1823,14 @@ class HEnvironment : public ArenaObject<kArenaAllocEnvironment> {
   }
 
  private:
-  ArenaVector<HUserRecord<HEnvironment*>> vregs_;
-  ArenaVector<Location> locations_;
+  // The number of vregs is fixed at construction, so plain arena arrays are used
+  // rather than ArenaVector<>s to keep environments small in huge methods. The number
+  // of vregs fits in 32 bits and shares a word with the dex pc.
+  HUserRecord<HEnvironment*>* const vregs_;
+  Location* locations_;
   HEnvironment* parent_;
   ArtMethod* method_;
+  const uint32_t number_of_vregs_;
   const uint32_t dex_pc_;
 
   // The instruction that holds this environment.
@@ -1828,6 +1841,9 @@ class HEnvironment : public ArenaObject<kArenaAllocEnvironment> {
   DISALLOW_COPY_AND_ASSIGN(HEnvironment);
 };
 
+// Environments are allocated for most instructions that can throw or deoptimize.
+static_assert(sizeof(void*) != 8u || sizeof(HEnvironment) == 48u, "Unexpected HEnvironment size");
+
 class HInstruction : public ArenaObject<kArenaAllocInstruction> {
  public:
   HInstruction(SideEffects side_effects, uint32_t dex_pc)
@@ -2314,6 +2330,10 @@ class HInstruction : public ArenaObject<kArenaAllocInstruction> {
 
   DISALLOW_COPY_AND_ASSIGN(HInstruction);
 };
+
+// Every node of the graph starts with an HInstruction. Its 32-bit fields are packed
+// together, so there is no padding left to reclaim by reordering them.
+static_assert(sizeof(void*) != 8u || sizeof(HInstruction) == 112u, "Unexpected HInstruction size");
 std::ostream& operator<<(std::ostream& os, const HInstruction::InstructionKind& rhs);
 
 // Iterates over the instructions, while preserving the next instruction
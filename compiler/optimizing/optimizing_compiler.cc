@@ -16,6 +16,7 @@
 
 #include "optimizing_compiler.h"
 
+#include <algorithm>
 #include <fstream>
 #include <memory>
 #include <sstream>
@@ -51,6 +52,7 @@
 #include "base/dumpable.h"
 #include "base/macros.h"
 #include "base/mutex.h"
+#include "base/time_utils.h"
 #include "base/timing_logger.h"
 #include "bounds_check_elimination.h"
 #include "builder.h"
@@ -145,12 +147,18 @@ class PassObserver : public ValueObject {
   PassObserver(HGraph* graph,
                CodeGenerator* codegen,
                std::ostream* visualizer_output,
+               std::ostream* compile_report_output,
                CompilerDriver* compiler_driver,
                Mutex& dump_mutex)
       : graph_(graph),
         cached_method_name_(),
         timing_logger_enabled_(compiler_driver->GetDumpPasses()),
         timing_logger_(timing_logger_enabled_ ? GetMethodName() : "", true, true),
+        compile_report_output_(compile_report_output),
+        compile_start_ns_(compile_report_output != nullptr ? NanoTime() : 0u),
+        pass_start_ns_(0u),
+        pass_times_(),
+        arena_peak_bytes_(0u),
         disasm_info_(graph->GetArena()),
         visualizer_oss_(),
         visualizer_output_(visualizer_output),
@@ -194,6 +202,65 @@ class PassObserver : public ValueObject {
     return cached_method_name_.c_str();
   }
 
+  // Append one line for this method to the --dump-compile-report file. The line is made
+  // of tab-separated key=value fields: the status, the total and per-pass wall time in
+  // nanoseconds, the HIR node counts, the generated code size and the peak arena memory in
+  // bytes. The arena memory is broken down by ArenaAllocKind if
+  // kArenaAllocatorCountAllocations. `status` is "Compiled", or the MethodCompilationStat
+  // name of the reason why the compilation failed, in which case the counts are those of
+  // the graph when the compilation stopped.
+  void WriteCompileReport(const ArenaAllocator* arena, size_t code_size, const char* status)
+      REQUIRES(!visualizer_dump_mutex_) {
+    if (compile_report_output_ == nullptr) {
+      return;
+    }
+    UpdateArenaPeakBytes(arena);
+    size_t num_blocks = 0u;
+    size_t num_instructions = 0u;
+    for (HBasicBlock* block : graph_->GetBlocks()) {
+      if (block == nullptr) {
+        continue;
+      }
+      ++num_blocks;
+      for (HInstructionIterator it(block->GetPhis()); !it.Done(); it.Advance()) {
+        ++num_instructions;
+      }
+      for (HInstructionIterator it(block->GetInstructions()); !it.Done(); it.Advance()) {
+        ++num_instructions;
+      }
+    }
+    std::ostringstream oss;
+    oss << "method=" << GetMethodName()
+        << "\tstatus=" << status
+        << "\tisa=" << graph_->GetInstructionSet()
+        << "\tosr=" << (graph_->IsCompilingOsr() ? 1 : 0)
+        << "\ttotal_ns=" << (NanoTime() - compile_start_ns_)
+        << "\tblocks=" << num_blocks
+        << "\tinstructions=" << num_instructions
+        << "\tinstruction_ids=" << graph_->GetCurrentInstructionId()
+        << "\tcode_size=" << code_size
+        << "\tarena_peak_bytes=" << arena_peak_bytes_;
+    for (const std::pair<const char*, uint64_t>& pass_time : pass_times_) {
+      oss << "\tpass:" << pass_time.first << "=" << pass_time.second;
+    }
+    if (kArenaAllocatorCountAllocations) {
+      for (size_t i = 0; i != kNumArenaAllocKinds; ++i) {
+        ArenaAllocKind kind = static_cast<ArenaAllocKind>(i);
+        size_t bytes = arena->BytesAllocatedByKind(kind);
+        if (bytes != 0u) {
+          // Drop the padding used for MemStats dumps.
+          std::string name = GetArenaAllocKindName(kind);
+          name.erase(name.find_last_not_of(' ') + 1u);
+          oss << "\tarena:" << name << "=" << bytes;
+        }
+      }
+    }
+    oss << "\n";
+    MutexLock mu(Thread::Current(), visualizer_dump_mutex_);
+    *compile_report_output_ << oss.str();
+    compile_report_output_->flush();
+  }
+
  private:
   void StartPass(const char* pass_name) REQUIRES(!visualizer_dump_mutex_) {
     VLOG(compiler) << "Starting pass: " << pass_name;
@@ -205,6 +272,9 @@ class PassObserver : public ValueObject {
     if (timing_logger_enabled_) {
       timing_logger_.StartTiming(pass_name);
     }
+    if (compile_report_output_ != nullptr) {
+      pass_start_ns_ = NanoTime();
+    }
   }
 
   void FlushVisualizer() REQUIRES(!visualizer_dump_mutex_) {
@@ -220,6 +290,10 @@ class PassObserver : public ValueObject {
     if (timing_logger_enabled_) {
       timing_logger_.EndTiming();
     }
+    if (compile_report_output_ != nullptr) {
+      pass_times_.emplace_back(pass_name, NanoTime() - pass_start_ns_);
+      UpdateArenaPeakBytes(graph_->GetArena());
+    }
     if (visualizer_enabled_) {
       visualizer_.DumpGraph(pass_name, /* is_after_pass */ true, graph_in_bad_state_);
       FlushVisualizer();
@@ -237,6 +311,12 @@ class PassObserver : public ValueObject {
     }
   }
 
+  // Record the largest arena usage seen so far. It is sampled after each pass, so that a
+  // compilation that stops in the middle of a pass still reports the memory it reached.
+  void UpdateArenaPeakBytes(const ArenaAllocator* arena) {
+    arena_peak_bytes_ = std::max(arena_peak_bytes_, arena->BytesUsed());
+  }
+
   static bool IsVerboseMethod(CompilerDriver* compiler_driver, const char* method_name) {
     // Test an exact match to --verbose-methods. If verbose-methods is set, this overrides an
     // empty kStringFilter matching all methods.
@@ -261,6 +341,13 @@ class PassObserver : public ValueObject {
   bool timing_logger_enabled_;
   TimingLogger timing_logger_;
 
+  // Per-method report for --dump-compile-report, disabled if the output is null.
+  std::ostream* const compile_report_output_;
+  const uint64_t compile_start_ns_;
+  uint64_t pass_start_ns_;
+  std::vector<std::pair<const char*, uint64_t>> pass_times_;
+  size_t arena_peak_bytes_;
+
   DisassemblyInformation disasm_info_;
 
   std::ostringstream visualizer_oss_;
@@ -395,17 +482,41 @@ class OptimizingCompiler FINAL : public Compiler {
                             CodeGenerator* codegen,
                             PassObserver* pass_observer) const;
 
+  // Append a line to the --dump-compile-report file for a method rejected before its graph
+  // was built, with the reason as its status. The PassObserver reports the other methods.
+  void MaybeWriteCompileReport(const DexFile& dex_file,
+                               uint32_t method_idx,
+                               const char* status) const;
+
   std::unique_ptr<OptimizingCompilerStats> compilation_stats_;
 
   std::unique_ptr<std::ostream> visualizer_output_;
 
-  mutable Mutex dump_mutex_;  // To synchronize visualizer writing.
+  std::unique_ptr<std::ostream> compile_report_output_;
+
+  mutable Mutex dump_mutex_;  // To synchronize visualizer and compile report writing.
 
   DISALLOW_COPY_AND_ASSIGN(OptimizingCompiler);
 };
 
 static const int kMaximumCompilationTimeBeforeWarning = 100; /* ms */
 
+void OptimizingCompiler::MaybeWriteCompileReport(const DexFile& dex_file,
+                                                 uint32_t method_idx,
+                                                 const char* status) const {
+  if (compile_report_output_ == nullptr) {
+    return;
+  }
+  std::ostringstream oss;
+  oss << "method=" << dex_file.PrettyMethod(method_idx)
+      << "\tstatus=" << status
+      << "\tisa=" << GetCompilerDriver()->GetInstructionSet()
+      << "\n";
+  MutexLock mu(Thread::Current(), dump_mutex_);
+  *compile_report_output_ << oss.str();
+  compile_report_output_->flush();
+}
+
 OptimizingCompiler::OptimizingCompiler(CompilerDriver* driver)
     : Compiler(driver, kMaximumCompilationTimeBeforeWarning),
       dump_mutex_("Visualizer dump lock") {}
@@ -420,6 +531,12 @@ void OptimizingCompiler::Init() {
         driver->GetCompilerOptions().GetDumpCfgAppend() ? std::ofstream::app : std::ofstream::out;
     visualizer_output_.reset(new std::ofstream(cfg_file_name, cfg_file_mode));
   }
+  const std::string& report_file_name =
+      driver->GetCompilerOptions().GetDumpCompileReportFileName();
+  if (!report_file_name.empty()) {
+    // Always append, the JIT of several processes may write to the same file.
+    compile_report_output_.reset(new std::ofstream(report_file_name, std::ofstream::app));
+  }
   if (driver->GetDumpStats()) {
     compilation_stats_.reset(new OptimizingCompilerStats());
   }
@@ -901,17 +1018,20 @@ CodeGenerator* OptimizingCompiler::TryCompile(ArenaAllocator* arena,
   // Do not attempt to compile on architectures we do not support.
   if (!IsInstructionSetSupported(instruction_set)) {
     MaybeRecordStat(MethodCompilationStat::kNotCompiledUnsupportedIsa);
+    MaybeWriteCompileReport(dex_file, method_idx, "NotCompiledUnsupportedIsa");
     return nullptr;
   }
 
   // When read barriers are enabled, do not attempt to compile for
   // instruction sets that have no read barrier support.
   if (kEmitCompilerReadBarrier && !InstructionSetSupportsReadBarrier(instruction_set)) {
+    MaybeWriteCompileReport(dex_file, method_idx, "NotCompiledNoReadBarrierSupport");
     return nullptr;
   }
 
   if (Compiler::IsPathologicalCase(*code_item, method_idx, dex_file)) {
     MaybeRecordStat(MethodCompilationStat::kNotCompiledPathological);
+    MaybeWriteCompileReport(dex_file, method_idx, "NotCompiledPathological");
     return nullptr;
   }
 
@@ -922,6 +1042,7 @@ CodeGenerator* OptimizingCompiler::TryCompile(ArenaAllocator* arena,
   if ((compiler_options.GetCompilerFilter() == CompilerFilter::kSpace)
       && (code_item->insns_size_in_code_units_ > kSpaceFilterOptimizingThreshold)) {
     MaybeRecordStat(MethodCompilationStat::kNotCompiledSpaceFilter);
+    MaybeWriteCompileReport(dex_file, method_idx, "NotCompiledSpaceFilter");
     return nullptr;
   }
 
@@ -975,6 +1096,7 @@ CodeGenerator* OptimizingCompiler::TryCompile(ArenaAllocator* arena,
                             compilation_stats_.get()));
   if (codegen.get() == nullptr) {
     MaybeRecordStat(MethodCompilationStat::kNotCompiledNoCodegen);
+    MaybeWriteCompileReport(dex_file, method_idx, "NotCompiledNoCodegen");
     return nullptr;
   }
   codegen->GetAssembler()->cfi().SetEnabled(
@@ -983,9 +1105,11 @@ CodeGenerator* OptimizingCompiler::TryCompile(ArenaAllocator* arena,
   PassObserver pass_observer(graph,
                              codegen.get(),
                              visualizer_output_.get(),
+                             compile_report_output_.get(),
                              compiler_driver,
                              dump_mutex_);
 
+  const char* builder_status = nullptr;
   {
     VLOG(compiler) << "Building " << pass_observer.GetMethodName();
     PassScope scope(HGraphBuilder::kBuilderPassName, &pass_observer);
@@ -1002,26 +1126,36 @@ CodeGenerator* OptimizingCompiler::TryCompile(ArenaAllocator* arena,
                           handles);
     GraphAnalysisResult result = builder.BuildGraph();
     if (result != kAnalysisSuccess) {
+      const char* status = nullptr;
       switch (result) {
         case kAnalysisSkipped:
           MaybeRecordStat(MethodCompilationStat::kNotCompiledSkipped);
+          status = "NotCompiledSkipped";
           break;
         case kAnalysisInvalidBytecode:
           MaybeRecordStat(MethodCompilationStat::kNotCompiledInvalidBytecode);
+          status = "NotCompiledInvalidBytecode";
           break;
         case kAnalysisFailThrowCatchLoop:
           MaybeRecordStat(MethodCompilationStat::kNotCompiledThrowCatchLoop);
+          status = "NotCompiledThrowCatchLoop";
           break;
         case kAnalysisFailAmbiguousArrayOp:
           MaybeRecordStat(MethodCompilationStat::kNotCompiledAmbiguousArrayOp);
+          status = "NotCompiledAmbiguousArrayOp";
           break;
         case kAnalysisSuccess:
           UNREACHABLE();
       }
       pass_observer.SetGraphInBadState();
-      return nullptr;
+      // Report once the builder pass has ended, so that its time and memory are included.
+      builder_status = status;
     }
   }
+  if (builder_status != nullptr) {
+    pass_observer.WriteCompileReport(arena, /* code_size */ 0u, builder_status);
+    return nullptr;
+  }
 
   RunOptimizations(graph,
                    codegen.get(),
@@ -1036,6 +1170,7 @@ CodeGenerator* OptimizingCompiler::TryCompile(ArenaAllocator* arena,
 
   codegen->Compile(code_allocator);
   pass_observer.DumpDisassembly();
+  pass_observer.WriteCompileReport(arena, code_allocator->GetSize(), "Compiled");
 
   return codegen.release();
 }
@@ -1093,8 +1228,10 @@ CompiledMethod* OptimizingCompiler::Compile(const DexFile::CodeItem* code_item,
   } else {
     if (compiler_driver->GetCompilerOptions().VerifyAtRuntime()) {
       MaybeRecordStat(MethodCompilationStat::kNotCompiledVerifyAtRuntime);
+      MaybeWriteCompileReport(dex_file, method_idx, "NotCompiledVerifyAtRuntime");
     } else {
       MaybeRecordStat(MethodCompilationStat::kNotCompiledVerificationError);
+      MaybeWriteCompileReport(dex_file, method_idx, "NotCompiledVerificationError");
     }
   }
 
@@ -328,6 +328,11 @@ NO_RETURN static void Usage(const char* fmt, ...) {
   UsageError("");
   UsageError("  --dump-timing: display a breakdown of where time was spent");
   UsageError("");
+  UsageError("  --dump-compile-report=<file-name>: append one line per method to the given file");
+  UsageError("      with whether it was compiled or why not, the time spent in each optimizing");
+  UsageError("      pass, the peak arena memory, the number of HIR nodes and the code size.");
+  UsageError("      Example: --dump-compile-report=/data/tmp/compile_report.txt");
+  UsageError("");
   UsageError("  --include-patch-information: Include patching information so the generated code");
   UsageError("      can have its base address moved without full recompilation.");
   UsageError("");
@@ -383,6 +388,9 @@ NO_RETURN static void Usage(const char* fmt, ...) {
   UsageError("      bytes to consider the input \"very large\" and punt on the compilation.");
   UsageError("      Example: --very-large-app-threshold=100000000");
   UsageError("");
+  UsageError("  --share-dex-data: write the string data used by several dex files once, in a data");
+  UsageError("      section of the vdex file shared by the dex files.");
+  UsageError("");
   UsageError("  --app-image-fd=<file-descriptor>: specify output file descriptor for app image.");
   UsageError("      Example: --app-image-fd=10");
   UsageError("");
@@ -1241,6 +1249,8 @@ class Dex2Oat FINAL {
                         "--very-large-app-threshold",
                         &very_large_threshold_,
                         Usage);
+      } else if (option == "--share-dex-data") {
+        share_dex_data_ = true;
       } else if (option.starts_with("--app-image-file=")) {
         app_image_file_name_ = option.substr(strlen("--app-image-file=")).data();
       } else if (option.starts_with("--app-image-fd=")) {
@@ -1544,7 +1554,9 @@ class Dex2Oat FINAL {
         // 1) Dexlayout since it does the verification. It also may not pass the verification since
         // we don't update the dex checksum.
         // 2) when we have a vdex file, which means it was already verified.
-        const bool verify = !DoDexLayoutOptimizations() && (input_vdex_file_ == nullptr);
+        // 3) Shared dex data since the dex files refer to data after their end.
+        const bool verify =
+            !DoDexLayoutOptimizations() && !share_dex_data_ && (input_vdex_file_ == nullptr);
         if (!oat_writers_[i]->WriteAndOpenDexFiles(
             kIsVdexEnabled ? vdex_files_[i].get() : oat_files_[i].get(),
             rodata_.back(),
@@ -2362,11 +2374,12 @@ class Dex2Oat FINAL {
       elf_writers_.emplace_back(CreateElfWriterQuick(instruction_set_,
                                                      instruction_set_features_.get(),
                                                      compiler_options_.get(),
-                                                     oat_file.get()));
+                                                     oat_file.get(),
+                                                     thread_count_));
       elf_writers_.back()->Start();
       const bool do_dexlayout = DoDexLayoutOptimizations();
-      oat_writers_.emplace_back(new OatWriter(
-          IsBootImage(), timings_, do_dexlayout ? profile_compilation_info_.get() : nullptr));
+      ProfileCompilationInfo* info = do_dexlayout ? profile_compilation_info_.get() : nullptr;
+      oat_writers_.emplace_back(new OatWriter(IsBootImage(), timings_, info, share_dex_data_));
     }
   }
 
@@ -2741,6 +2754,7 @@ class Dex2Oat FINAL {
   size_t min_dex_files_for_swap_ = kDefaultMinDexFilesForSwap;
   size_t min_dex_file_cumulative_size_for_swap_ = kDefaultMinDexFileCumulativeSizeForSwap;
   size_t very_large_threshold_ = std::numeric_limits<size_t>::max();
+  bool share_dex_data_ = false;
   std::string app_image_file_name_;
   int app_image_fd_;
   std::string profile_file_;
@@ -337,12 +337,42 @@ void Collections::ReadEncodedValue(
 void Collections::CreateStringId(const DexFile& dex_file, uint32_t i) {
   const DexFile::StringId& disk_string_id = dex_file.GetStringId(dex::StringIndex(i));
   StringData* string_data = new StringData(dex_file.GetStringData(disk_string_id));
-  string_datas_.AddItem(string_data, disk_string_id.string_data_off_);
+  if (disk_string_id.string_data_off_ >= dex_file.Size()) {
+    // The dex file was written with a shared data section, keep the string data there.
+    string_data->SetOffset(disk_string_id.string_data_off_);
+    shared_string_datas_.emplace_back(string_data);
+  } else {
+    string_datas_.AddItem(string_data, disk_string_id.string_data_off_);
+  }
 
   StringId* string_id = new StringId(string_data);
   string_ids_.AddIndexedItem(string_id, StringIdsOffset() + i * StringId::ItemSize(), i);
 }
 
+void Collections::MoveToSharedStringDatas(const std::unordered_set<StringData*>& string_datas) {
+  std::map<uint32_t, std::unique_ptr<StringData>>& collection = string_datas_.Collection();
+  for (auto it = collection.begin(); it != collection.end(); ) {
+    if (string_datas.find(it->second.get()) != string_datas.end()) {
+      shared_string_datas_.push_back(std::move(it->second));
+      it = collection.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+void Collections::RemoveDebugInfoItems(
+    const std::unordered_set<DebugInfoItem*>& debug_info_items) {
+  std::map<uint32_t, std::unique_ptr<DebugInfoItem>>& collection = debug_info_items_.Collection();
+  for (auto it = collection.begin(); it != collection.end(); ) {
+    if (debug_info_items.find(it->second.get()) != debug_info_items.end()) {
+      it = collection.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
 void Collections::CreateTypeId(const DexFile& dex_file, uint32_t i) {
   const DexFile::TypeId& disk_type_id = dex_file.GetTypeId(dex::TypeIndex(i));
   TypeId* type_id = new TypeId(GetStringId(disk_type_id.descriptor_idx_.index_));
@@ -20,6 +20,7 @@
 #define ART_DEXLAYOUT_DEX_IR_H_
 
 #include <map>
+#include <unordered_set>
 #include <vector>
 #include <stdint.h>
 
@@ -168,6 +169,9 @@ class Collections {
   std::map<uint32_t, std::unique_ptr<StringData>>& StringDatas()
       { return string_datas_.Collection(); }
   std::map<uint32_t, std::unique_ptr<TypeList>>& TypeLists() { return type_lists_.Collection(); }
+  // String data in a data section shared with other dex files, after the end of the dex file.
+  // They are not written with the dex file, see DexLayout::LayoutSharedData().
+  std::vector<std::unique_ptr<StringData>>& SharedStringDatas() { return shared_string_datas_; }
   std::map<uint32_t, std::unique_ptr<EncodedArrayItem>>& EncodedArrayItems()
       { return encoded_array_items_.Collection(); }
   std::map<uint32_t, std::unique_ptr<AnnotationItem>>& AnnotationItems()
@@ -190,6 +194,11 @@ class Collections {
   void CreateMethodId(const DexFile& dex_file, uint32_t i);
   void CreateClassDef(const DexFile& dex_file, uint32_t i);
 
+  // Moves `string_datas` from the string data section to the shared string data.
+  void MoveToSharedStringDatas(const std::unordered_set<StringData*>& string_datas);
+  // Removes `debug_info_items` from the debug info section. No code item may refer to them.
+  void RemoveDebugInfoItems(const std::unordered_set<DebugInfoItem*>& debug_info_items);
+
   TypeList* CreateTypeList(const DexFile::TypeList* type_list, uint32_t offset);
   EncodedArrayItem* CreateEncodedArrayItem(const uint8_t* static_data, uint32_t offset);
   AnnotationItem* CreateAnnotationItem(const DexFile::AnnotationItem* annotation, uint32_t offset);
@@ -290,6 +299,7 @@ class Collections {
   CollectionVector<ClassDef> class_defs_;
 
   CollectionMap<StringData> string_datas_;
+  std::vector<std::unique_ptr<StringData>> shared_string_datas_;
   CollectionMap<TypeList> type_lists_;
   CollectionMap<EncodedArrayItem> encoded_array_items_;
   CollectionMap<AnnotationItem> annotation_items_;
@@ -881,6 +891,7 @@ class CodeItem : public Item {
   uint16_t OutsSize() const { return outs_size_; }
   uint16_t TriesSize() const { return tries_ == nullptr ? 0 : tries_->size(); }
   DebugInfoItem* DebugInfo() const { return debug_info_; }
+  void SetDebugInfo(DebugInfoItem* debug_info) { debug_info_ = debug_info; }
   uint32_t InsnsSize() const { return insns_size_; }
   uint16_t* Insns() const { return insns_.get(); }
   TryItemVector* Tries() const { return tries_.get(); }
@@ -26,7 +26,9 @@
 #include <stdio.h>
 
 #include <functional>
+#include <map>
 #include <memory>
+#include <set>
 #include <vector>
 
 #include "dex_ir.h"
@@ -131,15 +133,7 @@ class Dumper {
  public:
   // Colors are based on the type of the section in MapList.
   Dumper(const dex_ir::Collections& collections, size_t dex_file_index) {
-    // Build the table that will map from offset to color
-    table_.emplace_back(DexFile::kDexTypeHeaderItem, 0u);
-    for (const FileSection& s : kFileSections) {
-      table_.emplace_back(s.type_, s.offset_fn_(collections));
-    }
-    // Sort into descending order by offset.
-    std::sort(table_.begin(),
-              table_.end(),
-              [](const SectionColor& a, const SectionColor& b) { return a.offset_ > b.offset_; });
+    BuildSectionTable(collections);
     // Open the file and emit the gnuplot prologue.
     std::string dex_file_name("classes");
     std::string out_file_base_name("layout");
@@ -173,17 +167,24 @@ class Dumper {
             "plot \"-\" using 1:2:3:4:5 with vector nohead linewidth 1 lc variable notitle\n");
   }
 
-  int GetColor(uint32_t offset) const {
+  // Only records the pages touched, without writing a gnuplot file.
+  explicit Dumper(const dex_ir::Collections& collections) : out_file_(nullptr) {
+    BuildSectionTable(collections);
+  }
+
+  uint16_t GetSectionType(uint32_t offset) const {
     // The dread linear search to find the right section for the reference.
-    uint16_t section = 0;
     for (uint16_t i = 0; i < table_.size(); ++i) {
-      if (table_[i].offset_ < offset) {
-        section = table_[i].type_;
-        break;
+      if (table_[i].offset_ <= offset) {
+        return table_[i].type_;
       }
     }
-    // And a lookup table from type to color.
-    ColorMapType::const_iterator iter = kColorMap.find(section);
+    return 0;
+  }
+
+  int GetColor(uint32_t offset) const {
+    // A lookup table from type to color.
+    ColorMapType::const_iterator iter = kColorMap.find(GetSectionType(offset));
     if (iter != kColorMap.end()) {
       return iter->second;
     }
@@ -194,7 +195,18 @@ class Dumper {
     const uint32_t low_page = from / kPageSize;
     const uint32_t high_page = (size > 0) ? (from + size - 1) / kPageSize : low_page;
     const uint32_t size_delta = high_page - low_page;
-    fprintf(out_file_, "%d %d %d 0 %d\n", low_page, class_index, size_delta, GetColor(from));
+    std::set<uint32_t>& section_pages = touched_pages_[GetSectionType(from)];
+    for (uint32_t page = low_page; page <= high_page; ++page) {
+      section_pages.insert(page);
+    }
+    if (out_file_ != nullptr) {
+      fprintf(out_file_, "%d %d %d 0 %d\n", low_page, class_index, size_delta, GetColor(from));
+    }
+  }
+
+  // Returns the distinct pages touched by the dumped items, keyed by the section of the items.
+  const std::map<uint16_t, std::set<uint32_t>>& GetTouchedPages() const {
+    return touched_pages_;
   }
 
   void DumpAddressRange(const dex_ir::Item* item, int class_index) {
@@ -266,10 +278,11 @@ class Dumper {
   void DumpMethodItem(dex_ir::MethodItem* method,
                       const DexFile* dex_file,
                       int class_index,
-                      ProfileCompilationInfo* profile_info) {
+                      ProfileCompilationInfo* profile_info,
+                      LayoutType max_layout_type) {
     if (profile_info != nullptr) {
       uint32_t method_idx = method->GetMethodId()->GetIndex();
-      if (!profile_info->ContainsMethod(MethodReference(dex_file, method_idx))) {
+      if (GetMethodLayoutType(profile_info, dex_file, method_idx) > max_layout_type) {
         return;
       }
     }
@@ -304,7 +317,9 @@ class Dumper {
   }
 
   ~Dumper() {
-    fclose(out_file_);
+    if (out_file_ != nullptr) {
+      fclose(out_file_);
+    }
   }
 
  private:
@@ -336,22 +351,34 @@ class Dumper {
     { DexFile::kDexTypeAnnotationsDirectoryItem, 16 }
   };
 
+  void BuildSectionTable(const dex_ir::Collections& collections) {
+    // Build the table that will map from offset to color
+    table_.emplace_back(DexFile::kDexTypeHeaderItem, 0u);
+    for (const FileSection& s : kFileSections) {
+      table_.emplace_back(s.type_, s.offset_fn_(collections));
+    }
+    // Sort into descending order by offset.
+    std::sort(table_.begin(),
+              table_.end(),
+              [](const SectionColor& a, const SectionColor& b) { return a.offset_ > b.offset_; });
+  }
+
   std::vector<SectionColor> table_;
+  std::map<uint16_t, std::set<uint32_t>> touched_pages_;
   FILE* out_file_;
 
   DISALLOW_COPY_AND_ASSIGN(Dumper);
 };
 
 /*
- * Dumps a gnuplot data file showing the parts of the dex_file that belong to each class.
- * If profiling information is present, it dumps only those classes that are marked as hot.
+ * Dumps the parts of the dex file used by the classes of the profile, and by their methods whose
+ * layout type is at most `max_layout_type`. Without profile, dumps all the classes and methods.
  */
-void VisualizeDexLayout(dex_ir::Header* header,
+static void DumpClasses(Dumper* dumper,
+                        dex_ir::Header* header,
                         const DexFile* dex_file,
-                        size_t dex_file_index,
-                        ProfileCompilationInfo* profile_info) {
-  std::unique_ptr<Dumper> dumper(new Dumper(header->GetCollections(), dex_file_index));
-
+                        ProfileCompilationInfo* profile_info,
+                        LayoutType max_layout_type) {
   const uint32_t class_defs_size = header->GetCollections().ClassDefsSize();
   for (uint32_t class_index = 0; class_index < class_defs_size; class_index++) {
     dex_ir::ClassDef* class_def = header->GetCollections().GetClassDef(class_index);
@@ -389,16 +416,90 @@ void VisualizeDexLayout(dex_ir::Header* header,
       }
       if (class_data->DirectMethods()) {
         for (auto& method_item : *class_data->DirectMethods()) {
-          dumper->DumpMethodItem(method_item.get(), dex_file, class_index, profile_info);
+          dumper->DumpMethodItem(
+              method_item.get(), dex_file, class_index, profile_info, max_layout_type);
         }
       }
       if (class_data->VirtualMethods()) {
         for (auto& method_item : *class_data->VirtualMethods()) {
-          dumper->DumpMethodItem(method_item.get(), dex_file, class_index, profile_info);
+          dumper->DumpMethodItem(
+              method_item.get(), dex_file, class_index, profile_info, max_layout_type);
         }
       }
     }
   }  // for
 }
 
+/*
+ * Dumps a gnuplot data file showing the parts of the dex_file that belong to each class.
+ * If profiling information is present, it dumps only those classes that are marked as hot.
+ */
+void VisualizeDexLayout(dex_ir::Header* header,
+                        const DexFile* dex_file,
+                        size_t dex_file_index,
+                        ProfileCompilationInfo* profile_info) {
+  std::unique_ptr<Dumper> dumper(new Dumper(header->GetCollections(), dex_file_index));
+  DumpClasses(dumper.get(), header, dex_file, profile_info, kLayoutTypeHot);
+}
+
+static size_t CountPages(const std::map<uint16_t, std::set<uint32_t>>& touched_pages,
+                         uint16_t section_type) {
+  auto it = touched_pages.find(section_type);
+  return (it != touched_pages.end()) ? it->second.size() : 0u;
+}
+
+static size_t CountPages(const std::map<uint16_t, std::set<uint32_t>>& touched_pages) {
+  std::set<uint32_t> pages;
+  for (const auto& section_pages : touched_pages) {
+    pages.insert(section_pages.second.begin(), section_pages.second.end());
+  }
+  return pages.size();
+}
+
+/*
+ * Replays the profile against the layout of the dex file, and prints the number of distinct
+ * pages touched by the startup methods, and by the startup and hot methods. Each page touched
+ * is a page fault when the dex file is not in the page cache, so fewer pages mean less I/O.
+ */
+void ShowDexLayoutPageCounts(dex_ir::Header* header,
+                             const DexFile* dex_file,
+                             ProfileCompilationInfo* profile_info,
+                             FILE* out_file) {
+  const dex_ir::Collections& collections = header->GetCollections();
+  Dumper startup_dumper(collections);
+  DumpClasses(&startup_dumper, header, dex_file, profile_info, kLayoutTypeStartup);
+  Dumper hot_dumper(collections);
+  DumpClasses(&hot_dumper, header, dex_file, profile_info, kLayoutTypeHot);
+  const std::map<uint16_t, std::set<uint32_t>>& startup_pages = startup_dumper.GetTouchedPages();
+  const std::map<uint16_t, std::set<uint32_t>>& hot_pages = hot_dumper.GetTouchedPages();
+
+  fprintf(out_file, "%-12s %10s %10s %12s\n", "section", "pages", "startup", "startup+hot");
+  for (const FileSection& s : kFileSections) {
+    if (s.size_fn_(collections) == 0) {
+      continue;
+    }
+    // The section ends where the next one starts.
+    uint32_t begin = s.offset_fn_(collections);
+    uint32_t end = header->FileSize();
+    for (const FileSection& other : kFileSections) {
+      uint32_t other_begin = other.offset_fn_(collections);
+      if (other.size_fn_(collections) != 0 && other_begin > begin && other_begin < end) {
+        end = other_begin;
+      }
+    }
+    fprintf(out_file,
+            "%-12s %10zu %10zu %12zu\n",
+            s.name_.c_str(),
+            (end - 1) / kPageSize - begin / kPageSize + 1,
+            CountPages(startup_pages, s.type_),
+            CountPages(hot_pages, s.type_));
+  }
+  fprintf(out_file,
+          "%-12s %10zu %10zu %12zu\n",
+          "total",
+          (header->FileSize() + kPageSize - 1) / kPageSize,
+          CountPages(startup_pages),
+          CountPages(hot_pages));
+}
+
 }  // namespace art
@@ -24,6 +24,7 @@
 #define ART_DEXLAYOUT_DEX_VISUALIZE_H_
 
 #include <stddef.h>
+#include <stdio.h>
 
 namespace art {
 
@@ -38,6 +39,11 @@ void VisualizeDexLayout(dex_ir::Header* header,
                         size_t dex_file_index,
                         ProfileCompilationInfo* profile_info);
 
+void ShowDexLayoutPageCounts(dex_ir::Header* header,
+                             const DexFile* dex_file,
+                             ProfileCompilationInfo* profile_info,
+                             FILE* out_file);
+
 }  // namespace art
 
 #endif  // ART_DEXLAYOUT_DEX_VISUALIZE_H_
@@ -25,9 +25,14 @@
 #include <inttypes.h>
 #include <stdio.h>
 
+#include <algorithm>
 #include <iostream>
+#include <limits>
+#include <map>
 #include <memory>
 #include <sstream>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 #include "android-base/stringprintf.h"
@@ -1491,6 +1496,32 @@ void DexLayout::DumpDexFile() {
   }
 }
 
+LayoutType GetMethodLayoutType(const ProfileCompilationInfo* info,
+                               const DexFile* dex_file,
+                               uint32_t method_idx) {
+  uint8_t flags = info->GetMethodFlags(MethodReference(dex_file, method_idx));
+  if ((flags & kProfileMethodFlagStartup) != 0) {
+    return kLayoutTypeStartup;
+  }
+  if ((flags & (kProfileMethodFlagHot | kProfileMethodFlagPostStartup)) != 0) {
+    return kLayoutTypeHot;
+  }
+  return kLayoutTypeCold;
+}
+
+// Calls `visitor` with the methods of the class data, direct methods first.
+template <typename Visitor>
+static void VisitMethods(dex_ir::ClassData* class_data, const Visitor& visitor) {
+  for (dex_ir::MethodItemVector* methods :
+           { class_data->DirectMethods(), class_data->VirtualMethods() }) {
+    if (methods != nullptr) {
+      for (std::unique_ptr<dex_ir::MethodItem>& method : *methods) {
+        visitor(method.get());
+      }
+    }
+  }
+}
+
 std::vector<dex_ir::ClassData*> DexLayout::LayoutClassDefsAndClassData(const DexFile* dex_file) {
   std::vector<dex_ir::ClassDef*> new_class_def_order;
   for (std::unique_ptr<dex_ir::ClassDef>& class_def : header_->GetCollections().ClassDefs()) {
@@ -1505,10 +1536,11 @@ std::vector<dex_ir::ClassData*> DexLayout::LayoutClassDefsAndClassData(const Dex
       new_class_def_order.push_back(class_def.get());
     }
   }
+  // The class data of the classes loaded at startup, i.e. the resolved classes of the profile
+  // and the classes of startup methods, come first. Then the classes of the hot methods.
   uint32_t class_defs_offset = header_->GetCollections().ClassDefsOffset();
-  uint32_t class_data_offset = header_->GetCollections().ClassDatasOffset();
   std::unordered_set<dex_ir::ClassData*> visited_class_data;
-  std::vector<dex_ir::ClassData*> new_class_data_order;
+  std::vector<dex_ir::ClassData*> class_data_by_type[kLayoutTypeCount];
   for (uint32_t i = 0; i < new_class_def_order.size(); ++i) {
     dex_ir::ClassDef* class_def = new_class_def_order[i];
     class_def->SetIndex(i);
@@ -1516,19 +1548,36 @@ std::vector<dex_ir::ClassData*> DexLayout::LayoutClassDefsAndClassData(const Dex
     class_defs_offset += dex_ir::ClassDef::ItemSize();
     dex_ir::ClassData* class_data = class_def->GetClassData();
     if (class_data != nullptr && visited_class_data.find(class_data) == visited_class_data.end()) {
+      visited_class_data.insert(class_data);
+      LayoutType layout_type = kLayoutTypeCold;
+      if (info_->ContainsClass(*dex_file, dex::TypeIndex(class_def->ClassType()->GetIndex()))) {
+        layout_type = kLayoutTypeStartup;
+      }
+      VisitMethods(class_data, [&](dex_ir::MethodItem* method) {
+        layout_type = std::min(
+            layout_type, GetMethodLayoutType(info_, dex_file, method->GetMethodId()->GetIndex()));
+      });
+      class_data_by_type[layout_type].push_back(class_data);
+    }
+  }
+  uint32_t class_data_offset = header_->GetCollections().ClassDatasOffset();
+  std::vector<dex_ir::ClassData*> new_class_data_order;
+  for (const std::vector<dex_ir::ClassData*>& class_datas : class_data_by_type) {
+    for (dex_ir::ClassData* class_data : class_datas) {
       class_data->SetOffset(class_data_offset);
       class_data_offset += class_data->GetSize();
-      visited_class_data.insert(class_data);
       new_class_data_order.push_back(class_data);
     }
   }
   return new_class_data_order;
 }
 
-// Orders code items according to specified class data ordering.
+// Orders code items by the layout type of their methods, and according to the specified class
+// data ordering within each layout type.
 // NOTE: If the section following the code items is byte aligned, the last code item is left in
 // place to preserve alignment. Layout needs an overhaul to handle movement of other sections.
-int32_t DexLayout::LayoutCodeItems(std::vector<dex_ir::ClassData*> new_class_data_order) {
+int32_t DexLayout::LayoutCodeItems(const DexFile* dex_file,
+                                   const std::vector<dex_ir::ClassData*>& new_class_data_order) {
   // Do not move code items if class data section precedes code item section.
   // ULEB encoding is variable length, causing problems determining the offset of the code items.
   // TODO: We should swap the order of these sections in the future to avoid this issue.
@@ -1553,30 +1602,297 @@ int32_t DexLayout::LayoutCodeItems(std::vector<dex_ir::ClassData*> new_class_dat
     visited_code_items.insert(last_code_item);
   }
 
+  // A code item shared by several methods goes with the method laid out first.
+  std::vector<dex_ir::CodeItem*> code_items_by_type[kLayoutTypeCount];
+  for (size_t i = 0; i != kLayoutTypeCount; ++i) {
+    for (dex_ir::ClassData* class_data : new_class_data_order) {
+      VisitMethods(class_data, [&](dex_ir::MethodItem* method) {
+        dex_ir::CodeItem* code_item = method->GetCodeItem();
+        if (code_item != nullptr &&
+            visited_code_items.find(code_item) == visited_code_items.end() &&
+            GetMethodLayoutType(info_, dex_file, method->GetMethodId()->GetIndex()) == i) {
+          visited_code_items.insert(code_item);
+          code_items_by_type[i].push_back(code_item);
+        }
+      });
+    }
+  }
+  std::unordered_map<dex_ir::CodeItem*, uint32_t> old_code_item_offsets;
+  for (const std::vector<dex_ir::CodeItem*>& code_items : code_items_by_type) {
+    for (dex_ir::CodeItem* code_item : code_items) {
+      old_code_item_offsets.emplace(code_item, code_item->GetOffset());
+      code_item->SetOffset(code_item_offset);
+      code_item_offset += RoundUp(code_item->GetSize(), kDexCodeItemAlignment);
+    }
+  }
+
+  // The code offsets of the class data are ULEB128 encoded, so the class data move with the
+  // difference in encoded size of the offsets preceding them.
   int32_t diff = 0;
   for (dex_ir::ClassData* class_data : new_class_data_order) {
     class_data->SetOffset(class_data->GetOffset() + diff);
-    for (auto& method : *class_data->DirectMethods()) {
-      dex_ir::CodeItem* code_item = method->GetCodeItem();
-      if (code_item != nullptr && visited_code_items.find(code_item) == visited_code_items.end()) {
-        visited_code_items.insert(code_item);
-        diff += UnsignedLeb128Size(code_item_offset) - UnsignedLeb128Size(code_item->GetOffset());
-        code_item->SetOffset(code_item_offset);
-        code_item_offset += RoundUp(code_item->GetSize(), kDexCodeItemAlignment);
+    VisitMethods(class_data, [&](dex_ir::MethodItem* method) {
+      auto it = old_code_item_offsets.find(method->GetCodeItem());
+      if (it != old_code_item_offsets.end()) {
+        diff += UnsignedLeb128Size(it->first->GetOffset()) - UnsignedLeb128Size(it->second);
       }
+    });
+  }
+  // Adjust diff to be 4-byte aligned.
+  return RoundUp(diff, kDexCodeItemAlignment);
+}
+
+// Orders string data so that the strings used by the code of startup methods come first, then
+// the strings used by the code of hot methods. The others keep their original order. String data
+// items are byte aligned, so the section keeps its size.
+void DexLayout::LayoutStringData(const DexFile* dex_file,
+                                 const std::vector<dex_ir::ClassData*>& new_class_data_order) {
+  dex_ir::Collections& collections = header_->GetCollections();
+  std::unordered_set<dex_ir::StringData*> visited_string_data;
+  // The string data of a shared data section are not part of the dex file.
+  for (std::unique_ptr<dex_ir::StringData>& string_data : collections.SharedStringDatas()) {
+    visited_string_data.insert(string_data.get());
+  }
+  std::vector<dex_ir::StringData*> string_data_by_type[kLayoutTypeCount];
+  auto add_string_data = [&](dex_ir::StringId* string_id, size_t layout_type) {
+    dex_ir::StringData* string_data = string_id->DataItem();
+    if (visited_string_data.insert(string_data).second) {
+      string_data_by_type[layout_type].push_back(string_data);
+    }
+  };
+  for (size_t i = 0; i != kLayoutTypeCold; ++i) {
+    for (dex_ir::ClassData* class_data : new_class_data_order) {
+      VisitMethods(class_data, [&](dex_ir::MethodItem* method) {
+        dex_ir::CodeItem* code_item = method->GetCodeItem();
+        if (code_item == nullptr ||
+            code_item->GetCodeFixups() == nullptr ||
+            GetMethodLayoutType(info_, dex_file, method->GetMethodId()->GetIndex()) != i) {
+          return;
+        }
+        const dex_ir::CodeFixups* fixups = code_item->GetCodeFixups();
+        for (dex_ir::StringId* string_id : *fixups->StringIds()) {
+          add_string_data(string_id, i);
+        }
+        // Resolving a type looks up its descriptor.
+        for (dex_ir::TypeId* type_id : *fixups->TypeIds()) {
+          add_string_data(type_id->GetStringId(), i);
+        }
+      });
+    }
+  }
+  // The string data map is ordered by original offset.
+  uint32_t string_data_offset = collections.StringDatasOffset();
+  uint32_t original_end = string_data_offset;
+  uint32_t packed_size = 0u;
+  for (auto& string_data_pair : collections.StringDatas()) {
+    dex_ir::StringData* string_data = string_data_pair.second.get();
+    if (visited_string_data.find(string_data) == visited_string_data.end()) {
+      string_data_by_type[kLayoutTypeCold].push_back(string_data);
+    }
+    // The size does not include the null terminator, which the writer leaves as zero.
+    original_end = std::max(original_end, string_data->GetOffset() + string_data->GetSize() + 1u);
+    packed_size += string_data->GetSize() + 1u;
+  }
+  // Do not move string data if the strings of the input overlap or are not null terminated.
+  if (packed_size > original_end - collections.StringDatasOffset()) {
+    return;
+  }
+  for (const std::vector<dex_ir::StringData*>& string_datas : string_data_by_type) {
+    for (dex_ir::StringData* string_data : string_datas) {
+      string_data->SetOffset(string_data_offset);
+      string_data_offset += string_data->GetSize() + 1u;
     }
-    for (auto& method : *class_data->VirtualMethods()) {
-      dex_ir::CodeItem* code_item = method->GetCodeItem();
-      if (code_item != nullptr && visited_code_items.find(code_item) == visited_code_items.end()) {
-        visited_code_items.insert(code_item);
-        diff += UnsignedLeb128Size(code_item_offset) - UnsignedLeb128Size(code_item->GetOffset());
-        code_item->SetOffset(code_item_offset);
-        code_item_offset += RoundUp(code_item->GetSize(), kDexCodeItemAlignment);
+  }
+}
+
+// Moves `string_datas` to the shared data section, and packs the remaining string data.
+void DexLayout::MoveToSharedStringData(
+    const std::unordered_set<dex_ir::StringData*>& string_datas) {
+  dex_ir::Collections& collections = header_->GetCollections();
+  auto string_data_size = [](const dex_ir::StringData* string_data) {
+    return string_data->GetSize() + 1u;
+  };
+  uint32_t original_end = collections.StringDatasOffset();
+  for (auto& string_data_pair : collections.StringDatas()) {
+    dex_ir::StringData* string_data = string_data_pair.second.get();
+    original_end = std::max(original_end, string_data->GetOffset() + string_data_size(string_data));
+  }
+  collections.MoveToSharedStringDatas(string_datas);
+  PackSection(collections.StringDatas(),
+              collections.StringDatasOffset(),
+              original_end,
+              string_data_size);
+}
+
+uint32_t DexLayout::DedupeDebugInfo() {
+  dex_ir::Collections& collections = header_->GetCollections();
+  std::map<uint32_t, std::unique_ptr<dex_ir::DebugInfoItem>>& debug_info_items =
+      collections.DebugInfoItems();
+  if (debug_info_items.empty()) {
+    return 0u;
+  }
+  // The first debug info item with some contents, in original order, is kept.
+  std::map<std::vector<uint8_t>, dex_ir::DebugInfoItem*> unique_debug_info;
+  std::map<dex_ir::DebugInfoItem*, dex_ir::DebugInfoItem*> replacements;
+  uint32_t original_end = collections.DebugInfoItemsOffset();
+  for (auto& debug_info_pair : debug_info_items) {
+    dex_ir::DebugInfoItem* debug_info = debug_info_pair.second.get();
+    original_end =
+        std::max(original_end, debug_info->GetOffset() + debug_info->GetDebugInfoSize());
+    std::vector<uint8_t> contents(debug_info->GetDebugInfo(),
+                                  debug_info->GetDebugInfo() + debug_info->GetDebugInfoSize());
+    auto it = unique_debug_info.emplace(std::move(contents), debug_info).first;
+    if (it->second != debug_info) {
+      replacements.emplace(debug_info, it->second);
+    }
+  }
+  if (replacements.empty()) {
+    return 0u;
+  }
+
+  std::unordered_set<dex_ir::DebugInfoItem*> duplicates;
+  for (const auto& replacement : replacements) {
+    duplicates.insert(replacement.first);
+  }
+  for (auto& code_item_pair : collections.CodeItems()) {
+    dex_ir::CodeItem* code_item = code_item_pair.second.get();
+    auto it = replacements.find(code_item->DebugInfo());
+    if (it != replacements.end()) {
+      code_item->SetDebugInfo(it->second);
+    }
+  }
+  collections.RemoveDebugInfoItems(duplicates);
+  return PackSection(debug_info_items,
+                     collections.DebugInfoItemsOffset(),
+                     original_end,
+                     [](const dex_ir::DebugInfoItem* debug_info) {
+                       return debug_info->GetDebugInfoSize();
+                     });
+}
+
+template<class T, class SizeFn>
+uint32_t DexLayout::PackSection(std::map<uint32_t, std::unique_ptr<T>>& map,
+                                uint32_t section_offset,
+                                uint32_t original_end,
+                                SizeFn size_fn) {
+  uint32_t packed_size = 0u;
+  for (auto& pair : map) {
+    packed_size += size_fn(pair.second.get());
+  }
+  // Leave the items in place if the items of the input overlap.
+  if (packed_size > original_end - section_offset) {
+    return 0u;
+  }
+  // Keep the order of the items, the map is ordered by original offset.
+  std::vector<T*> items;
+  for (auto& pair : map) {
+    items.push_back(pair.second.get());
+  }
+  std::sort(items.begin(),
+            items.end(),
+            [](const T* a, const T* b) { return a->GetOffset() < b->GetOffset(); });
+  uint32_t offset = section_offset;
+  for (T* item : items) {
+    item->SetOffset(offset);
+    offset += size_fn(item);
+  }
+  uint32_t saved = RoundDown(original_end - offset, kDexCodeItemAlignment);
+  if (saved != 0u) {
+    FixupSections(section_offset, -saved);
+    header_->SetFileSize(header_->FileSize() - saved);
+  }
+  return saved;
+}
+
+bool DexLayout::LayoutSharedData(Options& options,
+                                 ProfileCompilationInfo* info,
+                                 const std::vector<const DexFile*>& dex_files,
+                                 /*out*/std::vector<std::unique_ptr<MemMap>>* dex_file_maps,
+                                 /*out*/std::vector<uint8_t>* shared_data,
+                                 /*out*/std::string* error_msg) {
+  std::vector<std::unique_ptr<dex_ir::Header>> headers;
+  std::vector<std::unique_ptr<DexLayout>> dex_layouts;
+  // The number of dex files using each string. The string data already in a shared data section
+  // stay there.
+  std::map<std::string, size_t> string_counts;
+  for (const DexFile* dex_file : dex_files) {
+    headers.emplace_back(dex_ir::DexIrBuilder(*dex_file));
+    dex_layouts.emplace_back(new DexLayout(options, info, nullptr, headers.back().get()));
+    if (info != nullptr) {
+      dex_layouts.back()->LayoutOutputFile(dex_file);
+    }
+    if (options.dedupe_debug_info_) {
+      dex_layouts.back()->DedupeDebugInfo();
+    }
+    dex_ir::Collections& collections = headers.back()->GetCollections();
+    for (auto& string_data_pair : collections.StringDatas()) {
+      ++string_counts[string_data_pair.second->Data()];
+    }
+    for (std::unique_ptr<dex_ir::StringData>& string_data : collections.SharedStringDatas()) {
+      string_counts[string_data->Data()] += dex_files.size();
+    }
+  }
+
+  // Lay out the shared data section, sorted like the string ids.
+  std::map<std::string, uint32_t> shared_string_offsets;
+  shared_data->clear();
+  for (const auto& string_count : string_counts) {
+    if (string_count.second > 1u) {
+      const std::string& data = string_count.first;
+      shared_string_offsets.emplace(data, shared_data->size());
+      EncodeUnsignedLeb128(shared_data, CountModifiedUtf8Chars(data.c_str()));
+      shared_data->insert(shared_data->end(), data.begin(), data.end());
+      shared_data->push_back(0u);
+    }
+  }
+
+  // Remove the shared string data from the dex files, then place the dex files one after the
+  // other, followed by the shared data section.
+  std::vector<uint32_t> dex_file_offsets;
+  uint32_t offset = 0u;
+  for (size_t i = 0; i != dex_files.size(); ++i) {
+    dex_ir::Collections& collections = headers[i]->GetCollections();
+    std::unordered_set<dex_ir::StringData*> string_datas;
+    for (auto& string_data_pair : collections.StringDatas()) {
+      if (shared_string_offsets.find(string_data_pair.second->Data()) !=
+          shared_string_offsets.end()) {
+        string_datas.insert(string_data_pair.second.get());
       }
     }
+    dex_layouts[i]->MoveToSharedStringData(string_datas);
+    offset = RoundUp(offset, kSharedDataDexFileAlignment);
+    dex_file_offsets.push_back(offset);
+    offset += headers[i]->FileSize();
+  }
+  const uint32_t shared_data_offset = offset;
+  if (static_cast<uint64_t>(shared_data_offset) + shared_data->size() >
+      std::numeric_limits<uint32_t>::max()) {
+    *error_msg = "Dex files with a shared data section exceed 4GiB";
+    return false;
+  }
+
+  dex_file_maps->clear();
+  for (size_t i = 0; i != dex_files.size(); ++i) {
+    for (std::unique_ptr<dex_ir::StringData>& string_data :
+             headers[i]->GetCollections().SharedStringDatas()) {
+      auto it = shared_string_offsets.find(string_data->Data());
+      DCHECK(it != shared_string_offsets.end());
+      string_data->SetOffset(shared_data_offset + it->second - dex_file_offsets[i]);
+    }
+    std::unique_ptr<MemMap> mem_map(MemMap::MapAnonymous("layout dex",
+                                                         nullptr,
+                                                         headers[i]->FileSize(),
+                                                         PROT_READ | PROT_WRITE,
+                                                         /* low_4gb */ false,
+                                                         /* reuse */ false,
+                                                         error_msg));
+    if (mem_map == nullptr) {
+      return false;
+    }
+    DexWriter::Output(headers[i].get(), mem_map.get());
+    dex_file_maps->push_back(std::move(mem_map));
   }
-  // Adjust diff to be 4-byte aligned.
-  return RoundUp(diff, kDexCodeItemAlignment);
+  return true;
 }
 
 bool DexLayout::IsNextSectionCodeItemAligned(uint32_t offset) {
@@ -1684,7 +2000,8 @@ void DexLayout::FixupSections(uint32_t offset, uint32_t diff) {
 
 void DexLayout::LayoutOutputFile(const DexFile* dex_file) {
   std::vector<dex_ir::ClassData*> new_class_data_order = LayoutClassDefsAndClassData(dex_file);
-  int32_t diff = LayoutCodeItems(new_class_data_order);
+  LayoutStringData(dex_file, new_class_data_order);
+  int32_t diff = LayoutCodeItems(dex_file, new_class_data_order);
   // Move sections after ClassData by diff bytes.
   FixupSections(header_->GetCollections().ClassDatasOffset(), diff);
   // Update file size.
@@ -1745,6 +2062,18 @@ void DexLayout::ProcessDexFile(const char* file_name,
     return;
   }
 
+  if (options_.show_page_counts_) {
+    fprintf(out_file_, "Pages touched by the profile in '%s' %zu, original layout:\n",
+            file_name, dex_file_index);
+    ShowDexLayoutPageCounts(header_, dex_file, info_, out_file_);
+    // The layout only updates the offsets of the items, there is no need to write the file.
+    LayoutOutputFile(dex_file);
+    fprintf(out_file_, "Pages touched by the profile in '%s' %zu, new layout:\n",
+            file_name, dex_file_index);
+    ShowDexLayoutPageCounts(header_, dex_file, info_, out_file_);
+    return;
+  }
+
   // Dump dex file.
   if (options_.dump_) {
     DumpDexFile();
@@ -1755,6 +2084,13 @@ void DexLayout::ProcessDexFile(const char* file_name,
     if (info_ != nullptr) {
       LayoutOutputFile(dex_file);
     }
+    if (options_.dedupe_debug_info_) {
+      uint32_t saved = DedupeDebugInfo();
+      if (options_.verbose_) {
+        fprintf(out_file_, "Deduplicated debug info of '%s' %zu, saved %u bytes\n",
+                file_name, dex_file_index, saved);
+      }
+    }
     OutputDexFile(dex_file->GetLocation());
   }
 }
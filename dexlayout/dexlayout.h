@@ -26,6 +26,11 @@
 #include <stdint.h>
 #include <stdio.h>
 
+#include <memory>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
 #include "dex_ir.h"
 #include "mem_map.h"
 
@@ -49,12 +54,14 @@ class Options {
   bool dump_ = false;
   bool build_dex_ir_ = false;
   bool checksum_only_ = false;
+  bool dedupe_debug_info_ = false;
   bool disassemble_ = false;
   bool exports_only_ = false;
   bool ignore_bad_checksum_ = false;
   bool output_to_memmap_ = false;
   bool show_annotations_ = false;
   bool show_file_headers_ = false;
+  bool show_page_counts_ = false;
   bool show_section_headers_ = false;
   bool verbose_ = false;
   bool visualize_pattern_ = false;
@@ -64,6 +71,19 @@ class Options {
   const char* profile_file_name_ = nullptr;
 };
 
+// The groups of items in a new layout, in the order they are placed in each section.
+enum LayoutType : size_t {
+  kLayoutTypeStartup,  // Items used by startup methods.
+  kLayoutTypeHot,      // Items used by hot or post-startup methods.
+  kLayoutTypeCold,     // Items not used by the methods of the profile.
+  kLayoutTypeCount,
+};
+
+// Returns the group of the code and data of a method, based on its ProfileMethodFlag values.
+LayoutType GetMethodLayoutType(const ProfileCompilationInfo* info,
+                               const DexFile* dex_file,
+                               uint32_t method_idx);
+
 class DexLayout {
  public:
   DexLayout(Options& options,
@@ -81,6 +101,21 @@ class DexLayout {
 
   MemMap* GetAndReleaseMemMap() { return mem_map_.release(); }
 
+  // The alignment of the dex files placed before a shared data section.
+  static constexpr size_t kSharedDataDexFileAlignment = 4u;
+
+  // Writes `dex_files` to be placed one after the other, each aligned on
+  // kSharedDataDexFileAlignment, and followed by `shared_data`. The shared data section holds
+  // the string data used by several of the dex files, once. The dex files are laid out with
+  // the profile first, if any. Their string ids point to the shared data section after their
+  // end, so they are only valid in such a container, like a vdex file.
+  static bool LayoutSharedData(Options& options,
+                               ProfileCompilationInfo* info,
+                               const std::vector<const DexFile*>& dex_files,
+                               /*out*/std::vector<std::unique_ptr<MemMap>>* dex_file_maps,
+                               /*out*/std::vector<uint8_t>* shared_data,
+                               /*out*/std::string* error_msg);
+
  private:
   void DumpAnnotationSetItem(dex_ir::AnnotationSetItem* set_item);
   void DumpBytecodes(uint32_t idx, const dex_ir::CodeItem* code, uint32_t code_offset);
@@ -106,13 +141,29 @@ class DexLayout {
   void DumpDexFile();
 
   std::vector<dex_ir::ClassData*> LayoutClassDefsAndClassData(const DexFile* dex_file);
-  int32_t LayoutCodeItems(std::vector<dex_ir::ClassData*> new_class_data_order);
+  int32_t LayoutCodeItems(const DexFile* dex_file,
+                          const std::vector<dex_ir::ClassData*>& new_class_data_order);
+  void LayoutStringData(const DexFile* dex_file,
+                        const std::vector<dex_ir::ClassData*>& new_class_data_order);
+  void MoveToSharedStringData(const std::unordered_set<dex_ir::StringData*>& string_datas);
+  // Makes the code items with identical debug info share one debug info item, and packs the
+  // debug info section. Returns the number of bytes removed from the dex file.
+  uint32_t DedupeDebugInfo();
+  // Places the items of a data section one after the other from `section_offset`, in their
+  // original order. The sections after it move back by the space saved up to `original_end`,
+  // rounded down to keep them aligned. Returns the number of bytes removed from the dex file.
+  template<class T, class SizeFn>
+  uint32_t PackSection(std::map<uint32_t, std::unique_ptr<T>>& map,
+                       uint32_t section_offset,
+                       uint32_t original_end,
+                       SizeFn size_fn);
   bool IsNextSectionCodeItemAligned(uint32_t offset);
   template<class T> void FixupSection(std::map<uint32_t, std::unique_ptr<T>>& map, uint32_t diff);
   void FixupSections(uint32_t offset, uint32_t diff);
 
   // Creates a new layout for the dex file based on profile info.
-  // Currently reorders ClassDefs, ClassDataItems, and CodeItems.
+  // Currently reorders ClassDefs, ClassDataItems, CodeItems and StringDataItems. The items used
+  // by startup methods are placed first, then the items used by hot methods, then the others.
   void LayoutOutputFile(const DexFile* dex_file);
   void OutputDexFile(const std::string& dex_file_location);
 
@@ -44,7 +44,7 @@ static const char* kProgramName = "dexlayout";
 static void Usage(void) {
   fprintf(stderr, "Copyright (C) 2016 The Android Open Source Project\n\n");
   fprintf(stderr, "%s: [-a] [-c] [-d] [-e] [-f] [-h] [-i] [-l layout] [-o outfile] [-p profile]"
-                  " [-s] [-w directory] dexfile...\n\n", kProgramName);
+                  " [-s] [-t] [-u] [-w directory] dexfile...\n\n", kProgramName);
   fprintf(stderr, " -a : display annotations\n");
   fprintf(stderr, " -b : build dex_ir\n");
   fprintf(stderr, " -c : verify checksum and exit\n");
@@ -57,6 +57,8 @@ static void Usage(void) {
   fprintf(stderr, " -o : output file name (defaults to stdout)\n");
   fprintf(stderr, " -p : profile file name (defaults to no profile)\n");
   fprintf(stderr, " -s : visualize reference pattern\n");
+  fprintf(stderr, " -t : count the pages touched by the profile before and after layout\n");
+  fprintf(stderr, " -u : share identical debug info items in the output dex files\n");
   fprintf(stderr, " -w : output dex directory \n");
 }
 
@@ -75,7 +77,7 @@ int DexlayoutDriver(int argc, char** argv) {
 
   // Parse all arguments.
   while (1) {
-    const int ic = getopt(argc, argv, "abcdefghil:mo:p:sw:");
+    const int ic = getopt(argc, argv, "abcdefghil:mo:p:stuw:");
     if (ic < 0) {
       break;  // done
     }
@@ -127,6 +129,13 @@ int DexlayoutDriver(int argc, char** argv) {
         options.visualize_pattern_ = true;
         options.verbose_ = false;
         break;
+      case 't':  // count pages touched by the profile
+        options.show_page_counts_ = true;
+        options.verbose_ = false;
+        break;
+      case 'u':  // share identical debug info items
+        options.dedupe_debug_info_ = true;
+        break;
       case 'w':  // output dex files directory
         options.output_dex_directory_ = optarg;
         break;
@@ -145,6 +154,10 @@ int DexlayoutDriver(int argc, char** argv) {
     fprintf(stderr, "Can't specify both -c and -i\n");
     want_usage = true;
   }
+  if (options.show_page_counts_ && options.profile_file_name_ == nullptr) {
+    fprintf(stderr, "Can't specify -t without -p\n");
+    want_usage = true;
+  }
   if (want_usage) {
     Usage();
     return 2;
@@ -21,6 +21,7 @@
 #include <sys/types.h>
 #include <unistd.h>
 
+#include "android-base/file.h"
 #include "base/unix_file/fd_file.h"
 #include "common_runtime_test.h"
 #include "exec_utils.h"
@@ -41,7 +42,7 @@ static const char kDexFileLayoutInputDex[] =
     "AAAAdQEAAAAQAAABAAAAjAEAAA==";
 
 static const char kDexFileLayoutInputProfile[] =
-    "cHJvADAwNAABCwABAAAAAAD1KW3+Y2xhc3Nlcy5kZXgBAA==";
+    "cHJvADAwNgABCwABAAAAAAAAAAAA9Slt/mNsYXNzZXMuZGV4AQA=";
 
 static const char kDexFileLayoutExpectedOutputDex[] =
     "ZGV4CjAzNQD1KW3+B8NAB0f2A/ZVIBJ0aHrGIqcpVTAUAgAAcAAAAHhWNBIAAAAAAAAAAIwBAAAH"
@@ -512,4 +513,58 @@ TEST_F(DexLayoutTest, ClassDataBeforeCode) {
   }
 }
 
+TEST_F(DexLayoutTest, PageCounts) {
+  ScratchFile temp;
+  WriteBase64ToFile(kDexFileLayoutInputDex, temp.GetFile());
+  ScratchFile temp2;
+  WriteBase64ToFile(kDexFileLayoutInputProfile, temp2.GetFile());
+  EXPECT_EQ(temp.GetFile()->Flush(), 0);
+  ScratchFile output;
+  std::string dexlayout = GetTestAndroidRoot() + "/bin/dexlayout";
+  EXPECT_TRUE(OS::FileExists(dexlayout.c_str())) << dexlayout << " should be a valid file path";
+  std::vector<std::string> dexlayout_exec_argv = {
+      dexlayout, "-t", "-p", temp2.GetFilename(), "-o", output.GetFilename(), temp.GetFilename() };
+  std::string error_msg;
+  ASSERT_TRUE(::art::Exec(dexlayout_exec_argv, &error_msg)) << error_msg;
+  std::string page_counts;
+  ASSERT_TRUE(android::base::ReadFileToString(output.GetFilename(), &page_counts));
+  EXPECT_NE(page_counts.find("original layout"), std::string::npos) << page_counts;
+  EXPECT_NE(page_counts.find("new layout"), std::string::npos) << page_counts;
+  EXPECT_NE(page_counts.find("total"), std::string::npos) << page_counts;
+}
+
+TEST_F(DexLayoutTest, DedupeDebugInfo) {
+  // Disable test on target.
+  TEST_DISABLED_FOR_TARGET();
+  ScratchFile tmp_file;
+  const std::string& tmp_name = tmp_file.GetFilename();
+  std::string tmp_dir = tmp_name.substr(0, tmp_name.rfind('/') + 1);
+  std::string dexlayout = GetTestAndroidRoot() + "/bin/dexlayout";
+  EXPECT_TRUE(OS::FileExists(dexlayout.c_str())) << dexlayout << " should be a valid file path";
+
+  for (const std::string& dex_file : GetLibCoreDexFileNames()) {
+    std::vector<std::string> dexlayout_exec_argv =
+        { dexlayout, "-u", "-w", tmp_dir, "-o", tmp_name, dex_file };
+    std::string error_msg;
+    ASSERT_TRUE(::art::Exec(dexlayout_exec_argv, &error_msg)) << error_msg;
+    std::string output_dex = tmp_dir + dex_file.substr(dex_file.rfind('/') + 1);
+    std::vector<std::unique_ptr<const DexFile>> input_dex_files;
+    ASSERT_TRUE(DexFile::Open(dex_file.c_str(),
+                              dex_file,
+                              /* verify_checksum */ true,
+                              &error_msg,
+                              &input_dex_files)) << error_msg;
+    // The output keeps the checksum of the input, only check that it passes the verifier.
+    std::vector<std::unique_ptr<const DexFile>> output_dex_files;
+    ASSERT_TRUE(DexFile::Open(output_dex.c_str(),
+                              output_dex,
+                              /* verify_checksum */ false,
+                              &error_msg,
+                              &output_dex_files)) << error_msg;
+    ASSERT_EQ(1u, output_dex_files.size());
+    EXPECT_LE(output_dex_files[0]->Size(), input_dex_files[0]->Size());
+    EXPECT_EQ(0, unlink(output_dex.c_str()));
+  }
+}
+
 }  // namespace art
@@ -2301,10 +2301,11 @@ class ImageDumper {
       ImtConflictTable* table = method->GetImtConflictTable(image_header_.GetPointerSize());
       if (table != nullptr) {
         indent_os << "IMT conflict table " << table << " method: ";
-        for (size_t i = 0, count = table->NumEntries(pointer_size); i < count; ++i) {
-          indent_os << ArtMethod::PrettyMethod(table->GetImplementationMethod(i, pointer_size))
-                    << " ";
-        }
+        table->Visit([&indent_os](const std::pair<ArtMethod*, ArtMethod*>& methods)
+            REQUIRES_SHARED(Locks::mutator_lock_) {
+          indent_os << ArtMethod::PrettyMethod(methods.second) << " ";
+          return methods;
+        }, pointer_size);
       }
     } else {
       const DexFile::CodeItem* code_item = method->GetCodeItem();
@@ -3059,15 +3060,11 @@ class IMTDumper {
       std::cerr << "    <No IMT?>" << std::endl;
       return;
     }
-    size_t table_index = 0;
-    for (;;) {
-      ArtMethod* ptr = table->GetInterfaceMethod(table_index, pointer_size);
-      if (ptr == nullptr) {
-        return;
-      }
-      table_index++;
-      std::cerr << "    " << ptr->PrettyMethod(true) << std::endl;
-    }
+    table->Visit([](const std::pair<ArtMethod*, ArtMethod*>& methods)
+        REQUIRES_SHARED(Locks::mutator_lock_) {
+      std::cerr << "    " << methods.first->PrettyMethod(true) << std::endl;
+      return methods;
+    }, pointer_size);
   }
 
   static ImTable* PrepareAndGetImTable(Runtime* runtime,
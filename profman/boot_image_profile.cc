@@ -0,0 +1,199 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "boot_image_profile.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "base/logging.h"
+#include "jit/mapped_profile.h"
+#include "utils.h"
+
+namespace art {
+
+BootImageProfile::DexFileCounts::DexFileCounts(const DexFile* dex)
+    : dex_file(dex),
+      method_counts(dex->NumMethodIds(), 0u),
+      method_flags(dex->NumMethodIds(), 0u),
+      class_counts(dex->NumTypeIds(), 0u) {}
+
+BootImageProfile::BootImageProfile(const std::vector<std::unique_ptr<const DexFile>>& dex_files)
+    : number_of_profiles_(0u) {
+  dex_files_.reserve(dex_files.size());
+  for (const std::unique_ptr<const DexFile>& dex_file : dex_files) {
+    dex_file_indexes_.emplace(
+        ProfileCompilationInfo::GetProfileDexFileKey(dex_file->GetLocation()), dex_files_.size());
+    dex_files_.emplace_back(dex_file.get());
+  }
+}
+
+bool BootImageProfile::AddProfile(const MappedProfile& profile, std::string* error_msg) {
+  // Check the checksums first, so that a profile with a stale dex file is not counted at all.
+  std::vector<bool> in_profile(dex_files_.size(), false);
+  bool has_boot_dex_file = false;
+  for (size_t i = 0; i != dex_files_.size(); ++i) {
+    const DexFile* dex_file = dex_files_[i].dex_file;
+    uint32_t checksum;
+    if (profile.GetDexFileChecksum(
+            ProfileCompilationInfo::GetProfileDexFileKey(dex_file->GetLocation()), &checksum)) {
+      if (checksum != dex_file->GetLocationChecksum()) {
+        *error_msg = "Checksum mismatch for " + dex_file->GetLocation();
+        return false;
+      }
+      in_profile[i] = true;
+      has_boot_dex_file = true;
+    }
+  }
+  ++number_of_profiles_;
+  if (!has_boot_dex_file) {
+    return true;
+  }
+
+  auto find_counts = [&](const std::string& dex_location) -> DexFileCounts* {
+    auto it = dex_file_indexes_.find(dex_location);
+    return (it != dex_file_indexes_.end() && in_profile[it->second])
+        ? &dex_files_[it->second]
+        : nullptr;
+  };
+  profile.VisitMethodsAndClasses(
+      [&](const std::string& dex_location, uint16_t method_index, uint8_t flags) {
+        DexFileCounts* counts = find_counts(dex_location);
+        if (counts != nullptr && method_index < counts->method_counts.size()) {
+          ++counts->method_counts[method_index];
+          counts->method_flags[method_index] |= flags;
+        }
+      },
+      [&](const std::string& dex_location, dex::TypeIndex type_index) {
+        DexFileCounts* counts = find_counts(dex_location);
+        if (counts != nullptr && type_index.index_ < counts->class_counts.size()) {
+          ++counts->class_counts[type_index.index_];
+        }
+      });
+  return true;
+}
+
+uint32_t BootImageProfile::GetMethodCount(const MethodReference& method_ref) const {
+  auto it = dex_file_indexes_.find(
+      ProfileCompilationInfo::GetProfileDexFileKey(method_ref.dex_file->GetLocation()));
+  if (it == dex_file_indexes_.end()) {
+    return 0u;
+  }
+  const DexFileCounts& counts = dex_files_[it->second];
+  return (method_ref.dex_method_index < counts.method_counts.size())
+      ? counts.method_counts[method_ref.dex_method_index]
+      : 0u;
+}
+
+uint32_t BootImageProfile::GetClassCount(const DexFile& dex_file,
+                                         dex::TypeIndex type_index) const {
+  auto it = dex_file_indexes_.find(
+      ProfileCompilationInfo::GetProfileDexFileKey(dex_file.GetLocation()));
+  if (it == dex_file_indexes_.end()) {
+    return 0u;
+  }
+  const DexFileCounts& counts = dex_files_[it->second];
+  return (type_index.index_ < counts.class_counts.size())
+      ? counts.class_counts[type_index.index_]
+      : 0u;
+}
+
+bool BootImageProfile::GenerateProfile(const Options& options,
+                                       /*out*/ProfileCompilationInfo* profile) const {
+  for (const DexFileCounts& counts : dex_files_) {
+    const DexFile* dex_file = counts.dex_file;
+    for (size_t i = 0; i != counts.method_counts.size(); ++i) {
+      if (counts.method_counts[i] >= options.method_threshold &&
+          !profile->AddMethodIndex(dex_file->GetLocation(),
+                                   dex_file->GetLocationChecksum(),
+                                   static_cast<uint16_t>(i),
+                                   counts.method_flags[i])) {
+        return false;
+      }
+    }
+    for (size_t i = 0; i != counts.class_counts.size(); ++i) {
+      if (counts.class_counts[i] >= options.class_threshold &&
+          !profile->AddClassIndex(dex_file->GetLocation(),
+                                  dex_file->GetLocationChecksum(),
+                                  dex::TypeIndex(static_cast<uint16_t>(i)))) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+std::vector<std::string> BootImageProfile::GetCompiledMethods(const Options& options) const {
+  std::vector<std::pair<uint32_t, std::string>> methods;
+  for (const DexFileCounts& counts : dex_files_) {
+    for (size_t i = 0; i != counts.method_counts.size(); ++i) {
+      if (counts.method_counts[i] >= options.method_threshold) {
+        // CompilerDriver::IsMethodToCompile() looks up the pretty method with its signature.
+        methods.emplace_back(counts.method_counts[i],
+                             counts.dex_file->PrettyMethod(i, /* with_signature */ true));
+      }
+    }
+  }
+  // Most frequent first, so that the head of the list is the most valuable to compile.
+  std::stable_sort(methods.begin(),
+                   methods.end(),
+                   [](const std::pair<uint32_t, std::string>& a,
+                      const std::pair<uint32_t, std::string>& b) {
+                     return a.first > b.first;
+                   });
+  std::vector<std::string> result;
+  result.reserve(methods.size());
+  for (auto& method : methods) {
+    result.push_back(std::move(method.second));
+  }
+  return result;
+}
+
+std::vector<std::string> BootImageProfile::GetImageClasses(const Options& options) const {
+  return GetClasses(options.class_threshold);
+}
+
+std::vector<std::string> BootImageProfile::GetPreloadedClasses(const Options& options) const {
+  return GetClasses(options.preloaded_class_threshold);
+}
+
+std::vector<std::string> BootImageProfile::GetClasses(uint32_t threshold) const {
+  std::vector<std::pair<uint32_t, std::string>> classes;
+  for (const DexFileCounts& counts : dex_files_) {
+    for (size_t i = 0; i != counts.class_counts.size(); ++i) {
+      if (counts.class_counts[i] >= threshold) {
+        // dex2oat reads --image-classes as dotted names.
+        const char* descriptor =
+            counts.dex_file->StringByTypeIdx(dex::TypeIndex(static_cast<uint16_t>(i)));
+        classes.emplace_back(counts.class_counts[i], DescriptorToDot(descriptor));
+      }
+    }
+  }
+  std::stable_sort(classes.begin(),
+                   classes.end(),
+                   [](const std::pair<uint32_t, std::string>& a,
+                      const std::pair<uint32_t, std::string>& b) {
+                     return a.first > b.first;
+                   });
+  std::vector<std::string> result;
+  result.reserve(classes.size());
+  for (auto& klass : classes) {
+    result.push_back(std::move(klass.second));
+  }
+  return result;
+}
+
+}  // namespace art
@@ -0,0 +1,102 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_PROFMAN_BOOT_IMAGE_PROFILE_H_
+#define ART_PROFMAN_BOOT_IMAGE_PROFILE_H_
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/macros.h"
+#include "dex_file.h"
+#include "jit/profile_compilation_info.h"
+
+namespace art {
+
+class MappedProfile;
+
+// Aggregates app profiles into the profile of the boot image. For each method and class of
+// the boot class path dex files, counts the number of profiles containing it. The methods and
+// classes found in enough profiles are then written as a boot profile, and as the lists
+// given to dex2oat with --compiled-methods and --image-classes.
+class BootImageProfile {
+ public:
+  struct Options {
+    Options() : method_threshold(10u), class_threshold(10u), preloaded_class_threshold(100u) {}
+
+    // Minimum number of profiles containing a method for it to be compiled.
+    uint32_t method_threshold;
+    // Minimum number of profiles containing a class for it to be in the image.
+    uint32_t class_threshold;
+    // Minimum number of profiles containing a class for it to be preloaded.
+    uint32_t preloaded_class_threshold;
+  };
+
+  // `dex_files` are the dex files of the boot class path. They must outlive this object.
+  explicit BootImageProfile(const std::vector<std::unique_ptr<const DexFile>>& dex_files);
+
+  // Count the boot class path methods and classes of `profile`. The other dex files of the
+  // profile are ignored. Returns false if the profile has a boot class path dex file with a
+  // different checksum.
+  bool AddProfile(const MappedProfile& profile, std::string* error_msg);
+
+  size_t GetNumberOfProfiles() const {
+    return number_of_profiles_;
+  }
+
+  // Return the number of profiles containing the method or the class.
+  uint32_t GetMethodCount(const MethodReference& method_ref) const;
+  uint32_t GetClassCount(const DexFile& dex_file, dex::TypeIndex type_index) const;
+
+  // Add the methods and classes above the thresholds to `profile`. The methods keep the union
+  // of their ProfileMethodFlag values in the app profiles.
+  bool GenerateProfile(const Options& options, /*out*/ProfileCompilationInfo* profile) const;
+
+  // Return the methods above the method threshold, in the format of --compiled-methods.
+  std::vector<std::string> GetCompiledMethods(const Options& options) const;
+
+  // Return the classes above the class threshold, in the format of --image-classes.
+  std::vector<std::string> GetImageClasses(const Options& options) const;
+
+  // Return the classes above the preloaded class threshold, in the format of --image-classes.
+  std::vector<std::string> GetPreloadedClasses(const Options& options) const;
+
+ private:
+  struct DexFileCounts {
+    explicit DexFileCounts(const DexFile* dex);
+
+    const DexFile* dex_file;
+    std::vector<uint32_t> method_counts;
+    std::vector<uint8_t> method_flags;
+    std::vector<uint32_t> class_counts;
+  };
+
+  // Return the classes in at least `threshold` profiles, most frequent first.
+  std::vector<std::string> GetClasses(uint32_t threshold) const;
+
+  std::vector<DexFileCounts> dex_files_;
+  // Index in `dex_files_` of the dex files, keyed by profile key.
+  std::map<std::string, size_t> dex_file_indexes_;
+  size_t number_of_profiles_;
+
+  DISALLOW_COPY_AND_ASSIGN(BootImageProfile);
+};
+
+}  // namespace art
+
+#endif  // ART_PROFMAN_BOOT_IMAGE_PROFILE_H_
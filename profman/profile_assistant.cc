@@ -16,7 +16,17 @@
 
 #include "profile_assistant.h"
 
+#include <pthread.h>
+
+#include <algorithm>
+#include <functional>
+#include <map>
+
+#include "base/logging.h"
+#include "base/time_utils.h"
 #include "base/unix_file/fd_file.h"
+#include "jit/mapped_profile.h"
+#include "jit/profile_journal.h"
 #include "os.h"
 
 namespace art {
@@ -26,42 +36,299 @@ namespace art {
 static constexpr const uint32_t kMinNewMethodsForCompilation = 10;
 static constexpr const uint32_t kMinNewClassesForCompilation = 10;
 
+static bool InitFlock(const std::string& filename, ScopedFlock& flock, std::string* error) {
+  return flock.Init(filename.c_str(), O_RDWR, /* block */ true, error);
+}
+
+static bool InitFlock(int fd, ScopedFlock& flock, std::string* error) {
+  DCHECK_GE(fd, 0);
+  // We do not own the descriptor, so disable auto-close and don't check usage.
+  File file(fd, false);
+  file.DisableAutoClose();
+  return flock.Init(&file, error);
+}
+
+// The current profiles, given either by name or by descriptor. Each profile is opened and
+// locked only while it is merged, so the number of open files does not grow with the number
+// of profiles.
+class ProfileAssistant::ProfileFiles {
+ public:
+  explicit ProfileFiles(const std::vector<std::string>& filenames)
+      : filenames_(&filenames), fds_(nullptr) {}
+  explicit ProfileFiles(const std::vector<int>& fds) : filenames_(nullptr), fds_(&fds) {}
+
+  size_t Size() const {
+    return (filenames_ != nullptr) ? filenames_->size() : fds_->size();
+  }
+
+  // Will block until the lock is acquired.
+  bool Lock(size_t index, /* out */ ScopedFlock* flock, /* out */ std::string* error) const {
+    bool locked = (filenames_ != nullptr)
+        ? InitFlock((*filenames_)[index], *flock, error)
+        : InitFlock((*fds_)[index], *flock, error);
+    if (!locked) {
+      *error += " (index=" + std::to_string(index) + ")";
+    }
+    return locked;
+  }
+
+ private:
+  const std::vector<std::string>* const filenames_;
+  const std::vector<int>* const fds_;
+};
+
+// Counts the profiles containing each method and class. The counts are kept in arrays
+// indexed by the method and type indexes, so their size does not depend on the number of
+// profiles.
+class ProfileCounts {
+ public:
+  void Add(const MappedProfile& profile) {
+    profile.VisitMethodsAndClasses(
+        [this](const std::string& dex_location,
+               uint16_t method_index,
+               uint8_t flags ATTRIBUTE_UNUSED) {
+          Increment(&dex_files_[dex_location].methods, method_index, 1u);
+        },
+        [this](const std::string& dex_location, dex::TypeIndex type_index) {
+          Increment(&dex_files_[dex_location].classes, type_index.index_, 1u);
+        });
+  }
+
+  void Add(const ProfileCounts& other) {
+    for (const auto& it : other.dex_files_) {
+      DexFileCounts& counts = dex_files_[it.first];
+      for (size_t i = 0; i != it.second.methods.size(); ++i) {
+        Increment(&counts.methods, i, it.second.methods[i]);
+      }
+      for (size_t i = 0; i != it.second.classes.size(); ++i) {
+        Increment(&counts.classes, i, it.second.classes[i]);
+      }
+    }
+  }
+
+  uint32_t GetMethodCount(const std::string& dex_location, uint16_t method_index) const {
+    auto it = dex_files_.find(dex_location);
+    return (it != dex_files_.end()) ? Get(it->second.methods, method_index) : 0u;
+  }
+
+  uint32_t GetClassCount(const std::string& dex_location, dex::TypeIndex type_index) const {
+    auto it = dex_files_.find(dex_location);
+    return (it != dex_files_.end()) ? Get(it->second.classes, type_index.index_) : 0u;
+  }
+
+ private:
+  struct DexFileCounts {
+    std::vector<uint32_t> methods;
+    std::vector<uint32_t> classes;
+  };
+
+  static void Increment(std::vector<uint32_t>* counts, size_t index, uint32_t value) {
+    if (index >= counts->size()) {
+      counts->resize(index + 1u, 0u);
+    }
+    (*counts)[index] += value;
+  }
+
+  static uint32_t Get(const std::vector<uint32_t>& counts, size_t index) {
+    return (index < counts.size()) ? counts[index] : 0u;
+  }
+
+  std::map<std::string, DexFileCounts> dex_files_;
+};
+
+// The merge of a range of the current profiles.
+struct PartialMerge {
+  PartialMerge() : lock_failed(false) {}
+
+  std::unique_ptr<MappedProfile> profile;
+  ProfileCounts counts;
+  std::string error;
+  bool lock_failed;
+};
+
+// Merge the profiles in [begin, end) one after the other. Only the merged profile and the
+// profile being merged are in memory, and only the latter is open and locked.
+static void MergeRange(const ProfileAssistant::ProfileFiles& profile_files,
+                       size_t begin,
+                       size_t end,
+                       bool count,
+                       /*out*/PartialMerge* result) {
+  result->profile = MappedProfile::Create(std::vector<uint8_t>(), &result->error);
+  for (size_t i = begin; i != end && result->profile != nullptr; ++i) {
+    ScopedFlock flock;
+    if (!profile_files.Lock(i, &flock, &result->error)) {
+      result->error = "Could not lock profile files: " + result->error;
+      result->lock_failed = true;
+      result->profile = nullptr;
+      break;
+    }
+    // The profile is mapped privately, it stays valid once the file is closed.
+    std::unique_ptr<MappedProfile> profile =
+        MappedProfile::Open(flock.GetFile()->Fd(), &result->error);
+    if (profile == nullptr) {
+      result->error = "Could not load profile file at index " + std::to_string(i) + ": " +
+          result->error;
+      result->profile = nullptr;
+      break;
+    }
+    if (count) {
+      result->counts.Add(*profile);
+    }
+    result->profile = MappedProfile::Merge(*result->profile, *profile, &result->error);
+  }
+}
+
+struct ParallelTaskArgs {
+  const std::function<void(size_t)>* task;
+  size_t index;
+};
+
+static void* RunParallelTask(void* arg) {
+  ParallelTaskArgs* args = reinterpret_cast<ParallelTaskArgs*>(arg);
+  (*args->task)(args->index);
+  return nullptr;
+}
+
+// Run `task(i)` for each i in [0, n) on its own thread and wait for all of them. profman does
+// not start a runtime, so the tasks run on plain threads.
+static void RunInParallel(size_t n, const std::function<void(size_t)>& task) {
+  if (n == 1u) {
+    task(0u);
+    return;
+  }
+  std::vector<ParallelTaskArgs> args(n);
+  std::vector<pthread_t> threads(n);
+  for (size_t i = 0; i != n; ++i) {
+    args[i].task = &task;
+    args[i].index = i;
+    CHECK_PTHREAD_CALL(pthread_create,
+                       (&threads[i], nullptr, &RunParallelTask, &args[i]),
+                       "profile merge");
+  }
+  for (size_t i = 0; i != n; ++i) {
+    CHECK_PTHREAD_CALL(pthread_join, (threads[i], nullptr), "profile merge");
+  }
+}
+
+// Merge the current profiles with a tree reduction: each thread merges a range of the
+// profiles, then the partial results are merged pairwise in parallel. The left operand of
+// each merge comes first in `profile_files`, so the dex files end up in the same order as
+// with a sequential merge.
+static std::unique_ptr<MappedProfile> MergeProfiles(
+    const ProfileAssistant::ProfileFiles& profile_files,
+    const ProfileAssistant::MergeOptions& options,
+    /*out*/std::string* error,
+    /*out*/bool* lock_failed) {
+  const size_t num_profiles = profile_files.Size();
+  const size_t num_threads =
+      std::max<size_t>(1u, std::min<size_t>(options.num_threads, num_profiles));
+  const bool count = options.min_percentage != 0u;
+  std::vector<PartialMerge> partials(num_threads);
+  RunInParallel(num_threads, [&](size_t i) {
+    MergeRange(profile_files,
+               num_profiles * i / num_threads,
+               num_profiles * (i + 1u) / num_threads,
+               count,
+               &partials[i]);
+  });
+  for (size_t step = 1u; step < num_threads; step *= 2u) {
+    std::vector<size_t> lefts;
+    for (size_t left = 0u; left + step < num_threads; left += 2u * step) {
+      lefts.push_back(left);
+    }
+    RunInParallel(lefts.size(), [&](size_t i) {
+      PartialMerge& left = partials[lefts[i]];
+      PartialMerge& right = partials[lefts[i] + step];
+      if (left.profile == nullptr || right.profile == nullptr) {
+        if (left.profile != nullptr) {
+          left.error = right.error;
+          left.lock_failed = right.lock_failed;
+        }
+        left.profile = nullptr;
+        return;
+      }
+      left.profile = MappedProfile::Merge(*left.profile, *right.profile, &left.error);
+      right.profile = nullptr;
+      left.counts.Add(right.counts);
+      right.counts = ProfileCounts();
+    });
+  }
+
+  PartialMerge& result = partials[0];
+  if (result.profile == nullptr) {
+    *error = result.error;
+    *lock_failed = result.lock_failed;
+    return nullptr;
+  }
+  if (!count) {
+    return std::move(result.profile);
+  }
+  const uint64_t min_count = (static_cast<uint64_t>(options.min_percentage) * num_profiles + 99u) /
+      100u;
+  const ProfileCounts& counts = result.counts;
+  return MappedProfile::Filter(
+      *result.profile,
+      [&](const std::string& dex_location, uint16_t method_index) {
+        return counts.GetMethodCount(dex_location, method_index) >= min_count;
+      },
+      [&](const std::string& dex_location, dex::TypeIndex type_index) {
+        return counts.GetClassCount(dex_location, type_index) >= min_count;
+      },
+      error);
+}
+
 ProfileAssistant::ProcessingResult ProfileAssistant::ProcessProfilesInternal(
-        const std::vector<ScopedFlock>& profile_files,
-        const ScopedFlock& reference_profile_file) {
-  DCHECK(!profile_files.empty());
-
-  ProfileCompilationInfo info;
-  // Load the reference profile.
-  if (!info.Load(reference_profile_file.GetFile()->Fd())) {
-    LOG(WARNING) << "Could not load reference profile file";
+        const ProfileFiles& profile_files,
+        const ScopedFlock& reference_profile_file,
+        const MergeOptions& options) {
+  DCHECK_NE(profile_files.Size(), 0u);
+
+  // Map the reference profile. The profiles are merged by streaming their sorted sections
+  // together, without loading them into ProfileCompilationInfo maps.
+  std::string error;
+  std::unique_ptr<MappedProfile> info =
+      MappedProfile::Open(reference_profile_file.GetFile()->Fd(), &error);
+  if (info == nullptr) {
+    LOG(WARNING) << "Could not load reference profile file: " << error;
     return kErrorBadProfiles;
   }
 
   // Store the current state of the reference profile before merging with the current profiles.
-  uint32_t number_of_methods = info.GetNumberOfMethods();
-  uint32_t number_of_classes = info.GetNumberOfResolvedClasses();
+  uint32_t number_of_methods = info->GetNumberOfMethods();
+  uint32_t number_of_classes = info->GetNumberOfResolvedClasses();
 
   // Merge all current profiles.
-  for (size_t i = 0; i < profile_files.size(); i++) {
-    if (!info.Load(profile_files[i].GetFile()->Fd())) {
-      LOG(WARNING) << "Could not load profile file at index " << i;
-      return kErrorBadProfiles;
-    }
+  uint64_t start_ns = NanoTime();
+  bool lock_failed = false;
+  std::unique_ptr<MappedProfile> profiles =
+      MergeProfiles(profile_files, options, &error, &lock_failed);
+  if (profiles != nullptr) {
+    info = MappedProfile::Merge(*info, *profiles, &error);
   }
+  if (profiles == nullptr || info == nullptr) {
+    LOG(WARNING) << error;
+    return lock_failed ? kErrorCannotLock : kErrorBadProfiles;
+  }
+  uint64_t merge_ns = NanoTime() - start_ns;
+  VLOG(profiler) << "Merged " << profile_files.Size() << " profiles with "
+                 << options.num_threads << " threads in " << PrettyDuration(merge_ns) << " ("
+                 << profile_files.Size() * MsToNs(1000) / std::max<uint64_t>(merge_ns, 1u)
+                 << " profiles/s)";
 
   // Check if there is enough new information added by the current profiles.
-  if (((info.GetNumberOfMethods() - number_of_methods) < kMinNewMethodsForCompilation) &&
-      ((info.GetNumberOfResolvedClasses() - number_of_classes) < kMinNewClassesForCompilation)) {
+  if (((info->GetNumberOfMethods() - number_of_methods) < kMinNewMethodsForCompilation) &&
+      ((info->GetNumberOfResolvedClasses() - number_of_classes) < kMinNewClassesForCompilation)) {
     return kSkipCompilation;
   }
 
   // We were successful in merging all profile information. Update the reference profile.
+  // The merged profile is held in memory, it does not refer to the mapping of the reference
+  // profile which we are about to truncate.
   if (!reference_profile_file.GetFile()->ClearContent()) {
     PLOG(WARNING) << "Could not clear reference profile file";
     return kErrorIO;
   }
-  if (!info.Save(reference_profile_file.GetFile()->Fd())) {
+  if (!info->Save(reference_profile_file.GetFile()->Fd())) {
     LOG(WARNING) << "Could not save reference profile file";
     return kErrorIO;
   }
@@ -69,88 +336,44 @@ ProfileAssistant::ProcessingResult ProfileAssistant::ProcessProfilesInternal(
   return kCompile;
 }
 
-static bool InitFlock(const std::string& filename, ScopedFlock& flock, std::string* error) {
-  return flock.Init(filename.c_str(), O_RDWR, /* block */ true, error);
-}
-
-static bool InitFlock(int fd, ScopedFlock& flock, std::string* error) {
-  DCHECK_GE(fd, 0);
-  // We do not own the descriptor, so disable auto-close and don't check usage.
-  File file(fd, false);
-  file.DisableAutoClose();
-  return flock.Init(&file, error);
-}
-
-class ScopedCollectionFlock {
- public:
-  explicit ScopedCollectionFlock(size_t size) : flocks_(size) {}
-
-  // Will block until all the locks are acquired.
-  bool Init(const std::vector<std::string>& filenames, /* out */ std::string* error) {
-    for (size_t i = 0; i < filenames.size(); i++) {
-      if (!InitFlock(filenames[i], flocks_[i], error)) {
-        *error += " (index=" + std::to_string(i) + ")";
-        return false;
-      }
-    }
-    return true;
-  }
-
-  // Will block until all the locks are acquired.
-  bool Init(const std::vector<int>& fds, /* out */ std::string* error) {
-    for (size_t i = 0; i < fds.size(); i++) {
-      DCHECK_GE(fds[i], 0);
-      if (!InitFlock(fds[i], flocks_[i], error)) {
-        *error += " (index=" + std::to_string(i) + ")";
-        return false;
-      }
-    }
-    return true;
-  }
-
-  const std::vector<ScopedFlock>& Get() const { return flocks_; }
-
- private:
-  std::vector<ScopedFlock> flocks_;
-};
-
 ProfileAssistant::ProcessingResult ProfileAssistant::ProcessProfiles(
         const std::vector<int>& profile_files_fd,
-        int reference_profile_file_fd) {
+        int reference_profile_file_fd,
+        const MergeOptions& options) {
   DCHECK_GE(reference_profile_file_fd, 0);
   std::string error;
-  ScopedCollectionFlock profile_files_flocks(profile_files_fd.size());
-  if (!profile_files_flocks.Init(profile_files_fd, &error)) {
-    LOG(WARNING) << "Could not lock profile files: " << error;
-    return kErrorCannotLock;
-  }
   ScopedFlock reference_profile_file_flock;
   if (!InitFlock(reference_profile_file_fd, reference_profile_file_flock, &error)) {
     LOG(WARNING) << "Could not lock reference profiled files: " << error;
     return kErrorCannotLock;
   }
 
-  return ProcessProfilesInternal(profile_files_flocks.Get(),
-                                 reference_profile_file_flock);
+  return ProcessProfilesInternal(ProfileFiles(profile_files_fd),
+                                 reference_profile_file_flock,
+                                 options);
 }
 
 ProfileAssistant::ProcessingResult ProfileAssistant::ProcessProfiles(
         const std::vector<std::string>& profile_files,
-        const std::string& reference_profile_file) {
-  std::string error;
-  ScopedCollectionFlock profile_files_flocks(profile_files.size());
-  if (!profile_files_flocks.Init(profile_files, &error)) {
-    LOG(WARNING) << "Could not lock profile files: " << error;
-    return kErrorCannotLock;
+        const std::string& reference_profile_file,
+        const MergeOptions& options) {
+  for (const std::string& profile_file : profile_files) {
+    uint64_t bytes_written = 0;
+    if (!ProfileJournal::Compact(profile_file, &bytes_written)) {
+      // Merge what is in the profile, the journal is merged by the next processing.
+      LOG(WARNING) << "Could not compact the profile journal of " << profile_file;
+    }
   }
+  std::string error;
   ScopedFlock reference_profile_file_flock;
   if (!InitFlock(reference_profile_file, reference_profile_file_flock, &error)) {
     LOG(WARNING) << "Could not lock reference profile files: " << error;
     return kErrorCannotLock;
   }
 
-  return ProcessProfilesInternal(profile_files_flocks.Get(),
-                                 reference_profile_file_flock);
+  return ProcessProfilesInternal(ProfileFiles(profile_files),
+                                 reference_profile_file_flock,
+                                 options);
 }
 
 }  // namespace art
@@ -37,6 +37,18 @@ class ProfileAssistant {
     kErrorCannotLock = 4
   };
 
+  // How the current profiles are merged.
+  struct MergeOptions {
+    MergeOptions() : num_threads(1u), min_percentage(0u) {}
+
+    // Number of threads merging the current profiles. The profiles are split in ranges merged
+    // in parallel, and the results are then merged pairwise.
+    uint32_t num_threads;
+    // Keep only the methods and classes found in at least this percentage of the current
+    // profiles. Zero keeps all of them. The reference profile is always kept whole.
+    uint32_t min_percentage;
+  };
+
   // Process the profile information present in the given files. Returns one of
   // ProcessingResult values depending on profile information and whether or not
   // the analysis ended up successfully (i.e. no errors during reading,
@@ -51,18 +63,28 @@ class ProfileAssistant {
   // merge of the current profiles and the reference one is insignificant. In
   // this case no file will be updated.
   //
+  // The journals which the runtime appends next to the current profiles are compacted into
+  // them first. They cannot be found from file descriptors, so the variant taking
+  // descriptors only sees the data of the last compaction.
+  //
   static ProcessingResult ProcessProfiles(
       const std::vector<std::string>& profile_files,
-      const std::string& reference_profile_file);
+      const std::string& reference_profile_file,
+      const MergeOptions& options = MergeOptions());
 
   static ProcessingResult ProcessProfiles(
       const std::vector<int>& profile_files_fd_,
-      int reference_profile_file_fd);
+      int reference_profile_file_fd,
+      const MergeOptions& options = MergeOptions());
+
+  // The current profiles, opened and locked one at a time while they are merged.
+  class ProfileFiles;
 
  private:
   static ProcessingResult ProcessProfilesInternal(
-      const std::vector<ScopedFlock>& profile_files,
-      const ScopedFlock& reference_profile_file);
+      const ProfileFiles& profile_files,
+      const ScopedFlock& reference_profile_file,
+      const MergeOptions& options);
 
   DISALLOW_COPY_AND_ASSIGN(ProfileAssistant);
 };
@@ -16,6 +16,8 @@
 
 #include <gtest/gtest.h>
 
+#include "android-base/file.h"
+
 #include "art_method-inl.h"
 #include "base/unix_file/fd_file.h"
 #include "common_runtime_test.h"
@@ -76,7 +78,9 @@ class ProfileAssistantTest : public CommonRuntimeTest {
     return file_path;
   }
   // Runs test with given arguments.
-  int ProcessProfiles(const std::vector<int>& profiles_fd, int reference_profile_fd) {
+  int ProcessProfiles(const std::vector<int>& profiles_fd,
+                      int reference_profile_fd,
+                      const std::vector<std::string>& extra_args = std::vector<std::string>()) {
     std::string profman_cmd = GetProfmanCmd();
     std::vector<std::string> argv_str;
     argv_str.push_back(profman_cmd);
@@ -84,6 +88,7 @@ class ProfileAssistantTest : public CommonRuntimeTest {
       argv_str.push_back("--profile-file-fd=" + std::to_string(profiles_fd[k]));
     }
     argv_str.push_back("--reference-profile-file-fd=" + std::to_string(reference_profile_fd));
+    argv_str.insert(argv_str.end(), extra_args.begin(), extra_args.end());
 
     std::string error;
     return ExecAndReturnCode(argv_str, &error);
@@ -410,6 +415,82 @@ TEST_F(ProfileAssistantTest, FailProcessingBecauseOfReferenceProfiles) {
   CheckProfileInfo(profile1, info1);
 }
 
+TEST_F(ProfileAssistantTest, AdviseCompilationParallelMerge) {
+  static constexpr size_t kNumberOfProfiles = 5;
+  ScratchFile profiles[kNumberOfProfiles];
+  ProfileCompilationInfo infos[kNumberOfProfiles];
+  ScratchFile reference_profile;
+
+  std::vector<int> profile_fds;
+  ProfileCompilationInfo expected;
+  for (size_t i = 0; i < kNumberOfProfiles; i++) {
+    // Use overlapping dex files and methods so that the partial merges have to be combined.
+    SetupProfile("p" + std::to_string(i % 3),
+                 i % 3 + 1,
+                 /* number_of_methods */ 20,
+                 /* number_of_classes */ i,
+                 profiles[i],
+                 &infos[i],
+                 /* start_method_index */ 10 * i);
+    profile_fds.push_back(GetFd(profiles[i]));
+    ASSERT_TRUE(expected.MergeWith(infos[i]));
+  }
+  int reference_profile_fd = GetFd(reference_profile);
+
+  // The parallel merge must give the same result as merging the profiles one by one.
+  ASSERT_EQ(ProfileAssistant::kCompile,
+            ProcessProfiles(profile_fds, reference_profile_fd, {"--merge-threads=3"}));
+  ProfileCompilationInfo result;
+  ASSERT_TRUE(reference_profile.GetFile()->ResetOffset());
+  ASSERT_TRUE(result.Load(reference_profile_fd));
+  ASSERT_TRUE(expected.Equals(result));
+
+  for (size_t i = 0; i < kNumberOfProfiles; i++) {
+    CheckProfileInfo(profiles[i], infos[i]);
+  }
+}
+
+TEST_F(ProfileAssistantTest, AdviseCompilationMinProfilePercentage) {
+  static constexpr size_t kNumberOfProfiles = 4;
+  ScratchFile profiles[kNumberOfProfiles];
+  ProfileCompilationInfo infos[kNumberOfProfiles];
+  ScratchFile reference_profile;
+
+  // Profile i contains the methods [10 * i, 10 * i + 100). Only the first profile has classes.
+  std::vector<int> profile_fds;
+  for (size_t i = 0; i < kNumberOfProfiles; i++) {
+    SetupProfile("p1",
+                 1,
+                 /* number_of_methods */ 100,
+                 /* number_of_classes */ (i == 0) ? 20 : 0,
+                 profiles[i],
+                 &infos[i],
+                 /* start_method_index */ 10 * i);
+    profile_fds.push_back(GetFd(profiles[i]));
+  }
+  int reference_profile_fd = GetFd(reference_profile);
+
+  // With 50%, only the methods found in at least two profiles are kept: [10, 130).
+  ASSERT_EQ(ProfileAssistant::kCompile,
+            ProcessProfiles(profile_fds,
+                            reference_profile_fd,
+                            {"--merge-threads=2", "--min-profile-percentage=50"}));
+  ProfileCompilationInfo result;
+  ASSERT_TRUE(reference_profile.GetFile()->ResetOffset());
+  ASSERT_TRUE(result.Load(reference_profile_fd));
+
+  ScratchFile expected_profile;
+  ProfileCompilationInfo expected;
+  SetupProfile("p1",
+               1,
+               /* number_of_methods */ 120,
+               /* number_of_classes */ 0,
+               expected_profile,
+               &expected,
+               /* start_method_index */ 10);
+  ASSERT_TRUE(expected.Equals(result));
+}
+
 TEST_F(ProfileAssistantTest, TestProfileGeneration) {
   ScratchFile profile;
   // Generate a test profile.
@@ -560,4 +641,110 @@ TEST_F(ProfileAssistantTest, TestProfileCreateInlineCache) {
   }
 }
 
+TEST_F(ProfileAssistantTest, TestProfileCreateMethodFlags) {
+  // Create the profile content.
+  std::vector<std::string> methods = {
+    "SLTestInline;->inlineMonomorphic(LSuper;)I+LSubA;",
+    "HSPLTestInline;->inlinePolymorphic(LSuper;)I+LSubA;,LSubB;,LSubC;",
+    "LTestInline;->noInlineCache(LSuper;)I"
+  };
+  std::string input_file_contents;
+  for (std::string& m : methods) {
+    input_file_contents += m + std::string("\n");
+  }
+
+  // Create the profile and save it to disk.
+  ScratchFile profile_file;
+  ASSERT_TRUE(CreateProfile(input_file_contents,
+                            profile_file.GetFilename(),
+                            GetTestDexFileName("ProfileTestMultiDex")));
+
+  // Load the profile from disk.
+  ProfileCompilationInfo info;
+  profile_file.GetFile()->ResetOffset();
+  ASSERT_TRUE(info.Load(GetFd(profile_file)));
+
+  ScopedObjectAccess soa(Thread::Current());
+  jobject class_loader = LoadDex("ProfileTestMultiDex");
+  ASSERT_NE(class_loader, nullptr);
+
+  auto get_flags = [&](const std::string& name) REQUIRES_SHARED(Locks::mutator_lock_) {
+    ArtMethod* method = GetVirtualMethod(class_loader, "LTestInline;", name);
+    return info.GetMethodFlags(MethodReference(method->GetDexFile(),
+                                               method->GetDexMethodIndex()));
+  };
+  ASSERT_EQ(kProfileMethodFlagStartup, get_flags("inlineMonomorphic"));
+  ASSERT_EQ(kProfileMethodFlagHot | kProfileMethodFlagStartup | kProfileMethodFlagPostStartup,
+            get_flags("inlinePolymorphic"));
+  // Methods without flags are hot.
+  ASSERT_EQ(kProfileMethodFlagHot, get_flags("noInlineCache"));
+  ASSERT_EQ(0, get_flags("inlineMegamorphic"));
+}
+
+TEST_F(ProfileAssistantTest, TestBootImageProfile) {
+  // Treat the test dex file as the boot class path, and create three app profiles using it.
+  const std::string dex_location = GetTestDexFileName("ProfileTestMultiDex");
+  std::vector<std::string> contents = {
+    "LSubA;\nLSubB;\nHLTestInline;->inlineMonomorphic(LSuper;)I\n"
+        "SLTestInline;->noInlineCache(LSuper;)I\n",
+    "LSubA;\nSLTestInline;->inlineMonomorphic(LSuper;)I\n",
+    "LSubA;\nLSubB;\nLTestInline;->inlinePolymorphic(LSuper;)I\n",
+  };
+  std::vector<std::unique_ptr<ScratchFile>> profiles;
+  for (const std::string& content : contents) {
+    profiles.emplace_back(new ScratchFile());
+    ASSERT_TRUE(CreateProfile(content, profiles.back()->GetFilename(), dex_location));
+  }
+
+  ScratchFile boot_profile;
+  ScratchFile compiled_methods;
+  ScratchFile image_classes;
+  ScratchFile preloaded_classes;
+  std::vector<std::string> argv_str;
+  argv_str.push_back(GetProfmanCmd());
+  argv_str.push_back("--generate-boot-image-profile");
+  for (const std::unique_ptr<ScratchFile>& profile : profiles) {
+    argv_str.push_back("--profile-file=" + profile->GetFilename());
+  }
+  argv_str.push_back("--reference-profile-file=" + boot_profile.GetFilename());
+  argv_str.push_back("--apk=" + dex_location);
+  argv_str.push_back("--dex-location=" + dex_location);
+  argv_str.push_back("--boot-image-method-threshold=2");
+  argv_str.push_back("--boot-image-class-threshold=2");
+  argv_str.push_back("--boot-image-preloaded-class-threshold=3");
+  argv_str.push_back("--compiled-methods-out=" + compiled_methods.GetFilename());
+  argv_str.push_back("--image-classes-out=" + image_classes.GetFilename());
+  argv_str.push_back("--preloaded-classes-out=" + preloaded_classes.GetFilename());
+  std::string error;
+  ASSERT_EQ(0, ExecAndReturnCode(argv_str, &error)) << error;
+
+  std::string output;
+  ASSERT_TRUE(android::base::ReadFileToString(compiled_methods.GetFilename(), &output));
+  ASSERT_EQ("int TestInline.inlineMonomorphic(Super)\n", output);
+  // SubA is in more profiles than SubB, so it comes first.
+  ASSERT_TRUE(android::base::ReadFileToString(image_classes.GetFilename(), &output));
+  ASSERT_EQ("SubA\nSubB\n", output);
+  ASSERT_TRUE(android::base::ReadFileToString(preloaded_classes.GetFilename(), &output));
+  ASSERT_EQ("SubA\n", output);
+
+  ProfileCompilationInfo info;
+  ASSERT_TRUE(info.Load(GetFd(boot_profile)));
+  ScopedObjectAccess soa(Thread::Current());
+  jobject class_loader = LoadDex("ProfileTestMultiDex");
+  ASSERT_NE(class_loader, nullptr);
+  mirror::Class* sub_a = GetClass(class_loader, "LSubA;");
+  mirror::Class* sub_b = GetClass(class_loader, "LSubB;");
+  ASSERT_TRUE(info.ContainsClass(sub_a->GetDexFile(), sub_a->GetDexTypeIndex()));
+  ASSERT_TRUE(info.ContainsClass(sub_b->GetDexFile(), sub_b->GetDexTypeIndex()));
+  auto get_flags = [&](const std::string& name) REQUIRES_SHARED(Locks::mutator_lock_) {
+    ArtMethod* method = GetVirtualMethod(class_loader, "LTestInline;", name);
+    return info.GetMethodFlags(MethodReference(method->GetDexFile(),
+                                               method->GetDexMethodIndex()));
+  };
+  // The flags of the method in the app profiles are merged.
+  ASSERT_EQ(kProfileMethodFlagHot | kProfileMethodFlagStartup, get_flags("inlineMonomorphic"));
+  ASSERT_EQ(0, get_flags("noInlineCache"));
+  ASSERT_EQ(0, get_flags("inlinePolymorphic"));
+}
+
 }  // namespace art
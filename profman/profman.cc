@@ -40,8 +40,10 @@
 #include "dex_file.h"
 #include "jit/profile_compilation_info.h"
 #include "runtime.h"
+#include "jit/mapped_profile.h"
 #include "utils.h"
 #include "zip_archive.h"
+#include "boot_image_profile.h"
 #include "profile_assistant.h"
 
 namespace art {
@@ -110,6 +112,12 @@ NO_RETURN static void Usage(const char *fmt, ...) {
   UsageError("      accepts a file descriptor. Cannot be used together with");
   UsageError("      --reference-profile-file.");
   UsageError("");
+  UsageError("  --merge-threads=<number>: number of threads merging the profiles. Defaults to 1.");
+  UsageError("");
+  UsageError("  --min-profile-percentage=<number>: only keep the methods and classes found in at");
+  UsageError("      least this percentage of the --profile-file or --profile-file-fd profiles.");
+  UsageError("      Must be between 0 and 100. Defaults to 0, which keeps everything.");
+  UsageError("");
   UsageError("  --generate-test-profile=<filename>: generates a random profile file for testing.");
   UsageError("  --generate-test-profile-num-dex=<number>: number of dex files that should be");
   UsageError("      included in the generated profile. Defaults to 20.");
@@ -120,6 +128,22 @@ NO_RETURN static void Usage(const char *fmt, ...) {
   UsageError("");
   UsageError("  --create-profile-from=<filename>: creates a profile from a list of classes.");
   UsageError("");
+  UsageError("  --generate-boot-image-profile: aggregates the --profile-file or --profile-file-fd");
+  UsageError("      app profiles into a boot image profile written to --reference-profile-file");
+  UsageError("      or --reference-profile-file-fd. The boot class path dex files are given with");
+  UsageError("      --apk or --apk-fd.");
+  UsageError("  --boot-image-method-threshold=<number>: minimum number of profiles containing a");
+  UsageError("      boot class path method for it to be compiled. Defaults to 10.");
+  UsageError("  --boot-image-class-threshold=<number>: minimum number of profiles containing a");
+  UsageError("      boot class path class for it to be in the image. Defaults to 10.");
+  UsageError("  --boot-image-preloaded-class-threshold=<number>: minimum number of profiles");
+  UsageError("      containing a boot class path class for it to be preloaded. Defaults to 100.");
+  UsageError("  --compiled-methods-out=<filename>: writes the compiled methods of the boot image");
+  UsageError("      profile, in the format of dex2oat --compiled-methods.");
+  UsageError("  --image-classes-out=<filename>: writes the classes of the boot image profile, in");
+  UsageError("      the format of dex2oat --image-classes.");
+  UsageError("  --preloaded-classes-out=<filename>: writes the preloaded classes.");
+  UsageError("");
   UsageError("");
   UsageError("  --dex-location=<string>: location string to use with corresponding");
   UsageError("      apk-fd to find dex files");
@@ -142,6 +166,11 @@ static const std::string kMethodSep = "->";
 static constexpr char kProfileParsingInlineChacheSep = '+';
 static constexpr char kProfileParsingTypeSep = ',';
 static constexpr char kProfileParsingFirstCharInSignature = '(';
+// Optional prefixes of a method line giving the method flags, e.g. "SPLTestInline;->...".
+// A method without any of them is recorded as hot.
+static constexpr char kProfileParsingHotFlag = 'H';
+static constexpr char kProfileParsingStartupFlag = 'S';
+static constexpr char kProfileParsingPostStartupFlag = 'P';
 
 // TODO(calin): This class has grown too much from its initial design. Split the functionality
 // into smaller, more contained pieces.
@@ -155,6 +184,7 @@ class ProfMan FINAL {
       test_profile_num_dex_(kDefaultTestProfileNumDex),
       test_profile_method_ratio_(kDefaultTestProfileMethodRatio),
       test_profile_class_ratio_(kDefaultTestProfileClassRatio),
+      generate_boot_image_profile_(false),
       start_ns_(NanoTime()) {}
 
   ~ProfMan() {
@@ -197,6 +227,33 @@ class ProfMan FINAL {
         reference_profile_file_ = option.substr(strlen("--reference-profile-file=")).ToString();
       } else if (option.starts_with("--reference-profile-file-fd=")) {
         ParseUintOption(option, "--reference-profile-file-fd", &reference_profile_file_fd_, Usage);
+      } else if (option == "--generate-boot-image-profile") {
+        generate_boot_image_profile_ = true;
+      } else if (option.starts_with("--boot-image-method-threshold=")) {
+        ParseUintOption(option,
+                        "--boot-image-method-threshold",
+                        &boot_image_options_.method_threshold,
+                        Usage);
+      } else if (option.starts_with("--boot-image-class-threshold=")) {
+        ParseUintOption(option,
+                        "--boot-image-class-threshold",
+                        &boot_image_options_.class_threshold,
+                        Usage);
+      } else if (option.starts_with("--boot-image-preloaded-class-threshold=")) {
+        ParseUintOption(option,
+                        "--boot-image-preloaded-class-threshold",
+                        &boot_image_options_.preloaded_class_threshold,
+                        Usage);
+      } else if (option.starts_with("--compiled-methods-out=")) {
+        compiled_methods_out_ = option.substr(strlen("--compiled-methods-out=")).ToString();
+      } else if (option.starts_with("--image-classes-out=")) {
+        image_classes_out_ = option.substr(strlen("--image-classes-out=")).ToString();
+      } else if (option.starts_with("--preloaded-classes-out=")) {
+        preloaded_classes_out_ = option.substr(strlen("--preloaded-classes-out=")).ToString();
+      } else if (option.starts_with("--merge-threads=")) {
+        ParseUintOption(option, "--merge-threads", &merge_options_.num_threads, Usage);
+      } else if (option.starts_with("--min-profile-percentage=")) {
+        ParseUintOption(option, "--min-profile-percentage", &merge_options_.min_percentage, Usage);
       } else if (option.starts_with("--dex-location=")) {
         dex_locations_.push_back(option.substr(strlen("--dex-location=")).ToString());
       } else if (option.starts_with("--apk-fd=")) {
@@ -236,6 +293,12 @@ class ProfMan FINAL {
     if (!apk_files_.empty() && !apks_fd_.empty()) {
       Usage("APK files should not be specified with both --apk-fd and --apk");
     }
+    if (merge_options_.num_threads == 0u) {
+      Usage("--merge-threads must be at least 1");
+    }
+    if (merge_options_.min_percentage > 100u) {
+      Usage("--min-profile-percentage must be between 0 and 100");
+    }
   }
 
   ProfileAssistant::ProcessingResult ProcessProfiles() {
@@ -251,15 +314,20 @@ class ProfMan FINAL {
       Usage("Options --profile-file-fd and --reference-profile-file-fd "
             "should only be used together");
     }
+    MemMap::Init();  // for MappedProfile::Open
     ProfileAssistant::ProcessingResult result;
     if (profile_files_.empty()) {
       // The file doesn't need to be flushed here (ProcessProfiles will do it)
       // so don't check the usage.
       File file(reference_profile_file_fd_, false);
-      result = ProfileAssistant::ProcessProfiles(profile_files_fd_, reference_profile_file_fd_);
+      result = ProfileAssistant::ProcessProfiles(profile_files_fd_,
+                                                 reference_profile_file_fd_,
+                                                 merge_options_);
       CloseAllFds(profile_files_fd_, "profile_files_fd_");
     } else {
-      result = ProfileAssistant::ProcessProfiles(profile_files_, reference_profile_file_);
+      result = ProfileAssistant::ProcessProfiles(profile_files_,
+                                                 reference_profile_file_,
+                                                 merge_options_);
     }
     return result;
   }
@@ -626,10 +694,27 @@ class ProfMan FINAL {
   // Upon success return true and add the class or the method info to profile.
   // The format of the method line is:
   // "LTestInline;->inlinePolymorphic(LSuper;)I+LSubA;,LSubB;,LSubC;".
+  // It may be prefixed with the method flags, for example "HS" for a hot startup method.
   // The method and classes are searched only in the given dex files.
   bool ProcessLine(const std::vector<std::unique_ptr<const DexFile>>& dex_files,
-                   const std::string& line,
+                   const std::string& input_line,
                    /*out*/ProfileCompilationInfo* profile) {
+    uint8_t flags = 0u;
+    size_t flags_size = 0u;
+    for (; flags_size < input_line.size(); ++flags_size) {
+      char c = input_line[flags_size];
+      if (c == kProfileParsingHotFlag) {
+        flags |= kProfileMethodFlagHot;
+      } else if (c == kProfileParsingStartupFlag) {
+        flags |= kProfileMethodFlagStartup;
+      } else if (c == kProfileParsingPostStartupFlag) {
+        flags |= kProfileMethodFlagPostStartup;
+      } else {
+        break;
+      }
+    }
+    const std::string line = input_line.substr(flags_size);
+
     std::string klass;
     std::string method_str;
     size_t method_sep_index = line.find(kMethodSep);
@@ -648,6 +733,10 @@ class ProfMan FINAL {
 
     if (method_str.empty()) {
       // No method to add. Just add the class.
+      if (flags != 0u) {
+        LOG(ERROR) << "Method flags given for a class: " << input_line;
+        return false;
+      }
       std::set<DexCacheResolvedClasses> resolved_class_set;
       const DexFile* dex_file = class_ref.dex_file;
       const auto& dex_resolved_classes = resolved_class_set.emplace(
@@ -691,7 +780,10 @@ class ProfMan FINAL {
     std::vector<ProfileMethodInfo::ProfileInlineCache> inline_caches;
     inline_caches.emplace_back(dex_pc, classes);
     std::vector<ProfileMethodInfo> pmi;
-    pmi.emplace_back(class_ref.dex_file, method_index, inline_caches);
+    pmi.emplace_back(class_ref.dex_file,
+                     method_index,
+                     inline_caches,
+                     (flags != 0u) ? flags : kProfileMethodFlagHot);
 
     profile->AddMethodsAndClasses(pmi, std::set<DexCacheResolvedClasses>());
     return true;
@@ -705,6 +797,8 @@ class ProfMan FINAL {
   //   # Methods with inline caches
   //   LTestInline;->inlinePolymorphic(LSuper;)I+LSubA;,LSubB;,LSubC;
   //   LTestInline;->noInlineCache(LSuper;)I
+  //   # Method executed during and after startup
+  //   SPLTestInline;->noInlineCache(LSuper;)I
   int CreateProfile() {
     // Validate parameters for this command.
     if (apk_files_.empty() && apks_fd_.empty()) {
@@ -788,6 +882,118 @@ class ProfMan FINAL {
     return !test_profile_.empty();
   }
 
+  bool ShouldGenerateBootImageProfile() {
+    return generate_boot_image_profile_;
+  }
+
+  int GenerateBootImageProfile() {
+    // Validate parameters for this command.
+    if (apk_files_.empty() && apks_fd_.empty()) {
+      Usage("Boot class path dex files must be specified with --apk or --apk-fd");
+    }
+    if (dex_locations_.empty()) {
+      Usage("DEX locations must be specified");
+    }
+    if (profile_files_.empty() && profile_files_fd_.empty()) {
+      Usage("No profile files specified.");
+    }
+    if (reference_profile_file_.empty() && !FdIsValid(reference_profile_file_fd_)) {
+      Usage("Boot image profile must be specified with --reference-profile-file or "
+            "--reference-profile-file-fd");
+    }
+    if (boot_image_options_.method_threshold == 0u ||
+        boot_image_options_.class_threshold == 0u ||
+        boot_image_options_.preloaded_class_threshold == 0u) {
+      Usage("Boot image thresholds must be at least 1");
+    }
+    // for ZipArchive::OpenFromFd
+    MemMap::Init();
+    std::vector<std::unique_ptr<const DexFile>> dex_files;
+    OpenApkFilesFromLocations(&dex_files);
+
+    // Count the boot class path methods and classes, one profile at a time.
+    BootImageProfile boot_image_profile(dex_files);
+    auto add_profile = [&boot_image_profile](int fd) {
+      std::string error;
+      std::unique_ptr<MappedProfile> profile = MappedProfile::Open(fd, &error);
+      if (profile == nullptr || !boot_image_profile.AddProfile(*profile, &error)) {
+        // A bad device profile should not invalidate the others.
+        LOG(WARNING) << "Skipping profile fd=" << fd << ": " << error;
+      }
+    };
+    for (int profile_file_fd : profile_files_fd_) {
+      add_profile(profile_file_fd);
+    }
+    for (const std::string& profile_file : profile_files_) {
+      int fd = open(profile_file.c_str(), O_RDONLY);
+      if (!FdIsValid(fd)) {
+        LOG(ERROR) << "Cannot open " << profile_file << strerror(errno);
+        return -1;
+      }
+      add_profile(fd);
+      if (close(fd) < 0) {
+        PLOG(WARNING) << "Failed to close descriptor";
+      }
+    }
+
+    // Write the boot image profile.
+    ProfileCompilationInfo info;
+    if (!boot_image_profile.GenerateProfile(boot_image_options_, &info)) {
+      LOG(ERROR) << "Failed to generate the boot image profile";
+      return -1;
+    }
+    int fd = reference_profile_file_fd_;
+    if (!FdIsValid(fd)) {
+      fd = open(reference_profile_file_.c_str(), O_CREAT | O_TRUNC | O_WRONLY, 0644);
+      if (fd < 0) {
+        LOG(ERROR) << "Cannot open " << reference_profile_file_ << strerror(errno);
+        return -1;
+      }
+    }
+    bool saved = info.Save(fd);
+    if (close(fd) < 0) {
+      PLOG(WARNING) << "Failed to close descriptor";
+    }
+    if (!saved) {
+      LOG(ERROR) << "Failed to save the boot image profile";
+      return -1;
+    }
+    LOG(INFO) << "Boot image profile from " << boot_image_profile.GetNumberOfProfiles()
+              << " profiles: " << info.GetNumberOfMethods() << " methods, "
+              << info.GetNumberOfResolvedClasses() << " classes";
+
+    // Write the lists for dex2oat.
+    if (!compiled_methods_out_.empty() &&
+        !WriteLines(compiled_methods_out_,
+                    boot_image_profile.GetCompiledMethods(boot_image_options_))) {
+      return -1;
+    }
+    if (!image_classes_out_.empty() &&
+        !WriteLines(image_classes_out_,
+                    boot_image_profile.GetImageClasses(boot_image_options_))) {
+      return -1;
+    }
+    if (!preloaded_classes_out_.empty() &&
+        !WriteLines(preloaded_classes_out_,
+                    boot_image_profile.GetPreloadedClasses(boot_image_options_))) {
+      return -1;
+    }
+    return 0;
+  }
+
+  static bool WriteLines(const std::string& filename, const std::vector<std::string>& lines) {
+    std::ofstream out(filename.c_str(), std::ofstream::out | std::ofstream::trunc);
+    for (const std::string& line : lines) {
+      out << line << '\n';
+    }
+    out.close();
+    if (out.fail()) {
+      LOG(ERROR) << "Failed to write " << filename;
+      return false;
+    }
+    return true;
+  }
+
  private:
   static void ParseFdForCollection(const StringPiece& option,
                                    const char* arg_name,
@@ -828,6 +1034,12 @@ class ProfMan FINAL {
   uint16_t test_profile_num_dex_;
   uint16_t test_profile_method_ratio_;
   uint16_t test_profile_class_ratio_;
+  ProfileAssistant::MergeOptions merge_options_;
+  bool generate_boot_image_profile_;
+  BootImageProfile::Options boot_image_options_;
+  std::string compiled_methods_out_;
+  std::string image_classes_out_;
+  std::string preloaded_classes_out_;
   uint64_t start_ns_;
 };
 
@@ -850,6 +1062,9 @@ static int profman(int argc, char** argv) {
   if (profman.ShouldCreateProfile()) {
     return profman.CreateProfile();
   }
+  if (profman.ShouldGenerateBootImageProfile()) {
+    return profman.GenerateBootImageProfile();
+  }
   // Process profile information and assess if we need to do a profile guided compilation.
   // This operation involves I/O.
   return profman.ProcessProfiles();
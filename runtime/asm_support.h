@@ -22,6 +22,7 @@
 #include "base/bit_utils.h"
 #include "gc/allocator/rosalloc.h"
 #include "gc/heap.h"
+#include "imt_conflict_table.h"
 #include "jit/jit.h"
 #include "lock_word.h"
 #include "mirror/class.h"
@@ -249,6 +250,11 @@ ADD_TEST_EQ(MIRROR_STRING_VALUE_OFFSET, art::mirror::String::ValueOffset().Int32
 #define STRING_COMPRESSION_FEATURE 1
 ADD_TEST_EQ(STRING_COMPRESSION_FEATURE, art::mirror::kUseStringCompression);
 
+// Marker of a hashed ImtConflictTable.
+#define IMT_CONFLICT_TABLE_HASHED_MARKER 1
+ADD_TEST_EQ(static_cast<size_t>(IMT_CONFLICT_TABLE_HASHED_MARKER),
+            art::ImtConflictTable::kHashedMarker)
+
 #if defined(__cplusplus)
 }  // End of CheckAsmSupportOffsets.
 #endif
@@ -0,0 +1,190 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "background_verifier.h"
+
+#include "base/systrace.h"
+#include "base/time_utils.h"
+#include "dex_file-inl.h"
+#include "handle_scope-inl.h"
+#include "java_vm_ext.h"
+#include "jni_internal.h"
+#include "mirror/class-inl.h"
+#include "mirror/class_loader.h"
+#include "oat_file.h"
+#include "scoped_thread_state_change-inl.h"
+#include "thread-inl.h"
+#include "thread_pool.h"
+
+namespace art {
+
+// Number of classes verified by a task, so that the classes of a large dex file are spread over
+// the workers.
+static constexpr size_t kClassesPerTask = 64u;
+
+// Same as ANDROID_PRIORITY_BACKGROUND.
+static constexpr int kBackgroundVerifierPthreadPriority = 10;
+
+class BackgroundVerifier::VerifyClassesTask : public SelfDeletingTask {
+ public:
+  VerifyClassesTask(BackgroundVerifier* verifier,
+                    const DexFile* dex_file,
+                    jweak class_loader,
+                    std::vector<uint16_t>&& class_def_indexes)
+      : verifier_(verifier),
+        dex_file_(dex_file),
+        class_loader_(class_loader),
+        class_def_indexes_(std::move(class_def_indexes)) {}
+
+  void Run(Thread* self) OVERRIDE {
+    verifier_->VerifyClasses(self, dex_file_, class_loader_, class_def_indexes_);
+    self->GetJniEnv()->vm->DeleteWeakGlobalRef(self, class_loader_);
+  }
+
+ private:
+  BackgroundVerifier* const verifier_;
+  const DexFile* const dex_file_;
+  const jweak class_loader_;
+  const std::vector<uint16_t> class_def_indexes_;
+
+  DISALLOW_COPY_AND_ASSIGN(VerifyClassesTask);
+};
+
+BackgroundVerifier::BackgroundVerifier(size_t num_threads)
+    : pool_("Background verifier thread pool", num_threads),
+      num_queued_(0u),
+      num_verified_(0u),
+      background_verification_ns_(0u),
+      num_foreground_verified_(0u),
+      foreground_verification_ns_(0u),
+      num_foreground_waits_(0u),
+      foreground_wait_ns_(0u) {
+  pool_.SetPthreadPriority(kBackgroundVerifierPthreadPriority);
+}
+
+BackgroundVerifier::~BackgroundVerifier() {}
+
+void BackgroundVerifier::OnDexFileRegistered(Thread* self,
+                                             const DexFile& dex_file,
+                                             Handle<mirror::ClassLoader> class_loader) {
+  if (IsStopping()) {
+    return;
+  }
+  {
+    ScopedObjectAccessUnchecked soa(self);
+    if (!ClassWorkerPool::CanLoadClassesFor(soa, class_loader.Get())) {
+      VLOG(verifier) << "Not verifying " << dex_file.GetLocation() << " in the background";
+      return;
+    }
+  }
+  // The classes verified ahead of time do not run the method verifier, and loading them early
+  // would only cost memory.
+  const OatFile::OatDexFile* oat_dex_file = dex_file.GetOatDexFile();
+  const bool has_oat_file = oat_dex_file != nullptr && oat_dex_file->GetOatFile() != nullptr;
+  std::vector<std::vector<uint16_t>> chunks;
+  for (size_t i = 0; i != dex_file.NumClassDefs(); ++i) {
+    if (has_oat_file) {
+      mirror::Class::Status status = oat_dex_file->GetOatClass(i).GetStatus();
+      if (status == mirror::Class::kStatusVerified ||
+          status == mirror::Class::kStatusInitialized) {
+        continue;
+      }
+    }
+    if (chunks.empty() || chunks.back().size() == kClassesPerTask) {
+      chunks.emplace_back();
+      chunks.back().reserve(kClassesPerTask);
+    }
+    chunks.back().push_back(static_cast<uint16_t>(i));
+  }
+  if (chunks.empty()) {
+    return;
+  }
+
+  VLOG(verifier) << "Verifying " << ((chunks.size() - 1u) * kClassesPerTask + chunks.back().size())
+                 << " classes of " << dex_file.GetLocation() << " in the background";
+  JavaVMExt* const vm = self->GetJniEnv()->vm;
+  for (std::vector<uint16_t>& chunk : chunks) {
+    const size_t num_classes = chunk.size();
+    // The weak reference lets the class loader be unloaded, its dex file is then no longer used.
+    jweak weak_class_loader = vm->AddWeakGlobalRef(self, class_loader.Get());
+    if (!pool_.AddTask(
+            self, new VerifyClassesTask(this, &dex_file, weak_class_loader, std::move(chunk)))) {
+      // Stopped, the task was deleted without running.
+      vm->DeleteWeakGlobalRef(self, weak_class_loader);
+      break;
+    }
+    num_queued_.FetchAndAddRelaxed(num_classes);
+  }
+}
+
+void BackgroundVerifier::VerifyClasses(Thread* self,
+                                       const DexFile* dex_file,
+                                       jweak class_loader,
+                                       const std::vector<uint16_t>& class_def_indexes) {
+  ScopedTrace trace(__PRETTY_FUNCTION__);
+  if (IsStopping()) {
+    return;
+  }
+  ScopedObjectAccess soa(self);
+  StackHandleScope<1> hs(self);
+  Handle<mirror::ClassLoader> loader(hs.NewHandle(soa.Decode<mirror::ClassLoader>(class_loader)));
+  if (loader == nullptr) {
+    // The class loader was unloaded with its dex files.
+    return;
+  }
+  for (uint16_t class_def_index : class_def_indexes) {
+    if (IsStopping()) {
+      break;
+    }
+    const char* descriptor = dex_file->GetClassDescriptor(dex_file->GetClassDef(class_def_index));
+    bool verified;
+    ClassWorkerPool::FindAndVerifyClass(self, descriptor, loader, &verified);
+  }
+}
+
+void BackgroundVerifier::RecordVerification(Thread* self, uint64_t verification_ns) {
+  if (pool_.IsWorker(self)) {
+    num_verified_.FetchAndAddRelaxed(1u);
+    background_verification_ns_.FetchAndAddRelaxed(verification_ns);
+  } else {
+    num_foreground_verified_.FetchAndAddRelaxed(1u);
+    foreground_verification_ns_.FetchAndAddRelaxed(verification_ns);
+  }
+}
+
+void BackgroundVerifier::RecordWait(Thread* self, uint64_t wait_ns) {
+  if (!pool_.IsWorker(self)) {
+    num_foreground_waits_.FetchAndAddRelaxed(1u);
+    foreground_wait_ns_.FetchAndAddRelaxed(wait_ns);
+  }
+}
+
+void BackgroundVerifier::Stop(Thread* self) {
+  // The queued tasks check IsStopping() and only release their reference to the class loader.
+  pool_.Stop(self);
+}
+
+void BackgroundVerifier::DumpForSigQuit(std::ostream& os) {
+  os << "Background verification: " << num_verified_.LoadRelaxed() << "/"
+     << num_queued_.LoadRelaxed() << " classes verified in "
+     << PrettyDuration(background_verification_ns_.LoadRelaxed())
+     << ", foreground verified " << num_foreground_verified_.LoadRelaxed() << " classes in "
+     << PrettyDuration(foreground_verification_ns_.LoadRelaxed())
+     << ", foreground waited " << num_foreground_waits_.LoadRelaxed() << " times for "
+     << PrettyDuration(foreground_wait_ns_.LoadRelaxed()) << "\n";
+}
+
+}  // namespace art
@@ -0,0 +1,98 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_RUNTIME_BACKGROUND_VERIFIER_H_
+#define ART_RUNTIME_BACKGROUND_VERIFIER_H_
+
+#include <iosfwd>
+#include <memory>
+#include <vector>
+
+#include "atomic.h"
+#include "base/macros.h"
+#include "base/mutex.h"
+#include "class_worker_pool.h"
+#include "handle.h"
+#include "jni.h"
+
+namespace art {
+
+class DexFile;
+class Thread;
+
+namespace mirror {
+class ClassLoader;
+}  // namespace mirror
+
+// Verifies the classes that were not verified ahead of time on low priority background threads,
+// when their dex file is registered with a class loader. A thread initializing a class that is
+// still being verified waits for it in ClassLinker::VerifyClass(), as for a class verified by
+// another app thread. A class failing verification in the background is erroneous, and its first
+// use throws a NoClassDefFoundError caused by the VerifyError.
+class BackgroundVerifier {
+ public:
+  explicit BackgroundVerifier(size_t num_threads);
+  ~BackgroundVerifier();
+
+  // Called when a dex file is registered with a non boot class loader. Queues the verification of
+  // its classes without a verified status in the oat file, unless the workers cannot load classes
+  // for `class_loader`, see ClassWorkerPool::CanLoadClassesFor().
+  void OnDexFileRegistered(Thread* self,
+                           const DexFile& dex_file,
+                           Handle<mirror::ClassLoader> class_loader)
+      REQUIRES_SHARED(Locks::mutator_lock_);
+
+  // Called by ClassLinker::VerifyClass() after running the method verifier for a class, and after
+  // waiting for a class verified by another thread.
+  void RecordVerification(Thread* self, uint64_t verification_ns);
+  void RecordWait(Thread* self, uint64_t wait_ns);
+
+  // Stop verifying and wait for the workers, called during runtime shutdown before the thread
+  // list is deleted. The queued verifications are dropped.
+  void Stop(Thread* self);
+
+  void DumpForSigQuit(std::ostream& os);
+
+ private:
+  class VerifyClassesTask;
+
+  void VerifyClasses(Thread* self,
+                     const DexFile* dex_file,
+                     jweak class_loader,
+                     const std::vector<uint16_t>& class_def_indexes)
+      REQUIRES(!Locks::mutator_lock_);
+
+  bool IsStopping() const {
+    return pool_.IsStopping();
+  }
+
+  ClassWorkerPool pool_;
+
+  // Statistics, for measuring the time taken from the app threads.
+  Atomic<uint32_t> num_queued_;
+  Atomic<uint32_t> num_verified_;
+  Atomic<uint64_t> background_verification_ns_;
+  Atomic<uint32_t> num_foreground_verified_;
+  Atomic<uint64_t> foreground_verification_ns_;
+  Atomic<uint32_t> num_foreground_waits_;
+  Atomic<uint64_t> foreground_wait_ns_;
+
+  DISALLOW_COPY_AND_ASSIGN(BackgroundVerifier);
+};
+
+}  // namespace art
+
+#endif  // ART_RUNTIME_BACKGROUND_VERIFIER_H_
@@ -30,8 +30,7 @@ namespace art {
 static constexpr size_t kMemoryToolRedZoneBytes = 8;
 constexpr size_t Arena::kDefaultSize;
 
-template <bool kCount>
-const char* const ArenaAllocatorStatsImpl<kCount>::kAllocNames[] = {
+static const char* const kAllocNames[] = {
   "Misc         ",
   "SwitchTbl    ",
   "SlowPaths    ",
@@ -87,6 +86,13 @@ const char* const ArenaAllocatorStatsImpl<kCount>::kAllocNames[] = {
   "Scheduler    ",
 };
 
+static_assert(arraysize(kAllocNames) == kNumArenaAllocKinds, "arraysize of kAllocNames");
+
+const char* GetArenaAllocKindName(ArenaAllocKind kind) {
+  DCHECK_LT(static_cast<size_t>(kind), static_cast<size_t>(kNumArenaAllocKinds));
+  return kAllocNames[kind];
+}
+
 template <bool kCount>
 ArenaAllocatorStatsImpl<kCount>::ArenaAllocatorStatsImpl()
     : num_allocations_(0u),
@@ -116,6 +122,11 @@ size_t ArenaAllocatorStatsImpl<kCount>::BytesAllocated() const {
   return std::accumulate(alloc_stats_.begin(), alloc_stats_.end(), init);
 }
 
+template <bool kCount>
+size_t ArenaAllocatorStatsImpl<kCount>::BytesAllocatedByKind(ArenaAllocKind kind) const {
+  return alloc_stats_[kind];
+}
+
 template <bool kCount>
 void ArenaAllocatorStatsImpl<kCount>::Dump(std::ostream& os, const Arena* first,
                                            ssize_t lost_bytes_adjustment) const {
@@ -139,7 +150,6 @@ void ArenaAllocatorStatsImpl<kCount>::Dump(std::ostream& os, const Arena* first,
        << num_allocations << ", avg size: " << bytes_allocated / num_allocations << "\n";
   }
   os << "===== Allocation by kind\n";
-  static_assert(arraysize(kAllocNames) == kNumArenaAllocKinds, "arraysize of kAllocNames");
   for (int i = 0; i < kNumArenaAllocKinds; i++) {
       os << kAllocNames[i] << std::setw(10) << alloc_stats_[i] << "\n";
   }
@@ -297,6 +307,10 @@ size_t ArenaAllocator::BytesAllocated() const {
   return ArenaAllocatorStats::BytesAllocated();
 }
 
+size_t ArenaAllocator::BytesAllocatedByKind(ArenaAllocKind kind) const {
+  return ArenaAllocatorStats::BytesAllocatedByKind(kind);
+}
+
 size_t ArenaAllocator::BytesUsed() const {
   size_t total = ptr_ - begin_;
   if (arena_head_ != nullptr) {
@@ -101,6 +101,9 @@ enum ArenaAllocKind {
   kNumArenaAllocKinds
 };
 
+// Returns the name of the allocation kind, padded to a common width for use in MemStats dumps.
+const char* GetArenaAllocKindName(ArenaAllocKind kind);
+
 template <bool kCount>
 class ArenaAllocatorStatsImpl;
 
@@ -115,6 +118,7 @@ class ArenaAllocatorStatsImpl<false> {
   void RecordAlloc(size_t bytes ATTRIBUTE_UNUSED, ArenaAllocKind kind ATTRIBUTE_UNUSED) {}
   size_t NumAllocations() const { return 0u; }
   size_t BytesAllocated() const { return 0u; }
+  size_t BytesAllocatedByKind(ArenaAllocKind kind ATTRIBUTE_UNUSED) const { return 0u; }
   void Dump(std::ostream& os ATTRIBUTE_UNUSED,
             const Arena* first ATTRIBUTE_UNUSED,
             ssize_t lost_bytes_adjustment ATTRIBUTE_UNUSED) const {}
@@ -131,13 +135,12 @@ class ArenaAllocatorStatsImpl {
   void RecordAlloc(size_t bytes, ArenaAllocKind kind);
   size_t NumAllocations() const;
   size_t BytesAllocated() const;
+  size_t BytesAllocatedByKind(ArenaAllocKind kind) const;
   void Dump(std::ostream& os, const Arena* first, ssize_t lost_bytes_adjustment) const;
 
  private:
   size_t num_allocations_;
   dchecked_vector<size_t> alloc_stats_;  // Bytes used by various allocation kinds.
-
-  static const char* const kAllocNames[];
 };
 
 typedef ArenaAllocatorStatsImpl<kArenaAllocatorCountAllocations> ArenaAllocatorStats;
@@ -359,6 +362,9 @@ class ArenaAllocator
 
   size_t BytesAllocated() const;
 
+  // Bytes allocated for the given kind. Always zero unless kArenaAllocatorCountAllocations.
+  size_t BytesAllocatedByKind(ArenaAllocKind kind) const;
+
   MemStats GetMemStats() const;
 
   // The BytesUsed method sums up bytes allocated from arenas in arena_head_ and nodes.
@@ -167,6 +167,41 @@ TEST(BitVector, UnionIfNotIn) {
   }
 }
 
+TEST(BitVector, UnionWide) {
+  // Wide enough to exercise the vectorized loops and their scalar tails.
+  const uint32_t kBits = 32u * 37u;
+  BitVector first(kBits, true, Allocator::GetMallocAllocator());
+  BitVector second(kBits, true, Allocator::GetMallocAllocator());
+  BitVector third(kBits, true, Allocator::GetMallocAllocator());
+
+  for (uint32_t i = 0; i < kBits; i += 3) {
+    second.SetBit(i);
+  }
+  for (uint32_t i = 0; i < kBits; i += 5) {
+    third.SetBit(i);
+  }
+  // Bits set in second and not in third: multiples of 3 that are not multiples of 15.
+  uint32_t expected = (kBits + 2u) / 3u - (kBits + 14u) / 15u;
+
+  EXPECT_TRUE(first.UnionIfNotIn(&second, &third));
+  EXPECT_EQ(expected, first.NumSetBits());
+  EXPECT_FALSE(first.UnionIfNotIn(&second, &third));
+  for (uint32_t i = 0; i < kBits; ++i) {
+    EXPECT_EQ(i % 3u == 0u && i % 5u != 0u, first.IsBitSet(i)) << i;
+  }
+
+  EXPECT_TRUE(first.Union(&second));
+  EXPECT_EQ(second.NumSetBits(), first.NumSetBits());
+  EXPECT_TRUE(first.SameBitsSet(&second));
+  EXPECT_FALSE(first.Union(&second));
+
+  // Only a bit in the last word is new.
+  second.SetBit(kBits - 1u);
+  EXPECT_TRUE(first.Union(&second));
+  EXPECT_TRUE(first.IsBitSet(kBits - 1u));
+  EXPECT_EQ(second.NumSetBits(kBits - 1u), first.NumSetBits(kBits - 1u));
+}
+
 TEST(BitVector, Subset) {
   {
     BitVector first(2, true, Allocator::GetMallocAllocator());
@@ -33,6 +33,7 @@
 
 #include "art_field-inl.h"
 #include "art_method-inl.h"
+#include "background_verifier.h"
 #include "base/arena_allocator.h"
 #include "base/casts.h"
 #include "base/logging.h"
@@ -45,6 +46,7 @@
 #include "base/value_object.h"
 #include "cha.h"
 #include "class_linker-inl.h"
+#include "class_preloader.h"
 #include "class_table-inl.h"
 #include "compiler_callbacks.h"
 #include "debugger.h"
@@ -65,6 +67,7 @@
 #include "imtable-inl.h"
 #include "intern_table.h"
 #include "interpreter/interpreter.h"
+#include "interpreter/interpreter_cache.h"
 #include "jit/jit.h"
 #include "jit/jit_code_cache.h"
 #include "jit/profile_compilation_info.h"
@@ -91,6 +94,7 @@
 #include "mirror/reference-inl.h"
 #include "mirror/stack_trace_element.h"
 #include "mirror/string-inl.h"
+#include "monitor.h"
 #include "native/dalvik_system_DexFile.h"
 #include "oat.h"
 #include "oat_file.h"
@@ -109,6 +113,7 @@
 #include "utils.h"
 #include "utils/dex_cache_arrays_layout-inl.h"
 #include "verifier/method_verifier.h"
+#include "verifier/verifier_deps_recorder.h"
 #include "well_known_classes.h"
 
 namespace art {
@@ -352,6 +357,7 @@ static void ShuffleForward(size_t* current_field_idx,
 
 ClassLinker::ClassLinker(InternTable* intern_table)
     : failed_dex_cache_class_lookups_(0),
+      class_path_generation_(0u),
       class_roots_(nullptr),
       array_iftable_(nullptr),
       find_array_class_cache_next_victim_(0),
@@ -1025,6 +1031,60 @@ bool ClassLinker::IsBootClassLoader(ScopedObjectAccessAlreadyRunnable& soa,
            class_loader->GetClass();
 }
 
+bool ClassLinker::IsBaseDexClassLoaderChain(ScopedObjectAccessAlreadyRunnable& soa,
+                                            ObjPtr<mirror::ClassLoader> class_loader) {
+  ObjPtr<mirror::Class> path_class_loader_class =
+      soa.Decode<mirror::Class>(WellKnownClasses::dalvik_system_PathClassLoader);
+  ObjPtr<mirror::Class> dex_class_loader_class =
+      soa.Decode<mirror::Class>(WellKnownClasses::dalvik_system_DexClassLoader);
+  for (; !IsBootClassLoader(soa, class_loader); class_loader = class_loader->GetParent()) {
+    if (class_loader->GetClass() != path_class_loader_class &&
+        class_loader->GetClass() != dex_class_loader_class) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void ClassLinker::GetDexPathListDexFiles(ObjPtr<mirror::ClassLoader> class_loader,
+                                         /*out*/std::vector<const DexFile*>* dex_files) {
+  ArtField* const cookie_field =
+      jni::DecodeArtField(WellKnownClasses::dalvik_system_DexFile_cookie);
+  ArtField* const dex_file_field =
+      jni::DecodeArtField(WellKnownClasses::dalvik_system_DexPathList__Element_dexFile);
+  ObjPtr<mirror::Object> dex_path_list =
+      jni::DecodeArtField(WellKnownClasses::dalvik_system_BaseDexClassLoader_pathList)->
+          GetObject(class_loader);
+  if (dex_path_list == nullptr) {
+    return;
+  }
+  ObjPtr<mirror::Object> dex_elements_obj =
+      jni::DecodeArtField(WellKnownClasses::dalvik_system_DexPathList_dexElements)->
+          GetObject(dex_path_list);
+  if (dex_elements_obj == nullptr) {
+    return;
+  }
+  ObjPtr<mirror::ObjectArray<mirror::Object>> dex_elements =
+      dex_elements_obj->AsObjectArray<mirror::Object>();
+  for (int32_t i = 0; i < dex_elements->GetLength(); ++i) {
+    ObjPtr<mirror::Object> element = dex_elements->GetWithoutChecks(i);
+    ObjPtr<mirror::Object> dex_file =
+        (element != nullptr) ? dex_file_field->GetObject(element) : nullptr;
+    if (dex_file == nullptr) {
+      continue;
+    }
+    ObjPtr<mirror::LongArray> long_array = cookie_field->GetObject(dex_file)->AsLongArray();
+    if (long_array == nullptr) {
+      continue;
+    }
+    // First element is the oat file.
+    for (int32_t j = kDexFileIndexStart; j < long_array->GetLength(); ++j) {
+      dex_files->push_back(reinterpret_cast<const DexFile*>(
+          static_cast<uintptr_t>(long_array->GetWithoutChecks(j))));
+    }
+  }
+}
+
 static bool GetDexPathListElementName(ObjPtr<mirror::Object> element,
                                       ObjPtr<mirror::String>* out_name)
     REQUIRES_SHARED(Locks::mutator_lock_) {
@@ -1273,20 +1333,12 @@ bool ClassLinker::UpdateAppImageClassLoadersAndDexCaches(
         // If the oat file expects the dex cache arrays to be in the BSS, then allocate there and
         // copy over the arrays.
         DCHECK(dex_file != nullptr);
-        size_t num_strings = mirror::DexCache::kDexCacheStringCacheSize;
-        if (dex_file->NumStringIds() < num_strings) {
-          num_strings = dex_file->NumStringIds();
-        }
-        size_t num_types = mirror::DexCache::kDexCacheTypeCacheSize;
-        if (dex_file->NumTypeIds() < num_types) {
-          num_types = dex_file->NumTypeIds();
-        }
+        const size_t num_strings = mirror::DexCache::StringCacheSize(dex_file->NumStringIds());
+        const size_t num_types = mirror::DexCache::TypeCacheSize(dex_file->NumTypeIds());
         const size_t num_methods = dex_file->NumMethodIds();
         const size_t num_fields = dex_file->NumFieldIds();
-        size_t num_method_types = mirror::DexCache::kDexCacheMethodTypeCacheSize;
-        if (dex_file->NumProtoIds() < num_method_types) {
-          num_method_types = dex_file->NumProtoIds();
-        }
+        const size_t num_method_types =
+            mirror::DexCache::MethodTypeCacheSize(dex_file->NumProtoIds());
         const size_t num_call_sites = dex_file->NumCallSiteIds();
         CHECK_EQ(num_strings, dex_cache->NumStrings());
         CHECK_EQ(num_types, dex_cache->NumResolvedTypes());
@@ -1374,6 +1426,11 @@ bool ClassLinker::UpdateAppImageClassLoadersAndDexCaches(
         // in DexCacheData in RegisterDexFileLocked. We need the array pointer to be the one in the
         // BSS.
         CHECK(!FindDexCacheDataLocked(*dex_file).IsValid());
+        // Unlike RegisterDexFile(), do not call the OnDexFileRegistered() hooks of the class
+        // preloader, background verifier and verifier deps recorder. The class loader does not
+        // have its dex path list yet, so their workers could not find the classes, and the app
+        // image is only loaded for dex files compiled with a profile: the classes are verified
+        // ahead of time and the image already holds the classes of the profile.
         RegisterDexFileLocked(*dex_file, dex_cache, class_loader.Get());
       }
       if (kIsDebugBuild) {
@@ -2203,6 +2260,7 @@ void ClassLinker::DeleteClassLoader(Thread* self, const ClassLoaderData& data) {
       code_cache->RemoveMethodsIn(self, *data.allocator);
     }
   }
+  runtime->GetMonitorList()->RemoveContentionSitesIn(self, *data.allocator);
   delete data.allocator;
   delete data.class_table;
 }
@@ -2551,8 +2609,23 @@ mirror::Class* ClassLinker::FindClass(Thread* self,
     descriptor_equals = true;
   } else {
     ScopedObjectAccessUnchecked soa(self);
-    bool known_hierarchy =
-        FindClassInBaseDexClassLoader(soa, self, descriptor, hash, class_loader, &result_ptr);
+    // Read the generation before searching so that dex files opened concurrently invalidate the
+    // result recorded below.
+    const uint32_t class_path_generation = GetClassPathGeneration();
+    bool known_hierarchy;
+    if (IsKnownMissingClass(self, descriptor, hash, class_loader.Get(), class_path_generation)) {
+      // Repeated lookup of a missing class, skip searching all the dex files again. The Java side
+      // still runs below, so that a path list changed by reflection without opening a dex file
+      // is seen, and the exception is the one libcore throws.
+      known_hierarchy = true;
+      result_ptr = nullptr;
+    } else {
+      known_hierarchy =
+          FindClassInBaseDexClassLoader(soa, self, descriptor, hash, class_loader, &result_ptr);
+      if (known_hierarchy && result_ptr == nullptr) {
+        AddKnownMissingClass(self, descriptor, hash, class_loader.Get(), class_path_generation);
+      }
+    }
     if (result_ptr != nullptr) {
       // The chain was understood and we found the class. We still need to add the class to
       // the class table to protect from racy programs that can try and redefine the path list
@@ -3338,6 +3411,7 @@ void ClassLinker::AppendToBootClassPath(const DexFile& dex_file,
   CHECK(dex_cache != nullptr) << dex_file.GetLocation();
   boot_class_path_.push_back(&dex_file);
   RegisterBootClassPathDexFile(dex_file, dex_cache);
+  IncrementClassPathGeneration();
 }
 
 void ClassLinker::RegisterDexFileLocked(const DexFile& dex_file,
@@ -3468,6 +3542,19 @@ ObjPtr<mirror::DexCache> ClassLinker::RegisterDexFile(const DexFile& dex_file,
     // Since we added a strong root to the class table, do the write barrier as required for
     // remembered sets and generational GCs.
     Runtime::Current()->GetHeap()->WriteBarrierEveryFieldOf(h_class_loader.Get());
+    ClassPreloader* const class_preloader = Runtime::Current()->GetClassPreloader();
+    if (UNLIKELY(class_preloader != nullptr)) {
+      class_preloader->OnDexFileRegistered(self, dex_file, h_class_loader);
+    }
+    BackgroundVerifier* const background_verifier = Runtime::Current()->GetBackgroundVerifier();
+    if (UNLIKELY(background_verifier != nullptr)) {
+      background_verifier->OnDexFileRegistered(self, dex_file, h_class_loader);
+    }
+    verifier::VerifierDepsRecorder* const verifier_deps_recorder =
+        Runtime::Current()->GetVerifierDepsRecorder();
+    if (UNLIKELY(verifier_deps_recorder != nullptr)) {
+      verifier_deps_recorder->OnDexFileRegistered(self, dex_file, h_class_loader);
+    }
   }
   return h_dex_cache.Get();
 }
@@ -3828,6 +3915,27 @@ mirror::Class* ClassLinker::LookupClass(Thread* self,
   return nullptr;
 }
 
+bool ClassLinker::IsKnownMissingClass(Thread* self,
+                                      const char* descriptor,
+                                      size_t hash,
+                                      ObjPtr<mirror::ClassLoader> class_loader,
+                                      uint32_t class_path_generation) {
+  ReaderMutexLock mu(self, *Locks::classlinker_classes_lock_);
+  ClassTable* const class_table = ClassTableForClassLoader(class_loader);
+  return class_table != nullptr &&
+      class_table->IsKnownMissing(descriptor, hash, class_path_generation);
+}
+
+void ClassLinker::AddKnownMissingClass(Thread* self,
+                                       const char* descriptor,
+                                       size_t hash,
+                                       ObjPtr<mirror::ClassLoader> class_loader,
+                                       uint32_t class_path_generation) {
+  WriterMutexLock mu(self, *Locks::classlinker_classes_lock_);
+  ClassTable* const class_table = InsertClassTableForClassLoader(class_loader);
+  class_table->AddKnownMissing(descriptor, hash, class_path_generation);
+}
+
 class MoveClassTableToPreZygoteVisitor : public ClassLoaderVisitor {
  public:
   explicit MoveClassTableToPreZygoteVisitor() {}
@@ -3952,7 +4060,12 @@ verifier::MethodVerifier::FailureKind ClassLinker::VerifyClass(
     mirror::Class::Status old_status = klass->GetStatus();
     while (old_status == mirror::Class::kStatusVerifying ||
         old_status == mirror::Class::kStatusVerifyingAtRuntime) {
+      BackgroundVerifier* const background_verifier = Runtime::Current()->GetBackgroundVerifier();
+      const uint64_t wait_start_ns = (background_verifier != nullptr) ? NanoTime() : 0u;
       lock.WaitIgnoringInterrupts();
+      if (background_verifier != nullptr) {
+        background_verifier->RecordWait(self, NanoTime() - wait_start_ns);
+      }
       CHECK(klass->IsErroneous() || (klass->GetStatus() > old_status))
           << "Class '" << klass->PrettyClass()
           << "' performed an illegal verification state transition from " << old_status
@@ -4047,6 +4160,14 @@ verifier::MethodVerifier::FailureKind ClassLinker::VerifyClass(
   const DexFile& dex_file = *klass->GetDexCache()->GetDexFile();
   mirror::Class::Status oat_file_class_status(mirror::Class::kStatusNotReady);
   bool preverified = VerifyClassUsingOatFile(dex_file, klass.Get(), oat_file_class_status);
+  verifier::VerifierDepsRecorder* const verifier_deps_recorder =
+      Runtime::Current()->GetVerifierDepsRecorder();
+  if (!preverified &&
+      verifier_deps_recorder != nullptr &&
+      !mirror::Class::IsErroneous(oat_file_class_status)) {
+    // Without an oat file with verified classes, use the dependencies recorded by previous runs.
+    preverified = verifier_deps_recorder->IsVerified(self, klass);
+  }
   // If the oat file says the class had an error, re-run the verifier. That way we will get a
   // precise error message. To ensure a rerun, test:
   //     mirror::Class::IsErroneous(oat_file_class_status) => !preverified
@@ -4056,12 +4177,28 @@ verifier::MethodVerifier::FailureKind ClassLinker::VerifyClass(
   verifier::MethodVerifier::FailureKind verifier_failure = verifier::MethodVerifier::kNoFailure;
   if (!preverified) {
     Runtime* runtime = Runtime::Current();
+    BackgroundVerifier* const background_verifier = runtime->GetBackgroundVerifier();
+    const uint64_t verification_start_ns = (background_verifier != nullptr) ? NanoTime() : 0u;
+    const bool recording = (verifier_deps_recorder != nullptr) &&
+        verifier_deps_recorder->BeginRecording(self, klass.Get());
+    const uint64_t verification_start_cpu_ns =
+        (verifier_deps_recorder != nullptr) ? ThreadCpuNanoTime() : 0u;
     verifier_failure = verifier::MethodVerifier::VerifyClass(self,
                                                              klass.Get(),
                                                              runtime->GetCompilerCallbacks(),
                                                              runtime->IsAotCompiler(),
                                                              log_level,
                                                              &error_msg);
+    if (background_verifier != nullptr) {
+      background_verifier->RecordVerification(self, NanoTime() - verification_start_ns);
+    }
+    if (verifier_deps_recorder != nullptr) {
+      verifier_deps_recorder->EndRecording(self,
+                                           klass.Get(),
+                                           recording,
+                                           verifier_failure,
+                                           ThreadCpuNanoTime() - verification_start_cpu_ns);
+    }
   }
 
   // Verification is done, grab the lock again.
@@ -6566,9 +6703,7 @@ void ClassLinker::FillIMTFromIfTable(ObjPtr<mirror::IfTable> if_table,
           continue;
         }
         ImtConflictTable* table = imt[imt_index]->GetImtConflictTable(image_pointer_size_);
-        const size_t num_entries = table->NumEntries(image_pointer_size_);
-        table->SetInterfaceMethod(num_entries, image_pointer_size_, interface_method);
-        table->SetImplementationMethod(num_entries, image_pointer_size_, implementation_method);
+        table->AddEntry(interface_method, implementation_method, image_pointer_size_);
       }
     }
   }
@@ -8564,6 +8699,9 @@ void ClassLinker::DumpForSigQuit(std::ostream& os) {
   ReaderMutexLock mu(soa.Self(), *Locks::classlinker_classes_lock_);
   os << "Zygote loaded classes=" << NumZygoteClasses() << " post zygote classes="
      << NumNonZygoteClasses() << "\n";
+  if (mirror::DexCache::kCountHashedCacheLookups) {
+    mirror::DexCache::DumpHashedCacheStats(os);
+  }
 }
 
 class CountClassesVisitor : public ClassLoaderVisitor {
@@ -8770,6 +8908,9 @@ jobject ClassLinker::CreatePathClassLoader(Thread* self,
       soa.Decode<mirror::Class>(WellKnownClasses::java_lang_BootClassLoader)->AllocObject(self);
   parent_field->SetObject<false>(h_path_class_loader.Get(), boot_cl);
 
+  // The dex files now back a class loader, like dex files opened by libcore.
+  IncrementClassPathGeneration();
+
   // Make it a global ref and return.
   ScopedLocalRef<jobject> local_ref(
       soa.Env(), soa.Env()->AddLocalReference<jobject>(h_path_class_loader.Get()));
@@ -8837,6 +8978,10 @@ void ClassLinker::CleanupClassLoaders() {
       }
     }
   }
+  if (!to_delete.empty()) {
+    // The instructions cached by the interpreter may belong to the dex files freed below.
+    InterpreterCache::InvalidateAll();
+  }
   for (ClassLoaderData& data : to_delete) {
     DeleteClassLoader(self, data);
   }
@@ -626,6 +626,19 @@ class ClassLinker {
                                 ObjPtr<mirror::ClassLoader> class_loader)
       REQUIRES_SHARED(Locks::mutator_lock_);
 
+  // Returns true if `class_loader` and all its parents are the boot class loader, a
+  // PathClassLoader or a DexClassLoader, i.e. FindClassInBaseDexClassLoader finds classes through
+  // the whole chain the same way ClassLoader.loadClass() would, without calling into Java.
+  static bool IsBaseDexClassLoaderChain(ScopedObjectAccessAlreadyRunnable& soa,
+                                        ObjPtr<mirror::ClassLoader> class_loader)
+      REQUIRES_SHARED(Locks::mutator_lock_);
+
+  // Collect the dex files of the DexPathList of a BaseDexClassLoader in search order, without the
+  // dex files of its parents.
+  static void GetDexPathListDexFiles(ObjPtr<mirror::ClassLoader> class_loader,
+                                     /*out*/std::vector<const DexFile*>* dex_files)
+      REQUIRES_SHARED(Locks::mutator_lock_);
+
   ArtMethod* AddMethodToConflictTable(ObjPtr<mirror::Class> klass,
                                       ArtMethod* conflict_method,
                                       ArtMethod* interface_method,
@@ -669,6 +682,36 @@ class ClassLinker {
       REQUIRES_SHARED(Locks::mutator_lock_)
       REQUIRES(!Locks::dex_lock_);
 
+  // The class path generation changes whenever dex files are opened or appended to the boot class
+  // path, which invalidates the classes recorded as missing by FindClass.
+  uint32_t GetClassPathGeneration() const {
+    return class_path_generation_.LoadSequentiallyConsistent();
+  }
+  void IncrementClassPathGeneration() {
+    class_path_generation_.FetchAndAddSequentiallyConsistent(1u);
+  }
+
+  // Returns true if FindClassInBaseDexClassLoader already failed to find the descriptor through
+  // the class loader chain of `class_loader` at the given class path generation. A hit only
+  // skips that native search, FindClass still calls ClassLoader.loadClass() to throw.
+  bool IsKnownMissingClass(Thread* self,
+                           const char* descriptor,
+                           size_t hash,
+                           ObjPtr<mirror::ClassLoader> class_loader,
+                           uint32_t class_path_generation)
+      REQUIRES_SHARED(Locks::mutator_lock_)
+      REQUIRES(!Locks::classlinker_classes_lock_);
+
+  // Record that FindClassInBaseDexClassLoader did not find the descriptor through the class loader
+  // chain of `class_loader`.
+  void AddKnownMissingClass(Thread* self,
+                            const char* descriptor,
+                            size_t hash,
+                            ObjPtr<mirror::ClassLoader> class_loader,
+                            uint32_t class_path_generation)
+      REQUIRES_SHARED(Locks::mutator_lock_)
+      REQUIRES(!Locks::classlinker_classes_lock_);
+
   struct DexCacheData {
     // Construct an invalid data object.
     DexCacheData()
@@ -1199,6 +1242,9 @@ class ClassLinker {
   // the classes into the class_table_ to avoid dex cache based searches.
   Atomic<uint32_t> failed_dex_cache_class_lookups_;
 
+  // See GetClassPathGeneration.
+  Atomic<uint32_t> class_path_generation_;
+
   // Well known mirror::Class roots.
   GcRoot<mirror::ObjectArray<mirror::Class>> class_roots_;
 
@@ -48,6 +48,7 @@
 #include "mirror/reference.h"
 #include "mirror/stack_trace_element.h"
 #include "mirror/string-inl.h"
+#include "mirror/throwable.h"
 #include "handle_scope-inl.h"
 #include "scoped_thread_state_change-inl.h"
 #include "thread-inl.h"
@@ -855,6 +856,44 @@ TEST_F(ClassLinkerTest, FindClassNested) {
   EXPECT_EQ(1U, inner->NumDirectMethods());
 }
 
+TEST_F(ClassLinkerTest, FindClassKnownMissing) {
+  ScopedObjectAccess soa(Thread::Current());
+  StackHandleScope<1> hs(soa.Self());
+  Handle<mirror::ClassLoader> class_loader(
+      hs.NewHandle(soa.Decode<mirror::ClassLoader>(LoadDex("Nested"))));
+  const char* descriptor = "LNoSuchClass;";
+  const size_t hash = ComputeModifiedUtf8Hash(descriptor);
+  uint32_t generation = class_linker_->GetClassPathGeneration();
+  EXPECT_FALSE(class_linker_->IsKnownMissingClass(
+      soa.Self(), descriptor, hash, class_loader.Get(), generation));
+
+  // A failed lookup is recorded. The repeated lookup skips the native search but still calls
+  // ClassLoader.loadClass(), so both throw the same ClassNotFoundException from libcore.
+  for (size_t i = 0; i != 2u; ++i) {
+    EXPECT_TRUE(class_linker_->FindClass(soa.Self(), descriptor, class_loader) == nullptr);
+    ASSERT_TRUE(soa.Self()->IsExceptionPending());
+    ObjPtr<mirror::Throwable> exception = soa.Self()->GetException();
+    EXPECT_TRUE(exception->GetClass()->DescriptorEquals("Ljava/lang/ClassNotFoundException;"));
+    ASSERT_TRUE(exception->GetDetailMessage() != nullptr);
+    EXPECT_EQ(0u, exception->GetDetailMessage()->ToModifiedUtf8().find(
+        "Didn't find class \"NoSuchClass\" on path"));
+    soa.Self()->ClearException();
+    EXPECT_TRUE(class_linker_->IsKnownMissingClass(
+        soa.Self(), descriptor, hash, class_loader.Get(), generation));
+  }
+  // Existing classes are not affected.
+  EXPECT_TRUE(class_linker_->FindClass(soa.Self(), "LNested;", class_loader) != nullptr);
+
+  // Opening dex files invalidates the recorded lookups.
+  LoadDex("MyClass");
+  EXPECT_NE(generation, class_linker_->GetClassPathGeneration());
+  EXPECT_FALSE(class_linker_->IsKnownMissingClass(soa.Self(),
+                                                  descriptor,
+                                                  hash,
+                                                  class_loader.Get(),
+                                                  class_linker_->GetClassPathGeneration()));
+}
+
 TEST_F(ClassLinkerTest, FindClass_Primitives) {
   ScopedObjectAccess soa(Thread::Current());
   const std::string expected("BCDFIJSZV");
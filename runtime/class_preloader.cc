@@ -0,0 +1,268 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "class_preloader.h"
+
+#include <fcntl.h>
+
+#include <algorithm>
+#include <set>
+#include <unordered_set>
+
+#include "base/scoped_flock.h"
+#include "base/systrace.h"
+#include "base/time_utils.h"
+#include "class_linker.h"
+#include "dex_cache_resolved_classes.h"
+#include "dex_file-inl.h"
+#include "handle_scope-inl.h"
+#include "java_vm_ext.h"
+#include "jit/profile_compilation_info.h"
+#include "mirror/class_loader.h"
+#include "mirror/object-inl.h"
+#include "scoped_thread_state_change-inl.h"
+#include "thread-inl.h"
+#include "thread_pool.h"
+
+namespace art {
+
+class ClassPreloader::LoadProfileTask : public SelfDeletingTask {
+ public:
+  explicit LoadProfileTask(ClassPreloader* preloader) : preloader_(preloader) {}
+
+  void Run(Thread* self) OVERRIDE {
+    preloader_->LoadProfile(self);
+  }
+
+ private:
+  ClassPreloader* const preloader_;
+
+  DISALLOW_COPY_AND_ASSIGN(LoadProfileTask);
+};
+
+class ClassPreloader::PreloadClassesTask : public SelfDeletingTask {
+ public:
+  PreloadClassesTask(ClassPreloader* preloader, std::vector<std::string>&& descriptors)
+      : preloader_(preloader), descriptors_(std::move(descriptors)) {}
+
+  void Run(Thread* self) OVERRIDE {
+    preloader_->PreloadClasses(self, descriptors_);
+  }
+
+ private:
+  ClassPreloader* const preloader_;
+  const std::vector<std::string> descriptors_;
+
+  DISALLOW_COPY_AND_ASSIGN(PreloadClassesTask);
+};
+
+ClassPreloader::ClassPreloader(const std::string& profile_filename,
+                               const std::vector<std::string>& code_paths,
+                               size_t num_threads)
+    : profile_filename_(profile_filename),
+      code_paths_(code_paths),
+      num_threads_(num_threads),
+      lock_("Class preloader lock"),
+      started_(false),
+      class_loader_(nullptr),
+      pool_("Class preloader thread pool", num_threads),
+      start_ns_(0u),
+      finish_ns_(0u),
+      num_pending_tasks_(0u),
+      num_classes_(0u),
+      num_preloaded_(0u),
+      num_verified_(0u),
+      num_failed_(0u) {
+}
+
+ClassPreloader::~ClassPreloader() {
+  DCHECK(class_loader_ == nullptr) << "Stop() was not called";
+}
+
+void ClassPreloader::OnDexFileRegistered(Thread* self,
+                                         const DexFile& dex_file,
+                                         Handle<mirror::ClassLoader> class_loader) {
+  const std::string base_location = DexFile::GetBaseLocation(dex_file.GetLocation());
+  if (std::find(code_paths_.begin(), code_paths_.end(), base_location) == code_paths_.end()) {
+    return;
+  }
+  {
+    ScopedObjectAccessUnchecked soa(self);
+    if (!ClassWorkerPool::CanLoadClassesFor(soa, class_loader.Get())) {
+      VLOG(class_linker) << "Not preloading startup classes for " << base_location;
+      return;
+    }
+  }
+  {
+    MutexLock mu(self, lock_);
+    if (started_ || IsStopping()) {
+      return;
+    }
+    started_ = true;
+    class_loader_ = self->GetJniEnv()->vm->AddGlobalRef(self, class_loader.Get());
+  }
+  start_ns_ = NanoTime();
+  VLOG(class_linker) << "Starting to preload startup classes for " << base_location;
+  num_pending_tasks_.StoreRelaxed(1u);
+  if (!pool_.AddTask(self, new LoadProfileTask(this))) {
+    // Stopped, Stop() may have missed the class loader.
+    jobject global_class_loader;
+    {
+      MutexLock mu(self, lock_);
+      global_class_loader = class_loader_;
+      class_loader_ = nullptr;
+    }
+    if (global_class_loader != nullptr) {
+      self->GetJniEnv()->vm->DeleteGlobalRef(self, global_class_loader);
+    }
+  }
+}
+
+void ClassPreloader::LoadProfile(Thread* self) {
+  ScopedTrace trace(__PRETTY_FUNCTION__);
+  if (IsStopping()) {
+    return;
+  }
+  ProfileCompilationInfo info;
+  bool loaded = false;
+  {
+    ScopedFlock flock;
+    std::string error;
+    if (!flock.Init(profile_filename_.c_str(),
+                    O_RDONLY | O_NOFOLLOW | O_CLOEXEC,
+                    /* block */ true,
+                    &error)) {
+      LOG(WARNING) << "Couldn't lock the profile file " << profile_filename_ << ": " << error;
+    } else {
+      loaded = info.Load(flock.GetFile()->Fd());
+    }
+  }
+
+  std::vector<std::string> descriptors;
+  {
+    ScopedObjectAccess soa(self);
+    jobject class_loader;
+    {
+      MutexLock mu(self, lock_);
+      class_loader = class_loader_;
+    }
+    ObjPtr<mirror::ClassLoader> loader = soa.Decode<mirror::ClassLoader>(class_loader);
+    // The parents are not searched, the profile only records classes of the app's own dex files.
+    std::vector<const DexFile*> dex_files;
+    if (loaded) {
+      ClassLinker::GetDexPathListDexFiles(loader, &dex_files);
+    }
+
+    std::unordered_set<std::string> dex_locations;
+    for (const DexFile* dex_file : dex_files) {
+      dex_locations.insert(dex_file->GetLocation());
+    }
+    for (const DexCacheResolvedClasses& classes : info.GetResolvedClasses(dex_locations)) {
+      for (const DexFile* dex_file : dex_files) {
+        // Ignore the classes of a stale profile.
+        if (dex_file->GetLocation() != classes.GetDexLocation() ||
+            dex_file->GetLocationChecksum() != classes.GetLocationChecksum()) {
+          continue;
+        }
+        for (dex::TypeIndex type_idx : classes.GetClasses()) {
+          if (type_idx.index_ < dex_file->NumTypeIds()) {
+            descriptors.push_back(dex_file->StringByTypeIdx(type_idx));
+          }
+        }
+      }
+    }
+  }
+
+  num_classes_.StoreRelaxed(descriptors.size());
+  VLOG(class_linker) << "Preloading " << descriptors.size() << " classes from "
+                     << profile_filename_;
+  // Split the classes between the workers, this thread takes the first chunk.
+  const size_t chunk_size = (descriptors.size() + num_threads_ - 1u) / num_threads_;
+  std::vector<std::vector<std::string>> chunks;
+  for (size_t begin = 0; begin < descriptors.size(); begin += chunk_size) {
+    size_t end = std::min(descriptors.size(), begin + chunk_size);
+    chunks.emplace_back(std::make_move_iterator(descriptors.begin() + begin),
+                        std::make_move_iterator(descriptors.begin() + end));
+  }
+  for (size_t i = 1; i < chunks.size(); ++i) {
+    num_pending_tasks_.FetchAndAddSequentiallyConsistent(1u);
+    if (!pool_.AddTask(self, new PreloadClassesTask(this, std::move(chunks[i])))) {
+      num_pending_tasks_.FetchAndSubSequentiallyConsistent(1u);
+      break;
+    }
+  }
+  PreloadClasses(self, chunks.empty() ? std::vector<std::string>() : chunks[0]);
+}
+
+void ClassPreloader::PreloadClasses(Thread* self, const std::vector<std::string>& descriptors) {
+  ScopedTrace trace(__PRETTY_FUNCTION__);
+  jobject class_loader;
+  {
+    MutexLock mu(self, lock_);
+    class_loader = class_loader_;
+  }
+  ScopedObjectAccess soa(self);
+  StackHandleScope<1> hs(self);
+  Handle<mirror::ClassLoader> loader(hs.NewHandle(soa.Decode<mirror::ClassLoader>(class_loader)));
+  for (const std::string& descriptor : descriptors) {
+    if (IsStopping()) {
+      break;
+    }
+    bool verified;
+    if (ClassWorkerPool::FindAndVerifyClass(self, descriptor.c_str(), loader, &verified) ==
+            nullptr) {
+      num_failed_.FetchAndAddRelaxed(1u);
+      continue;
+    }
+    num_preloaded_.FetchAndAddRelaxed(1u);
+    if (verified) {
+      num_verified_.FetchAndAddRelaxed(1u);
+    }
+  }
+  if (num_pending_tasks_.FetchAndSubSequentiallyConsistent(1u) == 1u) {
+    finish_ns_.StoreRelaxed(NanoTime());
+    VLOG(class_linker) << "Preloaded " << num_preloaded_.LoadRelaxed() << " classes, verified "
+                       << num_verified_.LoadRelaxed() << ", failed " << num_failed_.LoadRelaxed()
+                       << " in " << PrettyDuration(finish_ns_.LoadRelaxed() - start_ns_);
+  }
+}
+
+void ClassPreloader::Stop(Thread* self) {
+  // The running tasks check IsStopping() between classes, so they finish shortly.
+  pool_.Stop(self);
+  jobject class_loader;
+  {
+    MutexLock mu(self, lock_);
+    class_loader = class_loader_;
+    class_loader_ = nullptr;
+  }
+  if (class_loader != nullptr) {
+    self->GetJniEnv()->vm->DeleteGlobalRef(self, class_loader);
+  }
+}
+
+void ClassPreloader::DumpForSigQuit(std::ostream& os) {
+  uint64_t finish_ns = finish_ns_.LoadRelaxed();
+  os << "Class preloader: " << num_preloaded_.LoadRelaxed() << "/" << num_classes_.LoadRelaxed()
+     << " preloaded, " << num_verified_.LoadRelaxed() << " verified, "
+     << num_failed_.LoadRelaxed() << " failed";
+  if (finish_ns != 0u) {
+    os << " in " << PrettyDuration(finish_ns - start_ns_);
+  }
+  os << "\n";
+}
+
+}  // namespace art
@@ -0,0 +1,105 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_RUNTIME_CLASS_PRELOADER_H_
+#define ART_RUNTIME_CLASS_PRELOADER_H_
+
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "atomic.h"
+#include "base/macros.h"
+#include "base/mutex.h"
+#include "class_worker_pool.h"
+#include "handle.h"
+#include "jni.h"
+
+namespace art {
+
+class DexFile;
+class Thread;
+
+namespace mirror {
+class ClassLoader;
+}  // namespace mirror
+
+// Loads, links and verifies the classes recorded in the app's profile on background threads
+// during startup. The main thread then finds most of the classes it needs already resolved and
+// verified instead of running DefineClass, LinkClass and the method verifier itself.
+class ClassPreloader {
+ public:
+  ClassPreloader(const std::string& profile_filename,
+                 const std::vector<std::string>& code_paths,
+                 size_t num_threads);
+  ~ClassPreloader();
+
+  // Called when a dex file is registered with a non boot class loader. Preloading starts the first
+  // time a dex file of one of the app's code paths is registered, using that class loader, unless
+  // the workers cannot load classes for it, see ClassWorkerPool::CanLoadClassesFor().
+  void OnDexFileRegistered(Thread* self,
+                           const DexFile& dex_file,
+                           Handle<mirror::ClassLoader> class_loader)
+      REQUIRES_SHARED(Locks::mutator_lock_)
+      REQUIRES(!lock_);
+
+  // Stop preloading and wait for the workers, called during runtime shutdown before the thread
+  // list is deleted.
+  void Stop(Thread* self) REQUIRES(!lock_);
+
+  void DumpForSigQuit(std::ostream& os);
+
+ private:
+  class LoadProfileTask;
+  class PreloadClassesTask;
+
+  // Read the profile and queue the preloading of the classes it lists for the app's dex files.
+  void LoadProfile(Thread* self) REQUIRES(!Locks::mutator_lock_);
+
+  void PreloadClasses(Thread* self, const std::vector<std::string>& descriptors)
+      REQUIRES(!Locks::mutator_lock_);
+
+  bool IsStopping() const {
+    return pool_.IsStopping();
+  }
+
+  const std::string profile_filename_;
+  const std::vector<std::string> code_paths_;
+  const size_t num_threads_;
+
+  Mutex lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
+  bool started_ GUARDED_BY(lock_);
+  // Global reference to the app's class loader.
+  jobject class_loader_ GUARDED_BY(lock_);
+
+  ClassWorkerPool pool_;
+
+  // Statistics, for measuring the effect on startup.
+  uint64_t start_ns_;
+  Atomic<uint64_t> finish_ns_;
+  Atomic<uint32_t> num_pending_tasks_;
+  Atomic<uint32_t> num_classes_;
+  Atomic<uint32_t> num_preloaded_;
+  Atomic<uint32_t> num_verified_;
+  Atomic<uint32_t> num_failed_;
+
+  DISALLOW_COPY_AND_ASSIGN(ClassPreloader);
+};
+
+}  // namespace art
+
+#endif  // ART_RUNTIME_CLASS_PRELOADER_H_
@@ -20,7 +20,8 @@
 
 namespace art {
 
-ClassTable::ClassTable() : lock_("Class loader classes", kClassLoaderClassesLock) {
+ClassTable::ClassTable()
+    : lock_("Class loader classes", kClassLoaderClassesLock), missing_classes_generation_(0u) {
   Runtime* const runtime = Runtime::Current();
   classes_.push_back(ClassSet(runtime->GetHashTableMinLoadFactor(),
                               runtime->GetHashTableMaxLoadFactor()));
@@ -282,4 +283,40 @@ uint32_t ClassTable::TableSlot::HashDescriptor(ObjPtr<mirror::Class> klass) {
   return ComputeModifiedUtf8Hash(klass->GetDescriptor(&temp));
 }
 
+bool ClassTable::IsKnownMissing(const char* descriptor,
+                                size_t hash,
+                                uint32_t class_path_generation) {
+  ReaderMutexLock mu(Thread::Current(), lock_);
+  if (missing_classes_generation_ != class_path_generation) {
+    return false;
+  }
+  auto range = missing_classes_.equal_range(hash);
+  for (auto it = range.first; it != range.second; ++it) {
+    if (it->second == descriptor) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void ClassTable::AddKnownMissing(const char* descriptor,
+                                 size_t hash,
+                                 uint32_t class_path_generation) {
+  // Bound the memory used by programs probing for many distinct missing classes.
+  static constexpr size_t kMaxMissingClasses = 1024;
+  WriterMutexLock mu(Thread::Current(), lock_);
+  if (missing_classes_generation_ != class_path_generation ||
+      missing_classes_.size() >= kMaxMissingClasses) {
+    missing_classes_.clear();
+    missing_classes_generation_ = class_path_generation;
+  }
+  auto range = missing_classes_.equal_range(hash);
+  for (auto it = range.first; it != range.second; ++it) {
+    if (it->second == descriptor) {
+      return;  // Recorded by another thread.
+    }
+  }
+  missing_classes_.emplace(hash, descriptor);
+}
+
 }  // namespace art
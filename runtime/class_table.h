@@ -18,6 +18,7 @@
 #define ART_RUNTIME_CLASS_TABLE_H_
 
 #include <string>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -241,6 +242,16 @@ class ClassTable {
       REQUIRES(!lock_)
       REQUIRES_SHARED(Locks::mutator_lock_);
 
+  // Return true if a native lookup of the descriptor through the class loader chain was recorded
+  // as failing at the given class path generation, see ClassLinker::GetClassPathGeneration.
+  bool IsKnownMissing(const char* descriptor, size_t hash, uint32_t class_path_generation)
+      REQUIRES(!lock_);
+
+  // Record that the descriptor was not found through the class loader chain. Entries recorded for
+  // an older class path generation are discarded.
+  void AddKnownMissing(const char* descriptor, size_t hash, uint32_t class_path_generation)
+      REQUIRES(!lock_);
+
   ReaderWriterMutex& GetLock() {
     return lock_;
   }
@@ -269,6 +280,11 @@ class ClassTable {
   std::vector<GcRoot<mirror::Object>> strong_roots_ GUARDED_BY(lock_);
   // Keep track of oat files with GC roots associated with dex caches in `strong_roots_`.
   std::vector<const OatFile*> oat_files_ GUARDED_BY(lock_);
+  // Descriptors, keyed by hash, that were not found in the dex files of the class loader chain.
+  // Lets repeated Class.forName() probes for missing classes skip searching every dex file.
+  std::unordered_multimap<size_t, std::string> missing_classes_ GUARDED_BY(lock_);
+  // The class path generation missing_classes_ is valid for.
+  uint32_t missing_classes_generation_ GUARDED_BY(lock_);
 
   friend class ImageWriter;  // for InsertWithoutLocks.
 };
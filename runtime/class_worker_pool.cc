@@ -0,0 +1,123 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "class_worker_pool.h"
+
+#include <algorithm>
+
+#include "class_linker.h"
+#include "handle_scope-inl.h"
+#include "mirror/class-inl.h"
+#include "mirror/class_loader.h"
+#include "runtime.h"
+#include "thread-inl.h"
+#include "thread_list.h"
+#include "thread_pool.h"
+
+namespace art {
+
+ClassWorkerPool::ClassWorkerPool(const char* name, size_t num_threads)
+    : lock_("Class worker pool lock"),
+      stopping_(false) {
+  DCHECK_GT(num_threads, 0u);
+  Thread* self = Thread::Current();
+  std::unique_ptr<ThreadPool> thread_pool(new ThreadPool(name, num_threads));
+  // The constructor of the pool waits for the workers to attach.
+  for (ThreadPoolWorker* worker : thread_pool->GetWorkers()) {
+    worker_threads_.push_back(worker->GetThread());
+  }
+  thread_pool->StartWorkers(self);
+  MutexLock mu(self, lock_);
+  thread_pool_ = std::move(thread_pool);
+}
+
+ClassWorkerPool::~ClassWorkerPool() {
+  DCHECK(thread_pool_ == nullptr) << "Stop() was not called";
+}
+
+void ClassWorkerPool::SetPthreadPriority(int priority) {
+  MutexLock mu(Thread::Current(), lock_);
+  if (thread_pool_ != nullptr) {
+    thread_pool_->SetPthreadPriority(priority);
+  }
+}
+
+bool ClassWorkerPool::AddTask(Thread* self, Task* task) {
+  ThreadPool* thread_pool;
+  {
+    MutexLock mu(self, lock_);
+    thread_pool = thread_pool_.get();
+  }
+  if (thread_pool == nullptr) {
+    task->Finalize();
+    return false;
+  }
+  // There is no suspend point since we read the pool. Do not hold lock_ since the task queue lock
+  // has the same level.
+  thread_pool->AddTask(self, task);
+  return true;
+}
+
+void ClassWorkerPool::Stop(Thread* self) {
+  stopping_.StoreRelaxed(true);
+  ThreadPool* thread_pool;
+  {
+    // Clear thread_pool_ while the threads are suspended, AddTask() checks against it.
+    ScopedSuspendAll ssa(__FUNCTION__);
+    MutexLock mu(self, lock_);
+    thread_pool = thread_pool_.release();
+  }
+  if (thread_pool != nullptr) {
+    // Let the workers drain the queue, so that the tasks release what they hold.
+    thread_pool->Wait(self, false, false);
+    delete thread_pool;
+  }
+}
+
+bool ClassWorkerPool::IsWorker(Thread* self) const {
+  return std::find(worker_threads_.begin(), worker_threads_.end(), self) != worker_threads_.end();
+}
+
+bool ClassWorkerPool::CanLoadClassesFor(ScopedObjectAccessAlreadyRunnable& soa,
+                                        ObjPtr<mirror::ClassLoader> class_loader) {
+  return !Runtime::Current()->IsJavaDebuggable() &&
+      ClassLinker::IsBaseDexClassLoaderChain(soa, class_loader);
+}
+
+ObjPtr<mirror::Class> ClassWorkerPool::FindAndVerifyClass(Thread* self,
+                                                          const char* descriptor,
+                                                          Handle<mirror::ClassLoader> class_loader,
+                                                          /*out*/ bool* verified) {
+  *verified = false;
+  ClassLinker* const class_linker = Runtime::Current()->GetClassLinker();
+  StackHandleScope<1> hs(self);
+  Handle<mirror::Class> klass(
+      hs.NewHandle(class_linker->FindClass(self, descriptor, class_loader)));
+  if (klass == nullptr) {
+    self->ClearException();
+    return nullptr;
+  }
+  if (!klass->IsVerified() && !klass->IsErroneous()) {
+    class_linker->VerifyClass(self, klass);
+    if (self->IsExceptionPending()) {
+      self->ClearException();
+    }
+    *verified = klass->IsVerified();
+  }
+  return klass.Get();
+}
+
+}  // namespace art
@@ -0,0 +1,101 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_RUNTIME_CLASS_WORKER_POOL_H_
+#define ART_RUNTIME_CLASS_WORKER_POOL_H_
+
+#include <memory>
+#include <vector>
+
+#include "atomic.h"
+#include "base/macros.h"
+#include "base/mutex.h"
+#include "handle.h"
+#include "obj_ptr.h"
+
+namespace art {
+
+class ScopedObjectAccessAlreadyRunnable;
+class Task;
+class Thread;
+class ThreadPool;
+
+namespace mirror {
+class Class;
+class ClassLoader;
+}  // namespace mirror
+
+// Background threads loading and verifying the classes of the app's dex files, shared by the
+// ClassPreloader and the BackgroundVerifier. Their tasks check IsStopping() between classes to
+// return early once Stop() is called.
+class ClassWorkerPool {
+ public:
+  // Creates the threads and starts them. The caller is not runnable yet, it is not safe to wait
+  // for new threads to attach once app dex files are registered.
+  ClassWorkerPool(const char* name, size_t num_threads);
+  ~ClassWorkerPool();
+
+  void SetPthreadPriority(int priority) REQUIRES(!lock_);
+
+  // Queues `task`, or deletes it and returns false if the pool is stopped. Must be called with
+  // the mutator lock held, or from a task of this pool: Stop() suspends all threads before
+  // clearing the pool, and waits for the running tasks before deleting it.
+  bool AddTask(Thread* self, Task* task) REQUIRES(!lock_);
+
+  // Stop the workers once they drain the queue, called during runtime shutdown before the thread
+  // list is deleted. The queued tasks still run, and should return as soon as IsStopping().
+  void Stop(Thread* self) REQUIRES(!lock_);
+
+  bool IsStopping() const {
+    return stopping_.LoadRelaxed();
+  }
+
+  bool IsWorker(Thread* self) const;
+
+  // Returns whether the workers may load the classes of `class_loader`, checked once when a dex
+  // file is registered. Workers cannot call into Java, so the whole class loader chain must be
+  // searched natively the same way ClassLoader.loadClass() would: with another parent a worker
+  // could fail to resolve a superclass and leave the class erroneous for the app. Classes are not
+  // loaded in the background for a Java debuggable app either, so that a debugger or agent sees
+  // the class load events on the app threads.
+  static bool CanLoadClassesFor(ScopedObjectAccessAlreadyRunnable& soa,
+                                ObjPtr<mirror::ClassLoader> class_loader)
+      REQUIRES_SHARED(Locks::mutator_lock_);
+
+  // Find the class with `descriptor` through `class_loader`, and verify it unless it is verified
+  // or erroneous. `class_loader` must pass CanLoadClassesFor(), so failures are recorded in the
+  // class the same way as if an app thread had loaded it, and the exceptions are cleared. Returns
+  // null if the class is not found. `verified` is set to whether this call verified the class.
+  static ObjPtr<mirror::Class> FindAndVerifyClass(Thread* self,
+                                                  const char* descriptor,
+                                                  Handle<mirror::ClassLoader> class_loader,
+                                                  /*out*/ bool* verified)
+      REQUIRES_SHARED(Locks::mutator_lock_);
+
+ private:
+  Mutex lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
+  std::unique_ptr<ThreadPool> thread_pool_ GUARDED_BY(lock_);
+  // The threads of the pool, set once they are all attached.
+  std::vector<Thread*> worker_threads_;
+
+  Atomic<bool> stopping_;
+
+  DISALLOW_COPY_AND_ASSIGN(ClassWorkerPool);
+};
+
+}  // namespace art
+
+#endif  // ART_RUNTIME_CLASS_WORKER_POOL_H_
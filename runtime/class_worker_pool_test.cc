@@ -0,0 +1,147 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "class_worker_pool.h"
+
+#include <unistd.h>
+
+#include "class_linker-inl.h"
+#include "common_runtime_test.h"
+#include "handle_scope-inl.h"
+#include "mirror/class-inl.h"
+#include "mirror/class_loader.h"
+#include "scoped_thread_state_change-inl.h"
+#include "thread-inl.h"
+#include "thread_pool.h"
+
+namespace art {
+
+class VerifyClassTask : public SelfDeletingTask {
+ public:
+  VerifyClassTask(ClassWorkerPool* pool,
+                  jobject class_loader,
+                  const char* descriptor,
+                  AtomicInteger* num_run,
+                  AtomicInteger* num_verified)
+      : pool_(pool),
+        class_loader_(class_loader),
+        descriptor_(descriptor),
+        num_run_(num_run),
+        num_verified_(num_verified) {}
+
+  void Run(Thread* self) OVERRIDE {
+    EXPECT_TRUE(pool_->IsWorker(self));
+    ScopedObjectAccess soa(self);
+    StackHandleScope<1> hs(self);
+    Handle<mirror::ClassLoader> loader(
+        hs.NewHandle(soa.Decode<mirror::ClassLoader>(class_loader_)));
+    bool verified;
+    ObjPtr<mirror::Class> klass =
+        ClassWorkerPool::FindAndVerifyClass(self, descriptor_, loader, &verified);
+    EXPECT_TRUE(klass != nullptr) << descriptor_;
+    EXPECT_FALSE(self->IsExceptionPending());
+    if (verified) {
+      num_verified_->FetchAndAddSequentiallyConsistent(1);
+    }
+    num_run_->FetchAndAddSequentiallyConsistent(1);
+  }
+
+ private:
+  ClassWorkerPool* const pool_;
+  const jobject class_loader_;
+  const char* const descriptor_;
+  AtomicInteger* const num_run_;
+  AtomicInteger* const num_verified_;
+};
+
+class SleepTask : public SelfDeletingTask {
+ public:
+  SleepTask(ClassWorkerPool* pool, AtomicInteger* num_run) : pool_(pool), num_run_(num_run) {}
+
+  void Run(Thread* self ATTRIBUTE_UNUSED) OVERRIDE {
+    if (!pool_->IsStopping()) {
+      usleep(1000);
+    }
+    num_run_->FetchAndAddSequentiallyConsistent(1);
+  }
+
+ private:
+  ClassWorkerPool* const pool_;
+  AtomicInteger* const num_run_;
+};
+
+class ClassWorkerPoolTest : public CommonRuntimeTest {};
+
+TEST_F(ClassWorkerPoolTest, VerifyClasses) {
+  Thread* self = Thread::Current();
+  jobject class_loader;
+  {
+    ScopedObjectAccess soa(self);
+    class_loader = LoadDex("Nested");
+  }
+  static const char* const kDescriptors[] = { "LNested;", "LNested$Inner;" };
+  ClassWorkerPool pool("Class worker pool test", 2u);
+  AtomicInteger num_run(0);
+  AtomicInteger num_verified(0);
+  {
+    ScopedObjectAccess soa(self);
+    EXPECT_TRUE(ClassWorkerPool::CanLoadClassesFor(soa, nullptr));
+    EXPECT_TRUE(
+        ClassWorkerPool::CanLoadClassesFor(soa, soa.Decode<mirror::ClassLoader>(class_loader)));
+    for (const char* descriptor : kDescriptors) {
+      EXPECT_TRUE(pool.AddTask(
+          self, new VerifyClassTask(&pool, class_loader, descriptor, &num_run, &num_verified)));
+    }
+  }
+  // The tasks ignore IsStopping(), Stop() waits for them to verify all the classes.
+  pool.Stop(self);
+  EXPECT_EQ(2, num_run.LoadSequentiallyConsistent());
+  EXPECT_EQ(2, num_verified.LoadSequentiallyConsistent());
+
+  ScopedObjectAccess soa(self);
+  StackHandleScope<2> hs(self);
+  Handle<mirror::ClassLoader> loader(hs.NewHandle(soa.Decode<mirror::ClassLoader>(class_loader)));
+  MutableHandle<mirror::Class> klass(hs.NewHandle<mirror::Class>(nullptr));
+  for (const char* descriptor : kDescriptors) {
+    klass.Assign(class_linker_->FindClass(self, descriptor, loader));
+    ASSERT_TRUE(klass != nullptr) << descriptor;
+    EXPECT_TRUE(klass->IsVerified()) << descriptor;
+  }
+  // The pool does not take tasks once stopped.
+  EXPECT_FALSE(pool.AddTask(
+      self, new VerifyClassTask(&pool, class_loader, kDescriptors[0], &num_run, &num_verified)));
+  EXPECT_EQ(2, num_run.LoadSequentiallyConsistent());
+}
+
+TEST_F(ClassWorkerPoolTest, StopDrainsQueue) {
+  Thread* self = Thread::Current();
+  static constexpr int32_t kNumTasks = 64;
+  ClassWorkerPool pool("Class worker pool test", 2u);
+  EXPECT_FALSE(pool.IsWorker(self));
+  AtomicInteger num_run(0);
+  {
+    ScopedObjectAccess soa(self);
+    for (int32_t i = 0; i != kNumTasks; ++i) {
+      EXPECT_TRUE(pool.AddTask(self, new SleepTask(&pool, &num_run)));
+    }
+  }
+  pool.Stop(self);
+  EXPECT_TRUE(pool.IsStopping());
+  // All the queued tasks ran before Stop() returned, the ones run after the stop returned early.
+  EXPECT_EQ(kNumTasks, num_run.LoadSequentiallyConsistent());
+}
+
+}  // namespace art
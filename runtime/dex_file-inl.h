@@ -33,6 +33,8 @@ inline int32_t DexFile::GetStringLength(const StringId& string_id) const {
 inline const char* DexFile::GetStringDataAndUtf16Length(const StringId& string_id,
                                                         uint32_t* utf16_length) const {
   DCHECK(utf16_length != nullptr) << GetLocation();
+  // The string data may also be after the end of the dex file, in the data section shared by the
+  // dex files of a vdex file.
   const uint8_t* ptr = begin_ + string_id.string_data_off_;
   *utf16_length = DecodeUnsignedLeb128(&ptr);
   return reinterpret_cast<const char*>(ptr);
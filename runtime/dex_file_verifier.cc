@@ -114,6 +114,8 @@ const char* DexFileVerifier::CheckLoadStringByIdx(dex::StringIndex idx, const ch
 static bool FindMethodName(uint32_t method_index,
                            const uint8_t* begin,
                            const DexFile::Header* header,
+                           const uint8_t* shared_data_begin,
+                           size_t shared_data_size,
                            const char** str,
                            std::string* error_msg) {
   if (method_index >= header->method_ids_size_) {
@@ -130,13 +132,18 @@ static bool FindMethodName(uint32_t method_index,
   uint32_t string_off =
       (reinterpret_cast<const DexFile::StringId*>(begin + header->string_ids_off_) + string_idx)->
           string_data_off_;
+  const uint8_t* str_data_ptr = begin + string_off;
+  const uint8_t* str_data_end = begin + header->file_size_;
   if (string_off >= header->file_size_) {
-    *error_msg = "String offset out of bounds for method flags verification";
-    return false;
+    // The string data may be in the shared data section.
+    str_data_end = shared_data_begin + shared_data_size;
+    if (str_data_ptr < shared_data_begin || str_data_ptr >= str_data_end) {
+      *error_msg = "String offset out of bounds for method flags verification";
+      return false;
+    }
   }
-  const uint8_t* str_data_ptr = begin + string_off;
   uint32_t dummy;
-  if (!DecodeUnsignedLeb128Checked(&str_data_ptr, begin + header->file_size_, &dummy)) {
+  if (!DecodeUnsignedLeb128Checked(&str_data_ptr, str_data_end, &dummy)) {
     *error_msg = "String size out of bounds for method flags verification";
     return false;
   }
@@ -231,7 +238,30 @@ bool DexFileVerifier::Verify(const DexFile* dex_file,
                              bool verify_checksum,
                              std::string* error_msg) {
   std::unique_ptr<DexFileVerifier> verifier(
-      new DexFileVerifier(dex_file, begin, size, location, verify_checksum));
+      new DexFileVerifier(dex_file, begin, size, nullptr, 0u, location, verify_checksum));
+  if (!verifier->Verify()) {
+    *error_msg = verifier->FailureReason();
+    return false;
+  }
+  return true;
+}
+
+bool DexFileVerifier::VerifyWithSharedData(const DexFile* dex_file,
+                                           const uint8_t* begin,
+                                           size_t size,
+                                           const uint8_t* shared_data_begin,
+                                           size_t shared_data_size,
+                                           const char* location,
+                                           bool verify_checksum,
+                                           std::string* error_msg) {
+  DCHECK_GE(shared_data_begin, begin + size);
+  std::unique_ptr<DexFileVerifier> verifier(new DexFileVerifier(dex_file,
+                                                                begin,
+                                                                size,
+                                                                shared_data_begin,
+                                                                shared_data_size,
+                                                                location,
+                                                                verify_checksum));
   if (!verifier->Verify()) {
     *error_msg = verifier->FailureReason();
     return false;
@@ -692,7 +722,13 @@ bool DexFileVerifier::CheckClassDataItemMethod(uint32_t idx,
 
   std::string error_msg;
   const char* method_name;
-  if (!FindMethodName(idx, begin_, header_, &method_name, &error_msg)) {
+  if (!FindMethodName(idx,
+                      begin_,
+                      header_,
+                      shared_data_begin_,
+                      shared_data_size_,
+                      &method_name,
+                      &error_msg)) {
     ErrorStringPrintf("%s", error_msg.c_str());
     return false;
   }
@@ -1210,12 +1246,19 @@ bool DexFileVerifier::CheckIntraCodeItem() {
 }
 
 bool DexFileVerifier::CheckIntraStringDataItem() {
-  DECODE_UNSIGNED_CHECKED_FROM(ptr_, size);
-  const uint8_t* file_end = begin_ + size_;
+  return CheckStringDataItem(begin_ + size_);
+}
+
+bool DexFileVerifier::CheckStringDataItem(const uint8_t* data_end) {
+  uint32_t size;
+  if (!DecodeUnsignedLeb128Checked(&ptr_, data_end, &size)) {
+    ErrorStringPrintf("Read out of bounds");
+    return false;
+  }
 
   for (uint32_t i = 0; i < size; i++) {
     CHECK_LT(i, size);  // b/15014252 Prevents hitting the impossible case below
-    if (UNLIKELY(ptr_ >= file_end)) {
+    if (UNLIKELY(ptr_ >= data_end)) {
       ErrorStringPrintf("String data would go beyond end-of-file");
       return false;
     }
@@ -1287,6 +1330,10 @@ bool DexFileVerifier::CheckIntraStringDataItem() {
     }
   }
 
+  if (UNLIKELY(ptr_ >= data_end)) {
+    ErrorStringPrintf("String data would go beyond end-of-file");
+    return false;
+  }
   if (UNLIKELY(*(ptr_++) != '\0')) {
     ErrorStringPrintf("String longer than indicated size %x", size);
     return false;
@@ -1904,9 +1951,16 @@ dex::TypeIndex DexFileVerifier::FindFirstAnnotationsDirectoryDefiner(const uint8
 bool DexFileVerifier::CheckInterStringIdItem() {
   const DexFile::StringId* item = reinterpret_cast<const DexFile::StringId*>(ptr_);
 
-  // Check the map to make sure it has the right offset->type.
-  if (!CheckOffsetToTypeMap(item->string_data_off_, DexFile::kDexTypeStringDataItem)) {
-    return false;
+  if (item->string_data_off_ >= size_ && shared_data_size_ != 0u) {
+    // The string data is in the shared data section, which is not in the map.
+    if (!CheckSharedStringData(item->string_data_off_)) {
+      return false;
+    }
+  } else {
+    // Check the map to make sure it has the right offset->type.
+    if (!CheckOffsetToTypeMap(item->string_data_off_, DexFile::kDexTypeStringDataItem)) {
+      return false;
+    }
   }
 
   // Check ordering between items.
@@ -1924,6 +1978,21 @@ bool DexFileVerifier::CheckInterStringIdItem() {
   return true;
 }
 
+bool DexFileVerifier::CheckSharedStringData(uint32_t offset) {
+  const uint8_t* data = begin_ + offset;
+  const uint8_t* shared_data_end = shared_data_begin_ + shared_data_size_;
+  if (UNLIKELY(data < shared_data_begin_ || data >= shared_data_end)) {
+    ErrorStringPrintf("String data offset %x out of bounds of the shared data", offset);
+    return false;
+  }
+  // The string data is checked again by each dex file using it.
+  const uint8_t* saved_ptr = ptr_;
+  ptr_ = data;
+  bool result = CheckStringDataItem(shared_data_end);
+  ptr_ = saved_ptr;
+  return result;
+}
+
 bool DexFileVerifier::CheckInterTypeIdItem() {
   const DexFile::TypeId* item = reinterpret_cast<const DexFile::TypeId*>(ptr_);
 
@@ -34,6 +34,18 @@ class DexFileVerifier {
                      bool verify_checksum,
                      std::string* error_msg);
 
+  // Verifies a dex file whose string ids may also point to string data in a section shared with
+  // other dex files, at [shared_data_begin, shared_data_begin + shared_data_size) after the end
+  // of the dex file. See DexLayout::LayoutSharedData().
+  static bool VerifyWithSharedData(const DexFile* dex_file,
+                                   const uint8_t* begin,
+                                   size_t size,
+                                   const uint8_t* shared_data_begin,
+                                   size_t shared_data_size,
+                                   const char* location,
+                                   bool verify_checksum,
+                                   std::string* error_msg);
+
   const std::string& FailureReason() const {
     return failure_reason_;
   }
@@ -42,11 +54,15 @@ class DexFileVerifier {
   DexFileVerifier(const DexFile* dex_file,
                   const uint8_t* begin,
                   size_t size,
+                  const uint8_t* shared_data_begin,
+                  size_t shared_data_size,
                   const char* location,
                   bool verify_checksum)
       : dex_file_(dex_file),
         begin_(begin),
         size_(size),
+        shared_data_begin_(shared_data_begin),
+        shared_data_size_(shared_data_size),
         location_(location),
         verify_checksum_(verify_checksum),
         header_(&dex_file->GetHeader()),
@@ -118,6 +134,8 @@ class DexFileVerifier {
 
   bool CheckIntraCodeItem();
   bool CheckIntraStringDataItem();
+  // Check the string data item at ptr_, which must not extend past data_end.
+  bool CheckStringDataItem(const uint8_t* data_end);
   bool CheckIntraDebugInfoItem();
   bool CheckIntraAnnotationItem();
   bool CheckIntraAnnotationsDirectoryItem();
@@ -135,6 +153,8 @@ class DexFileVerifier {
   dex::TypeIndex FindFirstAnnotationsDirectoryDefiner(const uint8_t* ptr, bool* success);
 
   bool CheckInterStringIdItem();
+  // Check that the string data at the given offset is in the shared data section, and valid.
+  bool CheckSharedStringData(uint32_t offset);
   bool CheckInterTypeIdItem();
   bool CheckInterProtoIdItem();
   bool CheckInterFieldIdItem();
@@ -199,6 +219,9 @@ class DexFileVerifier {
   const DexFile* const dex_file_;
   const uint8_t* const begin_;
   const size_t size_;
+  // The data section shared with other dex files, if any.
+  const uint8_t* const shared_data_begin_;
+  const size_t shared_data_size_;
   const char* const location_;
   const bool verify_checksum_;
   const DexFile::Header* const header_;
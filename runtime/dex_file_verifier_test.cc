@@ -2072,6 +2072,70 @@ static const char* kInvokeCustomDexFiles[] = {
   "CwAAACAAAAEAAADGCwAAABAAAAEAAADkCwAA"
 };
 
+TEST_F(DexFileVerifierTest, SharedStringData) {
+  size_t length;
+  std::unique_ptr<uint8_t[]> dex_bytes(DecodeBase64(kGoodTestDex, &length));
+  CHECK(dex_bytes != nullptr);
+  // Move the string data of the first string, "<init>", to a shared data section after the end
+  // of the dex file, as DexLayout::LayoutSharedData() does.
+  const size_t shared_data_offset = RoundUp(length, 4u);
+  std::vector<uint8_t> data(shared_data_offset + 16u, 0u);
+  memcpy(data.data(), dex_bytes.get(), length);
+  const DexFile::Header* header = reinterpret_cast<const DexFile::Header*>(data.data());
+  DexFile::StringId* string_id =
+      reinterpret_cast<DexFile::StringId*>(data.data() + header->string_ids_off_);
+  const uint8_t* string_data = data.data() + string_id->string_data_off_;
+  const uint8_t* chars = string_data;
+  DecodeUnsignedLeb128(&chars);
+  const size_t shared_data_size =
+      (chars - string_data) + strlen(reinterpret_cast<const char*>(chars)) + 1u;
+  ASSERT_LE(shared_data_size, data.size() - shared_data_offset);
+  memcpy(data.data() + shared_data_offset, string_data, shared_data_size);
+  string_id->string_data_off_ = static_cast<uint32_t>(shared_data_offset);
+  // Note: `dex_file` will be destroyed before `data`.
+  std::unique_ptr<DexFile> dex_file(GetDexFile(data.data(), length));
+  std::string error_msg;
+
+  // The string data is outside of the dex file.
+  EXPECT_FALSE(DexFileVerifier::Verify(dex_file.get(),
+                                       dex_file->Begin(),
+                                       dex_file->Size(),
+                                       "no shared data",
+                                       /*verify_checksum*/ false,
+                                       &error_msg));
+  EXPECT_TRUE(DexFileVerifier::VerifyWithSharedData(dex_file.get(),
+                                                    dex_file->Begin(),
+                                                    dex_file->Size(),
+                                                    data.data() + shared_data_offset,
+                                                    shared_data_size,
+                                                    "shared data",
+                                                    /*verify_checksum*/ false,
+                                                    &error_msg)) << error_msg;
+
+  // The string data goes beyond the end of the shared data.
+  EXPECT_FALSE(DexFileVerifier::VerifyWithSharedData(dex_file.get(),
+                                                     dex_file->Begin(),
+                                                     dex_file->Size(),
+                                                     data.data() + shared_data_offset,
+                                                     shared_data_size - 1u,
+                                                     "truncated shared data",
+                                                     /*verify_checksum*/ false,
+                                                     &error_msg));
+
+  // The string data is shorter than its size.
+  ASSERT_EQ(6u, data[shared_data_offset]);
+  data[shared_data_offset] = 7u;
+  EXPECT_FALSE(DexFileVerifier::VerifyWithSharedData(dex_file.get(),
+                                                     dex_file->Begin(),
+                                                     dex_file->Size(),
+                                                     data.data() + shared_data_offset,
+                                                     shared_data_size,
+                                                     "bad shared data",
+                                                     /*verify_checksum*/ false,
+                                                     &error_msg));
+  EXPECT_NE(error_msg.find("String data shorter than indicated"), std::string::npos) << error_msg;
+}
+
 TEST_F(DexFileVerifierTest, InvokeCustomDexSamples) {
   for (size_t i = 0; i < arraysize(kInvokeCustomDexFiles); ++i) {
     size_t length;
@@ -819,6 +819,30 @@ void Heap::DecrementDisableThreadFlip(Thread* self) {
   }
 }
 
+void Heap::PinForJniCritical(Thread* self, ObjPtr<mirror::Object> obj) {
+  if (!kUseReadBarrier) {
+    IncrementDisableMovingGC(self);
+  } else if (region_space_ != nullptr && region_space_->HasAddress(obj.Ptr())) {
+    // Neither the thread flip nor the GC need to wait for the critical section to end.
+    region_space_->PinRegion(obj.Ptr());
+  } else {
+    // For the CC collector, we only need to wait for the thread flip rather than the whole GC
+    // to occur thanks to the to-space invariant.
+    IncrementDisableThreadFlip(self);
+  }
+}
+
+void Heap::UnpinForJniCritical(Thread* self, ObjPtr<mirror::Object> obj) {
+  if (!kUseReadBarrier) {
+    DecrementDisableMovingGC(self);
+  } else if (region_space_ != nullptr && region_space_->HasAddress(obj.Ptr())) {
+    // The region was not evacuated, obj is at the address it was pinned at.
+    region_space_->UnpinRegion(obj.Ptr());
+  } else {
+    DecrementDisableThreadFlip(self);
+  }
+}
+
 void Heap::ThreadFlipBegin(Thread* self) {
   // Supposed to be called by GC. Set thread_flip_running_ to be true. If disable_thread_flip_count_
   // > 0, block. Otherwise, go ahead.
@@ -1357,6 +1381,14 @@ void Heap::Trim(Thread* self) {
     size_t count = runtime->GetMonitorList()->DeflateMonitors();
     VLOG(heap) << "Deflating " << count << " monitors took "
         << PrettyDuration(NanoTime() - start_time);
+  } else {
+    // Deflate the idle monitors without a pause, so that processes that care about pause times
+    // do not keep the monitors of objects that are no longer contended.
+    ScopedTrace trace("Deflating idle monitors");
+    uint64_t start_time = NanoTime();
+    size_t count = runtime->GetMonitorList()->DeflateMonitorsConcurrently(self);
+    VLOG(heap) << "Concurrently deflating " << count << " monitors took "
+        << PrettyDuration(NanoTime() - start_time);
   }
   TrimIndirectReferenceTables(self);
   TrimSpaces(self);
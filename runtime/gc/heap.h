@@ -315,6 +315,17 @@ class Heap {
   // Temporarily disable thread flip for JNI critical calls.
   void IncrementDisableThreadFlip(Thread* self) REQUIRES(!*thread_flip_lock_);
   void DecrementDisableThreadFlip(Thread* self) REQUIRES(!*thread_flip_lock_);
+
+  // Keep the movable object obj in place for a JNI critical section. With the concurrent copying
+  // collector, the region of obj is pinned and the GC proceeds around it; otherwise moving GC or
+  // thread flips are disabled until UnpinForJniCritical(). May suspend the thread unless the
+  // region is pinned, callers must re-read obj.
+  void PinForJniCritical(Thread* self, ObjPtr<mirror::Object> obj)
+      REQUIRES(!*gc_complete_lock_, !*thread_flip_lock_)
+      REQUIRES_SHARED(Locks::mutator_lock_);
+  void UnpinForJniCritical(Thread* self, ObjPtr<mirror::Object> obj)
+      REQUIRES(!*gc_complete_lock_, !*thread_flip_lock_)
+      REQUIRES_SHARED(Locks::mutator_lock_);
   void ThreadFlipBegin(Thread* self) REQUIRES(!*thread_flip_lock_);
   void ThreadFlipEnd(Thread* self) REQUIRES(!*thread_flip_lock_);
 
@@ -18,6 +18,7 @@
 
 #include <lz4.h>
 #include <random>
+#include <vector>
 #include <sys/statvfs.h>
 #include <sys/types.h>
 #include <unistd.h>
@@ -64,7 +65,10 @@ ImageSpace::ImageSpace(const std::string& image_filename,
                   end,
                   kGcRetentionPolicyNeverCollect),
       oat_file_non_owned_(nullptr),
-      image_location_(image_location) {
+      image_location_(image_location),
+      relocated_(false),
+      relocation_time_ns_(0u),
+      relocation_dirty_pages_(-1) {
   DCHECK(live_bitmap != nullptr);
   live_bitmap_.reset(live_bitmap);
 }
@@ -655,15 +659,31 @@ class ImageSpaceLoader {
         return nullptr;
       }
     }
+    bool relocated = false;
+    uint64_t relocation_time_ns = 0u;
     {
       TimingLogger::ScopedTiming timing("RelocateImage", &logger);
+      const uint64_t relocation_start_ns = NanoTime();
       if (!RelocateInPlace(*image_header,
                            map->Begin(),
                            bitmap.get(),
                            oat_file,
+                           &relocated,
                            error_msg)) {
         return nullptr;
       }
+      relocation_time_ns = NanoTime() - relocation_start_ns;
+    }
+    ssize_t relocation_dirty_pages = -1;
+    if (relocated) {
+      // Fixups only write the values that change, so pages that need no fixup stay clean and
+      // shared with the file. Count the pages that did get dirtied to keep track of the cost of
+      // not loading the image at its preferred address.
+      TimingLogger::ScopedTiming timing("CountRelocationDirtyPages", &logger);
+      relocation_dirty_pages = CountPrivateDirtyPages(map->Begin(), map->Size());
+      VLOG(image) << "Relocated image " << image_filename << " in "
+                  << PrettyDuration(relocation_time_ns) << ", dirtied "
+                  << relocation_dirty_pages << " of " << map->Size() / kPageSize << " pages";
     }
     // We only want the mirror object, not the ArtFields and ArtMethods.
     std::unique_ptr<ImageSpace> space(new ImageSpace(image_filename,
@@ -671,6 +691,9 @@ class ImageSpaceLoader {
                                                      map.release(),
                                                      bitmap.release(),
                                                      image_end));
+    space->relocated_ = relocated;
+    space->relocation_time_ns_ = relocation_time_ns;
+    space->relocation_dirty_pages_ = relocation_dirty_pages;
 
     // VerifyImageAllocations() will be called later in Runtime::Init()
     // as some class roots like ArtMethod::java_lang_reflect_ArtMethod_
@@ -826,6 +849,34 @@ class ImageSpaceLoader {
     return map.release();
   }
 
+  // Count the pages of [begin, begin + size) that are private to this process, that is the pages
+  // of a private file mapping that were written to, or any resident page of an anonymous mapping.
+  // Returns -1 if /proc/self/pagemap cannot be read.
+  static ssize_t CountPrivateDirtyPages(const uint8_t* begin, size_t size) {
+    // See https://www.kernel.org/doc/Documentation/vm/pagemap.txt
+    constexpr uint64_t kPagePresentMask = UINT64_C(1) << 63;
+    constexpr uint64_t kPageFileOrSharedAnonMask = UINT64_C(1) << 61;
+    std::unique_ptr<File> page_map_file(OS::OpenFileForReading("/proc/self/pagemap"));
+    if (page_map_file == nullptr) {
+      return -1;
+    }
+    const size_t first_page = reinterpret_cast<uintptr_t>(begin) / kPageSize;
+    const size_t num_pages = RoundUp(size, kPageSize) / kPageSize;
+    std::vector<uint64_t> entries(num_pages);
+    if (!page_map_file->PreadFully(entries.data(),
+                                   num_pages * sizeof(uint64_t),
+                                   first_page * sizeof(uint64_t))) {
+      return -1;
+    }
+    ssize_t count = 0;
+    for (uint64_t entry : entries) {
+      if ((entry & kPagePresentMask) != 0u && (entry & kPageFileOrSharedAnonMask) == 0u) {
+        ++count;
+      }
+    }
+    return count;
+  }
+
   class FixupVisitor : public ValueObject {
    public:
     FixupVisitor(const RelocationRange& boot_image,
@@ -940,9 +991,13 @@ class ImageSpaceLoader {
         // Space is not yet added to the heap, don't do a read barrier.
         mirror::Object* ref = obj->GetFieldObject<mirror::Object, kVerifyNone, kWithoutReadBarrier>(
             offset);
-        // Use SetFieldObjectWithoutWriteBarrier to avoid card marking since we are writing to the
-        // image.
-        obj->SetFieldObjectWithoutWriteBarrier<false, true, kVerifyNone>(offset, ForwardObject(ref));
+        mirror::Object* new_ref = ForwardObject(ref);
+        // Only write changed references so that pages which need no fixup stay clean.
+        if (ref != new_ref) {
+          // Use SetFieldObjectWithoutWriteBarrier to avoid card marking since we are writing to the
+          // image.
+          obj->SetFieldObjectWithoutWriteBarrier<false, true, kVerifyNone>(offset, new_ref);
+        }
       }
     }
 
@@ -971,9 +1026,12 @@ class ImageSpaceLoader {
                     ObjPtr<mirror::Reference> ref) const
         REQUIRES_SHARED(Locks::mutator_lock_) REQUIRES(Locks::heap_bitmap_lock_) {
       mirror::Object* obj = ref->GetReferent<kWithoutReadBarrier>();
-      ref->SetFieldObjectWithoutWriteBarrier<false, true, kVerifyNone>(
-          mirror::Reference::ReferentOffset(),
-          ForwardObject(obj));
+      mirror::Object* new_obj = ForwardObject(obj);
+      if (obj != new_obj) {
+        ref->SetFieldObjectWithoutWriteBarrier<false, true, kVerifyNone>(
+            mirror::Reference::ReferentOffset(),
+            new_obj);
+      }
     }
 
     void operator()(mirror::Object* obj) const NO_THREAD_SAFETY_ANALYSIS {
@@ -1123,8 +1181,11 @@ class ImageSpaceLoader {
                               uint8_t* target_base,
                               accounting::ContinuousSpaceBitmap* bitmap,
                               const OatFile* app_oat_file,
+                              /*out*/bool* relocated,
                               std::string* error_msg) {
+    DCHECK(relocated != nullptr);
     DCHECK(error_msg != nullptr);
+    *relocated = false;
     if (!image_header.IsPic()) {
       if (image_header.GetImageBegin() == target_base) {
         return true;
@@ -1193,6 +1254,7 @@ class ImageSpaceLoader {
       // Nothing to fix up.
       return true;
     }
+    *relocated = true;
     ScopedDebugDisallowReadBarriers sddrb(Thread::Current());
     // Need to update the image to be at the target base.
     const ImageSection& objects_section = image_header.GetImageSection(ImageHeader::kSectionObjects);
@@ -1715,7 +1777,12 @@ void ImageSpace::Dump(std::ostream& os) const {
       << " begin=" << reinterpret_cast<void*>(Begin())
       << ",end=" << reinterpret_cast<void*>(End())
       << ",size=" << PrettySize(Size())
-      << ",name=\"" << GetName() << "\"]";
+      << ",name=\"" << GetName() << "\"";
+  if (relocated_) {
+    os << ",relocation_time=" << PrettyDuration(relocation_time_ns_)
+       << ",relocation_dirty_pages=" << relocation_dirty_pages_;
+  }
+  os << "]";
 }
 
 std::string ImageSpace::GetMultiImageBootClassPath(
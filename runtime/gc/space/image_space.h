@@ -159,6 +159,23 @@ class ImageSpace : public MemMapSpace {
 
   void DumpSections(std::ostream& os) const;
 
+  // Return true if the image was not mapped at the addresses it was compiled for and had to be
+  // fixed up when it was loaded.
+  bool WasRelocated() const {
+    return relocated_;
+  }
+
+  // Time spent fixing up the image when it was relocated.
+  uint64_t GetRelocationTimeNs() const {
+    return relocation_time_ns_;
+  }
+
+  // Number of image pages that relocation made private to this process, or -1 if the count is not
+  // available.
+  ssize_t GetRelocationDirtyPages() const {
+    return relocation_dirty_pages_;
+  }
+
  protected:
   // Tries to initialize an ImageSpace from the given image path, returning null on error.
   //
@@ -194,6 +211,11 @@ class ImageSpace : public MemMapSpace {
 
   const std::string image_location_;
 
+  // Relocation statistics, see WasRelocated.
+  bool relocated_;
+  uint64_t relocation_time_ns_;
+  ssize_t relocation_dirty_pages_;
+
   friend class ImageSpaceLoader;
   friend class Space;
 
@@ -207,7 +207,9 @@ void RegionSpace::SetFromSpace(accounting::ReadBarrierTable* rb_table, bool forc
         DCHECK((state == RegionState::kRegionStateAllocated ||
                 state == RegionState::kRegionStateLarge) &&
                type == RegionType::kRegionTypeToSpace);
-        bool should_evacuate = force_evacuate_all || r->ShouldBeEvacuated();
+        // A region pinned by a JNI critical section keeps its objects in place, even when
+        // evacuating all regions.
+        bool should_evacuate = !r->IsPinned() && (force_evacuate_all || r->ShouldBeEvacuated());
         if (should_evacuate) {
           r->SetAsFromSpace();
           DCHECK(r->IsInFromSpace());
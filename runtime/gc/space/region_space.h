@@ -212,6 +212,18 @@ class RegionSpace FINAL : public ContinuousMemMapAllocSpace {
   void SetFromSpace(accounting::ReadBarrierTable* rb_table, bool force_evacuate_all)
       REQUIRES(!region_lock_);
 
+  // Pin the region of ref for a JNI critical section on ref. Pinned regions are not evacuated,
+  // so the objects in them do not move. Pins nest. The region is chosen as from-space only in
+  // the flip pause, so pinning while runnable, without a suspend point since ref was read,
+  // takes effect for the next evacuation.
+  void PinRegion(mirror::Object* ref) {
+    RefToRegionUnlocked(ref)->Pin();
+  }
+
+  void UnpinRegion(mirror::Object* ref) {
+    RefToRegionUnlocked(ref)->Unpin();
+  }
+
   size_t FromSpaceSize() REQUIRES(!region_lock_);
   size_t UnevacFromSpaceSize() REQUIRES(!region_lock_);
   size_t ToSpaceSize() REQUIRES(!region_lock_);
@@ -253,7 +265,7 @@ class RegionSpace FINAL : public ContinuousMemMapAllocSpace {
           begin_(nullptr), top_(nullptr), end_(nullptr),
           state_(RegionState::kRegionStateAllocated), type_(RegionType::kRegionTypeToSpace),
           objects_allocated_(0), alloc_time_(0), live_bytes_(static_cast<size_t>(-1)),
-          is_newly_allocated_(false), is_a_tlab_(false), thread_(nullptr) {}
+          is_newly_allocated_(false), is_a_tlab_(false), thread_(nullptr), pin_count_(0) {}
 
     void Init(size_t idx, uint8_t* begin, uint8_t* end) {
       idx_ = idx;
@@ -268,6 +280,7 @@ class RegionSpace FINAL : public ContinuousMemMapAllocSpace {
       is_newly_allocated_ = false;
       is_a_tlab_ = false;
       thread_ = nullptr;
+      pin_count_.StoreRelaxed(0);
       DCHECK_LT(begin, end);
       DCHECK_EQ(static_cast<size_t>(end - begin), kRegionSize);
     }
@@ -291,6 +304,21 @@ class RegionSpace FINAL : public ContinuousMemMapAllocSpace {
       is_newly_allocated_ = false;
       is_a_tlab_ = false;
       thread_ = nullptr;
+      DCHECK(!IsPinned());
+    }
+
+    void Pin() {
+      DCHECK(!IsFree() && !IsLargeTail());
+      pin_count_.FetchAndAddSequentiallyConsistent(1);
+    }
+
+    void Unpin() {
+      int32_t old_pin_count = pin_count_.FetchAndSubSequentiallyConsistent(1);
+      DCHECK_GT(old_pin_count, 0);
+    }
+
+    bool IsPinned() const {
+      return pin_count_.LoadSequentiallyConsistent() != 0;
     }
 
     ALWAYS_INLINE mirror::Object* Alloc(size_t num_bytes, size_t* bytes_allocated,
@@ -492,6 +520,7 @@ class RegionSpace FINAL : public ContinuousMemMapAllocSpace {
     bool is_newly_allocated_;           // True if it's allocated after the last collection.
     bool is_a_tlab_;                    // True if it's a tlab.
     Thread* thread_;                    // The owning thread if it's a tlab.
+    Atomic<int32_t> pin_count_;         // The number of JNI critical sections on its objects.
 
     friend class RegionSpace;
   };
@@ -18,20 +18,29 @@
 #define ART_RUNTIME_IMT_CONFLICT_TABLE_H_
 
 #include <cstddef>
+#include <cstring>
 
+#include "art_method.h"
+#include "base/bit_utils.h"
 #include "base/casts.h"
 #include "base/enums.h"
 #include "base/macros.h"
 
 namespace art {
 
-class ArtMethod;
-
 // Table to resolve IMT conflicts at runtime. The table is attached to
 // the jni entrypoint of IMT conflict ArtMethods.
 // The table contains a list of pairs of { interface_method, implementation_method }
 // with the last entry being null to make an assembly implementation of a lookup
 // faster.
+//
+// Tables with kHashedThreshold entries or more use a hashed layout instead. The first pair is
+// { kHashedMarker, mask } and is followed by 2 * (mask + 1) slots. A method is stored in the
+// first free slot at or after `interface_method->GetDexMethodIndex() & mask`. Probing does not
+// wrap around and the last slot is always null, so a lookup stops at the first null slot after
+// the start of the probe. The dex method index is hashed rather than the ArtMethod pointer so
+// that the layout stays valid when images are relocated. The conflict trampolines of all
+// architectures check for the marker and start their scan at the first probe slot.
 class ImtConflictTable {
   enum MethodIndex {
     kMethodInterface,
@@ -40,31 +49,63 @@ class ImtConflictTable {
   };
 
  public:
+  // Tables with at least this number of entries use the hashed layout.
+  static constexpr size_t kHashedThreshold = 8u;
+  // Interface method of the first entry of a hashed table.
+  static constexpr size_t kHashedMarker = 1u;
+
   // Build a new table copying `other` and adding the new entry formed of
   // the pair { `interface_method`, `implementation_method` }
   ImtConflictTable(ImtConflictTable* other,
                    ArtMethod* interface_method,
                    ArtMethod* implementation_method,
-                   PointerSize pointer_size) {
-    const size_t count = other->NumEntries(pointer_size);
-    for (size_t i = 0; i < count; ++i) {
-      SetInterfaceMethod(i, pointer_size, other->GetInterfaceMethod(i, pointer_size));
-      SetImplementationMethod(i, pointer_size, other->GetImplementationMethod(i, pointer_size));
-    }
-    SetInterfaceMethod(count, pointer_size, interface_method);
-    SetImplementationMethod(count, pointer_size, implementation_method);
-    // Add the null marker.
-    SetInterfaceMethod(count + 1, pointer_size, nullptr);
-    SetImplementationMethod(count + 1, pointer_size, nullptr);
+                   PointerSize pointer_size)
+      : ImtConflictTable(other->NumEntries(pointer_size) + 1u, pointer_size) {
+    other->Visit([this, pointer_size](const std::pair<ArtMethod*, ArtMethod*>& methods) {
+      AddEntry(methods.first, methods.second, pointer_size);
+      return methods;
+    }, pointer_size);
+    AddEntry(interface_method, implementation_method, pointer_size);
   }
 
-  // num_entries excludes the header.
+  // Build an empty table with room for `num_entries` entries, see AddEntry().
   ImtConflictTable(size_t num_entries, PointerSize pointer_size) {
-    SetInterfaceMethod(num_entries, pointer_size, nullptr);
-    SetImplementationMethod(num_entries, pointer_size, nullptr);
+    if (num_entries < kHashedThreshold) {
+      SetInterfaceMethod(num_entries, pointer_size, nullptr);
+      SetImplementationMethod(num_entries, pointer_size, nullptr);
+    } else {
+      const size_t capacity = HashedCapacity(num_entries);
+      SetInterfaceMethod(0u, pointer_size, reinterpret_cast<ArtMethod*>(kHashedMarker));
+      SetImplementationMethod(0u, pointer_size, reinterpret_cast<ArtMethod*>(capacity - 1u));
+      for (size_t i = 1u, end = NumHashedSlots(capacity) + 1u; i != end; ++i) {
+        SetInterfaceMethod(i, pointer_size, nullptr);
+        SetImplementationMethod(i, pointer_size, nullptr);
+      }
+    }
+  }
+
+  // Add an entry to a table built with room for it. For the linear layout, the entry is
+  // appended before the null marker.
+  void AddEntry(ArtMethod* interface_method,
+                ArtMethod* implementation_method,
+                PointerSize pointer_size) {
+    DCHECK(interface_method != nullptr);
+    size_t index;
+    if (IsHashed(pointer_size)) {
+      index = FirstProbeIndex(interface_method, pointer_size);
+      while (GetInterfaceMethod(index, pointer_size) != nullptr) {
+        ++index;
+      }
+      DCHECK_LT(index + 1u, GetHashedTableEnd(pointer_size)) << "Table is full";
+    } else {
+      index = NumEntries(pointer_size);
+    }
+    SetInterfaceMethod(index, pointer_size, interface_method);
+    SetImplementationMethod(index, pointer_size, implementation_method);
   }
 
-  // Set an entry at an index.
+  // Set an entry at an index. For hashed tables, index 0 is the header and the slots start
+  // at index 1.
   void SetInterfaceMethod(size_t index, PointerSize pointer_size, ArtMethod* method) {
     SetMethod(index * kMethodCount + kMethodInterface, pointer_size, method);
   }
@@ -81,20 +122,15 @@ class ImtConflictTable {
     return GetMethod(index * kMethodCount + kMethodImplementation, pointer_size);
   }
 
-  // Return true if two conflict tables are the same.
+  bool IsHashed(PointerSize pointer_size) const {
+    return GetInterfaceMethod(0u, pointer_size) == reinterpret_cast<ArtMethod*>(kHashedMarker);
+  }
+
+  // Return true if two conflict tables are the same. Hashed tables with the same entries
+  // are only considered the same if their slots match too.
   bool Equals(ImtConflictTable* other, PointerSize pointer_size) const {
-    size_t num = NumEntries(pointer_size);
-    if (num != other->NumEntries(pointer_size)) {
-      return false;
-    }
-    for (size_t i = 0; i < num; ++i) {
-      if (GetInterfaceMethod(i, pointer_size) != other->GetInterfaceMethod(i, pointer_size) ||
-          GetImplementationMethod(i, pointer_size) !=
-              other->GetImplementationMethod(i, pointer_size)) {
-        return false;
-      }
-    }
-    return true;
+    const size_t size = ComputeSize(pointer_size);
+    return size == other->ComputeSize(pointer_size) && memcmp(this, other, size) == 0;
   }
 
   // Visit all of the entries.
@@ -102,11 +138,13 @@ class ImtConflictTable {
   // and also returns one. The order is <interface, implementation>.
   template<typename Visitor>
   void Visit(const Visitor& visitor, PointerSize pointer_size) NO_THREAD_SAFETY_ANALYSIS {
-    uint32_t table_index = 0;
-    for (;;) {
+    const bool hashed = IsHashed(pointer_size);
+    const size_t end = hashed ? GetHashedTableEnd(pointer_size) : NumEntries(pointer_size);
+    for (size_t table_index = hashed ? 1u : 0u; table_index != end; ++table_index) {
       ArtMethod* interface_method = GetInterfaceMethod(table_index, pointer_size);
       if (interface_method == nullptr) {
-        break;
+        // Free slot of a hashed table.
+        continue;
       }
       ArtMethod* implementation_method = GetImplementationMethod(table_index, pointer_size);
       auto input = std::make_pair(interface_method, implementation_method);
@@ -117,14 +155,14 @@ class ImtConflictTable {
       if (input.second != updated.second) {
         SetImplementationMethod(table_index, pointer_size, updated.second);
       }
-      ++table_index;
     }
   }
 
   // Lookup the implementation ArtMethod associated to `interface_method`. Return null
   // if not found.
   ArtMethod* Lookup(ArtMethod* interface_method, PointerSize pointer_size) const {
-    uint32_t table_index = 0;
+    size_t table_index =
+        IsHashed(pointer_size) ? FirstProbeIndex(interface_method, pointer_size) : 0u;
     for (;;) {
       ArtMethod* current_interface_method = GetInterfaceMethod(table_index, pointer_size);
       if (current_interface_method == nullptr) {
@@ -140,6 +178,15 @@ class ImtConflictTable {
 
   // Compute the number of entries in this table.
   size_t NumEntries(PointerSize pointer_size) const {
+    if (IsHashed(pointer_size)) {
+      size_t num_entries = 0u;
+      for (size_t i = 1u, end = GetHashedTableEnd(pointer_size); i != end; ++i) {
+        if (GetInterfaceMethod(i, pointer_size) != nullptr) {
+          ++num_entries;
+        }
+      }
+      return num_entries;
+    }
     uint32_t table_index = 0;
     while (GetInterfaceMethod(table_index, pointer_size) != nullptr) {
       ++table_index;
@@ -149,6 +196,9 @@ class ImtConflictTable {
 
   // Compute the size in bytes taken by this table.
   size_t ComputeSize(PointerSize pointer_size) const {
+    if (IsHashed(pointer_size)) {
+      return GetHashedTableEnd(pointer_size) * EntrySize(pointer_size);
+    }
     // Add the end marker.
     return ComputeSize(NumEntries(pointer_size), pointer_size);
   }
@@ -156,11 +206,15 @@ class ImtConflictTable {
   // Compute the size in bytes needed for copying the given `table` and add
   // one more entry.
   static size_t ComputeSizeWithOneMoreEntry(ImtConflictTable* table, PointerSize pointer_size) {
-    return table->ComputeSize(pointer_size) + EntrySize(pointer_size);
+    return ComputeSize(table->NumEntries(pointer_size) + 1u, pointer_size);
   }
 
   // Compute size with a fixed number of entries.
   static size_t ComputeSize(size_t num_entries, PointerSize pointer_size) {
+    if (num_entries >= kHashedThreshold) {
+      // Add one for the header.
+      return (NumHashedSlots(HashedCapacity(num_entries)) + 1u) * EntrySize(pointer_size);
+    }
     return (num_entries + 1) * EntrySize(pointer_size);  // Add one for null terminator.
   }
 
@@ -169,6 +223,30 @@ class ImtConflictTable {
   }
 
  private:
+  // The probe for the last hashed bucket may run over up to `capacity - 1` other entries,
+  // so the slots are twice the capacity. This keeps the last slot null.
+  static size_t HashedCapacity(size_t num_entries) {
+    return RoundUpToPowerOfTwo(num_entries);
+  }
+
+  static size_t NumHashedSlots(size_t capacity) {
+    return 2u * capacity;
+  }
+
+  size_t GetHashMask(PointerSize pointer_size) const {
+    return reinterpret_cast<uintptr_t>(GetImplementationMethod(0u, pointer_size));
+  }
+
+  // Index past the last slot of a hashed table, the header included.
+  size_t GetHashedTableEnd(PointerSize pointer_size) const {
+    return NumHashedSlots(GetHashMask(pointer_size) + 1u) + 1u;
+  }
+
+  size_t FirstProbeIndex(ArtMethod* interface_method, PointerSize pointer_size) const {
+    // Skip the header.
+    return (interface_method->GetDexMethodIndexUnchecked() & GetHashMask(pointer_size)) + 1u;
+  }
+
   ArtMethod* GetMethod(size_t index, PointerSize pointer_size) const {
     if (pointer_size == PointerSize::k64) {
       return reinterpret_cast<ArtMethod*>(static_cast<uintptr_t>(data64_[index]));
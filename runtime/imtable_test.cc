@@ -18,6 +18,7 @@
 
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "jni.h"
 
@@ -28,6 +29,7 @@
 #include "mirror/class.h"
 #include "mirror/class_loader.h"
 #include "handle_scope-inl.h"
+#include "imt_conflict_table.h"
 #include "scoped_thread_state_change-inl.h"
 #include "thread-inl.h"
 
@@ -101,4 +103,68 @@ TEST_F(ImTableTest, NewClassBefore) {
   CHECK_EQ(ImTable::GetImtIndex(methods.first), ImTable::GetImtIndex(methods.second));
 }
 
+class ImtConflictTableTest : public testing::Test {
+ protected:
+  static constexpr size_t kMaxEntries = 3u * ImtConflictTable::kHashedThreshold;
+
+  void SetUp() OVERRIDE {
+    interface_methods_.reset(new ArtMethod[kMaxEntries]);
+    implementation_methods_.reset(new ArtMethod[kMaxEntries]);
+    for (size_t i = 0; i != kMaxEntries; ++i) {
+      // Make the dex method indexes collide to exercise the probing of hashed tables.
+      interface_methods_[i].SetDexMethodIndex(static_cast<uint32_t>(i % 5u) * 64u);
+    }
+  }
+
+  void CheckTable(ImtConflictTable* table, size_t num_entries, size_t size) {
+    const PointerSize pointer_size = kRuntimePointerSize;
+    EXPECT_EQ(num_entries >= ImtConflictTable::kHashedThreshold, table->IsHashed(pointer_size));
+    EXPECT_EQ(num_entries, table->NumEntries(pointer_size));
+    EXPECT_EQ(size, table->ComputeSize(pointer_size));
+    for (size_t i = 0; i != num_entries; ++i) {
+      EXPECT_EQ(&implementation_methods_[i],
+                table->Lookup(&interface_methods_[i], pointer_size)) << num_entries << " " << i;
+    }
+    ArtMethod missing_method;
+    EXPECT_TRUE(table->Lookup(&missing_method, pointer_size) == nullptr);
+    size_t num_visited = 0u;
+    table->Visit([&](const std::pair<ArtMethod*, ArtMethod*>& methods) {
+      EXPECT_EQ(methods.first - interface_methods_.get(),
+                methods.second - implementation_methods_.get());
+      ++num_visited;
+      return methods;
+    }, pointer_size);
+    EXPECT_EQ(num_entries, num_visited);
+  }
+
+  std::unique_ptr<ArtMethod[]> interface_methods_;
+  std::unique_ptr<ArtMethod[]> implementation_methods_;
+};
+
+TEST_F(ImtConflictTableTest, AddEntry) {
+  const PointerSize pointer_size = kRuntimePointerSize;
+  for (size_t num_entries = 0; num_entries <= kMaxEntries; ++num_entries) {
+    std::vector<uint8_t> data(ImtConflictTable::ComputeSize(num_entries, pointer_size));
+    ImtConflictTable* table = new (data.data()) ImtConflictTable(num_entries, pointer_size);
+    for (size_t i = 0; i != num_entries; ++i) {
+      table->AddEntry(&interface_methods_[i], &implementation_methods_[i], pointer_size);
+    }
+    CheckTable(table, num_entries, data.size());
+  }
+}
+
+TEST_F(ImtConflictTableTest, CopyWithOneMoreEntry) {
+  const PointerSize pointer_size = kRuntimePointerSize;
+  std::vector<std::vector<uint8_t>> tables;
+  tables.emplace_back(ImtConflictTable::ComputeSize(0u, pointer_size));
+  ImtConflictTable* table = new (tables.back().data()) ImtConflictTable(0u, pointer_size);
+  CheckTable(table, 0u, tables.back().size());
+  for (size_t i = 0; i != kMaxEntries; ++i) {
+    tables.emplace_back(ImtConflictTable::ComputeSizeWithOneMoreEntry(table, pointer_size));
+    table = new (tables.back().data()) ImtConflictTable(
+        table, &interface_methods_[i], &implementation_methods_[i], pointer_size);
+    CheckTable(table, i + 1u, tables.back().size());
+  }
+}
+
 }  // namespace art
@@ -91,7 +91,18 @@ ObjPtr<mirror::String> InternTable::LookupWeak(Thread* self, ObjPtr<mirror::Stri
   return LookupWeakLocked(s);
 }
 
+template <typename Key>
+ObjPtr<mirror::String> InternTable::LookupStrongFrozen(const Key& key)
+    NO_THREAD_SAFETY_ANALYSIS {
+  // Reading the frozen tables does not require the intern_table_lock_, see FindInFrozenTables.
+  return strong_interns_.FindInFrozenTables(key);
+}
+
 ObjPtr<mirror::String> InternTable::LookupStrong(Thread* self, ObjPtr<mirror::String> s) {
+  ObjPtr<mirror::String> strong = LookupStrongFrozen(s);
+  if (strong != nullptr) {
+    return strong;
+  }
   MutexLock mu(self, *Locks::intern_table_lock_);
   return LookupStrongLocked(s);
 }
@@ -103,6 +114,10 @@ ObjPtr<mirror::String> InternTable::LookupStrong(Thread* self,
   Utf8String string(utf16_length,
                     utf8_data,
                     ComputeUtf16HashFromModifiedUtf8(utf8_data, utf16_length));
+  ObjPtr<mirror::String> strong = LookupStrongFrozen(string);
+  if (strong != nullptr) {
+    return strong;
+  }
   MutexLock mu(self, *Locks::intern_table_lock_);
   return strong_interns_.Find(string);
 }
@@ -212,6 +227,12 @@ ObjPtr<mirror::String> InternTable::Insert(ObjPtr<mirror::String> s,
   if (s == nullptr) {
     return nullptr;
   }
+  // Most lookups hit image or zygote strings, find these without contending on the lock. Strong
+  // interns are never swept so this does not need to wait for weak root access.
+  ObjPtr<mirror::String> frozen = LookupStrongFrozen(s);
+  if (frozen != nullptr) {
+    return frozen;
+  }
   Thread* const self = Thread::Current();
   MutexLock mu(self, *Locks::intern_table_lock_);
   if (kDebugLocking && !holding_locks) {
@@ -376,7 +397,8 @@ size_t InternTable::Table::AddTableFromMemory(const uint8_t* ptr) {
     }
   }
   // Insert at the front since we add new interns into the back.
-  tables_.insert(tables_.begin(), std::move(set));
+  tables_.push_front(std::move(set));
+  PublishFrozenTables();
   return read_count;
 }
 
@@ -432,8 +454,44 @@ ObjPtr<mirror::String> InternTable::Table::Find(const Utf8String& string) {
   return nullptr;
 }
 
+template <typename Key>
+ObjPtr<mirror::String> InternTable::Table::FindInFrozenTablesImpl(const Key& key) const {
+  // The frozen sets are never resized, the only concurrent writes are the transaction rollback
+  // Remove and root updates by the GC, both of which store single references. A racing reader
+  // may miss the string but never returns a string that was not interned.
+  const FrozenTables* frozen_tables = frozen_tables_.LoadAcquire();
+  if (frozen_tables == nullptr) {
+    return nullptr;
+  }
+  for (const UnorderedSet* table : *frozen_tables) {
+    auto it = table->Find(key);
+    if (it != table->end()) {
+      return it->Read();
+    }
+  }
+  return nullptr;
+}
+
+ObjPtr<mirror::String> InternTable::Table::FindInFrozenTables(ObjPtr<mirror::String> s) const {
+  return FindInFrozenTablesImpl(GcRoot<mirror::String>(s));
+}
+
+ObjPtr<mirror::String> InternTable::Table::FindInFrozenTables(const Utf8String& string) const {
+  return FindInFrozenTablesImpl(string);
+}
+
+void InternTable::Table::PublishFrozenTables() {
+  std::unique_ptr<FrozenTables> frozen_tables(new FrozenTables());
+  for (size_t i = 0; i + 1 < tables_.size(); ++i) {
+    frozen_tables->push_back(&tables_[i]);
+  }
+  frozen_tables_.StoreRelease(frozen_tables.get());
+  frozen_tables_snapshots_.push_back(std::move(frozen_tables));
+}
+
 void InternTable::Table::AddNewTable() {
   tables_.push_back(UnorderedSet());
+  PublishFrozenTables();
 }
 
 void InternTable::Table::Insert(ObjPtr<mirror::String> s) {
@@ -495,7 +553,7 @@ void InternTable::ChangeWeakRootStateLocked(gc::WeakRootState new_state) {
   }
 }
 
-InternTable::Table::Table() {
+InternTable::Table::Table() : frozen_tables_(nullptr) {
   Runtime* const runtime = Runtime::Current();
   // Initial table.
   tables_.push_back(UnorderedSet());
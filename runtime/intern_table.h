@@ -17,7 +17,10 @@
 #ifndef ART_RUNTIME_INTERN_TABLE_H_
 #define ART_RUNTIME_INTERN_TABLE_H_
 
+#include <deque>
+#include <memory>
 #include <unordered_set>
+#include <vector>
 
 #include "atomic.h"
 #include "base/Xallocator.h"
@@ -190,6 +193,13 @@ class InternTable {
         REQUIRES(Locks::intern_table_lock_);
     ObjPtr<mirror::String> Find(const Utf8String& string) REQUIRES_SHARED(Locks::mutator_lock_)
         REQUIRES(Locks::intern_table_lock_);
+    // Lookup in the tables that are no longer inserted into, without holding the
+    // intern_table_lock_. A string that is concurrently removed or moved within these tables may
+    // be missed, so callers need to fall back to Find() with the lock held when this returns null.
+    ObjPtr<mirror::String> FindInFrozenTables(ObjPtr<mirror::String> s) const
+        REQUIRES_SHARED(Locks::mutator_lock_);
+    ObjPtr<mirror::String> FindInFrozenTables(const Utf8String& string) const
+        REQUIRES_SHARED(Locks::mutator_lock_);
     void Insert(ObjPtr<mirror::String> s) REQUIRES_SHARED(Locks::mutator_lock_)
         REQUIRES(Locks::intern_table_lock_);
     void Remove(ObjPtr<mirror::String> s)
@@ -215,12 +225,28 @@ class InternTable {
     typedef HashSet<GcRoot<mirror::String>, GcRootEmptyFn, StringHashEquals, StringHashEquals,
         TrackingAllocator<GcRoot<mirror::String>, kAllocatorTagInternTable>> UnorderedSet;
 
+    typedef std::vector<const UnorderedSet*> FrozenTables;
+
     void SweepWeaks(UnorderedSet* set, IsMarkedVisitor* visitor)
         REQUIRES_SHARED(Locks::mutator_lock_) REQUIRES(Locks::intern_table_lock_);
 
+    // Publish all tables but the back one for FindInFrozenTables.
+    void PublishFrozenTables() REQUIRES(Locks::intern_table_lock_);
+
+    template <typename Key>
+    ObjPtr<mirror::String> FindInFrozenTablesImpl(const Key& key) const
+        REQUIRES_SHARED(Locks::mutator_lock_);
+
     // We call AddNewTable when we create the zygote to reduce private dirty pages caused by
     // modifying the zygote intern table. The back of table is modified when strings are interned.
-    std::vector<UnorderedSet> tables_;
+    // A deque keeps the addresses of the sets stable when tables are added at either end.
+    std::deque<UnorderedSet> tables_;
+
+    // The tables before the back one. These are never inserted into and therefore never resized,
+    // so they can be searched without the lock. Old snapshots are kept alive in
+    // frozen_tables_snapshots_ since lock-free readers may still be using them.
+    Atomic<const FrozenTables*> frozen_tables_;
+    std::vector<std::unique_ptr<FrozenTables>> frozen_tables_snapshots_;
 
     ART_FRIEND_TEST(InternTableTest, CrossHash);
   };
@@ -231,6 +257,11 @@ class InternTable {
   ObjPtr<mirror::String> Insert(ObjPtr<mirror::String> s, bool is_strong, bool holding_locks)
       REQUIRES(!Locks::intern_table_lock_) REQUIRES_SHARED(Locks::mutator_lock_);
 
+  // Lookup in the strong tables that are no longer inserted into, without the lock. Returns null
+  // if not found there, the string may still be in the other strong tables.
+  template <typename Key>
+  ObjPtr<mirror::String> LookupStrongFrozen(const Key& key) REQUIRES_SHARED(Locks::mutator_lock_);
+
   ObjPtr<mirror::String> LookupStrongLocked(ObjPtr<mirror::String> s)
       REQUIRES_SHARED(Locks::mutator_lock_) REQUIRES(Locks::intern_table_lock_);
   ObjPtr<mirror::String> LookupWeakLocked(ObjPtr<mirror::String> s)
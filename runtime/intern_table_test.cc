@@ -232,4 +232,34 @@ TEST_F(InternTableTest, LookupStrong) {
   EXPECT_TRUE(lookup_foobbS == nullptr);
 }
 
+
+TEST_F(InternTableTest, LookupStrongFrozen) {
+  ScopedObjectAccess soa(Thread::Current());
+  InternTable intern_table;
+  StackHandleScope<4> hs(soa.Self());
+  Handle<mirror::String> foo(hs.NewHandle(intern_table.InternStrong(3, "foo")));
+  ASSERT_TRUE(foo != nullptr);
+  // Freeze the table holding "foo", new interns go to a new table.
+  intern_table.AddNewTable();
+  Handle<mirror::String> bar(hs.NewHandle(intern_table.InternStrong(3, "bar")));
+  ASSERT_TRUE(bar != nullptr);
+  EXPECT_EQ(2U, intern_table.StrongSize());
+  // Lookups hit both the frozen and the current table.
+  EXPECT_OBJ_PTR_EQ(intern_table.LookupStrong(soa.Self(), 3, "foo"), foo.Get());
+  EXPECT_OBJ_PTR_EQ(intern_table.LookupStrong(soa.Self(), 3, "bar"), bar.Get());
+  Handle<mirror::String> foo_copy(
+      hs.NewHandle(mirror::String::AllocFromModifiedUtf8(soa.Self(), "foo")));
+  EXPECT_OBJ_PTR_EQ(intern_table.LookupStrong(soa.Self(), foo_copy.Get()), foo.Get());
+  // Interning an equal string, strongly or weakly, returns the frozen strong intern.
+  EXPECT_OBJ_PTR_EQ(intern_table.InternStrong(foo_copy.Get()), foo.Get());
+  EXPECT_OBJ_PTR_EQ(intern_table.InternWeak(foo_copy.Get()), foo.Get());
+  EXPECT_EQ(0U, intern_table.WeakSize());
+  // A string that is only weakly interned is not found as strong.
+  Handle<mirror::String> baz(
+      hs.NewHandle(mirror::String::AllocFromModifiedUtf8(soa.Self(), "baz")));
+  EXPECT_OBJ_PTR_EQ(intern_table.InternWeak(baz.Get()), baz.Get());
+  EXPECT_TRUE(intern_table.LookupStrong(soa.Self(), 3, "baz") == nullptr);
+  EXPECT_EQ(2U, intern_table.StrongSize());
+}
+
 }  // namespace art
@@ -0,0 +1,95 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_RUNTIME_INTERPRETER_INTERPRETER_CACHE_H_
+#define ART_RUNTIME_INTERPRETER_INTERPRETER_CACHE_H_
+
+#include <array>
+#include <utility>
+
+#include "atomic.h"
+#include "base/bit_utils.h"
+#include "base/logging.h"
+#include "base/macros.h"
+
+namespace art {
+
+class Instruction;
+
+// Small direct-mapped cache from a dex instruction to what the interpreter resolved it to: the
+// ArtField of a field access, or the target ArtMethod or vtable index of an invoke. Executing the
+// same instruction again then skips the dex cache lookup and the access checks. The key is the
+// address of the instruction in the dex file, so it identifies both the method and the dex pc.
+//
+// Each thread owns its cache, so lookups and updates need no synchronization. When classes are
+// unloaded their dex files may be freed and the addresses reused for other instructions, so all
+// caches are invalidated by bumping a global generation, which each thread checks on lookup.
+class InterpreterCache {
+ public:
+  static constexpr size_t kSize = 256;
+
+  InterpreterCache();
+
+  ALWAYS_INLINE bool Get(const Instruction* key, /* out */ size_t* value) {
+    // Relaxed is enough: a thread can only execute instructions of a dex file loaded after an
+    // invalidation once the class linker locks have ordered the invalidation before it.
+    const uint32_t generation = global_generation_.LoadRelaxed();
+    if (UNLIKELY(generation != generation_)) {
+      Clear();
+      generation_ = generation;
+      return false;
+    }
+    const Entry& entry = data_[IndexOf(key)];
+    if (LIKELY(entry.first == key)) {
+      *value = entry.second;
+      return true;
+    }
+    return false;
+  }
+
+  ALWAYS_INLINE void Set(const Instruction* key, size_t value) {
+    DCHECK(key != nullptr);
+    data_[IndexOf(key)] = Entry(key, value);
+  }
+
+  // Invalidate the caches of all threads, called before the dex files of unloaded classes are
+  // freed.
+  static void InvalidateAll() {
+    global_generation_.FetchAndAddSequentiallyConsistent(1u);
+  }
+
+ private:
+  typedef std::pair<const Instruction*, size_t> Entry;
+
+  static size_t IndexOf(const Instruction* key) {
+    static_assert(IsPowerOfTwo(kSize), "Size must be a power of two");
+    // Instructions are at least two code units long, drop the bits that rarely differ.
+    return (reinterpret_cast<uintptr_t>(key) >> 2) & (kSize - 1);
+  }
+
+  void Clear();
+
+  static Atomic<uint32_t> global_generation_;
+
+  std::array<Entry, kSize> data_;
+  uint32_t generation_;
+
+  DISALLOW_COPY_AND_ASSIGN(InterpreterCache);
+};
+
+}  // namespace art
+
+#endif  // ART_RUNTIME_INTERPRETER_INTERPRETER_CACHE_H_
@@ -0,0 +1,62 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "interpreter_cache.h"
+
+#include <memory>
+
+#include "gtest/gtest.h"
+
+namespace art {
+
+TEST(InterpreterCache, GetSet) {
+  std::unique_ptr<InterpreterCache> cache(new InterpreterCache());
+  uint16_t code[4 * InterpreterCache::kSize] = {};
+  const Instruction* first = reinterpret_cast<const Instruction*>(&code[0]);
+  const Instruction* second = reinterpret_cast<const Instruction*>(&code[2]);
+  // Maps to the same entry as `first`.
+  const Instruction* conflicting =
+      reinterpret_cast<const Instruction*>(&code[2 * InterpreterCache::kSize]);
+  size_t value = 0u;
+  EXPECT_FALSE(cache->Get(first, &value));
+  cache->Set(first, 1u);
+  cache->Set(second, 2u);
+  ASSERT_TRUE(cache->Get(first, &value));
+  EXPECT_EQ(1u, value);
+  ASSERT_TRUE(cache->Get(second, &value));
+  EXPECT_EQ(2u, value);
+  cache->Set(conflicting, 3u);
+  EXPECT_FALSE(cache->Get(first, &value));
+  ASSERT_TRUE(cache->Get(conflicting, &value));
+  EXPECT_EQ(3u, value);
+}
+
+TEST(InterpreterCache, InvalidateAll) {
+  std::unique_ptr<InterpreterCache> cache(new InterpreterCache());
+  uint16_t code[2] = {};
+  const Instruction* inst = reinterpret_cast<const Instruction*>(&code[0]);
+  size_t value = 0u;
+  cache->Set(inst, 1u);
+  ASSERT_TRUE(cache->Get(inst, &value));
+  InterpreterCache::InvalidateAll();
+  EXPECT_FALSE(cache->Get(inst, &value));
+  // Entries added after the invalidation are kept.
+  cache->Set(inst, 2u);
+  ASSERT_TRUE(cache->Get(inst, &value));
+  EXPECT_EQ(2u, value);
+}
+
+}  // namespace art
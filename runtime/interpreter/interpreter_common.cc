@@ -42,14 +42,46 @@ void ThrowNullPointerExceptionFromInterpreter() {
   ThrowNullPointerExceptionFromDexPC();
 }
 
-template<FindFieldType find_type, Primitive::Type field_type, bool do_access_check>
-bool DoFieldGet(Thread* self, ShadowFrame& shadow_frame, const Instruction* inst,
-                uint16_t inst_data) {
-  const bool is_static = (find_type == StaticObjectRead) || (find_type == StaticPrimitiveRead);
+// Resolve the field accessed by an iget, iput, sget or sput instruction, using the thread's
+// interpreter cache to avoid the dex cache lookup and the access checks on later executions.
+template<FindFieldType find_type, bool do_access_check>
+static ALWAYS_INLINE ArtField* FindFieldFromCodeCached(Thread* self,
+                                                       const ShadowFrame& shadow_frame,
+                                                       const Instruction* inst,
+                                                       Primitive::Type field_type)
+    REQUIRES_SHARED(Locks::mutator_lock_) {
+  const bool is_static = (find_type == StaticObjectRead) ||
+                         (find_type == StaticPrimitiveRead) ||
+                         (find_type == StaticObjectWrite) ||
+                         (find_type == StaticPrimitiveWrite);
+  InterpreterCache* const cache = self->GetInterpreterCache();
+  size_t cached_field;
+  if (LIKELY(cache->Get(inst, &cached_field))) {
+    return reinterpret_cast<ArtField*>(cached_field);
+  }
   const uint32_t field_idx = is_static ? inst->VRegB_21c() : inst->VRegC_22c();
   ArtField* f =
       FindFieldFromCode<find_type, do_access_check>(field_idx, shadow_frame.GetMethod(), self,
                                                     Primitive::ComponentSize(field_type));
+  // Static fields are only cached once their class is initialized, so that a hit never needs to
+  // run the class initializer. Not while a transaction is active: its rollback may reset the
+  // status of a class it initialized.
+  if (f != nullptr &&
+      (!is_static ||
+       (f->GetDeclaringClass()->IsInitialized() && !Runtime::Current()->IsActiveTransaction()))) {
+    cache->Set(inst, reinterpret_cast<size_t>(f));
+  }
+  return f;
+}
+
+template<FindFieldType find_type, Primitive::Type field_type, bool do_access_check>
+bool DoFieldGet(Thread* self, ShadowFrame& shadow_frame, const Instruction* inst,
+                uint16_t inst_data) {
+  const bool is_static = (find_type == StaticObjectRead) || (find_type == StaticPrimitiveRead);
+  ArtField* f = FindFieldFromCodeCached<find_type, do_access_check>(self,
+                                                                   shadow_frame,
+                                                                   inst,
+                                                                   field_type);
   if (UNLIKELY(f == nullptr)) {
     CHECK(self->IsExceptionPending());
     return false;
@@ -242,10 +274,10 @@ bool DoFieldPut(Thread* self, const ShadowFrame& shadow_frame, const Instruction
                 uint16_t inst_data) {
   const bool do_assignability_check = do_access_check;
   bool is_static = (find_type == StaticObjectWrite) || (find_type == StaticPrimitiveWrite);
-  uint32_t field_idx = is_static ? inst->VRegB_21c() : inst->VRegC_22c();
-  ArtField* f =
-      FindFieldFromCode<find_type, do_access_check>(field_idx, shadow_frame.GetMethod(), self,
-                                                    Primitive::ComponentSize(field_type));
+  ArtField* f = FindFieldFromCodeCached<find_type, do_access_check>(self,
+                                                                   shadow_frame,
+                                                                   inst,
+                                                                   field_type);
   if (UNLIKELY(f == nullptr)) {
     CHECK(self->IsExceptionPending());
     return false;
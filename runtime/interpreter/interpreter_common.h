@@ -39,6 +39,7 @@
 #include "dex_instruction-inl.h"
 #include "entrypoints/entrypoint_utils-inl.h"
 #include "handle_scope-inl.h"
+#include "interpreter_cache.h"
 #include "jit/jit.h"
 #include "mirror/call_site.h"
 #include "mirror/class-inl.h"
@@ -111,6 +112,71 @@ template<bool is_range, bool do_assignability_check>
 bool DoCall(ArtMethod* called_method, Thread* self, ShadowFrame& shadow_frame,
             const Instruction* inst, uint16_t inst_data, JValue* result);
 
+// Look up the target of an invoke in the thread's interpreter cache. Returns null if the invoke
+// is not cached or needs the slow path, for example to throw a NullPointerException.
+template<InvokeType type>
+static ALWAYS_INLINE ArtMethod* FindMethodFromInterpreterCache(Thread* self,
+                                                               const Instruction* inst,
+                                                               ObjPtr<mirror::Object> receiver)
+    REQUIRES_SHARED(Locks::mutator_lock_) {
+  // Interface calls depend on the receiver's IMT, they are not cached.
+  size_t cached_value;
+  if (type == kInterface || !self->GetInterpreterCache()->Get(inst, &cached_value)) {
+    return nullptr;
+  }
+  switch (type) {
+    case kStatic:
+      return reinterpret_cast<ArtMethod*>(cached_value);
+    case kDirect:
+    case kSuper:
+      // Let FindMethodFromCode throw the NullPointerException for a null receiver.
+      return (receiver != nullptr) ? reinterpret_cast<ArtMethod*>(cached_value) : nullptr;
+    case kVirtual: {
+      // The cached value is the vtable index of the resolved method.
+      if (UNLIKELY(receiver == nullptr)) {
+        return nullptr;
+      }
+      ObjPtr<mirror::Class> klass = receiver->GetClass();
+      if (UNLIKELY(!klass->HasVTable() ||
+                   cached_value >= static_cast<size_t>(klass->GetVTableLength()))) {
+        return nullptr;
+      }
+      return klass->GetVTableEntry(cached_value, kRuntimePointerSize);
+    }
+    default:
+      LOG(FATAL) << "Unreachable: " << type;
+      UNREACHABLE();
+  }
+}
+
+// Remember the target of an invoke that was resolved by FindMethodFromCode.
+template<InvokeType type>
+static ALWAYS_INLINE void AddMethodToInterpreterCache(Thread* self,
+                                                      const Instruction* inst,
+                                                      uint32_t method_idx,
+                                                      ArtMethod* referrer,
+                                                      ArtMethod* called_method)
+    REQUIRES_SHARED(Locks::mutator_lock_) {
+  switch (type) {
+    case kStatic:
+    case kDirect:
+    case kSuper:
+      // The target does not depend on the receiver.
+      self->GetInterpreterCache()->Set(inst, reinterpret_cast<size_t>(called_method));
+      break;
+    case kVirtual: {
+      ArtMethod* resolved_method =
+          Runtime::Current()->GetClassLinker()->GetResolvedMethod(method_idx, referrer);
+      if (resolved_method != nullptr) {
+        self->GetInterpreterCache()->Set(inst, resolved_method->GetMethodIndex());
+      }
+      break;
+    }
+    default:
+      break;
+  }
+}
+
 // Handles all invoke-XXX/range instructions except for invoke-polymorphic[/range].
 // Returns true on success, otherwise throws an exception and returns false.
 template<InvokeType type, bool is_range, bool do_access_check>
@@ -123,8 +189,14 @@ static inline bool DoInvoke(Thread* self,
   const uint32_t vregC = (is_range) ? inst->VRegC_3rc() : inst->VRegC_35c();
   ObjPtr<mirror::Object> receiver = (type == kStatic) ? nullptr : shadow_frame.GetVRegReference(vregC);
   ArtMethod* sf_method = shadow_frame.GetMethod();
-  ArtMethod* const called_method = FindMethodFromCode<type, do_access_check>(
-      method_idx, &receiver, sf_method, self);
+  ArtMethod* called_method = FindMethodFromInterpreterCache<type>(self, inst, receiver);
+  if (called_method == nullptr) {
+    called_method = FindMethodFromCode<type, do_access_check>(
+        method_idx, &receiver, sf_method, self);
+    if (called_method != nullptr) {
+      AddMethodToInterpreterCache<type>(self, inst, method_idx, sf_method, called_method);
+    }
+  }
   // The shadow frame should already be pushed, so we don't need to update it.
   if (UNLIKELY(called_method == nullptr)) {
     CHECK(self->IsExceptionPending());
@@ -1297,8 +1297,13 @@ void JitCodeCache::GetProfiledMethods(const std::set<std::string>& dex_base_loca
             cache.dex_pc_, profile_classes);
       }
     }
+    // Methods which reached the JIT threshold are hot. The others only have samples, the
+    // caller decides when they were executed.
+    uint8_t flags = ContainsPc(method->GetEntryPointFromQuickCompiledCode())
+        ? kProfileMethodFlagHot
+        : 0u;
     methods.emplace_back(/*ProfileMethodInfo*/
-        dex_file, method->GetDexMethodIndex(), inline_caches);
+        dex_file, method->GetDexMethodIndex(), inline_caches, flags);
   }
 }
 
@@ -0,0 +1,653 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "mapped_profile.h"
+
+#include <limits.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <limits>
+
+#include "base/bit_utils.h"
+#include "base/logging.h"
+#include "base/systrace.h"
+#include "dex_file.h"
+#include "mem_map.h"
+
+namespace art {
+
+using InlineCacheMap = ProfileCompilationInfo::InlineCacheMap;
+
+static constexpr size_t kMaxDexFiles = std::numeric_limits<uint8_t>::max();
+
+// Read a little endian value, the sections of a profile are not aligned.
+template <typename T>
+static T ReadUint(const uint8_t* ptr) {
+  static_assert(std::is_unsigned<T>::value, "Type is not unsigned");
+  T value = 0;
+  for (size_t i = 0; i < sizeof(T); i++) {
+    value |= static_cast<T>(static_cast<T>(ptr[i]) << (i * kBitsPerByte));
+  }
+  return value;
+}
+
+std::unique_ptr<MappedProfile> MappedProfile::Open(int fd, std::string* error_msg) {
+  ScopedTrace trace(__PRETTY_FUNCTION__);
+  struct stat stat_buffer;
+  if (fstat(fd, &stat_buffer) != 0) {
+    *error_msg = std::string("Failed to stat profile: ") + strerror(errno);
+    return nullptr;
+  }
+  std::unique_ptr<MappedProfile> profile(new MappedProfile());
+  // Profiles may be created empty by ActivityManager or installd.
+  if (stat_buffer.st_size == 0) {
+    return profile;
+  }
+  profile->map_.reset(MemMap::MapFile(stat_buffer.st_size,
+                                      PROT_READ,
+                                      MAP_PRIVATE,
+                                      fd,
+                                      /* start */ 0,
+                                      /* low_4gb */ false,
+                                      "profile",
+                                      error_msg));
+  if (profile->map_ == nullptr) {
+    return nullptr;
+  }
+  profile->begin_ = profile->map_->Begin();
+  profile->size_ = profile->map_->Size();
+  if (!profile->Parse(error_msg)) {
+    return nullptr;
+  }
+  return profile;
+}
+
+std::unique_ptr<MappedProfile> MappedProfile::Create(std::vector<uint8_t>&& data,
+                                                     std::string* error_msg) {
+  std::unique_ptr<MappedProfile> profile(new MappedProfile());
+  profile->data_ = std::move(data);
+  profile->begin_ = profile->data_.data();
+  profile->size_ = profile->data_.size();
+  if (!profile->Parse(error_msg)) {
+    return nullptr;
+  }
+  return profile;
+}
+
+MappedProfile::~MappedProfile() {}
+
+bool MappedProfile::Parse(std::string* error_msg) {
+  if (size_ == 0u) {
+    return true;
+  }
+  const uint8_t* ptr = begin_;
+  const uint8_t* const end = begin_ + size_;
+  auto remaining = [&ptr, end]() { return static_cast<size_t>(end - ptr); };
+
+  if (remaining() < sizeof(ProfileCompilationInfo::kProfileMagic) +
+                    sizeof(ProfileCompilationInfo::kProfileVersion) +
+                    sizeof(uint8_t)) {
+    *error_msg = "Truncated profile header";
+    return false;
+  }
+  if (memcmp(ptr,
+             ProfileCompilationInfo::kProfileMagic,
+             sizeof(ProfileCompilationInfo::kProfileMagic)) != 0) {
+    *error_msg = "Profile missing magic";
+    return false;
+  }
+  ptr += sizeof(ProfileCompilationInfo::kProfileMagic);
+  if (memcmp(ptr,
+             ProfileCompilationInfo::kProfileVersion,
+             sizeof(ProfileCompilationInfo::kProfileVersion)) != 0) {
+    *error_msg = "Profile version mismatch";
+    return false;
+  }
+  ptr += sizeof(ProfileCompilationInfo::kProfileVersion);
+  const uint8_t number_of_dex_files = *ptr++;
+
+  dex_files_.reserve(number_of_dex_files);
+  for (uint8_t k = 0; k < number_of_dex_files; k++) {
+    if (remaining() < ProfileCompilationInfo::kLineHeaderSize) {
+      *error_msg = "Truncated profile line header";
+      return false;
+    }
+    DexFileSection section;
+    uint16_t dex_location_size = ReadUint<uint16_t>(ptr);
+    section.number_of_classes = ReadUint<uint16_t>(ptr + 2);
+    section.number_of_methods = ReadUint<uint32_t>(ptr + 4);
+    section.inline_caches_size = ReadUint<uint32_t>(ptr + 8);
+    section.checksum = ReadUint<uint32_t>(ptr + 12);
+    ptr += ProfileCompilationInfo::kLineHeaderSize;
+
+    if (dex_location_size == 0 || dex_location_size > PATH_MAX) {
+      *error_msg = "DexFileKey has an invalid size: " + std::to_string(dex_location_size);
+      return false;
+    }
+    if (section.number_of_methods > std::numeric_limits<uint16_t>::max() + 1u ||
+        section.inline_caches_size > remaining()) {
+      *error_msg = "Truncated profile line";
+      return false;
+    }
+    const size_t line_size = dex_location_size +
+        ProfileCompilationInfo::GetLineDataSize(section.number_of_methods,
+                                                section.inline_caches_size,
+                                                section.number_of_classes);
+    if (remaining() < line_size) {
+      *error_msg = "Truncated profile line";
+      return false;
+    }
+    section.dex_location.assign(reinterpret_cast<const char*>(ptr), dex_location_size);
+    ptr += dex_location_size;
+    section.method_indexes = ptr;
+    ptr += sizeof(uint16_t) * section.number_of_methods;
+    section.method_flags = ptr;
+    ptr += sizeof(uint8_t) * section.number_of_methods;
+    section.inline_cache_offsets = ptr;
+    ptr += sizeof(uint32_t) * section.number_of_methods;
+    section.inline_caches = ptr;
+    ptr += section.inline_caches_size;
+    section.class_indexes = ptr;
+    ptr += sizeof(uint16_t) * section.number_of_classes;
+
+    for (const DexFileSection& other : dex_files_) {
+      if (other.dex_location == section.dex_location) {
+        *error_msg = "Duplicate dex location " + section.dex_location;
+        return false;
+      }
+    }
+
+    // Check the sections once so that the lookups can trust them.
+    uint32_t expected_offset = 0u;
+    for (uint32_t i = 0; i != section.number_of_methods; ++i) {
+      if (i != 0u && ReadUint<uint16_t>(section.method_indexes + 2u * i) <=
+                     ReadUint<uint16_t>(section.method_indexes + 2u * (i - 1u))) {
+        *error_msg = "Unsorted method indexes for " + section.dex_location;
+        return false;
+      }
+      uint8_t flags = section.method_flags[i];
+      if (flags == 0u || (flags & ~kProfileMethodFlagsMask) != 0u) {
+        *error_msg = "Invalid method flags for " + section.dex_location;
+        return false;
+      }
+      if (ReadUint<uint32_t>(section.inline_cache_offsets + 4u * i) != expected_offset) {
+        *error_msg = "Invalid inline cache offset for " + section.dex_location;
+        return false;
+      }
+      const uint8_t* inline_cache = section.inline_caches + expected_offset;
+      ProfileCompilationInfo::SafeBuffer buffer(inline_cache,
+                                                section.inline_caches_size - expected_offset);
+      if (!ProfileCompilationInfo::SkipInlineCache(buffer, number_of_dex_files, error_msg)) {
+        return false;
+      }
+      expected_offset += buffer.GetBytesReadSince(inline_cache);
+    }
+    if (expected_offset != section.inline_caches_size) {
+      *error_msg = "Invalid inline cache region size for " + section.dex_location;
+      return false;
+    }
+    for (uint32_t i = 1u; i < section.number_of_classes; ++i) {
+      if (ReadUint<uint16_t>(section.class_indexes + 2u * i) <=
+          ReadUint<uint16_t>(section.class_indexes + 2u * (i - 1u))) {
+        *error_msg = "Unsorted class indexes for " + section.dex_location;
+        return false;
+      }
+    }
+    dex_files_.push_back(section);
+  }
+  if (ptr != end) {
+    *error_msg = "Unexpected content in the profile file";
+    return false;
+  }
+  return true;
+}
+
+const MappedProfile::DexFileSection* MappedProfile::FindDexFile(const std::string& profile_key,
+                                                                uint32_t checksum) const {
+  for (const DexFileSection& section : dex_files_) {
+    if (section.dex_location == profile_key) {
+      return section.checksum == checksum ? &section : nullptr;
+    }
+  }
+  return nullptr;
+}
+
+int32_t MappedProfile::FindMethodIndex(const DexFileSection& dex_file, uint16_t method_index) {
+  uint32_t low = 0u;
+  uint32_t high = dex_file.number_of_methods;
+  while (low < high) {
+    uint32_t mid = (low + high) / 2u;
+    uint16_t mid_method_index = ReadUint<uint16_t>(dex_file.method_indexes + 2u * mid);
+    if (mid_method_index < method_index) {
+      low = mid + 1u;
+    } else if (mid_method_index > method_index) {
+      high = mid;
+    } else {
+      return static_cast<int32_t>(mid);
+    }
+  }
+  return -1;
+}
+
+const uint8_t* MappedProfile::GetInlineCaches(const DexFileSection& dex_file,
+                                              uint32_t index,
+                                              /*out*/size_t* size) {
+  DCHECK_LT(index, dex_file.number_of_methods);
+  uint32_t begin = ReadUint<uint32_t>(dex_file.inline_cache_offsets + 4u * index);
+  uint32_t end = (index + 1u == dex_file.number_of_methods)
+      ? dex_file.inline_caches_size
+      : ReadUint<uint32_t>(dex_file.inline_cache_offsets + 4u * (index + 1u));
+  *size = end - begin;
+  return dex_file.inline_caches + begin;
+}
+
+bool MappedProfile::DecodeInlineCaches(const DexFileSection& dex_file,
+                                       uint32_t index,
+                                       /*out*/InlineCacheMap* inline_caches) const {
+  size_t size;
+  const uint8_t* data = GetInlineCaches(dex_file, index, &size);
+  ProfileCompilationInfo::SafeBuffer buffer(data, size);
+  std::string error;
+  if (!ProfileCompilationInfo::ReadInlineCache(
+          buffer, static_cast<uint8_t>(NumberOfDexFiles()), inline_caches, &error)) {
+    LOG(WARNING) << "Failed to decode inline caches: " << error;
+    return false;
+  }
+  return true;
+}
+
+bool MappedProfile::ContainsMethod(const MethodReference& method_ref) const {
+  const DexFileSection* section = FindDexFile(
+      ProfileCompilationInfo::GetProfileDexFileKey(method_ref.dex_file->GetLocation()),
+      method_ref.dex_file->GetLocationChecksum());
+  return section != nullptr &&
+      method_ref.dex_method_index <= std::numeric_limits<uint16_t>::max() &&
+      FindMethodIndex(*section, method_ref.dex_method_index) >= 0;
+}
+
+uint8_t MappedProfile::GetMethodFlags(const MethodReference& method_ref) const {
+  if (method_ref.dex_method_index > std::numeric_limits<uint16_t>::max()) {
+    return 0u;
+  }
+  return GetMethodFlags(method_ref.dex_file->GetLocation(),
+                        method_ref.dex_file->GetLocationChecksum(),
+                        method_ref.dex_method_index);
+}
+
+uint8_t MappedProfile::GetMethodFlags(const std::string& dex_location,
+                                      uint32_t dex_checksum,
+                                      uint16_t dex_method_index) const {
+  const DexFileSection* section =
+      FindDexFile(ProfileCompilationInfo::GetProfileDexFileKey(dex_location), dex_checksum);
+  if (section == nullptr) {
+    return 0u;
+  }
+  int32_t index = FindMethodIndex(*section, dex_method_index);
+  return (index >= 0) ? section->method_flags[index] : 0u;
+}
+
+bool MappedProfile::GetDexFileChecksum(const std::string& profile_key,
+                                       /*out*/uint32_t* checksum) const {
+  for (const DexFileSection& section : dex_files_) {
+    if (section.dex_location == profile_key) {
+      *checksum = section.checksum;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool MappedProfile::ContainsClass(const DexFile& dex_file, dex::TypeIndex type_idx) const {
+  const DexFileSection* section = FindDexFile(
+      ProfileCompilationInfo::GetProfileDexFileKey(dex_file.GetLocation()),
+      dex_file.GetLocationChecksum());
+  if (section == nullptr) {
+    return false;
+  }
+  uint32_t low = 0u;
+  uint32_t high = section->number_of_classes;
+  while (low < high) {
+    uint32_t mid = (low + high) / 2u;
+    uint16_t mid_type_index = ReadUint<uint16_t>(section->class_indexes + 2u * mid);
+    if (mid_type_index < type_idx.index_) {
+      low = mid + 1u;
+    } else if (mid_type_index > type_idx.index_) {
+      high = mid;
+    } else {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool MappedProfile::GetMethod(const std::string& dex_location,
+                              uint32_t dex_checksum,
+                              uint16_t dex_method_index,
+                              /*out*/ProfileCompilationInfo::OfflineProfileMethodInfo* pmi) const {
+  const DexFileSection* section =
+      FindDexFile(ProfileCompilationInfo::GetProfileDexFileKey(dex_location), dex_checksum);
+  if (section == nullptr) {
+    return false;
+  }
+  int32_t index = FindMethodIndex(*section, dex_method_index);
+  if (index < 0) {
+    return false;
+  }
+  pmi->dex_references.clear();
+  for (const DexFileSection& dex_file : dex_files_) {
+    pmi->dex_references.emplace_back(dex_file.dex_location, dex_file.checksum);
+  }
+  pmi->inline_caches.clear();
+  return DecodeInlineCaches(*section, static_cast<uint32_t>(index), &pmi->inline_caches);
+}
+
+uint32_t MappedProfile::GetNumberOfMethods() const {
+  uint32_t total = 0u;
+  for (const DexFileSection& section : dex_files_) {
+    total += section.number_of_methods;
+  }
+  return total;
+}
+
+uint32_t MappedProfile::GetNumberOfResolvedClasses() const {
+  uint32_t total = 0u;
+  for (const DexFileSection& section : dex_files_) {
+    total += section.number_of_classes;
+  }
+  return total;
+}
+
+bool MappedProfile::Save(int fd) const {
+  ScopedTrace trace(__PRETTY_FUNCTION__);
+  const uint8_t* buffer = begin_;
+  size_t byte_count = size_;
+  while (byte_count > 0) {
+    ssize_t bytes_written = TEMP_FAILURE_RETRY(write(fd, buffer, byte_count));
+    if (bytes_written == -1) {
+      return false;
+    }
+    byte_count -= bytes_written;
+    buffer += bytes_written;
+  }
+  return true;
+}
+
+// Add the inline caches of `src` to `dst`, renumbering the dex files of the classes with
+// `dex_profile_index_remap`.
+static void MergeInlineCaches(const InlineCacheMap& src,
+                              const std::vector<uint8_t>& dex_profile_index_remap,
+                              /*inout*/InlineCacheMap* dst) {
+  for (const auto& src_ic_it : src) {
+    auto dst_ic_it = dst->FindOrAdd(src_ic_it.first);
+    if (src_ic_it.second.is_megamorphic) {
+      dst_ic_it->second.SetMegamorphic();
+      continue;
+    }
+    for (const ProfileCompilationInfo::ClassReference& class_ref : src_ic_it.second.classes) {
+      dst_ic_it->second.AddClass(dex_profile_index_remap[class_ref.dex_profile_index],
+                                 class_ref.type_index);
+    }
+  }
+}
+
+template <typename T>
+static void WriteUint(std::vector<uint8_t>* buffer, T value) {
+  static_assert(std::is_unsigned<T>::value, "Type is not unsigned");
+  for (size_t i = 0; i < sizeof(T); i++) {
+    buffer->push_back(static_cast<uint8_t>(value >> (i * kBitsPerByte)));
+  }
+}
+
+// Accumulates the sections of a profile line. The methods and the classes must be added in
+// increasing index order.
+class MappedProfile::LineBuilder {
+ public:
+  void AddMethod(uint16_t method_index,
+                 uint8_t flags,
+                 const uint8_t* inline_caches,
+                 size_t inline_caches_size) {
+    DCHECK(number_of_methods_ == 0u || method_index > last_method_index_);
+    last_method_index_ = method_index;
+    ++number_of_methods_;
+    WriteUint(&method_indexes_, method_index);
+    method_flags_.push_back(flags);
+    WriteUint(&inline_cache_offsets_, static_cast<uint32_t>(inline_caches_.size()));
+    inline_caches_.insert(inline_caches_.end(), inline_caches, inline_caches + inline_caches_size);
+  }
+
+  void AddClass(uint16_t type_index) {
+    ++number_of_classes_;
+    WriteUint(&class_indexes_, type_index);
+  }
+
+  // Append the line to `buffer` and reset the builder.
+  bool Write(const std::string& dex_location,
+             uint32_t checksum,
+             /*out*/std::vector<uint8_t>* buffer,
+             /*out*/std::string* error_msg) {
+    if (number_of_classes_ > std::numeric_limits<uint16_t>::max()) {
+      *error_msg = "Too many classes in " + dex_location;
+      return false;
+    }
+    WriteUint(buffer, static_cast<uint16_t>(dex_location.size()));
+    WriteUint(buffer, static_cast<uint16_t>(number_of_classes_));
+    WriteUint(buffer, number_of_methods_);
+    WriteUint(buffer, static_cast<uint32_t>(inline_caches_.size()));
+    WriteUint(buffer, checksum);
+    buffer->insert(buffer->end(), dex_location.begin(), dex_location.end());
+    buffer->insert(buffer->end(), method_indexes_.begin(), method_indexes_.end());
+    buffer->insert(buffer->end(), method_flags_.begin(), method_flags_.end());
+    buffer->insert(buffer->end(), inline_cache_offsets_.begin(), inline_cache_offsets_.end());
+    buffer->insert(buffer->end(), inline_caches_.begin(), inline_caches_.end());
+    buffer->insert(buffer->end(), class_indexes_.begin(), class_indexes_.end());
+
+    number_of_methods_ = 0u;
+    number_of_classes_ = 0u;
+    method_indexes_.clear();
+    method_flags_.clear();
+    inline_cache_offsets_.clear();
+    inline_caches_.clear();
+    class_indexes_.clear();
+    return true;
+  }
+
+ private:
+  uint32_t number_of_methods_ = 0u;
+  uint32_t number_of_classes_ = 0u;
+  uint16_t last_method_index_ = 0u;
+  std::vector<uint8_t> method_indexes_;
+  std::vector<uint8_t> method_flags_;
+  std::vector<uint8_t> inline_cache_offsets_;
+  std::vector<uint8_t> inline_caches_;
+  std::vector<uint8_t> class_indexes_;
+};
+
+void MappedProfile::WriteHeader(size_t number_of_dex_files, /*out*/std::vector<uint8_t>* buffer) {
+  DCHECK_LE(number_of_dex_files, kMaxDexFiles);
+  buffer->insert(buffer->end(),
+                 ProfileCompilationInfo::kProfileMagic,
+                 ProfileCompilationInfo::kProfileMagic +
+                     sizeof(ProfileCompilationInfo::kProfileMagic));
+  buffer->insert(buffer->end(),
+                 ProfileCompilationInfo::kProfileVersion,
+                 ProfileCompilationInfo::kProfileVersion +
+                     sizeof(ProfileCompilationInfo::kProfileVersion));
+  WriteUint(buffer, static_cast<uint8_t>(number_of_dex_files));
+}
+
+std::unique_ptr<MappedProfile> MappedProfile::Merge(const MappedProfile& a,
+                                                    const MappedProfile& b,
+                                                    std::string* error_msg) {
+  ScopedTrace trace(__PRETTY_FUNCTION__);
+  // Assign the profile indexes of the merged dex files. Those of `a` do not change.
+  std::vector<std::pair<const DexFileSection*, const DexFileSection*>> dex_files;
+  for (const DexFileSection& section : a.dex_files_) {
+    dex_files.emplace_back(&section, nullptr);
+  }
+  std::vector<uint8_t> b_remap(b.dex_files_.size());
+  bool b_identity = true;
+  for (size_t j = 0; j != b.dex_files_.size(); ++j) {
+    const DexFileSection& section = b.dex_files_[j];
+    size_t index = 0u;
+    while (index != a.dex_files_.size() &&
+           a.dex_files_[index].dex_location != section.dex_location) {
+      ++index;
+    }
+    if (index == a.dex_files_.size()) {
+      dex_files.emplace_back(nullptr, &section);
+      index = dex_files.size() - 1u;
+    } else if (a.dex_files_[index].checksum != section.checksum) {
+      *error_msg = "Checksum mismatch for dex " + section.dex_location;
+      return nullptr;
+    } else {
+      dex_files[index].second = &section;
+    }
+    if (index >= kMaxDexFiles) {
+      *error_msg = "Exceeded the maximum number of dex files";
+      return nullptr;
+    }
+    b_remap[j] = static_cast<uint8_t>(index);
+    b_identity = b_identity && (index == j);
+  }
+
+  std::vector<uint8_t> buffer;
+  WriteHeader(dex_files.size(), &buffer);
+  LineBuilder line;
+  std::vector<uint8_t> encoded_inline_caches;
+  for (const auto& pair : dex_files) {
+    const DexFileSection* sa = pair.first;
+    const DexFileSection* sb = pair.second;
+    const DexFileSection& section = (sa != nullptr) ? *sa : *sb;
+
+    // Merge the sorted method sections.
+    const uint32_t a_methods = (sa != nullptr) ? sa->number_of_methods : 0u;
+    const uint32_t b_methods = (sb != nullptr) ? sb->number_of_methods : 0u;
+    for (uint32_t i = 0u, j = 0u; i != a_methods || j != b_methods; ) {
+      uint32_t a_index = (i != a_methods)
+          ? ReadUint<uint16_t>(sa->method_indexes + 2u * i)
+          : std::numeric_limits<uint32_t>::max();
+      uint32_t b_index = (j != b_methods)
+          ? ReadUint<uint16_t>(sb->method_indexes + 2u * j)
+          : std::numeric_limits<uint32_t>::max();
+      uint16_t method_index = static_cast<uint16_t>(std::min(a_index, b_index));
+      uint8_t a_flags = (a_index <= b_index) ? sa->method_flags[i] : 0u;
+      uint8_t b_flags = (b_index <= a_index) ? sb->method_flags[j] : 0u;
+      if (a_index < b_index || (a_index > b_index && b_identity)) {
+        // Copy the inline caches, the dex files they refer to keep their profile index.
+        const DexFileSection& src = (a_index < b_index) ? *sa : *sb;
+        uint32_t src_index = (a_index < b_index) ? i++ : j++;
+        size_t size;
+        const uint8_t* data = GetInlineCaches(src, src_index, &size);
+        line.AddMethod(method_index, a_flags | b_flags, data, size);
+        continue;
+      }
+      // Decode and merge the inline caches.
+      InlineCacheMap merged;
+      if (a_index == b_index) {
+        if (!a.DecodeInlineCaches(*sa, i, &merged)) {
+          *error_msg = "Bad inline caches in " + section.dex_location;
+          return nullptr;
+        }
+        ++i;
+      }
+      InlineCacheMap b_caches;
+      if (!b.DecodeInlineCaches(*sb, j, &b_caches)) {
+        *error_msg = "Bad inline caches in " + section.dex_location;
+        return nullptr;
+      }
+      ++j;
+      MergeInlineCaches(b_caches, b_remap, &merged);
+      encoded_inline_caches.clear();
+      ProfileCompilationInfo::AddInlineCacheToBuffer(&encoded_inline_caches, merged);
+      line.AddMethod(method_index,
+                     a_flags | b_flags,
+                     encoded_inline_caches.data(),
+                     encoded_inline_caches.size());
+    }
+
+    // Merge the sorted class sections.
+    const uint32_t a_classes = (sa != nullptr) ? sa->number_of_classes : 0u;
+    const uint32_t b_classes = (sb != nullptr) ? sb->number_of_classes : 0u;
+    for (uint32_t i = 0u, j = 0u; i != a_classes || j != b_classes; ) {
+      uint32_t a_index = (i != a_classes)
+          ? ReadUint<uint16_t>(sa->class_indexes + 2u * i)
+          : std::numeric_limits<uint32_t>::max();
+      uint32_t b_index = (j != b_classes)
+          ? ReadUint<uint16_t>(sb->class_indexes + 2u * j)
+          : std::numeric_limits<uint32_t>::max();
+      line.AddClass(static_cast<uint16_t>(std::min(a_index, b_index)));
+      i += (a_index <= b_index) ? 1u : 0u;
+      j += (b_index <= a_index) ? 1u : 0u;
+    }
+
+    if (!line.Write(section.dex_location, section.checksum, &buffer, error_msg)) {
+      return nullptr;
+    }
+  }
+  return Create(std::move(buffer), error_msg);
+}
+
+std::unique_ptr<MappedProfile> MappedProfile::Filter(const MappedProfile& profile,
+                                                     const MethodPredicate& keep_method,
+                                                     const ClassPredicate& keep_class,
+                                                     std::string* error_msg) {
+  ScopedTrace trace(__PRETTY_FUNCTION__);
+  std::vector<uint8_t> buffer;
+  WriteHeader(profile.dex_files_.size(), &buffer);
+  LineBuilder line;
+  // Keep all the dex files so that the inline caches do not need to be renumbered.
+  for (const DexFileSection& section : profile.dex_files_) {
+    for (uint32_t i = 0u; i != section.number_of_methods; ++i) {
+      uint16_t method_index = ReadUint<uint16_t>(section.method_indexes + 2u * i);
+      if (keep_method(section.dex_location, method_index)) {
+        size_t size;
+        const uint8_t* data = GetInlineCaches(section, i, &size);
+        line.AddMethod(method_index, section.method_flags[i], data, size);
+      }
+    }
+    for (uint32_t i = 0u; i != section.number_of_classes; ++i) {
+      uint16_t type_index = ReadUint<uint16_t>(section.class_indexes + 2u * i);
+      if (keep_class(section.dex_location, dex::TypeIndex(type_index))) {
+        line.AddClass(type_index);
+      }
+    }
+    if (!line.Write(section.dex_location, section.checksum, &buffer, error_msg)) {
+      return nullptr;
+    }
+  }
+  return Create(std::move(buffer), error_msg);
+}
+
+void MappedProfile::VisitMethodsAndClasses(const MethodVisitor& method_visitor,
+                                           const ClassVisitor& class_visitor) const {
+  for (const DexFileSection& section : dex_files_) {
+    for (uint32_t i = 0u; i != section.number_of_methods; ++i) {
+      method_visitor(section.dex_location,
+                     ReadUint<uint16_t>(section.method_indexes + 2u * i),
+                     section.method_flags[i]);
+    }
+    for (uint32_t i = 0u; i != section.number_of_classes; ++i) {
+      class_visitor(section.dex_location,
+                    dex::TypeIndex(ReadUint<uint16_t>(section.class_indexes + 2u * i)));
+    }
+  }
+}
+
+}  // namespace art
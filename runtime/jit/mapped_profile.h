@@ -0,0 +1,176 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_RUNTIME_JIT_MAPPED_PROFILE_H_
+#define ART_RUNTIME_JIT_MAPPED_PROFILE_H_
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/macros.h"
+#include "dex_file_types.h"
+#include "jit/profile_compilation_info.h"
+#include "method_reference.h"
+
+namespace art {
+
+class DexFile;
+class MemMap;
+
+// Read-only view of a profile in the format written by ProfileCompilationInfo::Save().
+// The profile is mapped and queried in place: methods and classes are found with a binary
+// search of the sorted sections of their dex file, and inline caches are only decoded when
+// requested. Unlike ProfileCompilationInfo::Load(), opening a profile does not build any map.
+class MappedProfile {
+ public:
+  using MethodPredicate = std::function<bool(const std::string& dex_location, uint16_t)>;
+  using ClassPredicate = std::function<bool(const std::string& dex_location, dex::TypeIndex)>;
+  using MethodVisitor =
+      std::function<void(const std::string& dex_location, uint16_t, uint8_t flags)>;
+  using ClassVisitor = std::function<void(const std::string& dex_location, dex::TypeIndex)>;
+
+  // Map the profile stored in `fd`. An empty file is an empty profile.
+  static std::unique_ptr<MappedProfile> Open(int fd, std::string* error_msg);
+
+  // Create a profile from serialized data.
+  static std::unique_ptr<MappedProfile> Create(std::vector<uint8_t>&& data,
+                                               std::string* error_msg);
+
+  // Merge two profiles into a new one. The sections of each dex file are sorted, so they are
+  // merged by walking both inputs in order. Only the inline caches of the methods that need
+  // to be merged or renumbered are decoded. The dex files of `a` keep their profile index,
+  // the new dex files of `b` follow in the order of `b`.
+  // Returns null if a dex file has different checksums in the two profiles, or if the result
+  // would have too many dex files.
+  static std::unique_ptr<MappedProfile> Merge(const MappedProfile& a,
+                                              const MappedProfile& b,
+                                              std::string* error_msg);
+
+  // Return a copy of `profile` with only the methods and classes accepted by the predicates,
+  // which are given the profile key of the dex file. All the dex files are kept since the
+  // inline caches may refer to them.
+  static std::unique_ptr<MappedProfile> Filter(const MappedProfile& profile,
+                                               const MethodPredicate& keep_method,
+                                               const ClassPredicate& keep_class,
+                                               std::string* error_msg);
+
+  ~MappedProfile();
+
+  // Visit all the methods and classes of the profile, in the order of the dex files and
+  // then of their indexes. Methods are visited with their ProfileMethodFlag values.
+  void VisitMethodsAndClasses(const MethodVisitor& method_visitor,
+                              const ClassVisitor& class_visitor) const;
+
+  // Write the profile to `fd`.
+  bool Save(int fd) const;
+
+  // Return true if the method reference is present in the profile.
+  bool ContainsMethod(const MethodReference& method_ref) const;
+
+  // Return the ProfileMethodFlag values of the method, or 0 if it is not in the profile.
+  uint8_t GetMethodFlags(const MethodReference& method_ref) const;
+  uint8_t GetMethodFlags(const std::string& dex_location,
+                         uint32_t dex_checksum,
+                         uint16_t dex_method_index) const;
+
+  // Return true if the profile has a dex file with the given profile key, and set `checksum`
+  // to its checksum.
+  bool GetDexFileChecksum(const std::string& profile_key, /*out*/uint32_t* checksum) const;
+
+  // Return true if the class's type is present in the profile.
+  bool ContainsClass(const DexFile& dex_file, dex::TypeIndex type_idx) const;
+
+  // Return true if the method is present in the profile.
+  // If the method is found, `pmi` is populated with its inline caches.
+  bool GetMethod(const std::string& dex_location,
+                 uint32_t dex_checksum,
+                 uint16_t dex_method_index,
+                 /*out*/ProfileCompilationInfo::OfflineProfileMethodInfo* pmi) const;
+
+  // Return the number of methods in the profile.
+  uint32_t GetNumberOfMethods() const;
+
+  // Return the number of classes in the profile.
+  uint32_t GetNumberOfResolvedClasses() const;
+
+  size_t NumberOfDexFiles() const {
+    return dex_files_.size();
+  }
+
+  const uint8_t* Begin() const {
+    return begin_;
+  }
+
+  size_t Size() const {
+    return size_;
+  }
+
+ private:
+  class LineBuilder;
+
+  // Location of the sections of a dex file in the profile.
+  struct DexFileSection {
+    std::string dex_location;
+    uint32_t checksum;
+    uint32_t number_of_methods;
+    uint16_t number_of_classes;
+    const uint8_t* method_indexes;
+    const uint8_t* method_flags;
+    const uint8_t* inline_cache_offsets;
+    const uint8_t* inline_caches;
+    uint32_t inline_caches_size;
+    const uint8_t* class_indexes;
+  };
+
+  MappedProfile() : begin_(nullptr), size_(0u) {}
+
+  // Check the profile and locate the sections of each dex file.
+  bool Parse(std::string* error_msg);
+
+  // Return the section of the dex file with the given profile key, or null if the dex file
+  // is not in the profile or has a different checksum.
+  const DexFileSection* FindDexFile(const std::string& profile_key, uint32_t checksum) const;
+
+  // Return the index of `method_index` in the method section of `dex_file`, or -1.
+  static int32_t FindMethodIndex(const DexFileSection& dex_file, uint16_t method_index);
+
+  // Return the encoded inline caches of the method at `index` in the method section.
+  static const uint8_t* GetInlineCaches(const DexFileSection& dex_file,
+                                        uint32_t index,
+                                        /*out*/size_t* size);
+
+  // Write the profile header for `number_of_dex_files` lines.
+  static void WriteHeader(size_t number_of_dex_files, /*out*/std::vector<uint8_t>* buffer);
+
+  // Decode the inline caches of the method at `index` in the method section.
+  bool DecodeInlineCaches(const DexFileSection& dex_file,
+                          uint32_t index,
+                          /*out*/ProfileCompilationInfo::InlineCacheMap* inline_caches) const;
+
+  std::unique_ptr<MemMap> map_;
+  std::vector<uint8_t> data_;
+  const uint8_t* begin_;
+  size_t size_;
+  std::vector<DexFileSection> dex_files_;
+
+  DISALLOW_COPY_AND_ASSIGN(MappedProfile);
+};
+
+}  // namespace art
+
+#endif  // ART_RUNTIME_JIT_MAPPED_PROFILE_H_
@@ -37,8 +37,8 @@
 namespace art {
 
 const uint8_t ProfileCompilationInfo::kProfileMagic[] = { 'p', 'r', 'o', '\0' };
-// Last profile version: fix the order of dex files in the profile.
-const uint8_t ProfileCompilationInfo::kProfileVersion[] = { '0', '0', '4', '\0' };
+// Last profile version: record startup, post-startup and hot flags for each method.
+const uint8_t ProfileCompilationInfo::kProfileVersion[] = { '0', '0', '6', '\0' };
 
 static constexpr uint16_t kMaxDexFileKeyLength = PATH_MAX;
 
@@ -179,28 +179,23 @@ static void AddStringToBuffer(std::vector<uint8_t>* buffer, const std::string& v
   buffer->insert(buffer->end(), value.begin(), value.end());
 }
 
-// Insert each byte, from low to high into the buffer.
-template <typename T>
-static void AddUintToBuffer(std::vector<uint8_t>* buffer, T value) {
-  for (size_t i = 0; i < sizeof(T); i++) {
-    buffer->push_back((value >> (i * kBitsPerByte)) & 0xff);
-  }
-}
-
-static constexpr size_t kLineHeaderSize =
-    2 * sizeof(uint16_t) +  // class_set.size + dex_location.size
-    2 * sizeof(uint32_t);   // method_map.size + checksum
-
 /**
  * Serialization format:
  *    magic,version,number_of_dex_files
- *    dex_location1,number_of_classes1,methods_region_size,dex_location_checksum1, \
- *        method_encoding_11,method_encoding_12...,class_id1,class_id2...
- *    dex_location2,number_of_classes2,methods_region_size,dex_location_checksum2, \
- *        method_encoding_21,method_encoding_22...,,class_id1,class_id2...
+ *    dex_location_size1,number_of_classes1,number_of_methods1,inline_cache_region_size1, \
+ *        dex_location_checksum1,dex_location1, \
+ *        method_id11,method_id12...,method_flags11,method_flags12..., \
+ *        inline_cache_offset11,inline_cache_offset12..., \
+ *        method_inline_caches11,method_inline_caches12...,class_id11,class_id12...
+ *    dex_location_size2,number_of_classes2,number_of_methods2,inline_cache_region_size2, \
+ *        ...
  *    .....
- * The method_encoding is:
- *    method_id,number_of_inline_caches,inline_cache1,inline_cache2...
+ * All values are little endian. The method ids and the class ids are sorted, and the
+ * inline_cache_offset of a method is the offset of its method_inline_caches in the inline cache
+ * region. This lets MappedProfile binary search a mapped profile without decoding it.
+ * The method_flags of a method is a byte of ProfileMethodFlag values.
+ * The method_inline_caches is:
+ *    number_of_inline_caches,inline_cache1,inline_cache2...
  * The inline_cache is:
  *    dex_pc,[M|dex_map_size], dex_profile_index,class_id1,class_id2...,dex_profile_index2,...
  *    dex_map_size is the number of dex_indeces that follows.
@@ -249,27 +244,45 @@ bool ProfileCompilationInfo::Save(int fd) {
       return false;
     }
 
+    // Compute the offsets of the inline caches of each method.
+    std::vector<uint32_t> inline_cache_offsets;
+    inline_cache_offsets.reserve(dex_data.method_map.size());
+    uint32_t inline_cache_region_size = 0u;
+    for (const auto& method_it : dex_data.method_map) {
+      inline_cache_offsets.push_back(inline_cache_region_size);
+      inline_cache_region_size += GetInlineCacheSize(method_it.second);
+    }
+
     // Make sure that the buffer has enough capacity to avoid repeated resizings
     // while we add data.
-    uint32_t methods_region_size = GetMethodsRegionSize(dex_data);
     size_t required_capacity = buffer.size() +
         kLineHeaderSize +
         dex_location.size() +
-        sizeof(uint16_t) * dex_data.class_set.size() +
-        methods_region_size;
+        GetLineDataSize(dex_data.method_map.size(),
+                        inline_cache_region_size,
+                        dex_data.class_set.size());
 
     buffer.reserve(required_capacity);
     DCHECK_LE(dex_location.size(), std::numeric_limits<uint16_t>::max());
     DCHECK_LE(dex_data.class_set.size(), std::numeric_limits<uint16_t>::max());
     AddUintToBuffer(&buffer, static_cast<uint16_t>(dex_location.size()));
     AddUintToBuffer(&buffer, static_cast<uint16_t>(dex_data.class_set.size()));
-    AddUintToBuffer(&buffer, methods_region_size);  // uint32_t
+    AddUintToBuffer(&buffer, static_cast<uint32_t>(dex_data.method_map.size()));
+    AddUintToBuffer(&buffer, inline_cache_region_size);  // uint32_t
     AddUintToBuffer(&buffer, dex_data.checksum);  // uint32_t
 
     AddStringToBuffer(&buffer, dex_location);
 
     for (const auto& method_it : dex_data.method_map) {
       AddUintToBuffer(&buffer, method_it.first);
+    }
+    for (const auto& flags_it : dex_data.method_flags) {
+      AddUintToBuffer(&buffer, flags_it.second);
+    }
+    for (uint32_t offset : inline_cache_offsets) {
+      AddUintToBuffer(&buffer, offset);
+    }
+    for (const auto& method_it : dex_data.method_map) {
       AddInlineCacheToBuffer(&buffer, method_it.second);
     }
     for (const auto& class_id : dex_data.class_set) {
@@ -330,23 +343,23 @@ void ProfileCompilationInfo::AddInlineCacheToBuffer(std::vector<uint8_t>* buffer
   }
 }
 
-uint32_t ProfileCompilationInfo::GetMethodsRegionSize(const DexFileData& dex_data) {
-  // ((uint16_t)method index + (uint16_t)inline cache size) * number of methods
-  uint32_t size = 2 * sizeof(uint16_t) * dex_data.method_map.size();
-  for (const auto& method_it : dex_data.method_map) {
-    const InlineCacheMap& inline_cache = method_it.second;
-    size += sizeof(uint16_t) * inline_cache.size();  // dex_pc
-    for (const auto& inline_cache_it : inline_cache) {
-      const ClassSet& classes = inline_cache_it.second.classes;
-      SafeMap<uint8_t, std::vector<dex::TypeIndex>> dex_to_classes_map;
-      GroupClassesByDex(classes, &dex_to_classes_map);
-      size += sizeof(uint8_t);  // dex_to_classes_map size
-      for (const auto& dex_it : dex_to_classes_map) {
-        size += sizeof(uint8_t);  // dex profile index
-        size += sizeof(uint8_t);  // number of classes
-        const std::vector<dex::TypeIndex>& dex_classes = dex_it.second;
-        size += sizeof(uint16_t) * dex_classes.size();  // the actual classes
-      }
+uint32_t ProfileCompilationInfo::GetInlineCacheSize(const InlineCacheMap& inline_cache) {
+  // (uint16_t)inline cache size
+  uint32_t size = sizeof(uint16_t);
+  size += sizeof(uint16_t) * inline_cache.size();  // dex_pc
+  for (const auto& inline_cache_it : inline_cache) {
+    size += sizeof(uint8_t);  // dex_to_classes_map size or megamorphic encoding
+    if (inline_cache_it.second.is_megamorphic) {
+      continue;
+    }
+    const ClassSet& classes = inline_cache_it.second.classes;
+    SafeMap<uint8_t, std::vector<dex::TypeIndex>> dex_to_classes_map;
+    GroupClassesByDex(classes, &dex_to_classes_map);
+    for (const auto& dex_it : dex_to_classes_map) {
+      size += sizeof(uint8_t);  // dex profile index
+      size += sizeof(uint8_t);  // number of classes
+      const std::vector<dex::TypeIndex>& dex_classes = dex_it.second;
+      size += sizeof(uint16_t) * dex_classes.size();  // the actual classes
     }
   }
   return size;
@@ -394,25 +407,38 @@ bool ProfileCompilationInfo::AddResolvedClasses(const DexCacheResolvedClasses& c
 
 bool ProfileCompilationInfo::AddMethodIndex(const std::string& dex_location,
                                             uint32_t dex_checksum,
-                                            uint16_t method_index) {
-  return AddMethod(dex_location, dex_checksum, method_index, OfflineProfileMethodInfo());
+                                            uint16_t method_index,
+                                            uint8_t flags) {
+  return AddMethod(dex_location, dex_checksum, method_index, OfflineProfileMethodInfo(), flags);
+}
+
+ProfileCompilationInfo::InlineCacheMap* ProfileCompilationInfo::FindOrAddMethod(
+    DexFileData* data,
+    uint16_t method_index,
+    uint8_t flags) {
+  DCHECK_NE(flags & kProfileMethodFlagsMask, 0u);
+  DCHECK_EQ(flags & ~kProfileMethodFlagsMask, 0u);
+  auto flags_it = data->method_flags.FindOrAdd(method_index);
+  flags_it->second |= flags;
+  return &data->method_map.FindOrAdd(method_index)->second;
 }
 
 bool ProfileCompilationInfo::AddMethod(const std::string& dex_location,
                                        uint32_t dex_checksum,
                                        uint16_t method_index,
-                                       const OfflineProfileMethodInfo& pmi) {
+                                       const OfflineProfileMethodInfo& pmi,
+                                       uint8_t flags) {
   DexFileData* const data = GetOrAddDexFileData(
       GetProfileDexFileKey(dex_location),
       dex_checksum);
   if (data == nullptr) {  // checksum mismatch
     return false;
   }
-  auto inline_cache_it = data->method_map.FindOrAdd(method_index);
+  InlineCacheMap* inline_cache = FindOrAddMethod(data, method_index, flags);
   for (const auto& pmi_inline_cache_it : pmi.inline_caches) {
     uint16_t pmi_ic_dex_pc = pmi_inline_cache_it.first;
     const DexPcData& pmi_ic_dex_pc_data = pmi_inline_cache_it.second;
-    auto dex_pc_data_it = inline_cache_it->second.FindOrAdd(pmi_ic_dex_pc);
+    auto dex_pc_data_it = inline_cache->FindOrAdd(pmi_ic_dex_pc);
     if (pmi_ic_dex_pc_data.is_megamorphic) {
       dex_pc_data_it->second.SetMegamorphic();
       continue;
@@ -438,7 +464,7 @@ bool ProfileCompilationInfo::AddMethod(const ProfileMethodInfo& pmi) {
   if (data == nullptr) {  // checksum mismatch
     return false;
   }
-  auto inline_cache_it = data->method_map.FindOrAdd(pmi.dex_method_index);
+  InlineCacheMap* inline_cache = FindOrAddMethod(data, pmi.dex_method_index, pmi.flags);
 
   for (const ProfileMethodInfo::ProfileInlineCache& cache : pmi.inline_caches) {
     for (const ProfileMethodInfo::ProfileClassReference& class_ref : cache.classes) {
@@ -448,7 +474,7 @@ bool ProfileCompilationInfo::AddMethod(const ProfileMethodInfo& pmi) {
       if (class_dex_data == nullptr) {  // checksum mismatch
         return false;
       }
-      auto dex_pc_data_it = inline_cache_it->second.FindOrAdd(cache.dex_pc);
+      auto dex_pc_data_it = inline_cache->FindOrAdd(cache.dex_pc);
       dex_pc_data_it->second.AddClass(class_dex_data->profile_index, class_ref.type_index);
     }
   }
@@ -511,19 +537,80 @@ bool ProfileCompilationInfo::ReadInlineCache(SafeBuffer& buffer,
   return true;
 }
 
+bool ProfileCompilationInfo::SkipInlineCache(SafeBuffer& buffer,
+                                             uint8_t number_of_dex_files,
+                                             /*out*/ std::string* error) {
+  uint16_t inline_cache_size;
+  READ_UINT(uint16_t, buffer, inline_cache_size, error);
+  for (; inline_cache_size > 0; inline_cache_size--) {
+    uint16_t dex_pc;
+    uint8_t dex_to_classes_map_size;
+    READ_UINT(uint16_t, buffer, dex_pc, error);
+    READ_UINT(uint8_t, buffer, dex_to_classes_map_size, error);
+    if (dex_to_classes_map_size == kMegamorphicEncoding) {
+      continue;
+    }
+    for (; dex_to_classes_map_size > 0; dex_to_classes_map_size--) {
+      uint8_t dex_profile_index;
+      uint8_t dex_classes_size;
+      READ_UINT(uint8_t, buffer, dex_profile_index, error);
+      READ_UINT(uint8_t, buffer, dex_classes_size, error);
+      if (dex_profile_index >= number_of_dex_files) {
+        *error = "dex_profile_index out of bounds ";
+        *error += std::to_string(dex_profile_index) + " " + std::to_string(number_of_dex_files);
+        return false;
+      }
+      for (; dex_classes_size > 0; dex_classes_size--) {
+        uint16_t type_index;
+        READ_UINT(uint16_t, buffer, type_index, error);
+      }
+    }
+  }
+  return true;
+}
+
 bool ProfileCompilationInfo::ReadMethods(SafeBuffer& buffer,
                                          uint8_t number_of_dex_files,
                                          const ProfileLineHeader& line_header,
                                          /*out*/std::string* error) {
-  while (buffer.HasMoreData()) {
-    DexFileData* const data = GetOrAddDexFileData(line_header.dex_location, line_header.checksum);
-    uint16_t method_index;
+  DexFileData* const data = GetOrAddDexFileData(line_header.dex_location, line_header.checksum);
+  std::vector<uint16_t> method_indexes(line_header.number_of_methods);
+  for (uint16_t& method_index : method_indexes) {
     READ_UINT(uint16_t, buffer, method_index, error);
+  }
+  std::vector<uint8_t> method_flags(line_header.number_of_methods);
+  for (uint8_t& flags : method_flags) {
+    READ_UINT(uint8_t, buffer, flags, error);
+    if (flags == 0u || (flags & ~kProfileMethodFlagsMask) != 0u) {
+      *error = "Invalid method flags " + std::to_string(flags);
+      return false;
+    }
+  }
+  std::vector<uint32_t> inline_cache_offsets(line_header.number_of_methods);
+  for (uint32_t& inline_cache_offset : inline_cache_offsets) {
+    READ_UINT(uint32_t, buffer, inline_cache_offset, error);
+  }
 
-    auto it = data->method_map.FindOrAdd(method_index);
-    if (!ReadInlineCache(buffer, number_of_dex_files, &(it->second), error)) {
+  // The inline caches are stored in the order of the methods.
+  const uint8_t* inline_cache_region = buffer.GetCurrentPtr();
+  for (size_t i = 0; i != method_indexes.size(); ++i) {
+    if (i != 0u && method_indexes[i] <= method_indexes[i - 1u]) {
+      *error = "Unsorted method indexes";
       return false;
     }
+    if (buffer.GetBytesReadSince(inline_cache_region) != inline_cache_offsets[i]) {
+      *error = "Invalid inline cache offset for method " + std::to_string(method_indexes[i]);
+      return false;
+    }
+    InlineCacheMap* inline_cache = FindOrAddMethod(data, method_indexes[i], method_flags[i]);
+    if (!ReadInlineCache(buffer, number_of_dex_files, inline_cache, error)) {
+      return false;
+    }
+  }
+  if (buffer.GetBytesReadSince(inline_cache_region) !=
+          line_header.inline_cache_region_size_bytes) {
+    *error = "Invalid inline cache region size";
+    return false;
   }
 
   return true;
@@ -589,8 +676,9 @@ ProfileCompilationInfo::ProfileLoadSatus ProfileCompilationInfo::SafeBuffer::Fil
       int fd,
       const std::string& source,
       /*out*/std::string* error) {
+  DCHECK(storage_ != nullptr);
   size_t byte_count = ptr_end_ - ptr_current_;
-  uint8_t* buffer = ptr_current_;
+  uint8_t* buffer = storage_.get() + (ptr_current_ - storage_.get());
   while (byte_count > 0) {
     int bytes_read = TEMP_FAILURE_RETRY(read(fd, buffer, byte_count));
     if (bytes_read == 0) {
@@ -644,7 +732,8 @@ bool ProfileCompilationInfo::ReadProfileLineHeaderElements(SafeBuffer& buffer,
                                                            /*out*/std::string* error) {
   READ_UINT(uint16_t, buffer, *dex_location_size, error);
   READ_UINT(uint16_t, buffer, line_header->class_set_size, error);
-  READ_UINT(uint32_t, buffer, line_header->method_region_size_bytes, error);
+  READ_UINT(uint32_t, buffer, line_header->number_of_methods, error);
+  READ_UINT(uint32_t, buffer, line_header->inline_cache_region_size_bytes, error);
   READ_UINT(uint32_t, buffer, line_header->checksum, error);
   return true;
 }
@@ -691,29 +780,24 @@ ProfileCompilationInfo::ProfileLoadSatus ProfileCompilationInfo::ReadProfileLine
     return kProfileLoadBadData;
   }
 
-  {
-    SafeBuffer buffer(line_header.method_region_size_bytes);
-    ProfileLoadSatus status = buffer.FillFromFd(fd, "ReadProfileLineMethods", error);
-    if (status != kProfileLoadSuccess) {
-      return status;
-    }
-
-    if (!ReadMethods(buffer, number_of_dex_files, line_header, error)) {
-      return kProfileLoadBadData;
-    }
+  if (line_header.number_of_methods > std::numeric_limits<uint16_t>::max() + 1u) {
+    *error = "Too many methods for " + line_header.dex_location;
+    return kProfileLoadBadData;
   }
 
-  {
-    SafeBuffer buffer(sizeof(uint16_t) * line_header.class_set_size);
-    ProfileLoadSatus status = buffer.FillFromFd(fd, "ReadProfileLineClasses", error);
-    if (status != kProfileLoadSuccess) {
-      return status;
-    }
-    if (!ReadClasses(buffer, line_header.class_set_size, line_header, error)) {
-      return kProfileLoadBadData;
-    }
+  SafeBuffer buffer(GetLineDataSize(line_header.number_of_methods,
+                                    line_header.inline_cache_region_size_bytes,
+                                    line_header.class_set_size));
+  ProfileLoadSatus status = buffer.FillFromFd(fd, "ReadProfileLine", error);
+  if (status != kProfileLoadSuccess) {
+    return status;
+  }
+  if (!ReadMethods(buffer, number_of_dex_files, line_header, error)) {
+    return kProfileLoadBadData;
+  }
+  if (!ReadClasses(buffer, line_header.class_set_size, line_header, error)) {
+    return kProfileLoadBadData;
   }
-
   return kProfileLoadSuccess;
 }
 
@@ -829,12 +913,15 @@ bool ProfileCompilationInfo::MergeWith(const ProfileCompilationInfo& other) {
     // Merge the methods and the inline caches.
     for (const auto& other_method_it : other_dex_data.method_map) {
       uint16_t other_method_index = other_method_it.first;
-      auto method_it = info_it->second.method_map.FindOrAdd(other_method_index);
+      InlineCacheMap* inline_cache = FindOrAddMethod(
+          &info_it->second,
+          other_method_index,
+          other_dex_data.method_flags.Get(other_method_index));
       const auto& other_inline_cache = other_method_it.second;
       for (const auto& other_ic_it : other_inline_cache) {
         uint16_t other_dex_pc = other_ic_it.first;
         const ClassSet& other_class_set = other_ic_it.second.classes;
-        auto class_set = method_it->second.FindOrAdd(other_dex_pc);
+        auto class_set = inline_cache->FindOrAdd(other_dex_pc);
         if (other_ic_it.second.is_megamorphic) {
           class_set->second.SetMegamorphic();
         } else {
@@ -905,6 +992,27 @@ bool ProfileCompilationInfo::GetMethod(const std::string& dex_location,
 }
 
 
+uint8_t ProfileCompilationInfo::GetMethodFlags(const MethodReference& method_ref) const {
+  return GetMethodFlags(method_ref.dex_file->GetLocation(),
+                        method_ref.dex_file->GetLocationChecksum(),
+                        method_ref.dex_method_index);
+}
+
+uint8_t ProfileCompilationInfo::GetMethodFlags(const std::string& dex_location,
+                                               uint32_t dex_checksum,
+                                               uint16_t dex_method_index) const {
+  auto info_it = info_.find(GetProfileDexFileKey(dex_location));
+  if (info_it != info_.end()) {
+    if (!ChecksumMatch(dex_checksum, info_it->second.checksum)) {
+      return 0u;
+    }
+    const SafeMap<uint16_t, uint8_t>& method_flags = info_it->second.method_flags;
+    const auto flags_it = method_flags.find(dex_method_index);
+    return flags_it == method_flags.end() ? 0u : flags_it->second;
+  }
+  return 0u;
+}
+
 bool ProfileCompilationInfo::ContainsClass(const DexFile& dex_file, dex::TypeIndex type_idx) const {
   auto info_it = info_.find(GetProfileDexFileKey(dex_file.GetLocation()));
   if (info_it != info_.end()) {
@@ -996,6 +1104,10 @@ std::string ProfileCompilationInfo::DumpInfo(const std::vector<const DexFile*>*
         os << method_it.first;
       }
 
+      uint8_t flags = dex_data.method_flags.Get(method_it.first);
+      os << ((flags & kProfileMethodFlagHot) != 0u ? "H" : "")
+         << ((flags & kProfileMethodFlagStartup) != 0u ? "S" : "")
+         << ((flags & kProfileMethodFlagPostStartup) != 0u ? "P" : "");
       os << "[";
       for (const auto& inline_cache_it : method_it.second) {
         os << "{" << std::hex << inline_cache_it.first << std::dec << ":";
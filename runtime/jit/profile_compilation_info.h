@@ -30,6 +30,18 @@
 
 namespace art {
 
+// Flags recording when a method is used. A method in the profile has at least one of them.
+enum ProfileMethodFlag : uint8_t {
+  // The method is executed often, e.g. it has been JIT compiled.
+  kProfileMethodFlagHot = 1 << 0,
+  // The method is executed during startup.
+  kProfileMethodFlagStartup = 1 << 1,
+  // The method is executed after startup.
+  kProfileMethodFlagPostStartup = 1 << 2,
+};
+static constexpr uint8_t kProfileMethodFlagsMask =
+    kProfileMethodFlagHot | kProfileMethodFlagStartup | kProfileMethodFlagPostStartup;
+
 /**
  *  Convenient class to pass around profile information (including inline caches)
  *  without the need to hold GC-able objects.
@@ -52,17 +64,22 @@ struct ProfileMethodInfo {
     const std::vector<ProfileClassReference> classes;
   };
 
-  ProfileMethodInfo(const DexFile* dex, uint32_t method_index)
-      : dex_file(dex), dex_method_index(method_index) {}
+  ProfileMethodInfo(const DexFile* dex,
+                    uint32_t method_index,
+                    uint8_t method_flags = kProfileMethodFlagHot)
+      : dex_file(dex), dex_method_index(method_index), flags(method_flags) {}
 
   ProfileMethodInfo(const DexFile* dex,
                     uint32_t method_index,
-                    const std::vector<ProfileInlineCache>& caches)
-      : dex_file(dex), dex_method_index(method_index), inline_caches(caches) {}
+                    const std::vector<ProfileInlineCache>& caches,
+                    uint8_t method_flags = kProfileMethodFlagHot)
+      : dex_file(dex), dex_method_index(method_index), inline_caches(caches), flags(method_flags) {}
 
   const DexFile* dex_file;
   const uint32_t dex_method_index;
   const std::vector<ProfileInlineCache> inline_caches;
+  // A combination of ProfileMethodFlag values.
+  uint8_t flags;
 };
 
 /**
@@ -70,7 +87,8 @@ struct ProfileMethodInfo {
  * performing profile guided compilation.
  * It is a serialize-friendly format based on information collected by the
  * interpreter (ProfileInfo).
- * Currently it stores only the hot compiled methods.
+ * It stores the profiled methods, with ProfileMethodFlag values telling whether they are hot
+ * and whether they are used during or after startup, and the resolved classes.
  */
 class ProfileCompilationInfo {
  public:
@@ -195,6 +213,13 @@ class ProfileCompilationInfo {
   // Return true if the method reference is present in the profiling info.
   bool ContainsMethod(const MethodReference& method_ref) const;
 
+  // Return the ProfileMethodFlag values recorded for the method, or 0 if the method is not
+  // present in the profiling info.
+  uint8_t GetMethodFlags(const MethodReference& method_ref) const;
+  uint8_t GetMethodFlags(const std::string& dex_location,
+                         uint32_t dex_checksum,
+                         uint16_t dex_method_index) const;
+
   // Return true if the class's type is present in the profiling info.
   bool ContainsClass(const DexFile& dex_file, dex::TypeIndex type_idx) const;
 
@@ -265,12 +290,16 @@ class ProfileCompilationInfo {
     uint32_t checksum;
     // The methonds' profile information
     MethodMap method_map;
+    // The ProfileMethodFlag values of the methods, with the same keys as method_map.
+    SafeMap<uint16_t, uint8_t> method_flags;
     // The classes which have been profiled. Note that these don't necessarily include
     // all the classes that can be found in the inline caches reference.
     std::set<dex::TypeIndex> class_set;
 
     bool operator==(const DexFileData& other) const {
-      return checksum == other.checksum && method_map == other.method_map;
+      return checksum == other.checksum &&
+          method_map == other.method_map &&
+          method_flags == other.method_flags;
     }
   };
 
@@ -282,7 +311,14 @@ class ProfileCompilationInfo {
   DexFileData* GetOrAddDexFileData(const std::string& dex_location, uint32_t checksum);
 
   // Add a method index to the profile (without inline caches).
-  bool AddMethodIndex(const std::string& dex_location, uint32_t checksum, uint16_t method_idx);
+  bool AddMethodIndex(const std::string& dex_location,
+                      uint32_t checksum,
+                      uint16_t method_idx,
+                      uint8_t flags = kProfileMethodFlagHot);
+
+  // Add the method to `data` if needed and record `flags` for it.
+  // Return the inline caches of the method.
+  static InlineCacheMap* FindOrAddMethod(DexFileData* data, uint16_t method_index, uint8_t flags);
 
   // Add a method to the profile using its online representation (containing runtime structures).
   bool AddMethod(const ProfileMethodInfo& pmi);
@@ -292,7 +328,8 @@ class ProfileCompilationInfo {
   bool AddMethod(const std::string& dex_location,
                  uint32_t dex_checksum,
                  uint16_t method_index,
-                 const OfflineProfileMethodInfo& pmi);
+                 const OfflineProfileMethodInfo& pmi,
+                 uint8_t flags = kProfileMethodFlagHot);
 
   // Add a class index to the profile.
   bool AddClassIndex(const std::string& dex_location, uint32_t checksum, dex::TypeIndex type_idx);
@@ -316,10 +353,26 @@ class ProfileCompilationInfo {
   struct ProfileLineHeader {
     std::string dex_location;
     uint16_t class_set_size;
-    uint32_t method_region_size_bytes;
+    uint32_t number_of_methods;
+    uint32_t inline_cache_region_size_bytes;
     uint32_t checksum;
   };
 
+  // Size of the line header in the file, excluding the dex location.
+  static constexpr size_t kLineHeaderSize =
+      2 * sizeof(uint16_t) +  // class_set.size + dex_location.size
+      3 * sizeof(uint32_t);   // method_map.size + inline cache region size + checksum
+
+  // Return the number of bytes of the method and class sections of a profile line.
+  static size_t GetLineDataSize(uint32_t number_of_methods,
+                                uint32_t inline_cache_region_size_bytes,
+                                uint16_t class_set_size) {
+    // index + flags + offset
+    return (sizeof(uint16_t) + sizeof(uint8_t) + sizeof(uint32_t)) * number_of_methods +
+        inline_cache_region_size_bytes +
+        sizeof(uint16_t) * class_set_size;
+  }
+
   // A helper structure to make sure we don't read past our buffers in the loops.
   struct SafeBuffer {
    public:
@@ -328,6 +381,10 @@ class ProfileCompilationInfo {
       ptr_end_ = ptr_current_ + size;
     }
 
+    // Read from data owned by the caller, for example a mapped profile.
+    SafeBuffer(const uint8_t* data, size_t size)
+        : ptr_current_(data), ptr_end_(data + size) {}
+
     // Reads the content of the descriptor at the current position.
     ProfileLoadSatus FillFromFd(int fd,
                                 const std::string& source,
@@ -344,13 +401,19 @@ class ProfileCompilationInfo {
     // Returns true if the buffer has more data to read.
     bool HasMoreData();
 
+    // Return the number of bytes read since `ptr`.
+    size_t GetBytesReadSince(const uint8_t* ptr) const { return ptr_current_ - ptr; }
+
+    // Get the current read position.
+    const uint8_t* GetCurrentPtr() const { return ptr_current_; }
+
     // Get the underlying raw buffer.
     uint8_t* Get() { return storage_.get(); }
 
    private:
     std::unique_ptr<uint8_t[]> storage_;
-    uint8_t* ptr_current_;
-    uint8_t* ptr_end_;
+    const uint8_t* ptr_current_;
+    const uint8_t* ptr_end_;
   };
 
   // Entry point for profile loding functionality.
@@ -392,25 +455,38 @@ class ProfileCompilationInfo {
                    /*out*/std::string* error);
 
   // Read the inline cache encoding from line_bufer into inline_cache.
-  bool ReadInlineCache(SafeBuffer& buffer,
-                       uint8_t number_of_dex_files,
-                       /*out*/InlineCacheMap* inline_cache,
-                       /*out*/std::string* error);
+  static bool ReadInlineCache(SafeBuffer& buffer,
+                              uint8_t number_of_dex_files,
+                              /*out*/InlineCacheMap* inline_cache,
+                              /*out*/std::string* error);
+
+  // Check the inline cache encoding in `buffer` and skip it, without decoding it.
+  static bool SkipInlineCache(SafeBuffer& buffer,
+                              uint8_t number_of_dex_files,
+                              /*out*/std::string* error);
 
   // Encode the inline cache into the given buffer.
-  void AddInlineCacheToBuffer(std::vector<uint8_t>* buffer,
-                              const InlineCacheMap& inline_cache);
+  static void AddInlineCacheToBuffer(std::vector<uint8_t>* buffer,
+                                     const InlineCacheMap& inline_cache);
 
-  // Return the number of bytes needed to encode the profile information
-  // for the methods in dex_data.
-  uint32_t GetMethodsRegionSize(const DexFileData& dex_data);
+  // Return the number of bytes needed to encode the inline cache.
+  static uint32_t GetInlineCacheSize(const InlineCacheMap& inline_cache);
 
   // Group `classes` by their owning dex profile index and put the result in
   // `dex_to_classes_map`.
-  void GroupClassesByDex(
+  static void GroupClassesByDex(
       const ClassSet& classes,
       /*out*/SafeMap<uint8_t, std::vector<dex::TypeIndex>>* dex_to_classes_map);
 
+  // Insert each byte, from low to high into the buffer.
+  template <typename T>
+  static void AddUintToBuffer(std::vector<uint8_t>* buffer, T value) {
+    for (size_t i = 0; i < sizeof(T); i++) {
+      buffer->push_back((value >> (i * kBitsPerByte)) & 0xff);
+    }
+  }
+
+  friend class MappedProfile;
   friend class ProfileCompilationInfoTest;
   friend class CompilerDriverProfileTest;
   friend class ProfileAssistantTest;
@@ -25,7 +25,9 @@
 #include "mirror/class-inl.h"
 #include "mirror/class_loader.h"
 #include "handle_scope-inl.h"
+#include "jit/mapped_profile.h"
 #include "jit/profile_compilation_info.h"
+#include "jit/profile_journal.h"
 #include "scoped_thread_state_change-inl.h"
 
 namespace art {
@@ -415,9 +417,9 @@ TEST_F(ProfileCompilationInfoTest, TooLongDexLocation) {
   uint8_t line_number[] = { 0, 1 };
   ASSERT_TRUE(profile.GetFile()->WriteFully(line_number, sizeof(line_number)));
 
-  // dex_location_size, methods_size, classes_size, checksum.
+  // dex_location_size, classes_size, methods_size, inline_cache_region_size, checksum.
   // Dex location size is too big and should be rejected.
-  uint8_t line[] = { 255, 255, 0, 1, 0, 1, 0, 0, 0, 0 };
+  uint8_t line[] = { 255, 255, 0, 1, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
   ASSERT_TRUE(profile.GetFile()->WriteFully(line, sizeof(line)));
   ASSERT_EQ(0, profile.GetFile()->Flush());
 
@@ -686,4 +688,303 @@ TEST_F(ProfileCompilationInfoTest, MegamorphicInlineCachesMerge) {
   ASSERT_TRUE(info_no_inline_cache.Save(GetFd(profile)));
 }
 
+TEST_F(ProfileCompilationInfoTest, MappedProfileGetMethod) {
+  ScratchFile profile;
+
+  ProfileCompilationInfo saved_info;
+  ProfileCompilationInfo::OfflineProfileMethodInfo pmi = GetOfflineProfileMethodInfo();
+  for (uint16_t method_idx = 0; method_idx < 100; method_idx += 2) {
+    ASSERT_TRUE(AddMethod("dex_location1", /* checksum */ 1, method_idx, pmi, &saved_info));
+    ASSERT_TRUE(AddMethod("dex_location4", /* checksum */ 4, method_idx, &saved_info));
+  }
+  ASSERT_TRUE(saved_info.Save(GetFd(profile)));
+  ASSERT_EQ(0, profile.GetFile()->Flush());
+
+  std::string error;
+  std::unique_ptr<MappedProfile> mapped_profile = MappedProfile::Open(GetFd(profile), &error);
+  ASSERT_TRUE(mapped_profile != nullptr) << error;
+  ASSERT_EQ(saved_info.GetNumberOfMethods(), mapped_profile->GetNumberOfMethods());
+  ASSERT_EQ(4u, mapped_profile->NumberOfDexFiles());
+
+  for (uint16_t method_idx = 0; method_idx < 100; method_idx++) {
+    ProfileCompilationInfo::OfflineProfileMethodInfo loaded_pmi;
+    bool expected = (method_idx % 2) == 0;
+    ASSERT_EQ(expected, mapped_profile->GetMethod("dex_location1",
+                                                  /* checksum */ 1,
+                                                  method_idx,
+                                                  &loaded_pmi));
+    if (expected) {
+      ASSERT_TRUE(loaded_pmi == pmi);
+    }
+    ASSERT_EQ(expected, mapped_profile->GetMethod("dex_location4",
+                                                  /* checksum */ 4,
+                                                  method_idx,
+                                                  &loaded_pmi));
+    if (expected) {
+      ASSERT_TRUE(loaded_pmi.inline_caches.empty());
+    }
+  }
+  ProfileCompilationInfo::OfflineProfileMethodInfo loaded_pmi;
+  ASSERT_FALSE(mapped_profile->GetMethod("dex_location1", /* checksum */ 2, 0, &loaded_pmi));
+  ASSERT_FALSE(mapped_profile->GetMethod("dex_location5", /* checksum */ 5, 0, &loaded_pmi));
+}
+
+TEST_F(ProfileCompilationInfoTest, MappedProfileMerge) {
+  ProfileCompilationInfo::OfflineProfileMethodInfo pmi = GetOfflineProfileMethodInfo();
+  ProfileCompilationInfo::OfflineProfileMethodInfo pmi_megamorphic = pmi;
+  MakeMegamorphic(&pmi_megamorphic);
+
+  ProfileCompilationInfo info1;
+  for (uint16_t method_idx = 0; method_idx < 10; method_idx++) {
+    ASSERT_TRUE(AddMethod("dex_location1", /* checksum */ 1, method_idx, pmi, &info1));
+  }
+  ASSERT_TRUE(AddClass("dex_location1", /* checksum */ 1, /* class_idx */ 3, &info1));
+
+  // The second profile has a new dex file before the common ones, so its inline caches
+  // need to be renumbered.
+  ProfileCompilationInfo info2;
+  for (uint16_t method_idx = 5; method_idx < 15; method_idx++) {
+    ASSERT_TRUE(AddMethod("dex_location4", /* checksum */ 4, method_idx, &info2));
+    ASSERT_TRUE(
+        AddMethod("dex_location1", /* checksum */ 1, method_idx, pmi_megamorphic, &info2));
+  }
+  ASSERT_TRUE(AddClass("dex_location1", /* checksum */ 1, /* class_idx */ 4, &info2));
+
+  ScratchFile profile1;
+  ScratchFile profile2;
+  ASSERT_TRUE(info1.Save(GetFd(profile1)));
+  ASSERT_EQ(0, profile1.GetFile()->Flush());
+  ASSERT_TRUE(info2.Save(GetFd(profile2)));
+  ASSERT_EQ(0, profile2.GetFile()->Flush());
+
+  std::string error;
+  std::unique_ptr<MappedProfile> mapped1 = MappedProfile::Open(GetFd(profile1), &error);
+  ASSERT_TRUE(mapped1 != nullptr) << error;
+  std::unique_ptr<MappedProfile> mapped2 = MappedProfile::Open(GetFd(profile2), &error);
+  ASSERT_TRUE(mapped2 != nullptr) << error;
+  std::unique_ptr<MappedProfile> merged = MappedProfile::Merge(*mapped1, *mapped2, &error);
+  ASSERT_TRUE(merged != nullptr) << error;
+
+  // The streamed merge must agree with the in-memory one.
+  ASSERT_TRUE(info1.MergeWith(info2));
+  ASSERT_EQ(info1.GetNumberOfMethods(), merged->GetNumberOfMethods());
+  ASSERT_EQ(info1.GetNumberOfResolvedClasses(), merged->GetNumberOfResolvedClasses());
+  for (uint16_t method_idx = 0; method_idx < 15; method_idx++) {
+    for (const char* dex_location : { "dex_location1", "dex_location4" }) {
+      uint32_t checksum = (dex_location == std::string("dex_location1")) ? 1u : 4u;
+      ProfileCompilationInfo::OfflineProfileMethodInfo expected_pmi;
+      ProfileCompilationInfo::OfflineProfileMethodInfo merged_pmi;
+      bool expected = info1.GetMethod(dex_location, checksum, method_idx, &expected_pmi);
+      ASSERT_EQ(expected, merged->GetMethod(dex_location, checksum, method_idx, &merged_pmi));
+      if (expected) {
+        ASSERT_TRUE(expected_pmi == merged_pmi);
+      }
+    }
+  }
+
+  // The merged profile must load back into the same information.
+  ScratchFile merged_profile;
+  ASSERT_TRUE(merged->Save(GetFd(merged_profile)));
+  ASSERT_EQ(0, merged_profile.GetFile()->Flush());
+  ASSERT_TRUE(merged_profile.GetFile()->ResetOffset());
+  ProfileCompilationInfo loaded_info;
+  ASSERT_TRUE(loaded_info.Load(GetFd(merged_profile)));
+  ASSERT_EQ(info1.GetNumberOfMethods(), loaded_info.GetNumberOfMethods());
+  ASSERT_EQ(info1.GetNumberOfResolvedClasses(), loaded_info.GetNumberOfResolvedClasses());
+}
+
+TEST_F(ProfileCompilationInfoTest, MappedProfileMergeFail) {
+  ProfileCompilationInfo info1;
+  ASSERT_TRUE(AddMethod("dex_location", /* checksum */ 1, /* method_idx */ 1, &info1));
+  ProfileCompilationInfo info2;
+  ASSERT_TRUE(AddMethod("dex_location", /* checksum */ 2, /* method_idx */ 2, &info2));
+
+  ScratchFile profile1;
+  ScratchFile profile2;
+  ASSERT_TRUE(info1.Save(GetFd(profile1)));
+  ASSERT_EQ(0, profile1.GetFile()->Flush());
+  ASSERT_TRUE(info2.Save(GetFd(profile2)));
+  ASSERT_EQ(0, profile2.GetFile()->Flush());
+
+  std::string error;
+  std::unique_ptr<MappedProfile> mapped1 = MappedProfile::Open(GetFd(profile1), &error);
+  ASSERT_TRUE(mapped1 != nullptr) << error;
+  std::unique_ptr<MappedProfile> mapped2 = MappedProfile::Open(GetFd(profile2), &error);
+  ASSERT_TRUE(mapped2 != nullptr) << error;
+  // Merge should fail because the checksums are different.
+  ASSERT_TRUE(MappedProfile::Merge(*mapped1, *mapped2, &error) == nullptr);
+}
+
+TEST_F(ProfileCompilationInfoTest, JournalAppendAndCompact) {
+  ScratchFile profile;
+  ProfileCompilationInfo info1;
+  ASSERT_TRUE(AddMethod("dex_location1", /* checksum */ 1, /* method_idx */ 1, &info1));
+  ASSERT_TRUE(AddClass("dex_location1", /* checksum */ 1, /* class_idx */ 2, &info1));
+  ASSERT_TRUE(info1.Save(GetFd(profile)));
+  ASSERT_EQ(0, profile.GetFile()->Flush());
+
+  // Append two deltas. The profile itself is not changed.
+  const std::string& filename = profile.GetFilename();
+  std::string journal_filename = ProfileJournal::GetJournalFilename(filename);
+  ProfileCompilationInfo delta1;
+  ASSERT_TRUE(AddMethod("dex_location1", /* checksum */ 1, /* method_idx */ 3, &delta1));
+  ProfileCompilationInfo delta2;
+  ASSERT_TRUE(AddMethod("dex_location2", /* checksum */ 2, /* method_idx */ 4, &delta2));
+  uint64_t bytes_written = 0;
+  uint64_t journal_size = 0;
+  ASSERT_TRUE(ProfileJournal::Append(filename, &delta1, &bytes_written, &journal_size));
+  ASSERT_EQ(bytes_written, journal_size);
+  ASSERT_TRUE(ProfileJournal::Append(filename, &delta2, &bytes_written, &journal_size));
+  ASSERT_LT(bytes_written, journal_size);
+  ProfileCompilationInfo loaded_info;
+  ASSERT_TRUE(profile.GetFile()->ResetOffset());
+  ASSERT_TRUE(loaded_info.Load(GetFd(profile)));
+  ASSERT_TRUE(loaded_info.Equals(info1));
+
+  // Compact the journal into the profile.
+  ASSERT_TRUE(ProfileJournal::Compact(filename, &bytes_written));
+  ASSERT_NE(0u, bytes_written);
+  ProfileCompilationInfo expected;
+  ASSERT_TRUE(expected.MergeWith(info1));
+  ASSERT_TRUE(expected.MergeWith(delta1));
+  ASSERT_TRUE(expected.MergeWith(delta2));
+  ProfileCompilationInfo compacted_info;
+  ASSERT_TRUE(profile.GetFile()->ResetOffset());
+  ASSERT_TRUE(compacted_info.Load(GetFd(profile)));
+  ASSERT_TRUE(compacted_info.Equals(expected));
+  ASSERT_EQ(0, GetFileSizeBytes(journal_filename));
+
+  // Compacting an empty journal does not write the profile.
+  ASSERT_TRUE(ProfileJournal::Compact(filename, &bytes_written));
+  ASSERT_EQ(0u, bytes_written);
+  ASSERT_EQ(0, unlink(journal_filename.c_str()));
+}
+
+TEST_F(ProfileCompilationInfoTest, JournalIncompleteRecord) {
+  ScratchFile profile;
+  const std::string& filename = profile.GetFilename();
+  std::string journal_filename = ProfileJournal::GetJournalFilename(filename);
+  ProfileCompilationInfo delta;
+  ASSERT_TRUE(AddMethod("dex_location1", /* checksum */ 1, /* method_idx */ 1, &delta));
+  uint64_t bytes_written = 0;
+  uint64_t journal_size = 0;
+  ASSERT_TRUE(ProfileJournal::Append(filename, &delta, &bytes_written, &journal_size));
+
+  // Simulate a crash in the middle of the next record, before its size is written.
+  {
+    std::unique_ptr<File> journal(OS::OpenFileReadWrite(journal_filename.c_str()));
+    ASSERT_TRUE(journal != nullptr);
+    const uint8_t incomplete_record[] = { 0, 0, 0, 0, 'p', 'r' };
+    ASSERT_TRUE(journal->PwriteFully(incomplete_record, sizeof(incomplete_record), journal_size));
+    ASSERT_EQ(0, journal->FlushClose());
+  }
+
+  // The complete record is kept, the incomplete one is dropped.
+  ASSERT_TRUE(ProfileJournal::Compact(filename, &bytes_written));
+  ProfileCompilationInfo compacted_info;
+  ASSERT_TRUE(profile.GetFile()->ResetOffset());
+  ASSERT_TRUE(compacted_info.Load(GetFd(profile)));
+  ASSERT_TRUE(compacted_info.Equals(delta));
+  ASSERT_EQ(0, unlink(journal_filename.c_str()));
+}
+
+TEST_F(ProfileCompilationInfoTest, JournalDroppedWhenProfileCleared) {
+  ScratchFile profile;
+  ProfileCompilationInfo info;
+  ASSERT_TRUE(AddMethod("dex_location1", /* checksum */ 1, /* method_idx */ 1, &info));
+  ASSERT_TRUE(info.Save(GetFd(profile)));
+  ASSERT_EQ(0, profile.GetFile()->Flush());
+  const std::string& filename = profile.GetFilename();
+  std::string journal_filename = ProfileJournal::GetJournalFilename(filename);
+  ProfileCompilationInfo delta;
+  ASSERT_TRUE(AddMethod("dex_location1", /* checksum */ 1, /* method_idx */ 2, &delta));
+  uint64_t bytes_written = 0;
+  uint64_t journal_size = 0;
+  ASSERT_TRUE(ProfileJournal::Append(filename, &delta, &bytes_written, &journal_size));
+
+  // Clear the profile like installd does. The journal is stale and is not merged.
+  ASSERT_TRUE(profile.GetFile()->ClearContent());
+  ASSERT_TRUE(ProfileJournal::Compact(filename, &bytes_written));
+  ASSERT_EQ(0u, bytes_written);
+  ASSERT_EQ(0, profile.GetFile()->GetLength());
+  ASSERT_EQ(0, GetFileSizeBytes(journal_filename));
+  ASSERT_EQ(0, unlink(journal_filename.c_str()));
+}
+
+TEST_F(ProfileCompilationInfoTest, JournalDeletedWithProfile) {
+  std::string journal_filename;
+  std::string filename;
+  {
+    ScratchFile profile;
+    filename = profile.GetFilename();
+    journal_filename = ProfileJournal::GetJournalFilename(filename);
+    ProfileCompilationInfo delta;
+    ASSERT_TRUE(AddMethod("dex_location1", /* checksum */ 1, /* method_idx */ 1, &delta));
+    uint64_t bytes_written = 0;
+    uint64_t journal_size = 0;
+    ASSERT_TRUE(ProfileJournal::Append(filename, &delta, &bytes_written, &journal_size));
+    ASSERT_TRUE(OS::FileExists(journal_filename.c_str()));
+  }
+
+  // The profile was deleted, its journal is deleted the next time it is accessed.
+  uint64_t bytes_written = 0;
+  ASSERT_FALSE(ProfileJournal::Compact(filename, &bytes_written));
+  ASSERT_FALSE(OS::FileExists(journal_filename.c_str()));
+}
+
+TEST_F(ProfileCompilationInfoTest, MethodFlags) {
+  ScratchFile profile;
+
+  ProfileCompilationInfo info1;
+  ASSERT_TRUE(info1.AddMethodIndex("dex_location1", /* checksum */ 1, /* method_idx */ 1,
+                                   kProfileMethodFlagStartup));
+  ASSERT_TRUE(info1.AddMethodIndex("dex_location1", /* checksum */ 1, /* method_idx */ 2,
+                                   kProfileMethodFlagPostStartup));
+  ASSERT_TRUE(info1.AddMethodIndex("dex_location1", /* checksum */ 1, /* method_idx */ 3,
+                                   kProfileMethodFlagHot));
+  // Adding a method again adds to its flags.
+  ASSERT_TRUE(info1.AddMethodIndex("dex_location1", /* checksum */ 1, /* method_idx */ 1,
+                                   kProfileMethodFlagHot));
+  ASSERT_EQ(kProfileMethodFlagStartup | kProfileMethodFlagHot,
+            info1.GetMethodFlags("dex_location1", /* checksum */ 1, /* method_idx */ 1));
+  ASSERT_EQ(0, info1.GetMethodFlags("dex_location1", /* checksum */ 1, /* method_idx */ 4));
+
+  ASSERT_TRUE(info1.Save(GetFd(profile)));
+  ASSERT_EQ(0, profile.GetFile()->Flush());
+  ASSERT_TRUE(profile.GetFile()->ResetOffset());
+  ProfileCompilationInfo loaded_info;
+  ASSERT_TRUE(loaded_info.Load(GetFd(profile)));
+  ASSERT_TRUE(loaded_info.Equals(info1));
+
+  std::string error;
+  std::unique_ptr<MappedProfile> mapped1 = MappedProfile::Open(GetFd(profile), &error);
+  ASSERT_TRUE(mapped1 != nullptr) << error;
+  for (uint16_t method_idx = 0; method_idx < 5; method_idx++) {
+    ASSERT_EQ(info1.GetMethodFlags("dex_location1", /* checksum */ 1, method_idx),
+              mapped1->GetMethodFlags("dex_location1", /* checksum */ 1, method_idx));
+  }
+
+  // Merging keeps the flags of both profiles.
+  ProfileCompilationInfo info2;
+  ASSERT_TRUE(info2.AddMethodIndex("dex_location1", /* checksum */ 1, /* method_idx */ 2,
+                                   kProfileMethodFlagStartup));
+  ASSERT_TRUE(info2.AddMethodIndex("dex_location1", /* checksum */ 1, /* method_idx */ 4,
+                                   kProfileMethodFlagPostStartup));
+  ScratchFile profile2;
+  ASSERT_TRUE(info2.Save(GetFd(profile2)));
+  ASSERT_EQ(0, profile2.GetFile()->Flush());
+  std::unique_ptr<MappedProfile> mapped2 = MappedProfile::Open(GetFd(profile2), &error);
+  ASSERT_TRUE(mapped2 != nullptr) << error;
+  std::unique_ptr<MappedProfile> merged = MappedProfile::Merge(*mapped1, *mapped2, &error);
+  ASSERT_TRUE(merged != nullptr) << error;
+
+  ASSERT_TRUE(info1.MergeWith(info2));
+  ASSERT_EQ(kProfileMethodFlagStartup | kProfileMethodFlagPostStartup,
+            info1.GetMethodFlags("dex_location1", /* checksum */ 1, /* method_idx */ 2));
+  for (uint16_t method_idx = 0; method_idx < 5; method_idx++) {
+    ASSERT_EQ(info1.GetMethodFlags("dex_location1", /* checksum */ 1, method_idx),
+              merged->GetMethodFlags("dex_location1", /* checksum */ 1, method_idx));
+  }
+}
+
 }  // namespace art
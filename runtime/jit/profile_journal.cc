@@ -0,0 +1,262 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "profile_journal.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <memory>
+#include <vector>
+
+#include "base/bit_utils.h"
+#include "base/logging.h"
+#include "base/scoped_flock.h"
+#include "base/systrace.h"
+#include "base/unix_file/fd_file.h"
+#include "jit/mapped_profile.h"
+#include "jit/profile_compilation_info.h"
+#include "os.h"
+
+namespace art {
+
+static constexpr size_t kRecordHeaderSize = sizeof(uint32_t);
+
+// Identifies the version of the profile file which the records of a journal apply to. Only
+// Compact() rewrites the profile, and it clears the journal, so a different stamp means that
+// the profile was cleared or replaced by someone else, e.g. installd when clearing the profiles
+// of an app, and that the records are stale.
+struct ProfileStamp {
+  uint64_t dev;
+  uint64_t ino;
+  uint64_t size;
+  uint64_t mtime;
+};
+
+static_assert(sizeof(ProfileStamp) == 4 * sizeof(uint64_t), "ProfileStamp has padding");
+
+static constexpr size_t kJournalHeaderSize = sizeof(ProfileStamp);
+
+static bool GetProfileStamp(const ScopedFlock& flock, /*out*/ProfileStamp* stamp) {
+  struct stat st;
+  if (fstat(flock.GetFile()->Fd(), &st) != 0) {
+    return false;
+  }
+  stamp->dev = static_cast<uint64_t>(st.st_dev);
+  stamp->ino = static_cast<uint64_t>(st.st_ino);
+  stamp->size = static_cast<uint64_t>(st.st_size);
+  stamp->mtime = static_cast<uint64_t>(st.st_mtime);
+  return true;
+}
+
+static bool LockProfile(const std::string& profile_filename, /*out*/ScopedFlock* flock) {
+  std::string error;
+  if (!flock->Init(profile_filename.c_str(),
+                   O_RDWR | O_NOFOLLOW | O_CLOEXEC,
+                   /* block */ false,
+                   &error)) {
+    LOG(WARNING) << "Couldn't lock the profile file " << profile_filename << ": " << error;
+    if (!OS::FileExists(profile_filename.c_str())) {
+      // The profile was deleted, delete its journal with it. A journal which outlives its
+      // profile would otherwise be merged into a new profile with the same name.
+      std::string journal_filename = ProfileJournal::GetJournalFilename(profile_filename);
+      if (unlink(journal_filename.c_str()) != 0 && errno != ENOENT) {
+        PLOG(WARNING) << "Couldn't delete the profile journal " << journal_filename;
+      }
+    }
+    return false;
+  }
+  return true;
+}
+
+bool ProfileJournal::Append(const std::string& profile_filename,
+                            ProfileCompilationInfo* info,
+                            /*out*/uint64_t* bytes_written,
+                            /*out*/uint64_t* journal_size) {
+  ScopedTrace trace(__PRETTY_FUNCTION__);
+  ScopedFlock flock;
+  if (!LockProfile(profile_filename, &flock)) {
+    return false;
+  }
+  std::string journal_filename = GetJournalFilename(profile_filename);
+  File journal(journal_filename,
+               O_RDWR | O_CREAT | O_NOFOLLOW | O_CLOEXEC,
+               0600,
+               /* check_usage */ false);
+  if (!journal.IsOpened()) {
+    PLOG(WARNING) << "Couldn't open the profile journal " << journal_filename;
+    return false;
+  }
+
+  ProfileStamp stamp;
+  if (!GetProfileStamp(flock, &stamp)) {
+    PLOG(WARNING) << "Couldn't stat the profile file " << profile_filename;
+    return false;
+  }
+  int64_t start = journal.GetLength();
+  if (start < 0) {
+    PLOG(WARNING) << "Couldn't get the length of the profile journal " << journal_filename;
+    return false;
+  }
+  int64_t write_start = start;
+  ProfileStamp journal_stamp;
+  if (start != 0 &&
+      (start < static_cast<int64_t>(kJournalHeaderSize) ||
+       !journal.PreadFully(&journal_stamp, sizeof(journal_stamp), 0u) ||
+       memcmp(&journal_stamp, &stamp, sizeof(stamp)) != 0)) {
+    VLOG(profiler) << "Dropping the stale profile journal " << journal_filename;
+    start = 0;
+  }
+  if (start == 0) {
+    // Start a new journal for the current version of the profile.
+    if (journal.SetLength(0) != 0 || !journal.PwriteFully(&stamp, sizeof(stamp), 0u)) {
+      // A header cut short is dropped by the next append or compaction.
+      PLOG(WARNING) << "Couldn't write the header of the profile journal " << journal_filename;
+      return false;
+    }
+    write_start = 0;
+    start = kJournalHeaderSize;
+  }
+
+  // Write the record with a zero size, and only set its size once it is complete.
+  uint8_t header[kRecordHeaderSize] = {};
+  if (lseek(journal.Fd(), start, SEEK_SET) != start ||
+      !journal.WriteFully(header, sizeof(header)) ||
+      !info->Save(journal.Fd())) {
+    PLOG(WARNING) << "Couldn't append to the profile journal " << journal_filename;
+    // Drop the partial record, so that the following ones can be read.
+    if (journal.SetLength(start) != 0) {
+      PLOG(WARNING) << "Couldn't truncate the profile journal " << journal_filename;
+    }
+    return false;
+  }
+  int64_t end = journal.GetLength();
+  uint32_t record_size = static_cast<uint32_t>(end - start - kRecordHeaderSize);
+  for (size_t i = 0; i != kRecordHeaderSize; ++i) {
+    header[i] = static_cast<uint8_t>(record_size >> (i * kBitsPerByte));
+  }
+  if (!journal.PwriteFully(header, sizeof(header), start)) {
+    PLOG(WARNING) << "Couldn't complete the profile journal record " << journal_filename;
+    if (journal.SetLength(start) != 0) {
+      PLOG(WARNING) << "Couldn't truncate the profile journal " << journal_filename;
+    }
+    return false;
+  }
+  *bytes_written = end - write_start;
+  *journal_size = end;
+  return true;
+}
+
+bool ProfileJournal::Compact(const std::string& profile_filename,
+                             /*out*/uint64_t* bytes_written) {
+  ScopedTrace trace(__PRETTY_FUNCTION__);
+  *bytes_written = 0u;
+  ScopedFlock flock;
+  if (!LockProfile(profile_filename, &flock)) {
+    return false;
+  }
+  std::string journal_filename = GetJournalFilename(profile_filename);
+  File journal(journal_filename, O_RDWR | O_NOFOLLOW | O_CLOEXEC, /* check_usage */ false);
+  if (!journal.IsOpened()) {
+    if (errno == ENOENT) {
+      return true;
+    }
+    PLOG(WARNING) << "Couldn't open the profile journal " << journal_filename;
+    return false;
+  }
+  int64_t journal_length = journal.GetLength();
+  if (journal_length <= 0) {
+    return journal_length == 0;
+  }
+  std::vector<uint8_t> data(journal_length);
+  if (!journal.PreadFully(data.data(), data.size(), 0u)) {
+    PLOG(WARNING) << "Couldn't read the profile journal " << journal_filename;
+    return false;
+  }
+  ProfileStamp stamp;
+  if (!GetProfileStamp(flock, &stamp)) {
+    PLOG(WARNING) << "Couldn't stat the profile file " << profile_filename;
+    return false;
+  }
+  if (data.size() < kJournalHeaderSize || memcmp(data.data(), &stamp, sizeof(stamp)) != 0) {
+    VLOG(profiler) << "Dropping the stale profile journal " << journal_filename;
+    if (journal.SetLength(0) != 0) {
+      PLOG(WARNING) << "Couldn't clear the profile journal " << journal_filename;
+      return false;
+    }
+    return true;
+  }
+
+  std::string error;
+  std::unique_ptr<MappedProfile> profile =
+      MappedProfile::Open(flock.GetFile()->Fd(), &error);
+  if (profile == nullptr) {
+    LOG(WARNING) << "Clearing bad or obsolete profile data from file "
+                 << profile_filename << ": " << error;
+    profile = MappedProfile::Create(std::vector<uint8_t>(), &error);
+  }
+  size_t number_of_records = 0u;
+  for (size_t offset = kJournalHeaderSize; data.size() - offset >= kRecordHeaderSize; ) {
+    uint32_t record_size = 0u;
+    for (size_t i = 0; i != kRecordHeaderSize; ++i) {
+      record_size |= static_cast<uint32_t>(data[offset + i]) << (i * kBitsPerByte);
+    }
+    offset += kRecordHeaderSize;
+    if (record_size == 0u || record_size > data.size() - offset) {
+      LOG(WARNING) << "Dropping incomplete records of the profile journal " << journal_filename;
+      break;
+    }
+    std::unique_ptr<MappedProfile> record = MappedProfile::Create(
+        std::vector<uint8_t>(data.begin() + offset, data.begin() + offset + record_size),
+        &error);
+    offset += record_size;
+    if (record == nullptr) {
+      LOG(WARNING) << "Dropping bad record of the profile journal " << journal_filename
+                   << ": " << error;
+      continue;
+    }
+    std::unique_ptr<MappedProfile> merged = MappedProfile::Merge(*profile, *record, &error);
+    if (merged == nullptr) {
+      // Like MergeAndSave() with `force`, the new data wins over the data of the file.
+      LOG(WARNING) << "Replacing the profile data of " << profile_filename << ": " << error;
+      merged = std::move(record);
+    }
+    profile = std::move(merged);
+    ++number_of_records;
+  }
+
+  if (number_of_records != 0u) {
+    // The profile is now held in memory, it does not refer to the mapping of the file.
+    File* profile_file = flock.GetFile();
+    if (!profile_file->ClearContent() || !profile->Save(profile_file->Fd())) {
+      PLOG(WARNING) << "Couldn't write the compacted profile " << profile_filename;
+      return false;
+    }
+    *bytes_written = profile->Size();
+  }
+  // Only clear the journal once the profile has been written. Merging the same records again
+  // after a crash does not change the profile.
+  if (journal.SetLength(0) != 0) {
+    PLOG(WARNING) << "Couldn't clear the profile journal " << journal_filename;
+    return false;
+  }
+  return true;
+}
+
+}  // namespace art
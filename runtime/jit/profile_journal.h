@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_RUNTIME_JIT_PROFILE_JOURNAL_H_
+#define ART_RUNTIME_JIT_PROFILE_JOURNAL_H_
+
+#include <string>
+
+#include "base/macros.h"
+
+namespace art {
+
+class ProfileCompilationInfo;
+
+// Append-only log of the profile data collected since a profile file was last rewritten.
+//
+// ProfileCompilationInfo::MergeAndSave() reads, merges and rewrites the whole profile even when
+// only a few methods are new. Instead, the new data can be appended to a journal next to the
+// profile, and the journal merged into the profile from time to time. Readers of the profile
+// only see the data once the journal has been compacted.
+//
+// The journal starts with a stamp of the profile file (device, inode, size and modification
+// time) followed by a sequence of records: a uint32_t size followed by a profile in the format
+// of ProfileCompilationInfo::Save(). The size is written last, so a record cut short by a crash
+// has a zero size and ends the journal. The journal is only accessed with the profile locked.
+//
+// Tools outside of the runtime, like installd, clear or delete profiles without knowing about
+// the journal. A journal whose stamp does not match the profile any more is dropped instead of
+// being merged, and the journal of a deleted profile is deleted when it is next accessed.
+class ProfileJournal {
+ public:
+  static std::string GetJournalFilename(const std::string& profile_filename) {
+    return profile_filename + ".journal";
+  }
+
+  // Append `info` to the journal of `profile_filename`. Returns the size of the record, and of
+  // the journal header if a new journal was started, in `bytes_written`, and the size of the
+  // journal after the append in `journal_size`.
+  static bool Append(const std::string& profile_filename,
+                     ProfileCompilationInfo* info,
+                     /*out*/uint64_t* bytes_written,
+                     /*out*/uint64_t* journal_size);
+
+  // Merge the records of the journal into `profile_filename` and clear the journal. Readers of
+  // the profile which know its filename should call this first. A record which cannot be merged
+  // because of a checksum mismatch is newer than the profile, so it replaces it. Returns the
+  // size of the new profile in `bytes_written`, or 0 if the journal was empty or stale.
+  static bool Compact(const std::string& profile_filename, /*out*/uint64_t* bytes_written);
+
+ private:
+  DISALLOW_IMPLICIT_CONSTRUCTORS(ProfileJournal);
+};
+
+}  // namespace art
+
+#endif  // ART_RUNTIME_JIT_PROFILE_JOURNAL_H_
@@ -27,12 +27,30 @@
 #include "base/systrace.h"
 #include "base/time_utils.h"
 #include "compiler_filter.h"
+#include "jit/profile_journal.h"
 #include "oat_file_manager.h"
 #include "scoped_thread_state_change-inl.h"
+#include "verifier/verifier_deps_recorder.h"
 
 
 namespace art {
 
+// The journal of a profile is merged into it after this many records, or once it reaches
+// this size, whichever comes first. It is also merged at the first save of the process, to
+// pick up the records of a process which was killed before compacting it, and when the saver
+// stops.
+static constexpr uint32_t kMaxJournalRecords = 16;
+static constexpr uint64_t kMaxJournalSize = 128 * KB;
+
+// The verifier dependencies are written with the profile, so that the next run of the app finds
+// them even if this process is killed.
+static void SaveRecordedVerifierDeps(Thread* self) {
+  verifier::VerifierDepsRecorder* recorder = Runtime::Current()->GetVerifierDepsRecorder();
+  if (recorder != nullptr) {
+    recorder->Save(self);
+  }
+}
+
 ProfileSaver* ProfileSaver::instance_ = nullptr;
 pthread_t ProfileSaver::profiler_pthread_ = 0U;
 
@@ -62,6 +80,11 @@ ProfileSaver::ProfileSaver(const ProfileSaverOptions& options,
       max_number_of_profile_entries_cached_(0),
       total_number_of_hot_spikes_(0),
       total_number_of_wake_ups_(0),
+      total_number_of_save_cycles_(0),
+      total_ns_of_cpu_work_(0),
+      max_ns_of_cpu_work_per_save_cycle_(0),
+      total_number_of_journal_appends_(0),
+      total_number_of_journal_compactions_(0),
       options_(options) {
   DCHECK(options_.IsEnabled());
   AddTrackedLocations(output_filename, app_data_dir, code_paths);
@@ -88,6 +111,7 @@ void ProfileSaver::Run() {
     total_ms_of_sleep_ += options_.GetSaveResolvedClassesDelayMs();
   }
   FetchAndCacheResolvedClassesAndMethods();
+  SaveRecordedVerifierDeps(self);
 
   // Loop for the profiled methods.
   while (!ShuttingDown(self)) {
@@ -129,7 +153,9 @@ void ProfileSaver::Run() {
 
     uint16_t new_methods = 0;
     uint64_t start_work = NanoTime();
+    uint64_t start_cpu_work = ThreadCpuNanoTime();
     bool profile_saved_to_disk = ProcessProfilingInfo(&new_methods);
+    SaveRecordedVerifierDeps(self);
     // Update the notification counter based on result. Note that there might be contention on this
     // but we don't care about to be 100% precise.
     if (!profile_saved_to_disk) {
@@ -138,6 +164,10 @@ void ProfileSaver::Run() {
       jit_activity_notifications_ = new_methods;
     }
     total_ns_of_work_ += NanoTime() - start_work;
+    uint64_t cpu_work = ThreadCpuNanoTime() - start_cpu_work;
+    total_number_of_save_cycles_++;
+    total_ns_of_cpu_work_ += cpu_work;
+    max_ns_of_cpu_work_per_save_cycle_ = std::max(max_ns_of_cpu_work_per_save_cycle_, cpu_work);
   }
 }
 
@@ -183,13 +213,89 @@ ProfileCompilationInfo* ProfileSaver::GetCachedProfiledInfo(const std::string& f
   return &info_it->second;
 }
 
+void ProfileSaver::AddToCachedProfiledInfo(const std::string& filename,
+                                           const std::vector<ProfileMethodInfo>& methods,
+                                           const std::set<DexCacheResolvedClasses>& classes) {
+  ProfileCompilationInfo* cached_info = GetCachedProfiledInfo(filename);
+  // Only the methods which are new or have new flags go to the delta. The inline caches of
+  // the other methods are written when the journal is compacted.
+  std::vector<ProfileMethodInfo> delta_methods;
+  for (const ProfileMethodInfo& method : methods) {
+    MethodReference method_ref(method.dex_file, method.dex_method_index);
+    uint8_t flags = cached_info->GetMethodFlags(method_ref);
+    if ((flags | method.flags) != flags || !cached_info->ContainsMethod(method_ref)) {
+      delta_methods.push_back(method);
+    }
+  }
+  cached_info->AddMethodsAndClasses(methods, classes);
+  auto delta_it = profile_delta_.find(filename);
+  if (delta_it == profile_delta_.end()) {
+    delta_it = profile_delta_.Put(filename, ProfileCompilationInfo());
+  }
+  delta_it->second.AddMethodsAndClasses(delta_methods, classes);
+}
+
+bool ProfileSaver::WriteProfile(const std::string& filename, uint64_t* bytes_written) {
+  ProfileCompilationInfo* cached_info = GetCachedProfiledInfo(filename);
+  auto records_it = journal_records_.find(filename);
+  bool compact = (records_it == journal_records_.end()) ||
+      (records_it->second + 1u >= kMaxJournalRecords);
+  // When compacting, append the whole cached profile rather than the delta, so that the
+  // profile also gets the inline caches which changed since the last compaction.
+  auto delta_it = profile_delta_.find(filename);
+  ProfileCompilationInfo* record = (compact || delta_it == profile_delta_.end())
+      ? cached_info
+      : &delta_it->second;
+  uint64_t journal_size = 0;
+  if (!ProfileJournal::Append(filename, record, bytes_written, &journal_size)) {
+    return false;
+  }
+  total_number_of_journal_appends_++;
+  profile_delta_.erase(filename);
+  uint32_t number_of_records =
+      (records_it == journal_records_.end()) ? 1u : records_it->second + 1u;
+  if (compact || journal_size >= kMaxJournalSize) {
+    uint64_t compaction_bytes_written = 0;
+    if (!ProfileJournal::Compact(filename, &compaction_bytes_written)) {
+      // The data is in the journal, the compaction will be tried again at the next save.
+      LOG(WARNING) << "Could not compact the profile journal of " << filename;
+    } else {
+      total_number_of_journal_compactions_++;
+      *bytes_written += compaction_bytes_written;
+      number_of_records = 0u;
+    }
+  }
+  journal_records_.Overwrite(filename, number_of_records);
+  return true;
+}
+
+void ProfileSaver::CompactJournals() {
+  for (const auto& it : journal_records_) {
+    if (it.second == 0u) {
+      continue;
+    }
+    uint64_t bytes_written = 0;
+    if (ProfileJournal::Compact(it.first, &bytes_written)) {
+      total_number_of_journal_compactions_++;
+    } else {
+      LOG(WARNING) << "Could not compact the profile journal of " << it.first;
+    }
+  }
+  journal_records_.clear();
+}
+
 // Get resolved methods that have a profile info or more than kStartupMethodSamples samples.
+// They are flagged as startup methods, and also as hot if they have more than
+// kHotStartupMethodSamples samples.
 // Excludes native methods and classes in the boot image.
 class GetMethodsVisitor : public ClassVisitor {
  public:
-  GetMethodsVisitor(std::vector<MethodReference>* methods, uint32_t startup_method_samples)
+  GetMethodsVisitor(std::vector<ProfileMethodInfo>* methods,
+                    uint32_t startup_method_samples,
+                    uint32_t hot_startup_method_samples)
     : methods_(methods),
-      startup_method_samples_(startup_method_samples) {}
+      startup_method_samples_(startup_method_samples),
+      hot_startup_method_samples_(hot_startup_method_samples) {}
 
   virtual bool operator()(ObjPtr<mirror::Class> klass) REQUIRES_SHARED(Locks::mutator_lock_) {
     if (Runtime::Current()->GetHeap()->ObjectIsInBootImageSpace(klass)) {
@@ -202,7 +308,11 @@ class GetMethodsVisitor : public ClassVisitor {
           // Have samples, add to profile.
           const DexFile* dex_file =
               method.GetInterfaceMethodIfProxy(kRuntimePointerSize)->GetDexFile();
-          methods_->push_back(MethodReference(dex_file, method.GetDexMethodIndex()));
+          uint8_t flags = kProfileMethodFlagStartup;
+          if (method.GetCounter() >= hot_startup_method_samples_) {
+            flags |= kProfileMethodFlagHot;
+          }
+          methods_->emplace_back(dex_file, method.GetDexMethodIndex(), flags);
         }
       }
     }
@@ -210,8 +320,9 @@ class GetMethodsVisitor : public ClassVisitor {
   }
 
  private:
-  std::vector<MethodReference>* const methods_;
+  std::vector<ProfileMethodInfo>* const methods_;
   uint32_t startup_method_samples_;
+  uint32_t hot_startup_method_samples_;
 };
 
 void ProfileSaver::FetchAndCacheResolvedClassesAndMethods() {
@@ -220,10 +331,12 @@ void ProfileSaver::FetchAndCacheResolvedClassesAndMethods() {
   std::set<DexCacheResolvedClasses> resolved_classes =
       class_linker->GetResolvedClasses(/*ignore boot classes*/ true);
 
-  std::vector<MethodReference> methods;
+  std::vector<ProfileMethodInfo> methods;
   {
     ScopedTrace trace2("Get hot methods");
-    GetMethodsVisitor visitor(&methods, options_.GetStartupMethodSamples());
+    GetMethodsVisitor visitor(&methods,
+                              options_.GetStartupMethodSamples(),
+                              options_.GetHotStartupMethodSamples());
     ScopedObjectAccess soa(Thread::Current());
     class_linker->VisitClasses(&visitor);
     VLOG(profiler) << "Methods with samples greater than "
@@ -237,9 +350,9 @@ void ProfileSaver::FetchAndCacheResolvedClassesAndMethods() {
     const std::string& filename = it.first;
     const std::set<std::string>& locations = it.second;
     std::vector<ProfileMethodInfo> profile_methods_for_location;
-    for (const MethodReference& ref : methods) {
-      if (locations.find(ref.dex_file->GetBaseLocation()) != locations.end()) {
-        profile_methods_for_location.emplace_back(ref.dex_file, ref.dex_method_index);
+    for (const ProfileMethodInfo& method : methods) {
+      if (locations.find(method.dex_file->GetBaseLocation()) != locations.end()) {
+        profile_methods_for_location.push_back(method);
       }
     }
     for (const DexCacheResolvedClasses& classes : resolved_classes) {
@@ -252,8 +365,9 @@ void ProfileSaver::FetchAndCacheResolvedClassesAndMethods() {
                        << " (" << classes.GetDexLocation() << ")";
       }
     }
-    ProfileCompilationInfo* info = GetCachedProfiledInfo(filename);
-    info->AddMethodsAndClasses(profile_methods_for_location, resolved_classes_for_location);
+    AddToCachedProfiledInfo(filename,
+                            profile_methods_for_location,
+                            resolved_classes_for_location);
     total_number_of_profile_entries_cached += resolved_classes_for_location.size();
   }
   max_number_of_profile_entries_cached_ = std::max(
@@ -286,9 +400,16 @@ bool ProfileSaver::ProcessProfilingInfo(uint16_t* new_methods) {
       jit_code_cache_->GetProfiledMethods(locations, profile_methods);
       total_number_of_code_cache_queries_++;
     }
+    // The startup methods have been recorded by FetchAndCacheResolvedClassesAndMethods, so
+    // the methods sampled by the JIT from now on are used after startup. The code cache does
+    // not know when a method got its samples, so a startup method which still has its
+    // profiling info is also flagged as a post-startup method.
+    for (ProfileMethodInfo& method : profile_methods) {
+      method.flags |= kProfileMethodFlagPostStartup;
+    }
 
+    AddToCachedProfiledInfo(filename, profile_methods, std::set<DexCacheResolvedClasses>());
     ProfileCompilationInfo* cached_info = GetCachedProfiledInfo(filename);
-    cached_info->AddMethodsAndClasses(profile_methods, std::set<DexCacheResolvedClasses>());
     int64_t delta_number_of_methods =
         cached_info->GetNumberOfMethods() -
         static_cast<int64_t>(last_save_number_of_methods_);
@@ -306,9 +427,10 @@ bool ProfileSaver::ProcessProfilingInfo(uint16_t* new_methods) {
     }
     *new_methods = std::max(static_cast<uint16_t>(delta_number_of_methods), *new_methods);
     uint64_t bytes_written;
-    // Force the save. In case the profile data is corrupted or the the profile
-    // has the wrong version this will "fix" the file to the correct format.
-    if (cached_info->MergeAndSave(filename, &bytes_written, /*force*/ true)) {
+    // Append the new data to the journal of the profile, and compact it from time to time.
+    // In case the profile data is corrupted or the profile has the wrong version, the
+    // compaction will "fix" the file to the correct format.
+    if (WriteProfile(filename, &bytes_written)) {
       last_save_number_of_methods_ = cached_info->GetNumberOfMethods();
       last_save_number_of_classes_ = cached_info->GetNumberOfResolvedClasses();
       // Clear resolved classes. No need to store them around as
@@ -319,10 +441,6 @@ bool ProfileSaver::ProcessProfilingInfo(uint16_t* new_methods) {
         total_bytes_written_ += bytes_written;
         profile_file_saved = true;
       } else {
-        // At this point we could still have avoided the write.
-        // We load and merge the data from the file lazily at its first ever
-        // save attempt. So, whatever we are trying to save could already be
-        // in the file.
         total_number_of_skipped_writes_++;
       }
     } else {
@@ -461,6 +579,7 @@ void ProfileSaver::Stop(bool dump_info) {
 
   // Wait for the saver thread to stop.
   CHECK_PTHREAD_CALL(pthread_join, (profiler_pthread, nullptr), "profile saver thread shutdown");
+  profile_saver->CompactJournals();
 
   {
     MutexLock profiler_mutex(Thread::Current(), *Locks::profiler_lock_);
@@ -650,7 +769,19 @@ void ProfileSaver::DumpInfo(std::ostream& os) {
      << "ProfileSaver max_number_profile_entries_cached="
      << max_number_of_profile_entries_cached_ << '\n'
      << "ProfileSaver total_number_of_hot_spikes=" << total_number_of_hot_spikes_ << '\n'
-     << "ProfileSaver total_number_of_wake_ups=" << total_number_of_wake_ups_ << '\n';
+     << "ProfileSaver total_number_of_wake_ups=" << total_number_of_wake_ups_ << '\n'
+     << "ProfileSaver total_number_of_save_cycles=" << total_number_of_save_cycles_ << '\n'
+     << "ProfileSaver total_ms_of_cpu_work=" << NsToMs(total_ns_of_cpu_work_) << '\n'
+     << "ProfileSaver average_us_of_cpu_work_per_save_cycle="
+     << ((total_number_of_save_cycles_ != 0)
+            ? NsToUs(total_ns_of_cpu_work_ / total_number_of_save_cycles_)
+            : UINT64_C(0)) << '\n'
+     << "ProfileSaver max_us_of_cpu_work_per_save_cycle="
+     << NsToUs(max_ns_of_cpu_work_per_save_cycle_) << '\n'
+     << "ProfileSaver total_number_of_journal_appends="
+     << total_number_of_journal_appends_ << '\n'
+     << "ProfileSaver total_number_of_journal_compactions="
+     << total_number_of_journal_compactions_ << '\n';
 }
 
 
@@ -98,6 +98,17 @@ class ProfileSaver {
   // If no entry exists, a new empty one will be created, added to the cache and
   // then returned.
   ProfileCompilationInfo* GetCachedProfiledInfo(const std::string& filename);
+  // Adds the methods and classes to the cached profile information of the given profile file,
+  // and the ones which are not in it yet to its delta.
+  void AddToCachedProfiledInfo(const std::string& filename,
+                               const std::vector<ProfileMethodInfo>& methods,
+                               const std::set<DexCacheResolvedClasses>& classes);
+  // Writes the delta of the given profile file to its journal, and compacts the journal if
+  // needed. Returns the number of bytes written in `bytes_written`.
+  bool WriteProfile(const std::string& filename, /*out*/uint64_t* bytes_written);
+  // Merges the journals with records into their profiles, called once the saver thread stopped
+  // so that tools reading the profiles after the process exits see all of its data.
+  void CompactJournals();
   // Fetches the current resolved classes and methods from the ClassLinker and stores them in the
   // profile_cache_ for later save.
   void FetchAndCacheResolvedClassesAndMethods();
@@ -140,6 +151,12 @@ class ProfileSaver {
   // to just a few hundreds entries in the ProfileCompilationInfo objects.
   // It helps avoiding unnecessary writes to disk.
   SafeMap<std::string, ProfileCompilationInfo> profile_cache_;
+  // The methods and classes added to profile_cache_ since they were last written, for each
+  // tracked file.
+  SafeMap<std::string, ProfileCompilationInfo> profile_delta_;
+  // The number of records in the journal of each tracked file. There is no entry until the
+  // first write, which compacts the journal left by previous processes.
+  SafeMap<std::string, uint32_t> journal_records_;
 
   // Save period condition support.
   Mutex wait_lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
@@ -157,6 +174,11 @@ class ProfileSaver {
   uint64_t max_number_of_profile_entries_cached_;
   uint64_t total_number_of_hot_spikes_;
   uint64_t total_number_of_wake_ups_;
+  uint64_t total_number_of_save_cycles_;
+  uint64_t total_ns_of_cpu_work_;
+  uint64_t max_ns_of_cpu_work_per_save_cycle_;
+  uint64_t total_number_of_journal_appends_;
+  uint64_t total_number_of_journal_compactions_;
 
   const ProfileSaverOptions options_;
   DISALLOW_COPY_AND_ASSIGN(ProfileSaver);
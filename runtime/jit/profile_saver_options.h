@@ -24,6 +24,8 @@ struct ProfileSaverOptions {
   static constexpr uint32_t kSaveResolvedClassesDelayMs = 2 * 1000;  // 2 seconds
   // Minimum number of JIT samples during launch to include a method into the profile.
   static constexpr uint32_t kStartupMethodSamples = 1;
+  // Minimum number of JIT samples during launch to mark a startup method as hot.
+  static constexpr uint32_t kHotStartupMethodSamples = 256;
   static constexpr uint32_t kMinMethodsToSave = 10;
   static constexpr uint32_t kMinClassesToSave = 10;
   static constexpr uint32_t kMinNotificationBeforeWake = 10;
@@ -34,6 +36,7 @@ struct ProfileSaverOptions {
     min_save_period_ms_(kMinSavePeriodMs),
     save_resolved_classes_delay_ms_(kSaveResolvedClassesDelayMs),
     startup_method_samples_(kStartupMethodSamples),
+    hot_startup_method_samples_(kHotStartupMethodSamples),
     min_methods_to_save_(kMinMethodsToSave),
     min_classes_to_save_(kMinClassesToSave),
     min_notification_before_wake_(kMinNotificationBeforeWake),
@@ -44,6 +47,7 @@ struct ProfileSaverOptions {
       uint32_t min_save_period_ms,
       uint32_t save_resolved_classes_delay_ms,
       uint32_t startup_method_samples,
+      uint32_t hot_startup_method_samples,
       uint32_t min_methods_to_save,
       uint32_t min_classes_to_save,
       uint32_t min_notification_before_wake,
@@ -52,6 +56,7 @@ struct ProfileSaverOptions {
     min_save_period_ms_(min_save_period_ms),
     save_resolved_classes_delay_ms_(save_resolved_classes_delay_ms),
     startup_method_samples_(startup_method_samples),
+    hot_startup_method_samples_(hot_startup_method_samples),
     min_methods_to_save_(min_methods_to_save),
     min_classes_to_save_(min_classes_to_save),
     min_notification_before_wake_(min_notification_before_wake),
@@ -73,6 +78,9 @@ struct ProfileSaverOptions {
   uint32_t GetStartupMethodSamples() const {
     return startup_method_samples_;
   }
+  uint32_t GetHotStartupMethodSamples() const {
+    return hot_startup_method_samples_;
+  }
   uint32_t GetMinMethodsToSave() const {
     return min_methods_to_save_;
   }
@@ -91,6 +99,7 @@ struct ProfileSaverOptions {
         << ", min_save_period_ms_" << pso.min_save_period_ms_
         << ", save_resolved_classes_delay_ms_" << pso.save_resolved_classes_delay_ms_
         << ", startup_method_samples_" << pso.startup_method_samples_
+        << ", hot_startup_method_samples_" << pso.hot_startup_method_samples_
         << ", min_methods_to_save_" << pso.min_methods_to_save_
         << ", min_classes_to_save_" << pso.min_classes_to_save_
         << ", min_notification_before_wake_" << pso.min_notification_before_wake_
@@ -102,6 +111,7 @@ struct ProfileSaverOptions {
   uint32_t min_save_period_ms_;
   uint32_t save_resolved_classes_delay_ms_;
   uint32_t startup_method_samples_;
+  uint32_t hot_startup_method_samples_;
   uint32_t min_methods_to_save_;
   uint32_t min_classes_to_save_;
   uint32_t min_notification_before_wake_;
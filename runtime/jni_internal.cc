@@ -1763,13 +1763,7 @@ class JNI {
     if (heap->IsMovableObject(s)) {
       StackHandleScope<1> hs(soa.Self());
       HandleWrapperObjPtr<mirror::String> h(hs.NewHandleWrapper(&s));
-      if (!kUseReadBarrier) {
-        heap->IncrementDisableMovingGC(soa.Self());
-      } else {
-        // For the CC collector, we only need to wait for the thread flip rather than the whole GC
-        // to occur thanks to the to-space invariant.
-        heap->IncrementDisableThreadFlip(soa.Self());
-      }
+      heap->PinForJniCritical(soa.Self(), s);
     }
     if (s->IsCompressed()) {
       if (is_copy != nullptr) {
@@ -1797,11 +1791,7 @@ class JNI {
     gc::Heap* heap = Runtime::Current()->GetHeap();
     ObjPtr<mirror::String> s = soa.Decode<mirror::String>(java_string);
     if (heap->IsMovableObject(s)) {
-      if (!kUseReadBarrier) {
-        heap->DecrementDisableMovingGC(soa.Self());
-      } else {
-        heap->DecrementDisableThreadFlip(soa.Self());
-      }
+      heap->UnpinForJniCritical(soa.Self(), s);
     }
     if (s->IsCompressed() || (s->IsCompressed() == false && s->GetValue() != chars)) {
       delete[] chars;
@@ -1958,14 +1948,8 @@ class JNI {
     }
     gc::Heap* heap = Runtime::Current()->GetHeap();
     if (heap->IsMovableObject(array)) {
-      if (!kUseReadBarrier) {
-        heap->IncrementDisableMovingGC(soa.Self());
-      } else {
-        // For the CC collector, we only need to wait for the thread flip rather than the whole GC
-        // to occur thanks to the to-space invariant.
-        heap->IncrementDisableThreadFlip(soa.Self());
-      }
-      // Re-decode in case the object moved since IncrementDisableGC waits for GC to complete.
+      heap->PinForJniCritical(soa.Self(), array);
+      // Re-decode in case the object moved since PinForJniCritical may wait for GC to complete.
       array = soa.Decode<mirror::Array>(java_array);
     }
     if (is_copy != nullptr) {
@@ -2518,12 +2502,8 @@ class JNI {
       if (is_copy) {
         delete[] reinterpret_cast<uint64_t*>(elements);
       } else if (heap->IsMovableObject(array)) {
-        // Non copy to a movable object must means that we had disabled the moving GC.
-        if (!kUseReadBarrier) {
-          heap->DecrementDisableMovingGC(soa.Self());
-        } else {
-          heap->DecrementDisableThreadFlip(soa.Self());
-        }
+        // Non copy to a movable object must means that we had pinned it for a critical section.
+        heap->UnpinForJniCritical(soa.Self(), array);
       }
     }
   }
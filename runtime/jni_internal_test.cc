@@ -1203,6 +1203,47 @@ TEST_F(JniInternalTest, GetReleasePrimitiveArrayCriticalOfWrongType) {
   GetReleasePrimitiveArrayCriticalOfWrongType(true);
 }
 
+// A GC, moving or not, must be able to run during a critical section and must leave the array
+// in place.
+TEST_F(JniInternalTest, GetPrimitiveArrayCriticalDuringGc) {
+  static constexpr size_t kNumArrays = 16;
+  static constexpr jsize kLength = 1024;
+  std::vector<jintArray> arrays;
+  for (size_t i = 0; i != kNumArrays; ++i) {
+    // Garbage around the arrays makes their regions candidates for evacuation.
+    env_->DeleteLocalRef(env_->NewIntArray(kLength));
+    jintArray array = env_->NewIntArray(kLength);
+    ASSERT_NE(array, nullptr);
+    arrays.push_back(array);
+  }
+  // No other JNI calls are allowed until the critical sections end.
+  std::vector<jint*> elements;
+  for (size_t i = 0; i != kNumArrays; ++i) {
+    jint* data = reinterpret_cast<jint*>(env_->GetPrimitiveArrayCritical(arrays[i], nullptr));
+    ASSERT_NE(data, nullptr);
+    elements.push_back(data);
+  }
+  for (size_t gc = 0; gc != 3; ++gc) {
+    Runtime::Current()->GetHeap()->CollectGarbage(false);
+    for (size_t i = 0; i != kNumArrays; ++i) {
+      for (jsize j = 0; j != kLength; ++j) {
+        elements[i][j] = static_cast<jint>(i * kLength + j + gc);
+      }
+    }
+  }
+  for (size_t i = 0; i != kNumArrays; ++i) {
+    env_->ReleasePrimitiveArrayCritical(arrays[i], elements[i], 0);
+  }
+  Runtime::Current()->GetHeap()->CollectGarbage(false);
+  std::vector<jint> buffer(kLength);
+  for (size_t i = 0; i != kNumArrays; ++i) {
+    env_->GetIntArrayRegion(arrays[i], 0, kLength, buffer.data());
+    for (jsize j = 0; j != kLength; ++j) {
+      ASSERT_EQ(static_cast<jint>(i * kLength + j + 2), buffer[j]);
+    }
+  }
+}
+
 TEST_F(JniInternalTest, GetPrimitiveArrayRegionElementsOfWrongType) {
   GetPrimitiveArrayRegionElementsOfWrongType(false);
   GetPrimitiveArrayRegionElementsOfWrongType(true);
@@ -43,14 +43,18 @@ inline uint32_t DexCache::ClassSize(PointerSize pointer_size) {
 
 inline uint32_t DexCache::StringSlotIndex(dex::StringIndex string_idx) {
   DCHECK_LT(string_idx.index_, GetDexFile()->NumStringIds());
-  const uint32_t slot_idx = string_idx.index_ % kDexCacheStringCacheSize;
+  const uint32_t slot_idx = HashedCacheSlot(string_idx.index_, NumStrings());
   DCHECK_LT(slot_idx, NumStrings());
   return slot_idx;
 }
 
 inline String* DexCache::GetResolvedString(dex::StringIndex string_idx) {
-  return GetStrings()[StringSlotIndex(string_idx)].load(
-      std::memory_order_relaxed).GetObjectForIndex(string_idx.index_);
+  StringDexCachePair pair =
+      GetStrings()[StringSlotIndex(string_idx)].load(std::memory_order_relaxed);
+  if (kCountHashedCacheLookups) {
+    CountHashedCacheLookup(kStringCache, pair, string_idx.index_);
+  }
+  return pair.GetObjectForIndex(string_idx.index_);
 }
 
 inline void DexCache::SetResolvedString(dex::StringIndex string_idx, ObjPtr<String> resolved) {
@@ -79,7 +83,7 @@ inline void DexCache::ClearString(dex::StringIndex string_idx) {
 
 inline uint32_t DexCache::TypeSlotIndex(dex::TypeIndex type_idx) {
   DCHECK_LT(type_idx.index_, GetDexFile()->NumTypeIds());
-  const uint32_t slot_idx = type_idx.index_ % kDexCacheTypeCacheSize;
+  const uint32_t slot_idx = HashedCacheSlot(type_idx.index_, NumResolvedTypes());
   DCHECK_LT(slot_idx, NumResolvedTypes());
   return slot_idx;
 }
@@ -87,8 +91,12 @@ inline uint32_t DexCache::TypeSlotIndex(dex::TypeIndex type_idx) {
 inline Class* DexCache::GetResolvedType(dex::TypeIndex type_idx) {
   // It is theorized that a load acquire is not required since obtaining the resolved class will
   // always have an address dependency or a lock.
-  return GetResolvedTypes()[TypeSlotIndex(type_idx)].load(
-      std::memory_order_relaxed).GetObjectForIndex(type_idx.index_);
+  TypeDexCachePair pair =
+      GetResolvedTypes()[TypeSlotIndex(type_idx)].load(std::memory_order_relaxed);
+  if (kCountHashedCacheLookups) {
+    CountHashedCacheLookup(kTypeCache, pair, type_idx.index_);
+  }
+  return pair.GetObjectForIndex(type_idx.index_);
 }
 
 inline void DexCache::SetResolvedType(dex::TypeIndex type_idx, ObjPtr<Class> resolved) {
@@ -117,14 +125,18 @@ inline void DexCache::ClearResolvedType(dex::TypeIndex type_idx) {
 inline uint32_t DexCache::MethodTypeSlotIndex(uint32_t proto_idx) {
   DCHECK(Runtime::Current()->IsMethodHandlesEnabled());
   DCHECK_LT(proto_idx, GetDexFile()->NumProtoIds());
-  const uint32_t slot_idx = proto_idx % kDexCacheMethodTypeCacheSize;
+  const uint32_t slot_idx = HashedCacheSlot(proto_idx, NumResolvedMethodTypes());
   DCHECK_LT(slot_idx, NumResolvedMethodTypes());
   return slot_idx;
 }
 
 inline MethodType* DexCache::GetResolvedMethodType(uint32_t proto_idx) {
-  return GetResolvedMethodTypes()[MethodTypeSlotIndex(proto_idx)].load(
-      std::memory_order_relaxed).GetObjectForIndex(proto_idx);
+  MethodTypeDexCachePair pair =
+      GetResolvedMethodTypes()[MethodTypeSlotIndex(proto_idx)].load(std::memory_order_relaxed);
+  if (kCountHashedCacheLookups) {
+    CountHashedCacheLookup(kMethodTypeCache, pair, proto_idx);
+  }
+  return pair.GetObjectForIndex(proto_idx);
 }
 
 inline void DexCache::SetResolvedMethodType(uint32_t proto_idx, MethodType* resolved) {
@@ -279,8 +291,10 @@ inline void DexCache::FixupStrings(StringDexCacheType* dest, const Visitor& visi
     StringDexCachePair source = src[i].load(std::memory_order_relaxed);
     String* ptr = source.object.Read<kReadBarrierOption>();
     String* new_source = visitor(ptr);
-    source.object = GcRoot<String>(new_source);
-    dest[i].store(source, std::memory_order_relaxed);
+    if (dest != src || ptr != new_source) {
+      source.object = GcRoot<String>(new_source);
+      dest[i].store(source, std::memory_order_relaxed);
+    }
   }
 }
 
@@ -291,8 +305,10 @@ inline void DexCache::FixupResolvedTypes(TypeDexCacheType* dest, const Visitor&
     TypeDexCachePair source = src[i].load(std::memory_order_relaxed);
     Class* ptr = source.object.Read<kReadBarrierOption>();
     Class* new_source = visitor(ptr);
-    source.object = GcRoot<Class>(new_source);
-    dest[i].store(source, std::memory_order_relaxed);
+    if (dest != src || ptr != new_source) {
+      source.object = GcRoot<Class>(new_source);
+      dest[i].store(source, std::memory_order_relaxed);
+    }
   }
 }
 
@@ -304,8 +320,10 @@ inline void DexCache::FixupResolvedMethodTypes(MethodTypeDexCacheType* dest,
     MethodTypeDexCachePair source = src[i].load(std::memory_order_relaxed);
     MethodType* ptr = source.object.Read<kReadBarrierOption>();
     MethodType* new_source = visitor(ptr);
-    source.object = GcRoot<MethodType>(new_source);
-    dest[i].store(source, std::memory_order_relaxed);
+    if (dest != src || ptr != new_source) {
+      source.object = GcRoot<MethodType>(new_source);
+      dest[i].store(source, std::memory_order_relaxed);
+    }
   }
 }
 
@@ -316,7 +334,9 @@ inline void DexCache::FixupResolvedCallSites(GcRoot<mirror::CallSite>* dest,
   for (size_t i = 0, count = NumResolvedCallSites(); i < count; ++i) {
     mirror::CallSite* source = src[i].Read<kReadBarrierOption>();
     mirror::CallSite* new_source = visitor(source);
-    dest[i] = GcRoot<mirror::CallSite>(new_source);
+    if (dest != src || source != new_source) {
+      dest[i] = GcRoot<mirror::CallSite>(new_source);
+    }
   }
 }
 
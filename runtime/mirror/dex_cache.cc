@@ -17,6 +17,7 @@
 #include "dex_cache-inl.h"
 
 #include "art_method-inl.h"
+#include "atomic.h"
 #include "base/logging.h"
 #include "class_linker.h"
 #include "gc/accounting/card_table-inl.h"
@@ -65,14 +66,8 @@ void DexCache::InitializeDexCache(Thread* self,
   ArtField** fields = (dex_file->NumFieldIds() == 0u) ? nullptr :
       reinterpret_cast<ArtField**>(raw_arrays + layout.FieldsOffset());
 
-  size_t num_strings = mirror::DexCache::kDexCacheStringCacheSize;
-  if (dex_file->NumStringIds() < num_strings) {
-    num_strings = dex_file->NumStringIds();
-  }
-  size_t num_types = mirror::DexCache::kDexCacheTypeCacheSize;
-  if (dex_file->NumTypeIds() < num_types) {
-    num_types = dex_file->NumTypeIds();
-  }
+  const size_t num_strings = StringCacheSize(dex_file->NumStringIds());
+  const size_t num_types = TypeCacheSize(dex_file->NumTypeIds());
 
   // Note that we allocate the method type dex caches regardless of this flag,
   // and we make sure here that they're not used by the runtime. This is in the
@@ -81,13 +76,7 @@ void DexCache::InitializeDexCache(Thread* self,
   // If this needs to be mitigated in a production system running this code,
   // DexCache::kDexCacheMethodTypeCacheSize can be set to zero.
   mirror::MethodTypeDexCacheType* method_types = nullptr;
-  size_t num_method_types = 0;
-
-  if (dex_file->NumProtoIds() < mirror::DexCache::kDexCacheMethodTypeCacheSize) {
-    num_method_types = dex_file->NumProtoIds();
-  } else {
-    num_method_types = mirror::DexCache::kDexCacheMethodTypeCacheSize;
-  }
+  const size_t num_method_types = MethodTypeCacheSize(dex_file->NumProtoIds());
 
   if (num_method_types > 0) {
     method_types = reinterpret_cast<mirror::MethodTypeDexCacheType*>(
@@ -218,5 +207,36 @@ void DexCache::SetLocation(ObjPtr<mirror::String> location) {
   SetFieldObject<false>(OFFSET_OF_OBJECT_MEMBER(DexCache, location_), location);
 }
 
+// Lookup counts of the hashed caches, only updated with kCountHashedCacheLookups.
+struct HashedCacheLookupCounts {
+  Atomic<uint64_t> hits;
+  Atomic<uint64_t> misses;
+  Atomic<uint64_t> collisions;
+};
+static HashedCacheLookupCounts gHashedCacheLookupCounts[DexCache::kHashedCacheKindCount];
+
+void DexCache::CountHashedCacheLookup(HashedCacheKind kind, bool hit, bool collision) {
+  HashedCacheLookupCounts& counts = gHashedCacheLookupCounts[kind];
+  if (hit) {
+    counts.hits.FetchAndAddRelaxed(1u);
+  } else {
+    counts.misses.FetchAndAddRelaxed(1u);
+    if (collision) {
+      counts.collisions.FetchAndAddRelaxed(1u);
+    }
+  }
+}
+
+void DexCache::DumpHashedCacheStats(std::ostream& os) {
+  static const char* const kNames[kHashedCacheKindCount] = { "types", "strings", "method types" };
+  for (size_t i = 0; i != kHashedCacheKindCount; ++i) {
+    const HashedCacheLookupCounts& counts = gHashedCacheLookupCounts[i];
+    os << "Dex cache " << kNames[i]
+       << ": hits=" << counts.hits.LoadRelaxed()
+       << " misses=" << counts.misses.LoadRelaxed()
+       << " collisions=" << counts.collisions.LoadRelaxed() << "\n";
+  }
+}
+
 }  // namespace mirror
 }  // namespace art
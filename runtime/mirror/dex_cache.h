@@ -17,6 +17,9 @@
 #ifndef ART_RUNTIME_MIRROR_DEX_CACHE_H_
 #define ART_RUNTIME_MIRROR_DEX_CACHE_H_
 
+#include <algorithm>
+#include <iosfwd>
+
 #include "array.h"
 #include "base/bit_utils.h"
 #include "dex_file_types.h"
@@ -106,34 +109,70 @@ class MANAGED DexCache FINAL : public Object {
   // Size of java.lang.DexCache.class.
   static uint32_t ClassSize(PointerSize pointer_size);
 
-  // Size of type dex cache. Needs to be a power of 2 for entrypoint assumptions to hold.
+  // Default size of type dex cache. Needs to be a power of 2 for entrypoint assumptions to hold.
   static constexpr size_t kDexCacheTypeCacheSize = 1024;
   static_assert(IsPowerOfTwo(kDexCacheTypeCacheSize),
                 "Type dex cache size is not a power of 2.");
 
-  // Size of string dex cache. Needs to be a power of 2 for entrypoint assumptions to hold.
+  // Default size of string dex cache. Needs to be a power of 2 for entrypoint assumptions to hold.
   static constexpr size_t kDexCacheStringCacheSize = 1024;
   static_assert(IsPowerOfTwo(kDexCacheStringCacheSize),
                 "String dex cache size is not a power of 2.");
 
-  // Size of method type dex cache. Needs to be a power of 2 for entrypoint assumptions
+  // Default size of method type dex cache. Needs to be a power of 2 for entrypoint assumptions
   // to hold.
   static constexpr size_t kDexCacheMethodTypeCacheSize = 1024;
   static_assert(IsPowerOfTwo(kDexCacheMethodTypeCacheSize),
                 "MethodType dex cache size is not a power of 2.");
 
-  static constexpr size_t StaticTypeSize() {
-    return kDexCacheTypeCacheSize;
+  // Maximum sizes of the dex caches of large dex files.
+  static constexpr size_t kDexCacheTypeCacheMaxSize = 8 * kDexCacheTypeCacheSize;
+  static constexpr size_t kDexCacheStringCacheMaxSize = 8 * kDexCacheStringCacheSize;
+  static constexpr size_t kDexCacheMethodTypeCacheMaxSize = 4 * kDexCacheMethodTypeCacheSize;
+
+  // Set to true to count the hits, misses and collisions of the hashed dex caches. The counts are
+  // dumped on SIGQUIT and help tuning the sizes above.
+  static constexpr bool kCountHashedCacheLookups = false;
+
+  enum HashedCacheKind {
+    kTypeCache,
+    kStringCache,
+    kMethodTypeCache,
+    kHashedCacheKindCount
+  };
+
+  // Number of entries of the hashed type, string and method type caches for a dex file with
+  // `num_ids` ids. Dex files with at most `default_size` ids get an entry per id. Larger ones get a
+  // power of two that grows with a quarter of the ids, between `default_size` and `max_size`.
+  static constexpr size_t HashedCacheSize(size_t num_ids, size_t default_size, size_t max_size) {
+    return (num_ids <= default_size)
+        ? num_ids
+        : std::min(max_size, std::max(default_size, RoundUpToPowerOfTwo(num_ids) / 4u));
   }
 
-  static constexpr size_t StaticStringSize() {
-    return kDexCacheStringCacheSize;
+  static constexpr size_t TypeCacheSize(size_t num_type_ids) {
+    return HashedCacheSize(num_type_ids, kDexCacheTypeCacheSize, kDexCacheTypeCacheMaxSize);
   }
 
-  static constexpr size_t StaticMethodTypeSize() {
-    return kDexCacheMethodTypeCacheSize;
+  static constexpr size_t StringCacheSize(size_t num_string_ids) {
+    return HashedCacheSize(num_string_ids, kDexCacheStringCacheSize, kDexCacheStringCacheMaxSize);
   }
 
+  static constexpr size_t MethodTypeCacheSize(size_t num_proto_ids) {
+    return HashedCacheSize(num_proto_ids,
+                           kDexCacheMethodTypeCacheSize,
+                           kDexCacheMethodTypeCacheMaxSize);
+  }
+
+  // Slot of `idx` in a hashed cache with `cache_size` entries. The size is either a power of two
+  // or the number of ids, in which case every id has its own slot.
+  static uint32_t HashedCacheSlot(uint32_t idx, size_t cache_size) {
+    return idx & (RoundUpToPowerOfTwo(static_cast<uint32_t>(cache_size)) - 1u);
+  }
+
+  // Dump the counts collected with kCountHashedCacheLookups.
+  static void DumpHashedCacheStats(std::ostream& os);
+
   // Size of an instance of java.lang.DexCache not including referenced values.
   static constexpr uint32_t InstanceSize() {
     return sizeof(DexCache);
@@ -406,6 +445,18 @@ class MANAGED DexCache FINAL : public Object {
   void VisitReferences(ObjPtr<Class> klass, const Visitor& visitor)
       REQUIRES_SHARED(Locks::mutator_lock_) REQUIRES(Locks::heap_bitmap_lock_);
 
+  // Record a lookup in a hashed cache for kCountHashedCacheLookups. A miss is a collision if the
+  // slot holds another id.
+  template <typename T>
+  static void CountHashedCacheLookup(HashedCacheKind kind, const DexCachePair<T>& pair, uint32_t idx)
+      REQUIRES_SHARED(Locks::mutator_lock_) {
+    CountHashedCacheLookup(kind,
+                           /* hit */ pair.index == idx,
+                           /* collision */ pair.index != idx && !pair.object.IsNull());
+  }
+
+  static void CountHashedCacheLookup(HashedCacheKind kind, bool hit, bool collision);
+
   HeapReference<Object> dex_;
   HeapReference<String> location_;
   uint64_t dex_file_;               // const DexFile*
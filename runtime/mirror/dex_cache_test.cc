@@ -49,14 +49,14 @@ TEST_F(DexCacheTest, Open) {
           Runtime::Current()->GetLinearAlloc())));
   ASSERT_TRUE(dex_cache != nullptr);
 
-  EXPECT_TRUE(dex_cache->StaticStringSize() == dex_cache->NumStrings()
-      || java_lang_dex_file_->NumStringIds() == dex_cache->NumStrings());
-  EXPECT_TRUE(dex_cache->StaticTypeSize() == dex_cache->NumResolvedTypes()
-      || java_lang_dex_file_->NumTypeIds() == dex_cache->NumResolvedTypes());
+  EXPECT_EQ(DexCache::StringCacheSize(java_lang_dex_file_->NumStringIds()),
+            dex_cache->NumStrings());
+  EXPECT_EQ(DexCache::TypeCacheSize(java_lang_dex_file_->NumTypeIds()),
+            dex_cache->NumResolvedTypes());
   EXPECT_EQ(java_lang_dex_file_->NumMethodIds(), dex_cache->NumResolvedMethods());
   EXPECT_EQ(java_lang_dex_file_->NumFieldIds(),  dex_cache->NumResolvedFields());
-  EXPECT_TRUE(dex_cache->StaticMethodTypeSize() == dex_cache->NumResolvedMethodTypes()
-      || java_lang_dex_file_->NumProtoIds() == dex_cache->NumResolvedMethodTypes());
+  EXPECT_EQ(DexCache::MethodTypeCacheSize(java_lang_dex_file_->NumProtoIds()),
+            dex_cache->NumResolvedMethodTypes());
 }
 
 TEST_F(DexCacheMethodHandlesTest, Open) {
@@ -69,8 +69,28 @@ TEST_F(DexCacheMethodHandlesTest, Open) {
           *java_lang_dex_file_,
           Runtime::Current()->GetLinearAlloc())));
 
-  EXPECT_TRUE(dex_cache->StaticMethodTypeSize() == dex_cache->NumResolvedMethodTypes()
-      || java_lang_dex_file_->NumProtoIds() == dex_cache->NumResolvedMethodTypes());
+  EXPECT_EQ(DexCache::MethodTypeCacheSize(java_lang_dex_file_->NumProtoIds()),
+            dex_cache->NumResolvedMethodTypes());
+}
+
+TEST_F(DexCacheTest, HashedCacheSize) {
+  // Small dex files get an entry per id.
+  EXPECT_EQ(0u, DexCache::StringCacheSize(0u));
+  EXPECT_EQ(100u, DexCache::StringCacheSize(100u));
+  EXPECT_EQ(DexCache::kDexCacheStringCacheSize,
+            DexCache::StringCacheSize(DexCache::kDexCacheStringCacheSize));
+  // Larger ones get a power of two, at least the default size and at most the maximum size.
+  EXPECT_EQ(DexCache::kDexCacheStringCacheSize,
+            DexCache::StringCacheSize(DexCache::kDexCacheStringCacheSize + 1u));
+  EXPECT_EQ(4096u, DexCache::StringCacheSize(10000u));
+  EXPECT_EQ(DexCache::kDexCacheStringCacheMaxSize, DexCache::StringCacheSize(1000000u));
+  for (size_t num_ids : { 1u, 100u, 1024u, 1025u, 10000u, 1000000u }) {
+    const size_t cache_size = DexCache::TypeCacheSize(num_ids);
+    EXPECT_TRUE(cache_size == num_ids || IsPowerOfTwo(cache_size)) << num_ids;
+    for (uint32_t idx : { 0u, 1u, static_cast<uint32_t>(num_ids - 1u) }) {
+      EXPECT_LT(DexCache::HashedCacheSlot(idx, cache_size), cache_size) << num_ids;
+    }
+  }
 }
 
 TEST_F(DexCacheTest, LinearAlloc) {
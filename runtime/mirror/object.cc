@@ -212,7 +212,12 @@ int32_t Object::IdentityHashCode() {
         // Already inflated, return the hash stored in the monitor.
         Monitor* monitor = lw.FatLockMonitor();
         DCHECK(monitor != nullptr);
-        return monitor->GetHashCode();
+        int32_t hash_code = monitor->GetHashCode();
+        if (LIKELY(hash_code != Monitor::kHashCodeDeflating)) {
+          return hash_code;
+        }
+        // The monitor is being deflated without a hash code, retry with the new lock word.
+        break;
       }
       case LockWord::kHashCode: {
         return lw.GetHashCode();
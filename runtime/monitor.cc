@@ -16,6 +16,7 @@
 
 #include "monitor.h"
 
+#include <algorithm>
 #include <vector>
 
 #include "android-base/stringprintf.h"
@@ -28,6 +29,8 @@
 #include "class_linker.h"
 #include "dex_file-inl.h"
 #include "dex_instruction-inl.h"
+#include "gc/scoped_gc_critical_section.h"
+#include "linear_alloc.h"
 #include "lock_word-inl.h"
 #include "mirror/class-inl.h"
 #include "mirror/object-inl.h"
@@ -35,6 +38,7 @@
 #include "scoped_thread_state_change-inl.h"
 #include "thread.h"
 #include "thread_list.h"
+#include "thread_pool.h"
 #include "verifier/method_verifier.h"
 #include "well_known_classes.h"
 
@@ -44,6 +48,25 @@ using android::base::StringPrintf;
 
 static constexpr uint64_t kLongWaitMs = 100;
 
+// Spinning for a contended monitor: each check for the release of the monitor is preceded by
+// kSpinPauses CPU pause instructions, and the number of checks adapts per monitor between the
+// bounds below.
+static constexpr size_t kSpinPauses = 64;
+static constexpr uint32_t kInitialSpinLimit = 8;
+static constexpr uint32_t kMinSpinLimit = 1;
+static constexpr uint32_t kMaxSpinLimit = 64;
+
+// Number of pause instructions to spin for a thin lock before yielding the CPU.
+static constexpr size_t kThinLockSpinPauses = 256;
+
+static inline void SpinPause() {
+#if defined(__i386__) || defined(__x86_64__)
+  __builtin_ia32_pause();
+#elif defined(__arm__) || defined(__aarch64__)
+  __asm__ __volatile__("yield");
+#endif
+}
+
 /*
  * Every Object has a monitor associated with it, but not every Object is actually locked.  Even
  * the ones that are locked do not need a full-fledged monitor until a) there is actual contention
@@ -55,7 +78,8 @@ static constexpr uint64_t kLongWaitMs = 100;
  *
  * The two states of an Object's lock are referred to as "thin" and "fat".  A lock may transition
  * from the "thin" state to the "fat" state and this transition is referred to as inflation. Once
- * a lock has been inflated it remains in the "fat" state indefinitely.
+ * a lock has been inflated it remains in the "fat" state until it is deflated, either with all
+ * threads suspended or, for monitors that are idle, concurrently by the heap trimmer.
  *
  * The lock value itself is stored in mirror::Object::monitor_ and the representation is described
  * in the LockWord value type.
@@ -81,6 +105,7 @@ Monitor::Monitor(Thread* self, Thread* owner, mirror::Object* obj, int32_t hash_
     : monitor_lock_("a monitor lock", kMonitorLock),
       monitor_contenders_("monitor contenders", monitor_lock_),
       num_waiters_(0),
+      spin_limit_(kInitialSpinLimit),
       owner_(owner),
       lock_count_(0),
       obj_(GcRoot<mirror::Object>(obj)),
@@ -104,6 +129,7 @@ Monitor::Monitor(Thread* self, Thread* owner, mirror::Object* obj, int32_t hash_
     : monitor_lock_("a monitor lock", kMonitorLock),
       monitor_contenders_("monitor contenders", monitor_lock_),
       num_waiters_(0),
+      spin_limit_(kInitialSpinLimit),
       owner_(owner),
       lock_count_(0),
       obj_(GcRoot<mirror::Object>(obj)),
@@ -122,13 +148,16 @@ Monitor::Monitor(Thread* self, Thread* owner, mirror::Object* obj, int32_t hash_
 }
 
 int32_t Monitor::GetHashCode() {
-  while (!HasHashCode()) {
-    if (hash_code_.CompareExchangeWeakRelaxed(0, mirror::Object::GenerateIdentityHashCode())) {
-      break;
+  while (true) {
+    // Sequentially consistent so that DeflateIfIdle() either sees the hash code we install or we
+    // see its kHashCodeDeflating.
+    int32_t hash_code = hash_code_.LoadSequentiallyConsistent();
+    if (hash_code != 0) {
+      return hash_code;
     }
+    hash_code_.CompareExchangeWeakSequentiallyConsistent(
+        0, mirror::Object::GenerateIdentityHashCode());
   }
-  DCHECK(HasHashCode());
-  return hash_code_.LoadRelaxed();
 }
 
 bool Monitor::Install(Thread* self) {
@@ -339,24 +368,38 @@ bool Monitor::TryLockLocked(Thread* self) {
 
 bool Monitor::TryLock(Thread* self) {
   MutexLock mu(self, monitor_lock_);
+  if (UNLIKELY(obj_.IsNull())) {
+    // Deflated concurrently, the caller re-reads the lock word.
+    return false;
+  }
   return TryLockLocked(self);
 }
 
-void Monitor::Lock(Thread* self) {
+bool Monitor::Lock(Thread* self) {
   MutexLock mu(self, monitor_lock_);
+  if (UNLIKELY(obj_.IsNull())) {
+    // Deflated concurrently after the caller read the lock word.
+    return false;
+  }
   while (true) {
     if (TryLockLocked(self)) {
-      return;
+      return true;
     }
     // Contended.
     const bool log_contention = (lock_profiling_threshold_ != 0);
-    uint64_t wait_start_ms = log_contention ? MilliTime() : 0;
+    uint64_t wait_start_ns = log_contention ? NanoTime() : 0;
     ArtMethod* owners_method = locking_method_;
     uint32_t owners_dex_pc = locking_dex_pc_;
     // Do this before releasing the lock so that we don't get deflated.
     size_t num_waiters = num_waiters_;
     ++num_waiters_;
 
+    // The owner may be about to release the monitor, spin for a while before blocking.
+    if (SpinUntilUnowned(self)) {
+      --num_waiters_;
+      continue;
+    }
+
     // If systrace logging is enabled, first look at the lock owner. Acquiring the monitor's
     // lock and then re-acquiring the mutator lock can deadlock.
     bool started_trace = false;
@@ -415,7 +458,7 @@ void Monitor::Lock(Thread* self) {
           }
 
           if (original_owner_tid != 0u) {
-            uint64_t wait_ms = MilliTime() - wait_start_ms;
+            uint64_t wait_ms = NsToMs(NanoTime() - wait_start_ns);
             uint32_t sample_percent;
             if (wait_ms >= lock_profiling_threshold_) {
               sample_percent = 100;
@@ -458,11 +501,41 @@ void Monitor::Lock(Thread* self) {
       ATRACE_END();
     }
     self->SetMonitorEnterObject(nullptr);
+    if (log_contention && owners_method != nullptr) {
+      Runtime::Current()->GetMonitorList()->RecordContention(owners_method,
+                                                             owners_dex_pc,
+                                                             NanoTime() - wait_start_ns);
+    }
     monitor_lock_.Lock(self);  // Reacquire locks in order.
     --num_waiters_;
   }
 }
 
+bool Monitor::SpinUntilUnowned(Thread* self) {
+  const uint32_t spin_limit = spin_limit_;
+  bool unowned = false;
+  for (uint32_t i = 0; i != spin_limit; ++i) {
+    monitor_lock_.Unlock(self);
+    for (size_t j = 0; j != kSpinPauses; ++j) {
+      SpinPause();
+    }
+    monitor_lock_.Lock(self);
+    if (owner_ == nullptr) {
+      unowned = true;
+      break;
+    }
+    // Do not delay suspension and checkpoints, we respond to them once blocked.
+    if (self->ReadFlag(kSuspendRequest) ||
+        self->ReadFlag(kCheckpointRequest) ||
+        self->ReadFlag(kEmptyCheckpointRequest)) {
+      return false;
+    }
+  }
+  spin_limit_ = unowned ? std::min(spin_limit * 2u, kMaxSpinLimit)
+                        : std::max(spin_limit / 2u, kMinSpinLimit);
+  return unowned;
+}
+
 static void ThrowIllegalMonitorStateExceptionF(const char* fmt, ...)
                                               __attribute__((format(printf, 1, 2)));
 
@@ -818,6 +891,50 @@ bool Monitor::Deflate(Thread* self, mirror::Object* obj) {
   return true;
 }
 
+bool Monitor::DeflateIfIdle(Thread* self) {
+  MutexLock mu(self, monitor_lock_);
+  mirror::Object* obj = GetObject();
+  if (obj == nullptr) {
+    return false;  // Already deflated.
+  }
+  // num_waiters_ also counts the threads contending for the lock in Lock(), so a monitor with
+  // no owner and no waiters has no thread inside it. New lockers need monitor_lock_ to get in.
+  if (owner_ != nullptr || num_waiters_ != 0) {
+    return false;
+  }
+  // A thread in Object::IdentityHashCode() that read the fat lock word can still install a hash
+  // code in this monitor without monitor_lock_. Claim the hash code first: either that thread's
+  // hash code is kept in the new lock word, or it sees kHashCodeDeflating and re-reads the lock
+  // word.
+  int32_t hash_code = hash_code_.LoadSequentiallyConsistent();
+  if (hash_code == 0 &&
+      !hash_code_.CompareExchangeStrongSequentiallyConsistent(0, kHashCodeDeflating)) {
+    hash_code = hash_code_.LoadSequentiallyConsistent();
+  }
+  DCHECK_NE(hash_code, kHashCodeDeflating);
+  LockWord lw = obj->GetLockWord(true);
+  while (true) {
+    if (lw.GetState() != LockWord::kFatLocked || lw.FatLockMonitor() != this) {
+      if (hash_code == 0) {
+        hash_code_.StoreSequentiallyConsistent(0);
+      }
+      return false;
+    }
+    LockWord new_lw = hash_code != 0
+        ? LockWord::FromHashCode(hash_code, lw.GCState())
+        : LockWord::FromDefault(lw.GCState());
+    // The CAS can fail because of a concurrent read barrier state change, retry with the new
+    // GC state.
+    if (obj->CasLockWordWeakRelease(lw, new_lw)) {
+      break;
+    }
+    lw = obj->GetLockWord(true);
+  }
+  VLOG(monitor) << "Deflated idle monitor " << this << " of " << obj;
+  obj_ = GcRoot<mirror::Object>(nullptr);
+  return true;
+}
+
 void Monitor::Inflate(Thread* self, Thread* owner, mirror::Object* obj, int32_t hash_code) {
   DCHECK(self != nullptr);
   DCHECK(obj != nullptr);
@@ -882,6 +999,21 @@ static mirror::Object* FakeUnlock(mirror::Object* obj)
   return obj;
 }
 
+// Spin for a while for the owner of a thin lock to release it. Returns true if the lock word
+// changed.
+static bool SpinUntilThinLockChanges(mirror::Object* obj, LockWord lock_word)
+    REQUIRES_SHARED(Locks::mutator_lock_) {
+  for (size_t i = 0; i != kThinLockSpinPauses; ++i) {
+    SpinPause();
+    LockWord current = obj->GetLockWord(false);
+    if (current.GetState() != LockWord::kThinLocked ||
+        current.ThinLockOwner() != lock_word.ThinLockOwner()) {
+      return true;
+    }
+  }
+  return false;
+}
+
 mirror::Object* Monitor::MonitorEnter(Thread* self, mirror::Object* obj, bool trylock) {
   DCHECK(self != nullptr);
   DCHECK(obj != nullptr);
@@ -943,14 +1075,15 @@ mirror::Object* Monitor::MonitorEnter(Thread* self, mirror::Object* obj, bool tr
           Runtime* runtime = Runtime::Current();
           if (contention_count <= runtime->GetMaxSpinsBeforeThinLockInflation()) {
             // TODO: Consider switching the thread state to kBlocked when we are yielding.
+            // Spin first, without sched_yield: if the owner is running, the median lock hold
+            // time is expected to be hundreds of nanoseconds or less, while sched_yield either
+            // does nothing (at significant expense), or waits at least microseconds.
             // Use sched_yield instead of NanoSleep since NanoSleep can wait much longer than the
             // parameter you pass in. This can cause thread suspension to take excessively long
             // and make long pauses. See b/16307460.
-            // TODO: We should literally spin first, without sched_yield. Sched_yield either does
-            // nothing (at significant expense), or guarantees that we wait at least microseconds.
-            // If the owner is running, I would expect the median lock hold time to be hundreds
-            // of nanoseconds or less.
-            sched_yield();
+            if (!SpinUntilThinLockChanges(h_obj.Get(), lock_word)) {
+              sched_yield();
+            }
           } else {
             contention_count = 0;
             // No ordering required for initial lockword read. Install rereads it anyway.
@@ -965,11 +1098,19 @@ mirror::Object* Monitor::MonitorEnter(Thread* self, mirror::Object* obj, bool tr
         QuasiAtomic::ThreadFenceAcquire();
         Monitor* mon = lock_word.FatLockMonitor();
         if (trylock) {
-          return mon->TryLock(self) ? h_obj.Get() : nullptr;
-        } else {
-          mon->Lock(self);
+          if (mon->TryLock(self)) {
+            return h_obj.Get();  // Success!
+          }
+          LockWord new_lock_word = h_obj->GetLockWord(true);
+          if (new_lock_word.GetState() == LockWord::kFatLocked &&
+              new_lock_word.FatLockMonitor() == mon) {
+            return nullptr;  // Contended.
+          }
+          continue;  // Deflated concurrently, go again.
+        } else if (mon->Lock(self)) {
           return h_obj.Get();  // Success!
         }
+        continue;  // Deflated concurrently, go again.
       }
       case LockWord::kHashCode:
         // Inflate with the existing hashcode.
@@ -1339,7 +1480,10 @@ uint32_t Monitor::GetOwnerThreadId() {
 
 MonitorList::MonitorList()
     : allow_new_monitors_(true), monitor_list_lock_("MonitorList lock", kMonitorListLock),
-      monitor_add_condition_("MonitorList disallow condition", monitor_list_lock_) {
+      monitor_add_condition_("MonitorList disallow condition", monitor_list_lock_),
+      num_deflated_(0u),
+      num_deflated_concurrently_(0u),
+      contention_profile_lock_("Lock contention profile lock", kGenericBottomLock) {
 }
 
 MonitorList::~MonitorList() {
@@ -1436,9 +1580,127 @@ size_t MonitorList::DeflateMonitors() {
   MonitorDeflateVisitor visitor;
   Locks::mutator_lock_->AssertExclusiveHeld(visitor.self_);
   SweepMonitorList(&visitor);
+  MutexLock mu(visitor.self_, monitor_list_lock_);
+  num_deflated_ += visitor.deflate_count_;
   return visitor.deflate_count_;
 }
 
+size_t MonitorList::DeflateMonitorsConcurrently(Thread* self) {
+  Monitors deflated;
+  {
+    // Run as a mutator: lock words are swapped with a CAS that preserves the read barrier state,
+    // as when a mutator installs a monitor, so a concurrent GC needs no special handling.
+    ScopedObjectAccess soa(self);
+    MutexLock mu(self, monitor_list_lock_);
+    // DeflateIfIdle() reads the objects with a read barrier. Like Add(), wait until the GC has
+    // swept the monitor list so that the objects of dead monitors are not read and resurrected.
+    while ((!kUseReadBarrier && UNLIKELY(!allow_new_monitors_)) ||
+           (kUseReadBarrier && UNLIKELY(!self->GetWeakRefAccessEnabled()))) {
+      // Check and run the empty checkpoint before blocking so the empty checkpoint will work in
+      // the presence of threads blocking for weak ref access.
+      self->CheckEmptyCheckpointFromWeakRefAccess(&monitor_list_lock_);
+      monitor_add_condition_.WaitHoldingLocks(self);
+    }
+    for (auto it = list_.begin(); it != list_.end(); ) {
+      Monitor* m = *it;
+      if (m->DeflateIfIdle(self)) {
+        deflated.push_back(m);
+        it = list_.erase(it);
+      } else {
+        ++it;
+      }
+    }
+    num_deflated_concurrently_ += deflated.size();
+  }
+  if (deflated.empty()) {
+    return 0u;
+  }
+  // A thread that read a lock word pointing to a deflated monitor uses the monitor until it sees
+  // that it is deflated, without passing a suspend point. Wait until every thread has passed one
+  // before reusing the monitors.
+  {
+    // The empty checkpoint supports a single user at a time, keep the collector from running one
+    // meanwhile.
+    gc::ScopedGCCriticalSection gcs(self, gc::kGcCauseTrim, gc::kCollectorTypeHeapTrim);
+    Runtime::Current()->GetThreadList()->RunEmptyCheckpoint();
+  }
+  size_t count = deflated.size();
+  MonitorPool::ReleaseMonitors(self, &deflated);
+  return count;
+}
+
+void MonitorList::DumpForSigQuit(std::ostream& os) {
+  {
+    MutexLock mu(Thread::Current(), monitor_list_lock_);
+    os << "Monitors: " << list_.size() << " inflated, " << num_deflated_ << " deflated, "
+       << num_deflated_concurrently_ << " deflated concurrently\n";
+  }
+  DumpContentionProfile(os);
+}
+
+void MonitorList::RecordContention(ArtMethod* owners_method,
+                                   uint32_t owners_dex_pc,
+                                   uint64_t wait_ns) {
+  MutexLock mu(Thread::Current(), contention_profile_lock_);
+  LockSite key(owners_method, owners_dex_pc);
+  auto it = contention_profile_.find(key);
+  if (it == contention_profile_.end()) {
+    if (contention_profile_.size() == kMaxContentionProfileSites) {
+      return;
+    }
+    it = contention_profile_.emplace(key, LockSiteContention { 0u, 0u, 0u }).first;
+  }
+  LockSiteContention& contention = it->second;
+  ++contention.count;
+  contention.total_wait_ns += wait_ns;
+  contention.max_wait_ns = std::max(contention.max_wait_ns, wait_ns);
+}
+
+void MonitorList::RemoveContentionSitesIn(Thread* self, const LinearAlloc& alloc) {
+  MutexLock mu(self, contention_profile_lock_);
+  for (auto it = contention_profile_.begin(); it != contention_profile_.end(); ) {
+    if (alloc.ContainsUnsafe(it->first.first)) {
+      it = contention_profile_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+void MonitorList::DumpContentionProfile(std::ostream& os) {
+  static constexpr size_t kMaxDumpedSites = 20;
+  // Hold the mutator lock so that the class loaders of the methods are not unloaded while the
+  // sites are formatted.
+  ScopedObjectAccess soa(Thread::Current());
+  std::vector<std::pair<LockSite, LockSiteContention>> sites;
+  {
+    MutexLock mu(soa.Self(), contention_profile_lock_);
+    sites.assign(contention_profile_.begin(), contention_profile_.end());
+  }
+  if (sites.empty()) {
+    return;
+  }
+  std::sort(sites.begin(),
+            sites.end(),
+            [](const std::pair<LockSite, LockSiteContention>& lhs,
+               const std::pair<LockSite, LockSiteContention>& rhs) {
+              return lhs.second.total_wait_ns > rhs.second.total_wait_ns;
+            });
+  os << "Lock contention profile (by lock site of the owner):\n";
+  for (size_t i = 0; i != std::min(sites.size(), kMaxDumpedSites); ++i) {
+    ArtMethod* method = sites[i].first.first;
+    const LockSiteContention& contention = sites[i].second;
+    const char* filename;
+    int32_t line_number;
+    Monitor::TranslateLocation(method, sites[i].first.second, &filename, &line_number);
+    os << "  " << method->PrettyMethod() << "(" << (filename != nullptr ? filename : "null")
+       << ":" << line_number << ")"
+       << " contentions=" << contention.count
+       << " total=" << PrettyDuration(contention.total_wait_ns)
+       << " max=" << PrettyDuration(contention.max_wait_ns) << "\n";
+  }
+}
+
 MonitorInfo::MonitorInfo(mirror::Object* obj) : owner_(nullptr), entry_count_(0) {
   DCHECK(obj != nullptr);
   LockWord lock_word = obj->GetLockWord(true);
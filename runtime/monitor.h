@@ -23,6 +23,9 @@
 
 #include <iosfwd>
 #include <list>
+#include <map>
+#include <string>
+#include <utility>
 #include <vector>
 
 #include "atomic.h"
@@ -37,6 +40,7 @@
 namespace art {
 
 class ArtMethod;
+class LinearAlloc;
 class LockWord;
 template<class T> class Handle;
 class StackVisitor;
@@ -117,12 +121,19 @@ class Monitor {
     return owner_;
   }
 
+  // Value of hash_code_ while DeflateIfIdle() swaps the lock word of an object without a hash
+  // code. Identity hash codes are masked with LockWord::kHashMask so they are never negative.
+  static constexpr int32_t kHashCodeDeflating = -1;
+
+  // Returns the identity hash code, generating it if needed. Returns kHashCodeDeflating if the
+  // monitor is being deflated, the caller must then re-read the lock word of the object.
   int32_t GetHashCode();
 
   bool IsLocked() REQUIRES_SHARED(Locks::mutator_lock_) REQUIRES(!monitor_lock_);
 
   bool HasHashCode() const {
-    return hash_code_.LoadRelaxed() != 0;
+    int32_t hash_code = hash_code_.LoadSequentiallyConsistent();
+    return hash_code != 0 && hash_code != kHashCodeDeflating;
   }
 
   MonitorId GetMonitorId() const {
@@ -139,6 +150,16 @@ class Monitor {
   static bool Deflate(Thread* self, mirror::Object* obj)
       REQUIRES_SHARED(Locks::mutator_lock_) NO_THREAD_SAFETY_ANALYSIS;
 
+  // Deflate this monitor without suspending other threads, provided that it is not owned and
+  // no thread is waiting on it or contending for it. The lock word of the object is swapped
+  // with a CAS so that racing lock operations either see the monitor before it is deflated or
+  // the new lock word. Threads that have read the old lock word find the monitor deflated when
+  // they lock it and retry. The monitor must not be released before all threads have passed a
+  // suspend point. Returns true if the monitor was deflated.
+  bool DeflateIfIdle(Thread* self)
+      REQUIRES(!monitor_lock_)
+      REQUIRES_SHARED(Locks::mutator_lock_);
+
 #ifndef __LP64__
   void* operator new(size_t size) {
     // Align Monitor* as per the monitor ID field size in the lock word.
@@ -202,9 +223,18 @@ class Monitor {
       REQUIRES(monitor_lock_)
       REQUIRES_SHARED(Locks::mutator_lock_);
 
-  void Lock(Thread* self)
+  // Returns false if the monitor has been deflated concurrently, the caller must then re-read
+  // the lock word of the object.
+  bool Lock(Thread* self)
       REQUIRES(!monitor_lock_)
       REQUIRES_SHARED(Locks::mutator_lock_);
+
+  // Spin with monitor_lock_ released until the owner gives up the monitor or the spin limit of
+  // the monitor is reached, and adapt the limit to the outcome. Returns true if the monitor was
+  // seen unowned.
+  bool SpinUntilUnowned(Thread* self)
+      REQUIRES(monitor_lock_)
+      REQUIRES_SHARED(Locks::mutator_lock_);
   bool Unlock(Thread* thread)
       REQUIRES(!monitor_lock_)
       REQUIRES_SHARED(Locks::mutator_lock_);
@@ -279,6 +309,11 @@ class Monitor {
   // Number of people waiting on the condition.
   size_t num_waiters_ GUARDED_BY(monitor_lock_);
 
+  // How many times a contending thread checks for the release of the monitor before blocking.
+  // Doubled when spinning acquired the monitor and halved otherwise, so that monitors held for
+  // long stop spinning.
+  uint32_t spin_limit_ GUARDED_BY(monitor_lock_);
+
   // Which thread currently owns the lock?
   Thread* volatile owner_ GUARDED_BY(monitor_lock_);
 
@@ -331,7 +366,24 @@ class MonitorList {
   void BroadcastForNewMonitors() REQUIRES(!monitor_list_lock_);
   // Returns how many monitors were deflated.
   size_t DeflateMonitors() REQUIRES(!monitor_list_lock_) REQUIRES(Locks::mutator_lock_);
+  // Add the time a thread was blocked on a monitor held from the given lock site to the lock
+  // contention profile. Only called when lock profiling is enabled.
+  void RecordContention(ArtMethod* owners_method, uint32_t owners_dex_pc, uint64_t wait_ns)
+      REQUIRES(!contention_profile_lock_) REQUIRES_SHARED(Locks::mutator_lock_);
+  // Drop the lock sites in methods of a class loader being unloaded, called before `alloc` is
+  // deleted.
+  void RemoveContentionSitesIn(Thread* self, const LinearAlloc& alloc)
+      REQUIRES(!contention_profile_lock_);
+  // Dump the lock sites with the most blocked time, most blocked first.
+  void DumpContentionProfile(std::ostream& os)
+      REQUIRES(!contention_profile_lock_) REQUIRES(!Locks::mutator_lock_);
+  // Deflate the idle monitors without suspending all threads, see Monitor::DeflateIfIdle().
+  // The deflated monitors are released to the pool once all threads have passed a checkpoint.
+  // Returns how many monitors were deflated.
+  size_t DeflateMonitorsConcurrently(Thread* self)
+      REQUIRES(!monitor_list_lock_, !Locks::mutator_lock_);
   size_t Size() REQUIRES(!monitor_list_lock_);
+  void DumpForSigQuit(std::ostream& os) REQUIRES(!monitor_list_lock_);
 
   typedef std::list<Monitor*, TrackingAllocator<Monitor*, kAllocatorTagMonitorList>> Monitors;
 
@@ -344,6 +396,22 @@ class MonitorList {
   Mutex monitor_list_lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
   ConditionVariable monitor_add_condition_ GUARDED_BY(monitor_list_lock_);
   Monitors list_ GUARDED_BY(monitor_list_lock_);
+  // Monitors deflated with all threads suspended and concurrently, for diagnostics.
+  size_t num_deflated_ GUARDED_BY(monitor_list_lock_);
+  size_t num_deflated_concurrently_ GUARDED_BY(monitor_list_lock_);
+
+  // Blocked time aggregated by the lock site of the owner of the monitor, that is the method and
+  // dex pc where the owner acquired it. The sites are only formatted when dumped.
+  struct LockSiteContention {
+    uint64_t count;
+    uint64_t total_wait_ns;
+    uint64_t max_wait_ns;
+  };
+  static constexpr size_t kMaxContentionProfileSites = 1024;
+  Mutex contention_profile_lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
+  typedef std::pair<ArtMethod*, uint32_t> LockSite;
+  std::map<LockSite, LockSiteContention> contention_profile_
+      GUARDED_BY(contention_profile_lock_);
 
   friend class Monitor;
   DISALLOW_COPY_AND_ASSIGN(MonitorList);
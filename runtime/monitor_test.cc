@@ -427,5 +427,72 @@ TEST_F(MonitorTest, TestTryLock) {
   thread_pool.StopWorkers(self);
 }
 
+TEST_F(MonitorTest, DeflateMonitorsConcurrently) {
+  Thread* const self = Thread::Current();
+  ScopedObjectAccess soa(self);
+  StackHandleScope<2> hs(self);
+  Handle<mirror::Object> idle(
+      hs.NewHandle<mirror::Object>(mirror::String::AllocFromModifiedUtf8(self, "idle")));
+  Handle<mirror::Object> held(
+      hs.NewHandle<mirror::Object>(mirror::String::AllocFromModifiedUtf8(self, "held")));
+
+  // Hashing a thin locked object inflates its lock.
+  int32_t hash_code;
+  {
+    ObjectLock<mirror::Object> lock(self, idle);
+    hash_code = idle->IdentityHashCode();
+  }
+  ASSERT_EQ(LockWord::kFatLocked, idle->GetLockWord(true).GetState());
+  ObjectLock<mirror::Object> held_lock(self, held);
+  held->IdentityHashCode();
+  ASSERT_EQ(LockWord::kFatLocked, held->GetLockWord(true).GetState());
+
+  size_t count;
+  {
+    ScopedThreadSuspension sts(self, kSuspended);
+    count = Runtime::Current()->GetMonitorList()->DeflateMonitorsConcurrently(self);
+  }
+  EXPECT_GE(count, 1u);
+  // The idle monitor is deflated and keeps its hash code, the held one is untouched.
+  LockWord idle_lock_word = idle->GetLockWord(true);
+  ASSERT_EQ(LockWord::kHashCode, idle_lock_word.GetState());
+  EXPECT_EQ(hash_code, idle_lock_word.GetHashCode());
+  EXPECT_EQ(hash_code, idle->IdentityHashCode());
+  EXPECT_EQ(LockWord::kFatLocked, held->GetLockWord(true).GetState());
+
+  // The object can still be locked.
+  {
+    ObjectLock<mirror::Object> lock(self, idle);
+    EXPECT_EQ(self->GetThreadId(), Monitor::GetLockOwnerThreadId(idle.Get()));
+  }
+}
+
+TEST_F(MonitorTest, DeflateIfIdleWithoutHashCode) {
+  Thread* const self = Thread::Current();
+  ScopedObjectAccess soa(self);
+  StackHandleScope<1> hs(self);
+  Handle<mirror::Object> obj(
+      hs.NewHandle<mirror::Object>(mirror::String::AllocFromModifiedUtf8(self, "obj")));
+
+  // Inflate without a hash code.
+  {
+    ObjectLock<mirror::Object> lock(self, obj);
+    Monitor::InflateThinLocked(self, obj, obj->GetLockWord(true), 0);
+  }
+  LockWord lock_word = obj->GetLockWord(true);
+  ASSERT_EQ(LockWord::kFatLocked, lock_word.GetState());
+  Monitor* monitor = lock_word.FatLockMonitor();
+  ASSERT_FALSE(monitor->HasHashCode());
+
+  // A thread that read the fat lock word before the deflation must not get a hash code from the
+  // deflated monitor, the new lock word does not keep it.
+  ASSERT_TRUE(monitor->DeflateIfIdle(self));
+  EXPECT_EQ(LockWord::kUnlocked, obj->GetLockWord(true).GetState());
+  EXPECT_EQ(Monitor::kHashCodeDeflating, monitor->GetHashCode());
+  int32_t hash_code = obj->IdentityHashCode();
+  LockWord hash_lock_word = obj->GetLockWord(true);
+  ASSERT_EQ(LockWord::kHashCode, hash_lock_word.GetState());
+  EXPECT_EQ(hash_code, static_cast<int32_t>(hash_lock_word.GetHashCode()));
+}
 
 }  // namespace art
@@ -106,6 +106,9 @@ static jlongArray ConvertDexFilesToJavaArray(JNIEnv* env,
     dex_file.release();
   }
 
+  // Classes previously not found may be defined by class loaders using these dex files.
+  Runtime::Current()->GetClassLinker()->IncrementClassPathGeneration();
+
   return long_array;
 }
 
@@ -281,6 +281,14 @@ std::unique_ptr<RuntimeParser> ParsedOptions::MakeParser(bool ignore_unrecognize
       .Define("-Xzygote-max-boot-retry=_")
           .WithType<unsigned int>()
           .IntoKey(M::ZygoteMaxFailedBoots)
+      .Define("-XX:StartupClassPreloadThreads=_")
+          .WithType<unsigned int>()
+          .IntoKey(M::StartupClassPreloadThreads)
+      .Define("-XX:BackgroundVerificationThreads=_")
+          .WithType<unsigned int>()
+          .IntoKey(M::BackgroundVerificationThreads)
+      .Define("-XX:RecordVerifierDeps")
+          .IntoKey(M::RecordVerifierDeps)
       .Define("-Xno-dex-file-fallback")
           .IntoKey(M::NoDexFileFallback)
       .Define("-Xno-sig-chain")
@@ -686,6 +694,9 @@ void ParsedOptions::Usage(const char* fmt, ...) {
   UsageMessage(stream, "  -XX:+DisableExplicitGC\n");
   UsageMessage(stream, "  -XX:ParallelGCThreads=integervalue\n");
   UsageMessage(stream, "  -XX:ConcGCThreads=integervalue\n");
+  UsageMessage(stream, "  -XX:StartupClassPreloadThreads=integervalue\n");
+  UsageMessage(stream, "  -XX:BackgroundVerificationThreads=integervalue\n");
+  UsageMessage(stream, "  -XX:RecordVerifierDeps\n");
   UsageMessage(stream, "  -XX:MaxSpinsBeforeThinLockInflation=integervalue\n");
   UsageMessage(stream, "  -XX:LongPauseLogThreshold=integervalue\n");
   UsageMessage(stream, "  -XX:LongGCLogThreshold=integervalue\n");
@@ -704,6 +715,7 @@ void ParsedOptions::Usage(const char* fmt, ...) {
   UsageMessage(stream, "  -Xps-min-save-period-ms:integervalue\n");
   UsageMessage(stream, "  -Xps-save-resolved-classes-delay-ms:integervalue\n");
   UsageMessage(stream, "  -Xps-startup-method-samples:integervalue\n");
+  UsageMessage(stream, "  -Xps-hot-startup-method-samples:integervalue\n");
   UsageMessage(stream, "  -Xps-min-methods-to-save:integervalue\n");
   UsageMessage(stream, "  -Xps-min-classes-to-save:integervalue\n");
   UsageMessage(stream, "  -Xps-min-notification-before-wake:integervalue\n");
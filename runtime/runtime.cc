@@ -58,6 +58,7 @@
 #include "art_method-inl.h"
 #include "asm_support.h"
 #include "atomic.h"
+#include "background_verifier.h"
 #include "base/arena_allocator.h"
 #include "base/dumpable.h"
 #include "base/enums.h"
@@ -66,6 +67,7 @@
 #include "base/unix_file/fd_file.h"
 #include "cha.h"
 #include "class_linker-inl.h"
+#include "class_preloader.h"
 #include "compiler_callbacks.h"
 #include "debugger.h"
 #include "elf_file.h"
@@ -154,6 +156,7 @@
 #include "utils.h"
 #include "vdex_file.h"
 #include "verifier/method_verifier.h"
+#include "verifier/verifier_deps_recorder.h"
 #include "well_known_classes.h"
 
 #ifdef ART_TARGET_ANDROID
@@ -248,6 +251,10 @@ Runtime::Runtime()
       is_native_debuggable_(false),
       is_java_debuggable_(false),
       zygote_max_failed_boots_(0),
+      startup_class_preload_threads_(0u),
+      class_preloader_(nullptr),
+      background_verification_threads_(0u),
+      record_verifier_deps_(false),
       experimental_flags_(ExperimentalFlags::kNone),
       oat_file_manager_(nullptr),
       is_low_memory_mode_(false),
@@ -306,6 +313,11 @@ Runtime::~Runtime() {
 
   Trace::Shutdown();
 
+  if (verifier_deps_recorder_ != nullptr) {
+    // Write the dependencies of the classes verified since the profile saver last wrote them.
+    verifier_deps_recorder_->Save(self);
+  }
+
   // Report death. Clients me require a working thread, still, so do it before GC completes and
   // all non-daemon threads are done.
   {
@@ -330,6 +342,13 @@ Runtime::~Runtime() {
     // Similarly, stop the profile saver thread before deleting the thread list.
     jit_->StopProfileSaver();
   }
+  ClassPreloader* const class_preloader = GetClassPreloader();
+  if (class_preloader != nullptr) {
+    class_preloader->Stop(self);
+  }
+  if (background_verifier_ != nullptr) {
+    background_verifier_->Stop(self);
+  }
 
   // TODO Maybe do some locking.
   for (auto& agent : agents_) {
@@ -350,6 +369,8 @@ Runtime::~Runtime() {
     ScopedTrace trace2("Delete thread list");
     delete thread_list_;
   }
+  // Delete the class preloader after the thread list, the threads registering dex files use it.
+  delete class_preloader;
   // Delete the JIT after thread list to ensure that there is no remaining threads which could be
   // accessing the instrumentation when we delete it.
   if (jit_ != nullptr) {
@@ -798,6 +819,13 @@ void Runtime::InitNonZygoteOrPostFork(
 
   // Create the thread pools.
   heap_->CreateThreadPool();
+  if (background_verification_threads_ != 0u &&
+      background_verifier_ == nullptr &&
+      !IsAotCompiler() &&
+      IsVerificationEnabled()) {
+    // Not in the zygote, which cannot have threads when forking.
+    background_verifier_.reset(new BackgroundVerifier(background_verification_threads_));
+  }
   // Reset the gc performance data at zygote fork so that the GCs
   // before fork aren't attributed to an app.
   heap_->ResetGcPerformanceInfo();
@@ -1067,6 +1095,10 @@ bool Runtime::Init(RuntimeArgumentMap&& runtime_options_in) {
   }
 
   zygote_max_failed_boots_ = runtime_options.GetOrDefault(Opt::ZygoteMaxFailedBoots);
+  startup_class_preload_threads_ = runtime_options.GetOrDefault(Opt::StartupClassPreloadThreads);
+  background_verification_threads_ =
+      runtime_options.GetOrDefault(Opt::BackgroundVerificationThreads);
+  record_verifier_deps_ = runtime_options.Exists(Opt::RecordVerifierDeps);
   experimental_flags_ = runtime_options.GetOrDefault(Opt::Experimental);
   is_low_memory_mode_ = runtime_options.Exists(Opt::LowMemoryMode);
 
@@ -1570,7 +1602,18 @@ void Runtime::DumpForSigQuit(std::ostream& os) {
   GetInternTable()->DumpForSigQuit(os);
   GetJavaVM()->DumpForSigQuit(os);
   GetHeap()->DumpForSigQuit(os);
+  GetMonitorList()->DumpForSigQuit(os);
   oat_file_manager_->DumpForSigQuit(os);
+  ClassPreloader* const class_preloader = GetClassPreloader();
+  if (class_preloader != nullptr) {
+    class_preloader->DumpForSigQuit(os);
+  }
+  if (background_verifier_ != nullptr) {
+    background_verifier_->DumpForSigQuit(os);
+  }
+  if (verifier_deps_recorder_ != nullptr) {
+    verifier_deps_recorder_->DumpForSigQuit(os);
+  }
   if (GetJit() != nullptr) {
     GetJit()->DumpForSigQuit(os);
   } else {
@@ -1966,6 +2009,35 @@ void Runtime::RegisterAppInfo(const std::vector<std::string>& code_paths,
                               const std::string& profile_output_filename,
                               const std::string& foreign_dex_profile_path,
                               const std::string& app_dir) {
+  if (startup_class_preload_threads_ != 0u &&
+      GetClassPreloader() == nullptr &&
+      !profile_output_filename.empty() &&
+      !code_paths.empty() &&
+      FileExists(profile_output_filename)) {
+    // Preloading starts once the app's class loader registers one of the code paths. Publish the
+    // preloader with a release store, the threads registering dex files, SIGQUIT dumps and the
+    // shutdown read it without a lock.
+    std::unique_ptr<ClassPreloader> class_preloader(
+        new ClassPreloader(profile_output_filename, code_paths, startup_class_preload_threads_));
+    if (class_preloader_.CompareExchangeStrongSequentiallyConsistent(nullptr,
+                                                                     class_preloader.get())) {
+      class_preloader.release();
+    } else {
+      // Another call published a preloader first.
+      class_preloader->Stop(Thread::Current());
+    }
+  }
+
+  if (record_verifier_deps_ &&
+      verifier_deps_recorder_ == nullptr &&
+      IsVerificationEnabled() &&
+      !profile_output_filename.empty() &&
+      !code_paths.empty()) {
+    // Recording starts once the app's class loader registers one of the code paths.
+    verifier_deps_recorder_.reset(
+        new verifier::VerifierDepsRecorder(profile_output_filename, code_paths));
+  }
+
   if (jit_.get() == nullptr) {
     // We are not JITing. Nothing to do.
     return;
@@ -27,6 +27,7 @@
 #include <vector>
 
 #include "arch/instruction_set.h"
+#include "atomic.h"
 #include "base/macros.h"
 #include "base/mutex.h"
 #include "dex_file_types.h"
@@ -72,12 +73,15 @@ namespace ti {
 }  // namespace ti
 namespace verifier {
   class MethodVerifier;
+  class VerifierDepsRecorder;
   enum class VerifyMode : int8_t;
 }  // namespace verifier
 class ArenaPool;
 class ArtMethod;
+class BackgroundVerifier;
 class ClassHierarchyAnalysis;
 class ClassLinker;
+class ClassPreloader;
 class Closure;
 class CompilerCallbacks;
 class DexFile;
@@ -542,6 +546,21 @@ class Runtime {
     return zygote_max_failed_boots_;
   }
 
+  // Returns null unless startup class preloading was requested and the app has a profile.
+  ClassPreloader* GetClassPreloader() const {
+    return class_preloader_.LoadAcquire();
+  }
+
+  // Returns null unless background verification was requested.
+  BackgroundVerifier* GetBackgroundVerifier() const {
+    return background_verifier_.get();
+  }
+
+  // Returns null unless recording verifier dependencies was requested and the app has a profile.
+  verifier::VerifierDepsRecorder* GetVerifierDepsRecorder() const {
+    return verifier_deps_recorder_.get();
+  }
+
   bool AreExperimentalFlagsEnabled(ExperimentalFlags flags) {
     return (experimental_flags_ & flags) != ExperimentalFlags::kNone;
   }
@@ -871,6 +890,19 @@ class Runtime {
   // zygote.
   uint32_t zygote_max_failed_boots_;
 
+  // Number of threads loading the classes of the app's profile at startup, 0 when disabled.
+  uint32_t startup_class_preload_threads_;
+  // Set once by RegisterAppInfo() and read without a lock, owned by the runtime.
+  Atomic<ClassPreloader*> class_preloader_;
+
+  // Number of threads verifying the classes of newly registered dex files, 0 when disabled.
+  uint32_t background_verification_threads_;
+  std::unique_ptr<BackgroundVerifier> background_verifier_;
+
+  // Whether to record the verifier dependencies of apps verified at runtime next to their profile.
+  bool record_verifier_deps_;
+  std::unique_ptr<verifier::VerifierDepsRecorder> verifier_deps_recorder_;
+
   // Enable experimental opcodes that aren't fully specified yet. The intent is to
   // eventually publish them as public-usable opcodes, but they aren't ready yet.
   //
@@ -1943,6 +1943,7 @@ Thread::Thread(bool daemon)
       wait_monitor_(nullptr),
       interrupted_(false),
       custom_tls_(nullptr),
+      recorded_verifier_deps_(nullptr),
       can_call_into_java_(true) {
   wait_mutex_ = new Mutex("a thread wait mutex");
   wait_cond_ = new ConditionVariable("a thread wait condition variable", *wait_mutex_);
@@ -37,6 +37,7 @@
 #include "globals.h"
 #include "handle_scope.h"
 #include "instrumentation.h"
+#include "interpreter/interpreter_cache.h"
 #include "jvalue.h"
 #include "object_callbacks.h"
 #include "offsets.h"
@@ -1161,6 +1162,23 @@ class Thread {
     custom_tls_ = data;
   }
 
+  // Runtime counterpart of GetVerifierDeps(). The AOT compiler shares the entry of the stack
+  // trace sample, which is also used by the sampling profiler at runtime.
+  verifier::VerifierDeps* GetRecordedVerifierDeps() const {
+    DCHECK(!IsAotCompiler());
+    return recorded_verifier_deps_;
+  }
+
+  void SetRecordedVerifierDeps(verifier::VerifierDeps* verifier_deps) {
+    DCHECK(!IsAotCompiler());
+    DCHECK(verifier_deps == nullptr || recorded_verifier_deps_ == nullptr);
+    recorded_verifier_deps_ = verifier_deps;
+  }
+
+  InterpreterCache* GetInterpreterCache() {
+    return &interpreter_cache_;
+  }
+
   // Returns true if the current thread is the jit sensitive thread.
   bool IsJitSensitiveThread() const {
     return this == jit_sensitive_thread_;
@@ -1643,10 +1661,17 @@ class Thread {
   // TODO: Generalize once we have more plugins.
   const void* custom_tls_;
 
+  // Per-thread VerifierDeps of the runtime verifier::VerifierDepsRecorder, only set while the
+  // method verifier runs for a class it records.
+  verifier::VerifierDeps* recorded_verifier_deps_;
+
   // True if the thread is allowed to call back into java (for e.g. during class resolution).
   // By default this is true.
   bool can_call_into_java_;
 
+  // Fields and methods resolved by the interpreter, indexed by dex instruction.
+  InterpreterCache interpreter_cache_;
+
   friend class Dbg;  // For SetStateUnsafe.
   friend class gc::collector::SemiSpace;  // For getting stack traces.
   friend class Runtime;  // For CreatePeer.
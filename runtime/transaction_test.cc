@@ -580,6 +580,60 @@ TEST_F(TransactionTest, StaticFieldClass) {
   ASSERT_FALSE(soa.Self()->IsExceptionPending());
 }
 
+// Tests that a rolled back class initialization does not leave the interpreter with a static field
+// of a class initialized by the transaction, whose class initializer would not run again.
+TEST_F(TransactionTest, StaticFieldReadAbortClass) {
+  ScopedObjectAccess soa(Thread::Current());
+  StackHandleScope<3> hs(soa.Self());
+  Handle<mirror::ClassLoader> class_loader(
+      hs.NewHandle(soa.Decode<mirror::ClassLoader>(LoadDex("Transaction"))));
+  ASSERT_TRUE(class_loader != nullptr);
+
+  MutableHandle<mirror::Class> h_klass(
+      hs.NewHandle(class_linker_->FindSystemClass(soa.Self(),
+                                                  "Ljava/lang/ExceptionInInitializerError;")));
+  ASSERT_TRUE(h_klass != nullptr);
+  class_linker_->EnsureInitialized(soa.Self(), h_klass, true, true);
+  ASSERT_TRUE(h_klass->IsInitialized());
+  h_klass.Assign(class_linker_->FindSystemClass(soa.Self(), Transaction::kAbortExceptionSignature));
+  ASSERT_TRUE(h_klass != nullptr);
+  class_linker_->EnsureInitialized(soa.Self(), h_klass, true, true);
+  ASSERT_TRUE(h_klass->IsInitialized());
+  h_klass.Assign(class_linker_->FindClass(soa.Self(), "LTransaction$AbortHelperClass;",
+                                          class_loader));
+  ASSERT_TRUE(h_klass != nullptr);
+  class_linker_->VerifyClass(soa.Self(), h_klass);
+  ASSERT_TRUE(h_klass->IsVerified());
+
+  Handle<mirror::Class> h_field_klass(
+      hs.NewHandle(class_linker_->FindClass(soa.Self(), "LTransaction$StaticFieldClass;",
+                                            class_loader)));
+  ASSERT_TRUE(h_field_klass != nullptr);
+  class_linker_->VerifyClass(soa.Self(), h_field_klass);
+  ASSERT_TRUE(h_field_klass->IsVerified());
+  h_klass.Assign(class_linker_->FindClass(soa.Self(), "LTransaction$StaticFieldReadAbortClass;",
+                                          class_loader));
+  ASSERT_TRUE(h_klass != nullptr);
+  class_linker_->VerifyClass(soa.Self(), h_klass);
+  ASSERT_TRUE(h_klass->IsVerified());
+
+  // Both attempts abort, the second one must still initialize StaticFieldClass.
+  for (size_t i = 0; i != 2u; ++i) {
+    Transaction transaction;
+    Runtime::Current()->EnterTransactionMode(&transaction);
+    bool success = class_linker_->EnsureInitialized(soa.Self(), h_klass, true, true);
+    Runtime::Current()->ExitTransactionMode();
+    ASSERT_FALSE(success);
+    ASSERT_TRUE(transaction.IsAborted());
+    EXPECT_TRUE(h_field_klass->IsInitialized()) << i;
+
+    soa.Self()->ClearException();
+    transaction.Rollback();
+    ASSERT_TRUE(h_klass->IsVerified());
+    ASSERT_FALSE(h_field_klass->IsInitialized());
+  }
+}
+
 // Tests failing class initialization due to native call.
 TEST_F(TransactionTest, NativeCallAbortClass) {
   testTransactionAbort("LTransaction$NativeCallAbortClass;");
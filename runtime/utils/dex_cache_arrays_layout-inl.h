@@ -70,17 +70,8 @@ constexpr PointerSize GcRootAsPointerSize() {
   return PointerSize::k32;
 }
 
-inline size_t DexCacheArraysLayout::TypeOffset(dex::TypeIndex type_idx) const {
-  return types_offset_ + ElementOffset(PointerSize::k64,
-                                       type_idx.index_ % mirror::DexCache::kDexCacheTypeCacheSize);
-}
-
 inline size_t DexCacheArraysLayout::TypesSize(size_t num_elements) const {
-  size_t cache_size = mirror::DexCache::kDexCacheTypeCacheSize;
-  if (num_elements < cache_size) {
-    cache_size = num_elements;
-  }
-  return ArraySize(PointerSize::k64, cache_size);
+  return ArraySize(PointerSize::k64, mirror::DexCache::TypeCacheSize(num_elements));
 }
 
 inline size_t DexCacheArraysLayout::TypesAlignment() const {
@@ -99,17 +90,8 @@ inline size_t DexCacheArraysLayout::MethodsAlignment() const {
   return static_cast<size_t>(pointer_size_);
 }
 
-inline size_t DexCacheArraysLayout::StringOffset(uint32_t string_idx) const {
-  return strings_offset_ + ElementOffset(PointerSize::k64,
-                                         string_idx % mirror::DexCache::kDexCacheStringCacheSize);
-}
-
 inline size_t DexCacheArraysLayout::StringsSize(size_t num_elements) const {
-  size_t cache_size = mirror::DexCache::kDexCacheStringCacheSize;
-  if (num_elements < cache_size) {
-    cache_size = num_elements;
-  }
-  return ArraySize(PointerSize::k64, cache_size);
+  return ArraySize(PointerSize::k64, mirror::DexCache::StringCacheSize(num_elements));
 }
 
 inline size_t DexCacheArraysLayout::StringsAlignment() const {
@@ -131,12 +113,7 @@ inline size_t DexCacheArraysLayout::FieldsAlignment() const {
 }
 
 inline size_t DexCacheArraysLayout::MethodTypesSize(size_t num_elements) const {
-  size_t cache_size = mirror::DexCache::kDexCacheMethodTypeCacheSize;
-  if (num_elements < cache_size) {
-    cache_size = num_elements;
-  }
-
-  return ArraySize(PointerSize::k64, cache_size);
+  return ArraySize(PointerSize::k64, mirror::DexCache::MethodTypeCacheSize(num_elements));
 }
 
 inline size_t DexCacheArraysLayout::MethodTypesAlignment() const {
@@ -63,8 +63,6 @@ class DexCacheArraysLayout {
     return types_offset_;
   }
 
-  size_t TypeOffset(dex::TypeIndex type_idx) const;
-
   size_t TypesSize(size_t num_elements) const;
 
   size_t TypesAlignment() const;
@@ -83,8 +81,6 @@ class DexCacheArraysLayout {
     return strings_offset_;
   }
 
-  size_t StringOffset(uint32_t string_idx) const;
-
   size_t StringsSize(size_t num_elements) const;
 
   size_t StringsAlignment() const;
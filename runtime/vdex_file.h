@@ -45,6 +45,7 @@ class VdexFile {
    public:
     Header(uint32_t number_of_dex_files_,
            uint32_t dex_size,
+           uint32_t shared_dex_data_size,
            uint32_t verifier_deps_size,
            uint32_t quickening_info_size);
 
@@ -55,18 +56,22 @@ class VdexFile {
     bool IsValid() const { return IsMagicValid() && IsVersionValid(); }
 
     uint32_t GetDexSize() const { return dex_size_; }
+    uint32_t GetSharedDexDataSize() const { return shared_dex_data_size_; }
     uint32_t GetVerifierDepsSize() const { return verifier_deps_size_; }
     uint32_t GetQuickeningInfoSize() const { return quickening_info_size_; }
     uint32_t GetNumberOfDexFiles() const { return number_of_dex_files_; }
 
    private:
     static constexpr uint8_t kVdexMagic[] = { 'v', 'd', 'e', 'x' };
-    static constexpr uint8_t kVdexVersion[] = { '0', '0', '3', '\0' };  // Remove verify-profile
+    // Last update: Add shared dex data section.
+    static constexpr uint8_t kVdexVersion[] = { '0', '0', '4', '\0' };
 
     uint8_t magic_[4];
     uint8_t version_[4];
     uint32_t number_of_dex_files_;
+    // Size of the dex section, including the shared dex data section at its end.
     uint32_t dex_size_;
+    uint32_t shared_dex_data_size_;
     uint32_t verifier_deps_size_;
     uint32_t quickening_info_size_;
   };
@@ -95,6 +100,16 @@ class VdexFile {
     return *reinterpret_cast<const Header*>(Begin());
   }
 
+  // The data shared by the dex files, placed after the last one. The dex files refer to it with
+  // offsets beyond their end, so they can only be used in place.
+  ArrayRef<const uint8_t> GetSharedDexData() const {
+    return ArrayRef<const uint8_t>(DexEnd(), GetHeader().GetSharedDexDataSize());
+  }
+
+  bool HasSharedDexData() const {
+    return GetHeader().GetSharedDexDataSize() != 0;
+  }
+
   ArrayRef<const uint8_t> GetVerifierDepsData() const {
     return ArrayRef<const uint8_t>(
         DexBegin() + GetHeader().GetDexSize(), GetHeader().GetVerifierDepsSize());
@@ -133,8 +148,9 @@ class VdexFile {
     return Begin() + sizeof(Header) + GetSizeOfChecksumsSection();
   }
 
+  // End of the dex files, and start of the shared dex data.
   const uint8_t* DexEnd() const {
-    return DexBegin() + GetHeader().GetDexSize();
+    return DexBegin() + GetHeader().GetDexSize() - GetHeader().GetSharedDexDataSize();
   }
 
   size_t GetSizeOfChecksumsSection() const {
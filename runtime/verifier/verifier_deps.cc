@@ -16,7 +16,9 @@
 
 #include "verifier_deps.h"
 
+#include <algorithm>
 #include <cstring>
+#include <limits>
 
 #include "base/stl_util.h"
 #include "compiler_callbacks.h"
@@ -24,6 +26,7 @@
 #include "mirror/class-inl.h"
 #include "obj_ptr-inl.h"
 #include "runtime.h"
+#include "verifier_deps_recorder.h"
 
 namespace art {
 namespace verifier {
@@ -163,7 +166,9 @@ static inline VerifierDeps* GetMainVerifierDeps() {
   // end of verification will have all the per-thread VerifierDeps merged into it.
   CompilerCallbacks* callbacks = Runtime::Current()->GetCompilerCallbacks();
   if (callbacks == nullptr) {
-    return nullptr;
+    // At runtime, the per-thread VerifierDeps are merged into the one of the recorder.
+    VerifierDepsRecorder* recorder = Runtime::Current()->GetVerifierDepsRecorder();
+    return (recorder != nullptr) ? recorder->GetMainVerifierDeps() : nullptr;
   }
   return callbacks->GetVerifierDeps();
 }
@@ -171,8 +176,9 @@ static inline VerifierDeps* GetMainVerifierDeps() {
 static inline VerifierDeps* GetThreadLocalVerifierDeps() {
   // During AOT, each thread has its own VerifierDeps, to avoid lock contention. At the end
   // of full verification, these VerifierDeps will be merged into the main one.
+  // At runtime, the VerifierDepsRecorder sets them while verifying the classes it records.
   if (!Runtime::Current()->IsAotCompiler()) {
-    return nullptr;
+    return Thread::Current()->GetRecordedVerifierDeps();
   }
   return Thread::Current()->GetVerifierDeps();
 }
@@ -677,6 +683,123 @@ static inline void DecodeStringVector(const uint8_t** in,
   }
 }
 
+// Decoding functions for data that may be corrupt. They return false instead of reading past
+// `end` or truncating values.
+
+template<typename T> inline bool DecodeChecked(uint32_t in, T* out);
+
+template<> inline bool DecodeChecked<uint16_t>(uint32_t in, uint16_t* out) {
+  *out = static_cast<uint16_t>(in);
+  return in <= std::numeric_limits<uint16_t>::max();
+}
+template<> inline bool DecodeChecked<uint32_t>(uint32_t in, uint32_t* out) {
+  *out = in;
+  return true;
+}
+template<> inline bool DecodeChecked<dex::TypeIndex>(uint32_t in, dex::TypeIndex* out) {
+  *out = dex::TypeIndex(static_cast<uint16_t>(in));
+  return in <= std::numeric_limits<uint16_t>::max();
+}
+template<> inline bool DecodeChecked<dex::StringIndex>(uint32_t in, dex::StringIndex* out) {
+  *out = dex::StringIndex(in);
+  return true;
+}
+
+template<typename T>
+static inline bool DecodeValueChecked(const uint8_t** in, const uint8_t* end, T* out) {
+  uint32_t value;
+  return DecodeUnsignedLeb128Checked(in, end, &value) && DecodeChecked<T>(value, out);
+}
+
+template<typename T1, typename T2>
+static inline bool DecodeTupleChecked(const uint8_t** in,
+                                      const uint8_t* end,
+                                      std::tuple<T1, T2>* t) {
+  T1 v1;
+  T2 v2;
+  if (!DecodeValueChecked(in, end, &v1) || !DecodeValueChecked(in, end, &v2)) {
+    return false;
+  }
+  *t = std::make_tuple(v1, v2);
+  return true;
+}
+
+template<typename T1, typename T2, typename T3>
+static inline bool DecodeTupleChecked(const uint8_t** in,
+                                      const uint8_t* end,
+                                      std::tuple<T1, T2, T3>* t) {
+  T1 v1;
+  T2 v2;
+  T3 v3;
+  if (!DecodeValueChecked(in, end, &v1) ||
+      !DecodeValueChecked(in, end, &v2) ||
+      !DecodeValueChecked(in, end, &v3)) {
+    return false;
+  }
+  *t = std::make_tuple(v1, v2, v3);
+  return true;
+}
+
+template<typename T>
+static inline bool DecodeSetChecked(const uint8_t** in, const uint8_t* end, std::set<T>* set) {
+  DCHECK(set->empty());
+  uint32_t num_entries;
+  if (!DecodeUnsignedLeb128Checked(in, end, &num_entries)) {
+    return false;
+  }
+  for (size_t i = 0; i < num_entries; ++i) {
+    T tuple;
+    if (!DecodeTupleChecked(in, end, &tuple)) {
+      return false;
+    }
+    set->emplace(tuple);
+  }
+  return true;
+}
+
+template<typename T>
+static inline bool DecodeUint16VectorChecked(const uint8_t** in,
+                                             const uint8_t* end,
+                                             std::vector<T>* vector) {
+  DCHECK(vector->empty());
+  uint32_t num_entries;
+  // Each entry takes at least one byte, do not reserve more than that.
+  if (!DecodeUnsignedLeb128Checked(in, end, &num_entries) ||
+      num_entries > static_cast<size_t>(end - *in)) {
+    return false;
+  }
+  vector->reserve(num_entries);
+  for (size_t i = 0; i < num_entries; ++i) {
+    T value;
+    if (!DecodeValueChecked(in, end, &value)) {
+      return false;
+    }
+    vector->push_back(value);
+  }
+  return true;
+}
+
+static inline bool DecodeStringVectorChecked(const uint8_t** in,
+                                             const uint8_t* end,
+                                             std::vector<std::string>* strings) {
+  DCHECK(strings->empty());
+  uint32_t num_strings;
+  if (!DecodeUnsignedLeb128Checked(in, end, &num_strings) ||
+      num_strings > static_cast<size_t>(end - *in)) {
+    return false;
+  }
+  strings->reserve(num_strings);
+  for (size_t i = 0; i < num_strings; ++i) {
+    const uint8_t* string_end = std::find(*in, end, 0u);
+    if (string_end == end) {
+      return false;
+    }
+    strings->emplace_back(reinterpret_cast<const char*>(*in), string_end - *in);
+    *in = string_end + 1;
+  }
+  return true;
+}
+
 }  // namespace
 
 void VerifierDeps::Encode(const std::vector<const DexFile*>& dex_files,
@@ -721,6 +844,73 @@ VerifierDeps::VerifierDeps(const std::vector<const DexFile*>& dex_files,
   CHECK_LE(data_start, data_end);
 }
 
+std::unique_ptr<VerifierDeps> VerifierDeps::DecodeUntrusted(
+    const std::vector<const DexFile*>& dex_files,
+    ArrayRef<const uint8_t> data) {
+  std::unique_ptr<VerifierDeps> verifier_deps(new VerifierDeps(dex_files));
+  const uint8_t* data_start = data.data();
+  const uint8_t* data_end = data_start + data.size();
+  for (const DexFile* dex_file : dex_files) {
+    DexFileDeps* deps = verifier_deps->GetDexFileDeps(*dex_file);
+    if (!DecodeStringVectorChecked(&data_start, data_end, &deps->strings_) ||
+        !DecodeSetChecked(&data_start, data_end, &deps->assignable_types_) ||
+        !DecodeSetChecked(&data_start, data_end, &deps->unassignable_types_) ||
+        !DecodeSetChecked(&data_start, data_end, &deps->classes_) ||
+        !DecodeSetChecked(&data_start, data_end, &deps->fields_) ||
+        !DecodeSetChecked(&data_start, data_end, &deps->direct_methods_) ||
+        !DecodeSetChecked(&data_start, data_end, &deps->virtual_methods_) ||
+        !DecodeSetChecked(&data_start, data_end, &deps->interface_methods_) ||
+        !DecodeUint16VectorChecked(&data_start, data_end, &deps->unverified_classes_) ||
+        !deps->IsValidFor(*dex_file)) {
+      return nullptr;
+    }
+  }
+  if (data_start != data_end) {
+    return nullptr;
+  }
+  return verifier_deps;
+}
+
+bool VerifierDeps::DexFileDeps::IsValidFor(const DexFile& dex_file) const {
+  // The validation and Dump() index the dex file and `strings_` with the decoded ids.
+  const size_t num_string_ids = dex_file.NumStringIds() + strings_.size();
+  auto is_valid_string = [num_string_ids](dex::StringIndex string_idx) {
+    return string_idx.index_ < num_string_ids;
+  };
+  auto is_valid_type = [&dex_file](dex::TypeIndex type_idx) {
+    return type_idx.index_ < dex_file.NumTypeIds();
+  };
+  for (const std::set<TypeAssignability>* assignables :
+       { &assignable_types_, &unassignable_types_ }) {
+    for (const TypeAssignability& entry : *assignables) {
+      if (!is_valid_string(entry.GetDestination()) || !is_valid_string(entry.GetSource())) {
+        return false;
+      }
+    }
+  }
+  for (const ClassResolution& entry : classes_) {
+    if (!is_valid_type(entry.GetDexTypeIndex())) {
+      return false;
+    }
+  }
+  for (const FieldResolution& entry : fields_) {
+    if (entry.GetDexFieldIndex() >= dex_file.NumFieldIds() ||
+        (entry.IsResolved() && !is_valid_string(entry.GetDeclaringClassIndex()))) {
+      return false;
+    }
+  }
+  for (const std::set<MethodResolution>* methods :
+       { &direct_methods_, &virtual_methods_, &interface_methods_ }) {
+    for (const MethodResolution& entry : *methods) {
+      if (entry.GetDexMethodIndex() >= dex_file.NumMethodIds() ||
+          (entry.IsResolved() && !is_valid_string(entry.GetDeclaringClassIndex()))) {
+        return false;
+      }
+    }
+  }
+  return std::all_of(unverified_classes_.begin(), unverified_classes_.end(), is_valid_type);
+}
+
 bool VerifierDeps::Equals(const VerifierDeps& rhs) const {
   if (dex_deps_.size() != rhs.dex_deps_.size()) {
     return false;
@@ -18,6 +18,7 @@
 #define ART_RUNTIME_VERIFIER_VERIFIER_DEPS_H_
 
 #include <map>
+#include <memory>
 #include <set>
 #include <vector>
 
@@ -52,6 +53,11 @@ class VerifierDeps {
 
   VerifierDeps(const std::vector<const DexFile*>& dex_files, ArrayRef<const uint8_t> data);
 
+  // Decode data which may be corrupt, such as data read from an app-writable location. Returns
+  // null unless the whole data decodes and all the ids it holds are valid for `dex_files`.
+  static std::unique_ptr<VerifierDeps> DecodeUntrusted(const std::vector<const DexFile*>& dex_files,
+                                                       ArrayRef<const uint8_t> data);
+
   // Merge `other` into this `VerifierDeps`'. `other` and `this` must be for the
   // same set of dex files.
   void MergeWith(const VerifierDeps& other, const std::vector<const DexFile*>& dex_files);
@@ -191,6 +197,9 @@ class VerifierDeps {
     std::vector<dex::TypeIndex> unverified_classes_;
 
     bool Equals(const DexFileDeps& rhs) const;
+
+    // Returns whether the decoded ids are in range for `dex_file`.
+    bool IsValidFor(const DexFile& dex_file) const;
   };
 
   // Finds the DexFileDep instance associated with `dex_file`, or nullptr if
@@ -0,0 +1,446 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "verifier_deps_recorder.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include <algorithm>
+#include <cstring>
+
+#include "base/bit_utils.h"
+#include "base/logging.h"
+#include "base/scoped_flock.h"
+#include "base/systrace.h"
+#include "base/time_utils.h"
+#include "base/unix_file/fd_file.h"
+#include "class_linker.h"
+#include "compiler_filter.h"
+#include "dex_file-inl.h"
+#include "globals.h"
+#include "handle_scope-inl.h"
+#include "mirror/class-inl.h"
+#include "mirror/class_loader.h"
+#include "oat_file.h"
+#include "thread-inl.h"
+#include "utils.h"
+#include "verifier_deps.h"
+
+namespace art {
+namespace verifier {
+
+static constexpr uint8_t kVerifierDepsMagic[] = { 'v', 'd', 'p', '\n' };
+static constexpr uint8_t kVerifierDepsVersion[] = { '0', '0', '3', '\0' };
+
+// Larger files are not written by the recorder, do not read them.
+static constexpr size_t kMaxVerifierDepsFileSize = 16 * MB;
+
+static void AppendUint32(std::vector<uint8_t>* buffer, uint32_t value) {
+  for (size_t i = 0; i != sizeof(uint32_t); ++i) {
+    buffer->push_back(static_cast<uint8_t>(value >> (i * kBitsPerByte)));
+  }
+}
+
+static bool ReadUint32(ArrayRef<const uint8_t> buffer, size_t* offset, uint32_t* value) {
+  if (buffer.size() - *offset < sizeof(uint32_t)) {
+    return false;
+  }
+  *value = 0u;
+  for (size_t i = 0; i != sizeof(uint32_t); ++i) {
+    *value |= static_cast<uint32_t>(buffer[*offset + i]) << (i * kBitsPerByte);
+  }
+  *offset += sizeof(uint32_t);
+  return true;
+}
+
+// Size of the bitmap of the verified class defs of `dex_file`, stored before the VerifierDeps data.
+static size_t GetVerifiedBitmapSize(const DexFile& dex_file) {
+  return RoundUp(dex_file.NumClassDefs(), kBitsPerByte) / kBitsPerByte;
+}
+
+static uint32_t ComputeChecksum(ArrayRef<const uint8_t> data) {
+  uint32_t checksum = adler32(0L, Z_NULL, 0);
+  return adler32(checksum, data.data(), data.size());
+}
+
+VerifierDepsRecorder::VerifierDepsRecorder(const std::string& profile_filename,
+                                           const std::vector<std::string>& code_paths)
+    : deps_filename_(GetDepsFilename(profile_filename)),
+      code_paths_(code_paths),
+      lock_("Verifier deps recorder lock"),
+      state_(State::kWaitingForDexFiles),
+      num_recorded_(0u),
+      num_saved_(0u),
+      validation_ns_(0u),
+      num_verified_(0u),
+      verification_cpu_ns_(0u),
+      num_skipped_(0u) {
+  // Read the file now, this is called before any app code runs and the caller is not runnable.
+  if (!FileExists(deps_filename_)) {
+    return;
+  }
+  ScopedFlock flock;
+  std::string error;
+  if (!flock.Init(deps_filename_.c_str(),
+                  O_RDONLY | O_NOFOLLOW | O_CLOEXEC,
+                  /* block */ true,
+                  &error)) {
+    LOG(WARNING) << "Couldn't lock the verifier dependencies " << deps_filename_ << ": " << error;
+    return;
+  }
+  // The file is in a directory the app can write to. Only trust a regular file written by the
+  // recorder, which is owned by the app and not writable by others.
+  File* file = flock.GetFile();
+  struct stat st;
+  if (fstat(file->Fd(), &st) != 0) {
+    PLOG(WARNING) << "Couldn't stat the verifier dependencies " << deps_filename_;
+    return;
+  }
+  if (!S_ISREG(st.st_mode) ||
+      st.st_uid != getuid() ||
+      (st.st_mode & (S_IWGRP | S_IWOTH)) != 0 ||
+      static_cast<uint64_t>(st.st_size) > kMaxVerifierDepsFileSize) {
+    LOG(WARNING) << "Ignoring the verifier dependencies " << deps_filename_ << " with mode "
+                 << std::oct << st.st_mode << std::dec << ", owner " << st.st_uid << " and size "
+                 << st.st_size;
+    return;
+  }
+  int64_t length = st.st_size;
+  if (length > 0) {
+    file_data_.resize(length);
+    if (!file->PreadFully(file_data_.data(), file_data_.size(), 0u)) {
+      PLOG(WARNING) << "Couldn't read the verifier dependencies " << deps_filename_;
+      file_data_.clear();
+    }
+  }
+}
+
+VerifierDepsRecorder::~VerifierDepsRecorder() {}
+
+void VerifierDepsRecorder::OnDexFileRegistered(Thread* self,
+                                               const DexFile& dex_file,
+                                               Handle<mirror::ClassLoader> class_loader) {
+  const std::string base_location = DexFile::GetBaseLocation(dex_file.GetLocation());
+  if (std::find(code_paths_.begin(), code_paths_.end(), base_location) == code_paths_.end()) {
+    return;
+  }
+  {
+    MutexLock mu(self, lock_);
+    if (state_ != State::kWaitingForDexFiles) {
+      return;
+    }
+  }
+  std::vector<const DexFile*> dex_files;
+  ClassLinker::GetDexPathListDexFiles(class_loader.Get(), &dex_files);
+  if (std::find(dex_files.begin(), dex_files.end(), &dex_file) == dex_files.end()) {
+    // Not the class loader of the app's code paths.
+    return;
+  }
+  // The classes of an oat file with verified classes are verified from their oat class status,
+  // the method verifier only runs for the ones which failed.
+  const bool verified_ahead_of_time =
+      std::any_of(dex_files.begin(), dex_files.end(), [](const DexFile* app_dex_file) {
+        const OatFile::OatDexFile* oat_dex_file = app_dex_file->GetOatDexFile();
+        return oat_dex_file != nullptr &&
+            oat_dex_file->GetOatFile() != nullptr &&
+            CompilerFilter::IsVerificationEnabled(oat_dex_file->GetOatFile()->GetCompilerFilter());
+      });
+
+  MutexLock mu(self, lock_);
+  if (state_ != State::kWaitingForDexFiles) {
+    return;
+  }
+  if (verified_ahead_of_time) {
+    VLOG(verifier) << "Not recording verifier dependencies of " << base_location
+                   << ", it was verified ahead of time";
+    state_ = State::kNotRecording;
+    file_data_.clear();
+    file_data_.shrink_to_fit();
+    return;
+  }
+  VLOG(verifier) << "Recording verifier dependencies of " << dex_files.size() << " dex files of "
+                 << base_location << " to " << deps_filename_;
+  dex_files_ = std::move(dex_files);
+  state_ = State::kWaitingForValidation;
+}
+
+bool VerifierDepsRecorder::IsVerified(Thread* self, Handle<mirror::Class> klass) {
+  {
+    MutexLock mu(self, lock_);
+    if (state_ != State::kWaitingForValidation ||
+        GetDexFileIndex(klass->GetDexFile()) == dex_files_.size()) {
+      return IsVerifiedLocked(klass->GetDexFile(), klass->GetDexClassDefIndex());
+    }
+    state_ = State::kValidating;
+  }
+  // The classes verified until the validation is done, by other threads or by this one for the
+  // classes the validation loads, run the method verifier without being recorded.
+  StackHandleScope<1> hs(self);
+  Validate(self, hs.NewHandle(klass->GetClassLoader()));
+  MutexLock mu(self, lock_);
+  return IsVerifiedLocked(klass->GetDexFile(), klass->GetDexClassDefIndex());
+}
+
+bool VerifierDepsRecorder::IsVerifiedLocked(const DexFile& dex_file, uint16_t class_def_index) {
+  if (state_ != State::kRecording) {
+    return false;
+  }
+  size_t index = GetDexFileIndex(dex_file);
+  if (index == dex_files_.size() || !verified_class_defs_[index][class_def_index]) {
+    return false;
+  }
+  num_skipped_.FetchAndAddRelaxed(1u);
+  return true;
+}
+
+void VerifierDepsRecorder::Validate(Thread* self, Handle<mirror::ClassLoader> class_loader) {
+  ScopedTrace trace(__PRETTY_FUNCTION__);
+  const uint64_t start_ns = NanoTime();
+  std::vector<std::vector<bool>> verified_class_defs;
+  for (const DexFile* dex_file : dex_files_) {
+    verified_class_defs.emplace_back(dex_file->NumClassDefs(), false);
+  }
+  std::unique_ptr<VerifierDeps> deps;
+  size_t num_recorded = 0u;
+  ArrayRef<const uint8_t> data = GetRecordedData();
+  size_t bitmaps_size = 0u;
+  for (const DexFile* dex_file : dex_files_) {
+    bitmaps_size += GetVerifiedBitmapSize(*dex_file);
+  }
+  std::unique_ptr<VerifierDeps> recorded_deps;
+  if (!data.empty()) {
+    if (data.size() > bitmaps_size) {
+      recorded_deps = VerifierDeps::DecodeUntrusted(dex_files_, data.SubArray(bitmaps_size));
+    }
+    if (recorded_deps == nullptr) {
+      LOG(WARNING) << "Corrupt verifier dependencies " << deps_filename_;
+    }
+  }
+  if (recorded_deps != nullptr) {
+    if (recorded_deps->ValidateDependencies(class_loader, self)) {
+      // Only the classes recorded as verified skip the method verifier.
+      const uint8_t* bitmap = data.data();
+      for (size_t i = 0; i != dex_files_.size(); ++i) {
+        const DexFile* dex_file = dex_files_[i];
+        for (size_t j = 0; j != dex_file->NumClassDefs(); ++j) {
+          if ((bitmap[j / kBitsPerByte] & (1u << (j % kBitsPerByte))) != 0u) {
+            verified_class_defs[i][j] = true;
+            ++num_recorded;
+          }
+        }
+        bitmap += GetVerifiedBitmapSize(*dex_file);
+      }
+      deps = std::move(recorded_deps);
+    } else {
+      VLOG(verifier) << "Dropping the verifier dependencies of " << deps_filename_
+                     << ", the class path changed";
+    }
+  }
+  if (deps == nullptr) {
+    deps.reset(new VerifierDeps(dex_files_));
+  }
+  VLOG(verifier) << "Validated the verifier dependencies of " << num_recorded << " classes in "
+                 << PrettyDuration(NanoTime() - start_ns);
+
+  MutexLock mu(self, lock_);
+  DCHECK(state_ == State::kValidating);
+  file_data_.clear();
+  file_data_.shrink_to_fit();
+  main_deps_ = std::move(deps);
+  verified_class_defs_ = std::move(verified_class_defs);
+  num_recorded_ = num_recorded;
+  num_saved_ = num_recorded;
+  validation_ns_ = NanoTime() - start_ns;
+  state_ = State::kRecording;
+}
+
+ArrayRef<const uint8_t> VerifierDepsRecorder::GetRecordedData() const {
+  ArrayRef<const uint8_t> file_data(file_data_);
+  if (file_data.size() < sizeof(kVerifierDepsMagic) + sizeof(kVerifierDepsVersion) ||
+      memcmp(file_data.data(), kVerifierDepsMagic, sizeof(kVerifierDepsMagic)) != 0 ||
+      memcmp(file_data.data() + sizeof(kVerifierDepsMagic),
+             kVerifierDepsVersion,
+             sizeof(kVerifierDepsVersion)) != 0) {
+    if (!file_data.empty()) {
+      LOG(WARNING) << "Bad or obsolete verifier dependencies " << deps_filename_;
+    }
+    return ArrayRef<const uint8_t>();
+  }
+  size_t offset = sizeof(kVerifierDepsMagic) + sizeof(kVerifierDepsVersion);
+  uint32_t number_of_dex_files;
+  if (!ReadUint32(file_data, &offset, &number_of_dex_files) ||
+      number_of_dex_files != dex_files_.size()) {
+    return ArrayRef<const uint8_t>();
+  }
+  for (const DexFile* dex_file : dex_files_) {
+    uint32_t location_checksum;
+    const DexFile::Header& header = dex_file->GetHeader();
+    if (!ReadUint32(file_data, &offset, &location_checksum) ||
+        location_checksum != dex_file->GetLocationChecksum() ||
+        file_data.size() - offset < DexFile::kSha1DigestSize ||
+        memcmp(file_data.data() + offset, header.signature_, DexFile::kSha1DigestSize) != 0) {
+      // The app was updated.
+      return ArrayRef<const uint8_t>();
+    }
+    offset += DexFile::kSha1DigestSize;
+  }
+  uint32_t data_size;
+  uint32_t data_checksum;
+  if (!ReadUint32(file_data, &offset, &data_size) ||
+      !ReadUint32(file_data, &offset, &data_checksum) ||
+      data_size != file_data.size() - offset) {
+    LOG(WARNING) << "Truncated verifier dependencies " << deps_filename_;
+    return ArrayRef<const uint8_t>();
+  }
+  // The checksum only catches truncated or partially written data, the content is checked when
+  // decoded.
+  ArrayRef<const uint8_t> data = file_data.SubArray(offset);
+  if (data.empty() || ComputeChecksum(data) != data_checksum) {
+    LOG(WARNING) << "Corrupt verifier dependencies " << deps_filename_;
+    return ArrayRef<const uint8_t>();
+  }
+  return data;
+}
+
+size_t VerifierDepsRecorder::GetDexFileIndex(const DexFile& dex_file) const {
+  return std::find(dex_files_.begin(), dex_files_.end(), &dex_file) - dex_files_.begin();
+}
+
+bool VerifierDepsRecorder::BeginRecording(Thread* self, ObjPtr<mirror::Class> klass) {
+  if (self->GetRecordedVerifierDeps() != nullptr) {
+    // Verifying a class does not verify others, but keep their dependencies apart if it does.
+    return false;
+  }
+  {
+    MutexLock mu(self, lock_);
+    if (state_ != State::kRecording || GetDexFileIndex(klass->GetDexFile()) == dex_files_.size()) {
+      return false;
+    }
+  }
+  // Like during AOT verification, each thread records in its own VerifierDeps to avoid contention
+  // on the main one.
+  self->SetRecordedVerifierDeps(new VerifierDeps(dex_files_));
+  return true;
+}
+
+void VerifierDepsRecorder::EndRecording(Thread* self,
+                                        ObjPtr<mirror::Class> klass,
+                                        bool recording,
+                                        MethodVerifier::FailureKind failure_kind,
+                                        uint64_t verification_cpu_ns) {
+  num_verified_.FetchAndAddRelaxed(1u);
+  verification_cpu_ns_.FetchAndAddRelaxed(verification_cpu_ns);
+  if (!recording) {
+    return;
+  }
+  std::unique_ptr<VerifierDeps> thread_deps(self->GetRecordedVerifierDeps());
+  self->SetRecordedVerifierDeps(nullptr);
+  DCHECK(thread_deps != nullptr);
+  MutexLock mu(self, lock_);
+  main_deps_->MergeWith(*thread_deps, dex_files_);
+  // Soft failures are checked again at runtime, record them as unverified like dex2oat does.
+  if (failure_kind == MethodVerifier::kNoFailure) {
+    size_t index = GetDexFileIndex(klass->GetDexFile());
+    DCHECK_NE(index, dex_files_.size());
+    std::vector<bool>::reference verified =
+        verified_class_defs_[index][klass->GetDexClassDefIndex()];
+    if (!verified) {
+      verified = true;
+      ++num_recorded_;
+    }
+  }
+}
+
+void VerifierDepsRecorder::Save(Thread* self) {
+  ScopedTrace trace(__PRETTY_FUNCTION__);
+  std::vector<uint8_t> data;
+  size_t num_recorded;
+  {
+    MutexLock mu(self, lock_);
+    if (state_ != State::kRecording || num_recorded_ == num_saved_) {
+      return;
+    }
+    num_recorded = num_recorded_;
+    num_saved_ = num_recorded_;
+    for (size_t i = 0; i != dex_files_.size(); ++i) {
+      const DexFile* dex_file = dex_files_[i];
+      const size_t bitmap_offset = data.size();
+      data.resize(bitmap_offset + GetVerifiedBitmapSize(*dex_file), 0u);
+      for (size_t j = 0; j != dex_file->NumClassDefs(); ++j) {
+        if (verified_class_defs_[i][j]) {
+          data[bitmap_offset + j / kBitsPerByte] |= 1u << (j % kBitsPerByte);
+        }
+      }
+    }
+    // The verifying threads add the strings to the main VerifierDeps without holding lock_.
+    ReaderMutexLock mu2(self, *Locks::verifier_deps_lock_);
+    main_deps_->Encode(dex_files_, &data);
+  }
+
+  std::vector<uint8_t> buffer(std::begin(kVerifierDepsMagic), std::end(kVerifierDepsMagic));
+  buffer.insert(buffer.end(), std::begin(kVerifierDepsVersion), std::end(kVerifierDepsVersion));
+  AppendUint32(&buffer, dex_files_.size());
+  for (const DexFile* dex_file : dex_files_) {
+    AppendUint32(&buffer, dex_file->GetLocationChecksum());
+    const uint8_t* signature = dex_file->GetHeader().signature_;
+    buffer.insert(buffer.end(), signature, signature + DexFile::kSha1DigestSize);
+  }
+  AppendUint32(&buffer, data.size());
+  AppendUint32(&buffer, ComputeChecksum(ArrayRef<const uint8_t>(data)));
+  buffer.insert(buffer.end(), data.begin(), data.end());
+
+  // Writers lock the file, a run reading it while it is being written drops the truncated data.
+  ScopedFlock flock;
+  std::string error;
+  if (!flock.Init(deps_filename_.c_str(),
+                  O_RDWR | O_CREAT | O_NOFOLLOW | O_CLOEXEC,
+                  /* block */ true,
+                  &error)) {
+    LOG(WARNING) << "Couldn't lock the verifier dependencies " << deps_filename_ << ": " << error;
+    return;
+  }
+  File* file = flock.GetFile();
+  if (fchmod(file->Fd(), S_IRUSR | S_IWUSR) != 0 ||
+      !file->ClearContent() ||
+      !file->WriteFully(buffer.data(), buffer.size())) {
+    PLOG(WARNING) << "Couldn't write the verifier dependencies " << deps_filename_;
+    return;
+  }
+  VLOG(verifier) << "Saved the verifier dependencies of " << num_recorded << " classes to "
+                 << deps_filename_ << ", " << num_verified_.LoadRelaxed()
+                 << " classes verified in this run in "
+                 << PrettyDuration(verification_cpu_ns_.LoadRelaxed()) << " of CPU time";
+}
+
+void VerifierDepsRecorder::DumpForSigQuit(std::ostream& os) {
+  MutexLock mu(Thread::Current(), lock_);
+  os << "Verifier deps recorder: " << num_verified_.LoadRelaxed() << " classes verified in "
+     << PrettyDuration(verification_cpu_ns_.LoadRelaxed()) << " of CPU time, "
+     << num_skipped_.LoadRelaxed() << " skipped with recorded dependencies, "
+     << num_recorded_ << " recorded";
+  if (state_ == State::kRecording) {
+    os << ", validated in " << PrettyDuration(validation_ns_);
+  } else if (state_ == State::kNotRecording) {
+    os << ", verified ahead of time";
+  }
+  os << "\n";
+}
+
+}  // namespace verifier
+}  // namespace art
@@ -0,0 +1,168 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_RUNTIME_VERIFIER_VERIFIER_DEPS_RECORDER_H_
+#define ART_RUNTIME_VERIFIER_VERIFIER_DEPS_RECORDER_H_
+
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "atomic.h"
+#include "base/array_ref.h"
+#include "base/macros.h"
+#include "base/mutex.h"
+#include "handle.h"
+#include "method_verifier.h"  // For MethodVerifier::FailureKind.
+#include "obj_ptr.h"
+
+namespace art {
+
+class DexFile;
+class Thread;
+
+namespace mirror {
+class Class;
+class ClassLoader;
+}  // namespace mirror
+
+namespace verifier {
+
+class VerifierDeps;
+
+// Records the VerifierDeps of the app classes verified by the runtime when the app's dex files
+// were not verified ahead of time, for example after an update and before background dexopt, and
+// stores them next to the app's profile. On the next start, the recorded dependencies are
+// validated against the class path the first time an app class is verified, and the classes
+// they list as verified then skip the method verifier.
+//
+// The file starts with a header holding the location checksums and SHA-1 signatures of the app's
+// dex files and the checksum of the data. The data holds, for each dex file, a bitmap of the class
+// defs verified without failures, followed by the data of VerifierDeps::Encode(). Only the classes
+// set in the bitmaps are trusted as verified, the classes which were never verified are not listed
+// anywhere. As the app can write the file, it is only read if it is a regular file owned by the app
+// and not writable by others, and its data is decoded with VerifierDeps::DecodeUntrusted().
+class VerifierDepsRecorder {
+ public:
+  VerifierDepsRecorder(const std::string& profile_filename,
+                       const std::vector<std::string>& code_paths);
+  ~VerifierDepsRecorder();
+
+  static std::string GetDepsFilename(const std::string& profile_filename) {
+    return profile_filename + ".vdeps";
+  }
+
+  // Called when a dex file is registered with a non boot class loader. Recording starts the first
+  // time a dex file of one of the app's code paths is registered, for the dex files of that class
+  // loader, unless they have an oat file with verified classes.
+  void OnDexFileRegistered(Thread* self,
+                           const DexFile& dex_file,
+                           Handle<mirror::ClassLoader> class_loader)
+      REQUIRES_SHARED(Locks::mutator_lock_)
+      REQUIRES(!lock_);
+
+  // Called by ClassLinker::VerifyClass() for a class without a verified status in the oat file.
+  // Returns whether the class was verified by a previous run with dependencies that still hold.
+  bool IsVerified(Thread* self, Handle<mirror::Class> klass)
+      REQUIRES_SHARED(Locks::mutator_lock_)
+      REQUIRES(!lock_);
+
+  // Called by ClassLinker::VerifyClass() around the method verifier. BeginRecording() returns
+  // whether the dependencies of `klass` are recorded, which is passed to EndRecording() with the
+  // outcome of the verification and the CPU time it took.
+  bool BeginRecording(Thread* self, ObjPtr<mirror::Class> klass)
+      REQUIRES_SHARED(Locks::mutator_lock_)
+      REQUIRES(!lock_);
+  void EndRecording(Thread* self,
+                    ObjPtr<mirror::Class> klass,
+                    bool recording,
+                    MethodVerifier::FailureKind failure_kind,
+                    uint64_t verification_cpu_ns)
+      REQUIRES_SHARED(Locks::mutator_lock_)
+      REQUIRES(!lock_);
+
+  // The VerifierDeps the per-thread ones are merged into, which also holds the strings of all of
+  // them. It is set before recording starts and does not change afterwards.
+  VerifierDeps* GetMainVerifierDeps() const {
+    return main_deps_.get();
+  }
+
+  // Write the recorded dependencies if classes were verified since they were last written. Called
+  // by the profile saver and during runtime shutdown.
+  void Save(Thread* self) REQUIRES(!lock_);
+
+  void DumpForSigQuit(std::ostream& os) REQUIRES(!lock_);
+
+ private:
+  enum class State {
+    kWaitingForDexFiles,     // The app's class loader has not registered a dex file yet.
+    kNotRecording,           // The app's dex files were verified ahead of time.
+    kWaitingForValidation,   // No app class has been verified yet.
+    kValidating,             // A thread is validating the dependencies of the previous runs.
+    kRecording,
+  };
+
+  // Validate the dependencies read from the file and start recording. Called by the thread which
+  // moved the state to kValidating.
+  void Validate(Thread* self, Handle<mirror::ClassLoader> class_loader)
+      REQUIRES_SHARED(Locks::mutator_lock_)
+      REQUIRES(!lock_);
+
+  // Returns the data recorded by a previous run for the dex files, or an empty array if the file
+  // was written for other dex files or is corrupt.
+  ArrayRef<const uint8_t> GetRecordedData() const;
+
+  size_t GetDexFileIndex(const DexFile& dex_file) const;
+
+  bool IsVerifiedLocked(const DexFile& dex_file, uint16_t class_def_index) REQUIRES(lock_);
+
+  const std::string deps_filename_;
+  const std::vector<std::string> code_paths_;
+
+  Mutex lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
+  State state_ GUARDED_BY(lock_);
+
+  // The dex files of the app's class loader, set with lock_ held when leaving kWaitingForDexFiles
+  // and constant afterwards.
+  std::vector<const DexFile*> dex_files_;
+
+  // The content of the file written by a previous run, only read by the validating thread.
+  std::vector<uint8_t> file_data_;
+
+  std::unique_ptr<VerifierDeps> main_deps_;
+
+  // For each dex file, whether its class defs are verified with the recorded dependencies.
+  std::vector<std::vector<bool>> verified_class_defs_ GUARDED_BY(lock_);
+
+  // Number of classes verified with the recorded dependencies, and the number when they were last
+  // written.
+  size_t num_recorded_ GUARDED_BY(lock_);
+  size_t num_saved_ GUARDED_BY(lock_);
+
+  // Statistics for this run.
+  uint64_t validation_ns_ GUARDED_BY(lock_);
+  Atomic<uint32_t> num_verified_;
+  Atomic<uint64_t> verification_cpu_ns_;
+  Atomic<uint32_t> num_skipped_;
+
+  DISALLOW_COPY_AND_ASSIGN(VerifierDepsRecorder);
+};
+
+}  // namespace verifier
+}  // namespace art
+
+#endif  // ART_RUNTIME_VERIFIER_VERIFIER_DEPS_RECORDER_H_
@@ -0,0 +1,205 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "verifier_deps_recorder.h"
+
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include "android-base/file.h"
+
+#include "class_linker-inl.h"
+#include "common_runtime_test.h"
+#include "dex_file.h"
+#include "handle_scope-inl.h"
+#include "mirror/class-inl.h"
+#include "scoped_thread_state_change-inl.h"
+#include "thread-inl.h"
+#include "verifier_log_mode.h"
+
+namespace art {
+namespace verifier {
+
+// Offsets in the file written for a single dex file: magic, version, number of dex files,
+// location checksum, SHA-1 signature, data size, data checksum, data. The data starts with the
+// one byte bitmap of the verified class defs of Nested.
+static constexpr size_t kSignatureOffset = 16u;
+static constexpr size_t kDataSizeOffset = kSignatureOffset + DexFile::kSha1DigestSize;
+static constexpr size_t kDataChecksumOffset = kDataSizeOffset + 4u;
+static constexpr size_t kDataOffset = kDataChecksumOffset + 4u;
+
+class VerifierDepsRecorderTest : public CommonRuntimeTest {
+ protected:
+  void SetUp() OVERRIDE {
+    CommonRuntimeTest::SetUp();
+    ScopedObjectAccess soa(Thread::Current());
+    class_loader_ = LoadDex("Nested");
+    std::vector<const DexFile*> dex_files = GetDexFiles(class_loader_);
+    ASSERT_EQ(1u, dex_files.size());
+    dex_file_ = dex_files[0];
+    profile_filename_ = android_data_ + "/primary.prof";
+    deps_filename_ = VerifierDepsRecorder::GetDepsFilename(profile_filename_);
+  }
+
+  void TearDown() OVERRIDE {
+    unlink(deps_filename_.c_str());
+    CommonRuntimeTest::TearDown();
+  }
+
+  // Start the app with a new recorder, as on a new launch, verify the class Nested and save the
+  // dependencies. Returns whether Nested was verified with the dependencies of a previous run.
+  bool RunApp() {
+    Thread* self = Thread::Current();
+    VerifierDepsRecorder recorder(profile_filename_, { dex_file_->GetLocation() });
+    bool preverified;
+    {
+      ScopedObjectAccess soa(self);
+      StackHandleScope<3> hs(self);
+      Handle<mirror::ClassLoader> class_loader(
+          hs.NewHandle(soa.Decode<mirror::ClassLoader>(class_loader_)));
+      recorder.OnDexFileRegistered(self, *dex_file_, class_loader);
+      Handle<mirror::Class> klass(
+          hs.NewHandle(class_linker_->FindClass(self, "LNested;", class_loader)));
+      EXPECT_TRUE(klass != nullptr);
+      preverified = recorder.IsVerified(self, klass);
+      if (!preverified) {
+        bool recording = recorder.BeginRecording(self, klass.Get());
+        EXPECT_TRUE(recording);
+        std::string error_msg;
+        MethodVerifier::FailureKind failure = MethodVerifier::VerifyClass(
+            self, klass.Get(), nullptr, true, HardFailLogMode::kLogWarning, &error_msg);
+        EXPECT_EQ(MethodVerifier::kNoFailure, failure) << error_msg;
+        recorder.EndRecording(self, klass.Get(), recording, failure, 0u);
+      }
+      // Classes which were never verified are not recorded as verified.
+      Handle<mirror::Class> inner(
+          hs.NewHandle(class_linker_->FindClass(self, "LNested$Inner;", class_loader)));
+      EXPECT_TRUE(inner != nullptr);
+      EXPECT_FALSE(recorder.IsVerified(self, inner));
+    }
+    recorder.Save(self);
+    return preverified;
+  }
+
+  std::string ReadDepsFile() {
+    std::string content;
+    EXPECT_TRUE(android::base::ReadFileToString(deps_filename_, &content));
+    return content;
+  }
+
+  void WriteDepsFile(const std::string& content) {
+    ASSERT_TRUE(android::base::WriteStringToFile(content, deps_filename_));
+  }
+
+  // Replace the data of the file, with a size and checksum matching the new data.
+  void ReplaceData(const std::vector<uint8_t>& data) {
+    std::string content = ReadDepsFile().substr(0u, kDataOffset);
+    ASSERT_EQ(kDataOffset, content.size());
+    uint32_t checksum = adler32(adler32(0L, Z_NULL, 0), data.data(), data.size());
+    for (size_t i = 0; i != 4u; ++i) {
+      content[kDataSizeOffset + i] = static_cast<char>(data.size() >> (i * 8u));
+      content[kDataChecksumOffset + i] = static_cast<char>(checksum >> (i * 8u));
+    }
+    content.append(data.begin(), data.end());
+    WriteDepsFile(content);
+  }
+
+  std::string profile_filename_;
+  std::string deps_filename_;
+  jobject class_loader_;
+  const DexFile* dex_file_;
+};
+
+TEST_F(VerifierDepsRecorderTest, Record) {
+  EXPECT_FALSE(RunApp());
+  struct stat st;
+  ASSERT_EQ(0, stat(deps_filename_.c_str(), &st));
+  // Only the app can read or write the file.
+  EXPECT_EQ(static_cast<mode_t>(S_IRUSR | S_IWUSR), st.st_mode & 0777);
+  std::string content = ReadDepsFile();
+  ASSERT_GT(content.size(), kDataOffset);
+  EXPECT_EQ(0, memcmp(content.data() + kSignatureOffset,
+                      dex_file_->GetHeader().signature_,
+                      DexFile::kSha1DigestSize));
+}
+
+TEST_F(VerifierDepsRecorderTest, Reuse) {
+  EXPECT_FALSE(RunApp());
+  EXPECT_TRUE(RunApp());
+  EXPECT_TRUE(RunApp());
+}
+
+TEST_F(VerifierDepsRecorderTest, StaleFile) {
+  EXPECT_FALSE(RunApp());
+  // A file written for a dex file with another signature, as after an update of the app.
+  std::string content = ReadDepsFile();
+  content[kSignatureOffset] ^= 1;
+  WriteDepsFile(content);
+  EXPECT_FALSE(RunApp());
+  // The file is written again for the current dex file.
+  EXPECT_TRUE(RunApp());
+}
+
+TEST_F(VerifierDepsRecorderTest, CorruptFile) {
+  EXPECT_FALSE(RunApp());
+  // Data not matching its checksum.
+  std::string content = ReadDepsFile();
+  content.back() ^= 1;
+  WriteDepsFile(content);
+  EXPECT_FALSE(RunApp());
+
+  // Data matching its checksum but failing to decode: a huge number of strings.
+  ReplaceData({ 0x03, 0xff, 0xff, 0xff, 0xff, 0x0f });
+  EXPECT_FALSE(RunApp());
+
+  // Data decoding to an out of range type index: no strings or dependencies, and one
+  // unverified class with type index 0x7fff.
+  ReplaceData({ 0x03, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0xff, 0xff, 0x01 });
+  EXPECT_FALSE(RunApp());
+
+  // Only the bitmap, without dependencies.
+  ReplaceData({ 0x03 });
+  EXPECT_FALSE(RunApp());
+
+  // Truncated file.
+  content = ReadDepsFile();
+  WriteDepsFile(content.substr(0u, content.size() - 1u));
+  EXPECT_FALSE(RunApp());
+  EXPECT_TRUE(RunApp());
+}
+
+TEST_F(VerifierDepsRecorderTest, OnlyRecordedClassesVerified) {
+  EXPECT_FALSE(RunApp());
+  // Valid dependencies without any unverified class, but no class recorded as verified.
+  ReplaceData({ 0x00, 0, 0, 0, 0, 0, 0, 0, 0, 0 });
+  EXPECT_FALSE(RunApp());
+  EXPECT_TRUE(RunApp());
+}
+
+TEST_F(VerifierDepsRecorderTest, WritableByOthers) {
+  EXPECT_FALSE(RunApp());
+  ASSERT_EQ(0, chmod(deps_filename_.c_str(), 0666));
+  EXPECT_FALSE(RunApp());
+  // The file is written again, only for the app.
+  struct stat st;
+  ASSERT_EQ(0, stat(deps_filename_.c_str(), &st));
+  EXPECT_EQ(static_cast<mode_t>(S_IRUSR | S_IWUSR), st.st_mode & 0777);
+  EXPECT_TRUE(RunApp());
+}
+
+}  // namespace verifier
+}  // namespace art
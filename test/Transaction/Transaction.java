@@ -74,6 +74,19 @@ public class Transaction {
       }
     }
 
+    static class StaticFieldReadAbortClass {
+      public static int intField;
+      static {
+        // Initializes StaticFieldClass in the transaction before aborting it.
+        intField = StaticFieldClass.intField;
+        try {
+          AbortHelperClass.nativeMethod();
+        } catch (Throwable e) {
+          // ignore exception.
+        }
+      }
+    }
+
     // Helper class to abort transaction: finalizable class with natve methods.
     static class AbortHelperClass {
       public void finalize() throws Throwable {
@@ -0,0 +1,336 @@
+#!/usr/bin/env python3.4
+#
+# Copyright (C) 2017 The Android Open Source Project
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""Measures the throughput of the optimizing compiler.
+
+See README.md.
+
+Example usage:
+./compiler_benchmark.py --isa x86_64 --repetitions 5
+"""
+
+import argparse
+import collections
+import glob
+import json
+import os
+import statistics
+import sys
+import time
+
+sys.path.append(os.path.dirname(os.path.dirname(
+        os.path.realpath(__file__))))
+
+from common.common import FatalError
+from common.common import GetEnvVariableOrError
+from common.common import HostTestEnv
+from common.common import RetCode
+
+# Instruction sets the optimizing compiler has a backend for.
+ALL_ISAS = ['arm', 'arm64', 'x86', 'x86_64', 'mips', 'mips64']
+
+# Instruction sets of the host core.art, benchmarked when no --isa is given.
+HOST_ISAS = ['x86', 'x86_64']
+
+# Number of methods to list in the slowest and largest method tables.
+TOP_METHODS = 10
+
+# Sizes of the synthetic stress methods.
+STRESS_SWITCH_CASES = 2000
+STRESS_STRAIGHT_LINE_STATEMENTS = 4000
+STRESS_LOCALS = 250
+STRESS_LOOP_NEST_DEPTH = 12
+
+
+def GenerateStressSource():
+  """Returns Java source of a class with methods stressing the compiler.
+
+  The methods are generated deterministically so that the benchmark numbers
+  can be compared between runs.
+
+  Returns:
+    string, Java source of class StressMethods.
+  """
+  lines = ['public class StressMethods {']
+  # Huge packed switch, as produced for state machines and obfuscated code.
+  lines.append('  public static int hugeSwitch(int x) {')
+  lines.append('    switch (x) {')
+  for i in range(STRESS_SWITCH_CASES):
+    lines.append('      case {0}: return x * {1} + {2};'.format(i, i % 7 + 1, i))
+  lines.append('      default: return -1;')
+  lines.append('    }')
+  lines.append('  }')
+  # Long straight-line code with many live values.
+  lines.append('  public static long straightLine(long a, long b) {')
+  for i in range(STRESS_LOCALS):
+    lines.append('    long v{0} = a + {0} * b;'.format(i))
+  for i in range(STRESS_STRAIGHT_LINE_STATEMENTS):
+    j = i % STRESS_LOCALS
+    k = (i * 31 + 7) % STRESS_LOCALS
+    lines.append('    v{0} = (v{0} ^ v{1}) + {2};'.format(j, k, i))
+  lines.append('    return ' + ' + '.join(
+      'v{0}'.format(i) for i in range(STRESS_LOCALS)) + ';')
+  lines.append('  }')
+  # Deep loop nest with array accesses for BCE, LICM and induction analysis.
+  lines.append('  public static int loopNest(int[] array, int n) {')
+  lines.append('    int sum = 0;')
+  for depth in range(STRESS_LOOP_NEST_DEPTH):
+    indent = '    ' + '  ' * depth
+    lines.append('{0}for (int i{1} = 0; i{1} < n; i{1}++) {{'.format(
+        indent, depth))
+  indent = '    ' + '  ' * STRESS_LOOP_NEST_DEPTH
+  lines.append('{0}sum += array[i0] + array[i{1}] * i{2};'.format(
+      indent, STRESS_LOOP_NEST_DEPTH - 1, STRESS_LOOP_NEST_DEPTH // 2))
+  for depth in reversed(range(STRESS_LOOP_NEST_DEPTH)):
+    lines.append('    ' + '  ' * depth + '}')
+  lines.append('    return sum;')
+  lines.append('  }')
+  lines.append('}')
+  return '\n'.join(lines) + '\n'
+
+
+def BuildStressDex(env):
+  """Compiles the synthetic stress methods to a dex file.
+
+  Args:
+    env: HostTestEnv, environment to build in.
+
+  Returns:
+    string, path to the jar with the stress dex file.
+
+  Raises:
+    FatalError: The stress methods failed to compile.
+  """
+  source = env.CreateFile('StressMethods.java')
+  with open(source, 'w') as f:
+    f.write(GenerateStressSource())
+  # dx requires the path of a class file to match its class name, so give it
+  # the root of a directory holding only the compiled classes.
+  classes_dir = os.path.join(os.path.dirname(source), 'stress-classes')
+  os.makedirs(classes_dir, exist_ok=True)
+  output, retcode = env.RunCommand(['javac', '-source', '1.7', '-target', '1.7',
+                                    '-d', classes_dir, source])
+  if retcode != RetCode.SUCCESS:
+    raise FatalError('Failed to compile stress methods:\n' + output)
+  jar = os.path.join(os.path.dirname(source), 'stress-methods.jar')
+  output, retcode = env.RunCommand(
+      ['dx', '--dex', '--output=' + jar, classes_dir])
+  if retcode != RetCode.SUCCESS:
+    raise FatalError('Failed to dex stress methods:\n' + output)
+  return jar
+
+
+def DefaultCorpus():
+  """Returns the dex files compiled when none are given on the command line."""
+  host_out = GetEnvVariableOrError('ANDROID_HOST_OUT')
+  corpus = sorted(glob.glob(os.path.join(host_out, 'framework', 'art-gtest-*.jar')))
+  if not corpus:
+    raise FatalError('No art-gtest-*.jar found in {0}/framework, build the gtest '
+                     'dependencies or pass --dex-file.'.format(host_out))
+  return corpus
+
+
+def ParseReport(report_path):
+  """Parses the output of dex2oat --dump-compile-report.
+
+  Args:
+    report_path: string, path to the report.
+
+  Returns:
+    list of dicts, one per compiled method. Numeric fields are converted to
+      ints, 'pass:' and 'arena:' fields are grouped in 'passes' and 'arena'.
+  """
+  methods = []
+  with open(report_path) as f:
+    for line in f:
+      method = {'passes': collections.OrderedDict(), 'arena': {}}
+      for field in line.rstrip('\n').split('\t'):
+        key, _, value = field.partition('=')
+        if key.startswith('pass:'):
+          pass_name = key[len('pass:'):]
+          # A pass may run several times per method, e.g. in the inliner.
+          method['passes'][pass_name] = (
+              method['passes'].get(pass_name, 0) + int(value))
+        elif key.startswith('arena:'):
+          method['arena'][key[len('arena:'):]] = int(value)
+        elif key in ('method', 'isa'):
+          method[key] = value
+        else:
+          method[key] = int(value)
+      methods.append(method)
+  return methods
+
+
+def CompileCorpus(env, dex2oat, isa, boot_image, dex_files, extra_args):
+  """Compiles the corpus once and returns the per-method report and wall time.
+
+  Args:
+    env: HostTestEnv, environment to run dex2oat in.
+    dex2oat: string, dex2oat binary.
+    isa: string, instruction set to compile for.
+    boot_image: string, boot image location.
+    dex_files: list of strings, dex files to compile.
+    extra_args: list of strings, additional dex2oat arguments.
+
+  Returns:
+    tuple (list of dicts, float), parsed report and dex2oat wall time in seconds.
+
+  Raises:
+    FatalError: dex2oat failed.
+  """
+  report = env.CreateFile('report-' + isa)
+  open(report, 'w').close()  # The report is appended to.
+  oat_file = env.CreateFile('benchmark-' + isa + '.odex')
+  cmd = [dex2oat,
+         '--runtime-arg', '-Xnorelocate',
+         '--boot-image=' + boot_image,
+         '--instruction-set=' + isa,
+         '--compiler-filter=speed',
+         # A single compiler thread gives the most stable numbers.
+         '-j1',
+         '--dump-compile-report=' + report,
+         '--oat-file=' + oat_file]
+  cmd += ['--dex-file=' + dex_file for dex_file in dex_files]
+  cmd += extra_args
+  start = time.monotonic()
+  output, retcode = env.RunCommand(cmd)
+  wall_time = time.monotonic() - start
+  if retcode != RetCode.SUCCESS:
+    raise FatalError('dex2oat failed for {0}:\n{1}'.format(isa, output))
+  return ParseReport(report), wall_time
+
+
+def Summarize(isa, runs):
+  """Aggregates the repeated runs for one instruction set.
+
+  Compile times are the median over the repetitions to filter out noise. Memory
+  and code size are deterministic and are taken from the first run.
+
+  Args:
+    isa: string, instruction set.
+    runs: list of tuples (list of dicts, float) returned by CompileCorpus.
+
+  Returns:
+    dict, summary of the benchmark for the instruction set.
+  """
+  first_run = runs[0][0]
+  num_methods = len(first_run)
+  compile_seconds = [sum(m['total_ns'] for m in report) / 1e9 for report, _ in runs]
+  median_compile_seconds = statistics.median(compile_seconds)
+  pass_names = collections.OrderedDict()
+  for method in first_run:
+    for pass_name in method['passes']:
+      pass_names[pass_name] = True
+  pass_seconds = collections.OrderedDict()
+  for pass_name in pass_names:
+    pass_seconds[pass_name] = statistics.median(
+        sum(m['passes'].get(pass_name, 0) for m in report) / 1e9 for report, _ in runs)
+  by_time = sorted(first_run, key=lambda m: m['total_ns'], reverse=True)
+  by_memory = sorted(first_run, key=lambda m: m['arena_bytes'], reverse=True)
+  return collections.OrderedDict([
+      ('isa', isa),
+      ('methods', num_methods),
+      ('methods_per_second', num_methods / median_compile_seconds
+                             if median_compile_seconds else 0.0),
+      ('compile_seconds_median', median_compile_seconds),
+      ('compile_seconds_stdev', statistics.pstdev(compile_seconds)),
+      ('dex2oat_wall_seconds_median', statistics.median(w for _, w in runs)),
+      ('peak_arena_bytes', by_memory[0]['arena_bytes'] if by_memory else 0),
+      ('total_code_size', sum(m['code_size'] for m in first_run)),
+      ('pass_seconds', pass_seconds),
+      ('slowest_methods', [(m['method'], m['total_ns']) for m in by_time[:TOP_METHODS]]),
+      ('largest_methods', [(m['method'], m['arena_bytes'])
+                           for m in by_memory[:TOP_METHODS]]),
+  ])
+
+
+def PrintSummary(summary):
+  """Prints a human readable summary for one instruction set."""
+  print('=== {0}: {1} methods, {2:.1f} methods/s (stdev {3:.3f}s), '
+        'dex2oat {4:.2f}s'.format(summary['isa'],
+                                  summary['methods'],
+                                  summary['methods_per_second'],
+                                  summary['compile_seconds_stdev'],
+                                  summary['dex2oat_wall_seconds_median']))
+  print('Peak arena memory: {0} bytes, code size: {1} bytes'.format(
+      summary['peak_arena_bytes'], summary['total_code_size']))
+  total = summary['compile_seconds_median']
+  print('Passes:')
+  for pass_name, seconds in sorted(summary['pass_seconds'].items(),
+                                   key=lambda item: item[1], reverse=True):
+    print('  {0:40} {1:8.3f}s {2:5.1f}%'.format(
+        pass_name, seconds, 100.0 * seconds / total if total else 0.0))
+  print('Slowest methods (ns):')
+  for method, value in summary['slowest_methods']:
+    print('  {0:12} {1}'.format(value, method))
+  print('Largest methods (arena bytes):')
+  for method, value in summary['largest_methods']:
+    print('  {0:12} {1}'.format(value, method))
+
+
+def ParseArgs():
+  """Parses command line arguments."""
+  parser = argparse.ArgumentParser(
+      description='Measure optimizing compiler throughput.')
+  parser.add_argument('--isa', action='append', choices=ALL_ISAS,
+                      help='instruction set to benchmark, may be repeated '
+                           '(default: the host instruction sets, {0})'.format(
+                               ', '.join(HOST_ISAS)))
+  parser.add_argument('--dex-file', action='append',
+                      help='dex file to compile, may be repeated '
+                           '(default: art-gtest-*.jar from ANDROID_HOST_OUT)')
+  parser.add_argument('--no-stress', action='store_true',
+                      help='do not add the synthetic stress methods')
+  parser.add_argument('--boot-image',
+                      help='boot image location (default: core.art in '
+                           'ANDROID_HOST_OUT/framework)')
+  parser.add_argument('--dex2oat', default='dex2oat',
+                      help='dex2oat binary (default: dex2oat)')
+  parser.add_argument('--repetitions', type=int, default=3,
+                      help='number of times to compile the corpus per isa')
+  parser.add_argument('--json', help='write the results to this JSON file')
+  parser.add_argument('--dex2oat-arg', action='append', default=[],
+                      help='additional dex2oat argument, may be repeated')
+  return parser.parse_args()
+
+
+def main():
+  args = ParseArgs()
+  if args.repetitions < 1:
+    raise FatalError('--repetitions must be positive.')
+  env = HostTestEnv('compiler_benchmark_', x64=True, timeout=3600)
+  boot_image = args.boot_image
+  if boot_image is None:
+    boot_image = os.path.join(GetEnvVariableOrError('ANDROID_HOST_OUT'),
+                              'framework', 'core.art')
+  dex_files = args.dex_file if args.dex_file else DefaultCorpus()
+  if not args.no_stress:
+    dex_files = dex_files + [BuildStressDex(env)]
+  summaries = []
+  for isa in args.isa if args.isa else HOST_ISAS:
+    runs = [CompileCorpus(env, args.dex2oat, isa, boot_image, dex_files,
+                          args.dex2oat_arg)
+            for _ in range(args.repetitions)]
+    summary = Summarize(isa, runs)
+    PrintSummary(summary)
+    summaries.append(summary)
+  if args.json:
+    with open(args.json, 'w') as f:
+      json.dump(summaries, f, indent=2)
+
+
+if __name__ == '__main__':
+  main()